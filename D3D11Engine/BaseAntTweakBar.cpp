@@ -3,6 +3,8 @@
 #include "BaseGraphicsEngine.h"
 #include "GSky.h"
 #include "zCMaterial.h"
+#include "VobPool.h"
+#include "WorldClusterCulling.h"
 
 #pragma comment(lib, "AntTweakBar.lib")
 
@@ -93,13 +95,30 @@ XRESULT BaseAntTweakBar::Init() {
     TwAddButton( Bar_General, "Save ZEN-Resources", (TwButtonCallback)SaveZENResourcesCallback, this, nullptr );
     TwAddButton( Bar_General, "Load ZEN-Resources", (TwButtonCallback)LoadZENResourcesCallback, this, nullptr );
     TwAddButton( Bar_General, "Open Settings Dialog", (TwButtonCallback)OpenSettingsCallback, this, nullptr );
+#ifndef PUBLIC_RELEASE
+    // Developer tools, not meant for players
+    TwAddButton( Bar_General, "Benchmark vob collection", (TwButtonCallback)VobCollectionBenchmarkCallback, this, nullptr );
+    TwDefine( " General/'Benchmark vob collection' help='Times collecting 50000 synthetic vobs through heap objects and through the vob pool and writes the result to the log' " );
+    TwAddButton( Bar_General, "Benchmark logging", (TwButtonCallback)LogBenchmarkCallback, this, nullptr );
+    TwDefine( " General/'Benchmark logging' help='Times the cost of a log call on the calling thread and writes the result to the log' " );
+    TwAddButton( Bar_General, "Record camera path", (TwButtonCallback)RecordCameraPathCallback, this, nullptr );
+    TwDefine( " General/'Record camera path' help='Starts recording the camera for the cluster culling replay. Press again to stop and save the path for the current world' " );
+    TwAddButton( Bar_General, "Replay camera path", (TwButtonCallback)ReplayCameraPathCallback, this, nullptr );
+    TwDefine( " General/'Replay camera path' help='Culls the world mesh clusters from every recorded camera of the current world and writes the culled clusters and triangles to the log' " );
+#endif
 
     TwAddVarRW( Bar_General, "Enable DebugLog", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.EnableDebugLog, nullptr );
+    for ( int i = 0; i < LC_NUM_CHANNELS; i++ ) {
+        std::string name = std::string( "LogLevel " ) + LogChannelNames[i];
+        TwAddVarRW( Bar_General, name.c_str(), TW_TYPE_INT32, &LogChannelLevels[i], "min=0 max=3" );
+        TwDefine( (" General/'" + name + "' help='Lowest level written to the log for this channel. 0 = Info, 1 = Warning, 2 = Error, 3 = Nothing' ").c_str() );
+    }
     TwAddVarRW( Bar_General, "DisableRendering", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.DisableRendering, nullptr );
     TwAddVarRW( Bar_General, "Draw VOBs", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.DrawVOBs, nullptr );
     TwAddVarRW( Bar_General, "Draw Dynamic Vobs", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.DrawDynamicVOBs, nullptr );
     TwAddVarRW( Bar_General, "Draw WorldMesh", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererSettings.DrawWorldMesh, nullptr );
     TwAddVarRW( Bar_General, "Draw Skeletal Meshes", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.DrawSkeletalMeshes, nullptr );
+    TwAddVarRW( Bar_General, "Skeletal Mesh Instancing", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.EnableSkeletalMeshInstancing, nullptr );
     TwAddVarRW( Bar_General, "Draw Mobs", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.DrawMobs, nullptr );
     TwAddVarRW( Bar_General, "Draw ParticleEffects", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.DrawParticleEffects, nullptr );
     //TwAddVarRW(Bar_General, "Draw Sky", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.DrawSky, nullptr);
@@ -116,6 +135,10 @@ XRESULT BaseAntTweakBar::Init() {
 
     TwAddVarRW( Bar_General, "SMAA", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.EnableSMAA, nullptr );
     TwAddVarRW( Bar_General, "Sharpen", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererSettings.SharpenFactor, nullptr );
+    TwAddVarRW( Bar_General, "SMAA Predication", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.SMAAPredication, nullptr );
+    TwAddVarRW( Bar_General, "SMAA T2x", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.EnableSMAAT2x, nullptr );
+    TwAddVarRW( Bar_General, "SMAA Stats", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.LogSMAAStats, nullptr );
+    TwDefine( " General/'SMAA Stats' help='Times each SMAA pass and logs the averages to the PostFX channel every 600 frames' " );
     TwDefine( " General/Sharpen  step=0.01 min=0" );
 
     TwAddVarRW( Bar_General, "DynamicLighting", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.EnableDynamicLighting, nullptr );
@@ -149,6 +172,12 @@ XRESULT BaseAntTweakBar::Init() {
     TwAddVarRW( Bar_General, "WorldShadowRangeScale", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererSettings.WorldShadowRangeScale, nullptr );
     TwDefine( " General/WorldShadowRangeScale  step=0.01 min=0" );
 
+    TwAddVarRW( Bar_General, "NumShadowCascades", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererSettings.NumShadowCascades, nullptr );
+    TwDefine( " General/NumShadowCascades  min=1 max=4" );
+    TwAddVarRW( Bar_General, "ShadowCascadeSplitLambda", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererSettings.ShadowCascadeSplitLambda, nullptr );
+    TwDefine( " General/ShadowCascadeSplitLambda  step=0.01 min=0 max=1" );
+    TwAddVarRW( Bar_General, "ShadowCascadeAlternateUpdates", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.ShadowCascadeAlternateUpdates, nullptr );
+
     TwAddVarRW( Bar_General, "ShadowStrength", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererSettings.ShadowStrength, nullptr );
     TwDefine( " General/ShadowStrength  step=0.01 min=0" );
 
@@ -183,6 +212,34 @@ XRESULT BaseAntTweakBar::Init() {
 
     TwAddVarRW( Bar_General, "OutdoorSmallVobRadius", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererSettings.OutdoorSmallVobDrawRadius, nullptr );
     TwAddVarRW( Bar_General, "SkeletalMeshDrawRadius", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererSettings.SkeletalMeshDrawRadius, nullptr );
+    TwAddVarRW( Bar_General, "SkeletalLOD", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.EnableSkeletalLOD, nullptr );
+    TwAddVarRW( Bar_General, "SkeletalLOD1ScreenSize", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererSettings.SkeletalLOD1ScreenSize, nullptr );
+    TwDefine( " General/SkeletalLOD1ScreenSize  step=0.01 min=0 max=1 help='Models covering less of the screen height than this use the first reduced LOD' " );
+    TwAddVarRW( Bar_General, "SkeletalLOD2ScreenSize", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererSettings.SkeletalLOD2ScreenSize, nullptr );
+    TwDefine( " General/SkeletalLOD2ScreenSize  step=0.01 min=0 max=1 help='Models covering less of the screen height than this use the coarsest LOD' " );
+    TwAddVarRW( Bar_General, "SkeletalLODPoseInterval", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererSettings.SkeletalLODPoseInterval, nullptr );
+    TwDefine( " General/SkeletalLODPoseInterval  min=1 max=16 help='Frames between pose updates of models on the coarsest LOD' " );
+    TwAddVarRW( Bar_General, "VertexCompression", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.EnableVertexCompression, nullptr );
+    TwDefine( " General/VertexCompression  help='Store static vob meshes with 16-bit positions, normals and texcoords. Applies to visuals loaded afterwards.' " );
+    TwAddVarRW( Bar_General, "WorldMeshClusterCulling", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.EnableWorldMeshClusterCulling, nullptr );
+    TwDefine( " General/WorldMeshClusterCulling  help='Skip clusters of the world mesh which are outside the view, facing away or too far away' " );
+    TwAddVarRW( Bar_General, "ConstantBufferRing", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.EnableConstantBufferRing, nullptr );
+    TwDefine( " General/ConstantBufferRing  help='Put constantbuffer updates into a few large shared buffers. Has no effect if the GPU does not support binding them by offset.' " );
+    TwAddVarRW( Bar_General, "HUDBatching", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.EnableHUDBatching, nullptr );
+    TwDefine( " General/HUDBatching  help='Draw consecutive HUD elements sharing texture and states with a single drawcall' " );
+    TwAddVarRW( Bar_General, "TextureCompression", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.EnableTextureCompression, nullptr );
+    TwDefine( " General/TextureCompression  help='Store world textures block compressed to save video memory. Applies to textures loaded afterwards.' " );
+    TwAddVarRW( Bar_General, "CPUMipMaps", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.EnableCPUMipMapGeneration, nullptr );
+    TwDefine( " General/CPUMipMaps  help='Generate texture mipmaps on the loading threads instead of the GPU. Applies to textures loaded afterwards.' " );
+    TwAddVarRW( Bar_General, "MipMapFilter", TwDefineEnumFromString( "MipMapFilterEnum", "0 {Box}, 1 {Kaiser}" ), &Engine::GAPI->GetRendererState().RendererSettings.MipMapFilter, nullptr );
+    TwAddVarRW( Bar_General, "VideoMemoryBudgetMB", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererSettings.VideoMemoryBudgetMB, "min=0 step=64" );
+    TwDefine( " General/VideoMemoryBudgetMB  help='Least recently used textures lose their top mips when the renderer needs more video memory than this. 0 uses most of the adapter memory.' " );
+    TwAddVarRW( Bar_General, "WorldSectionStreaming", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.EnableWorldSectionStreaming, nullptr );
+    TwDefine( " General/WorldSectionStreaming  help='Only keep the world sections around the camera in video memory. Sections outside the radius neither draw nor cast shadows.' " );
+    TwAddVarRW( Bar_General, "SectionStreamingRadius", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererSettings.SectionStreamingRadius, "min=1" );
+    TwDefine( " General/SectionStreamingRadius  help='Sections closer than this are uploaded. Never smaller than the SectionDrawRadius.' " );
+    TwAddVarRW( Bar_General, "SectionStreamingHysteresis", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererSettings.SectionStreamingHysteresis, "min=0" );
+    TwDefine( " General/SectionStreamingHysteresis  help='How many sections beyond the streaming radius a section stays uploaded, so it does not reload when walking along a section border' " );
 
     TwAddVarRW( Bar_General, "VisualFXDrawRadius", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererSettings.VisualFXDrawRadius, nullptr );
 
@@ -231,6 +288,14 @@ XRESULT BaseAntTweakBar::Init() {
     TwDefine( " General/HDRMiddleGray  step=0.01" );
     TwDefine( " General/HDRMiddleGray" );
 
+    TwAddVarRW( Bar_General, "HDRLumLowPercentile", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererSettings.HDRLumLowPercentile, nullptr );
+    TwDefine( " General/HDRLumLowPercentile  step=0.01 min=0 max=1" );
+    TwDefine( " General/HDRLumLowPercentile  help='Darkest share of the pixels which is ignored for the exposure. Needs compute shaders.' " );
+
+    TwAddVarRW( Bar_General, "HDRLumHighPercentile", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererSettings.HDRLumHighPercentile, nullptr );
+    TwDefine( " General/HDRLumHighPercentile  step=0.01 min=0 max=1" );
+    TwDefine( " General/HDRLumHighPercentile  help='Pixels brighter than this share are ignored for the exposure. Needs compute shaders.' " );
+
     TwAddVarRW( Bar_General, "BloomThreshold", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererSettings.BloomThreshold, nullptr );
     TwDefine( " General/BloomThreshold  step=0.01" );
     TwDefine( " General/BloomThreshold" );
@@ -239,6 +304,17 @@ XRESULT BaseAntTweakBar::Init() {
     TwDefine( " General/BloomStrength  step=0.01" );
     TwDefine( " General/BloomStrength" );
 
+    TwAddVarRW( Bar_General, "BloomQuality", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererSettings.BloomQuality, nullptr );
+    TwDefine( " General/BloomQuality  min=0 max=2" );
+    TwDefine( " General/BloomQuality  help='Lower tiers skip the smallest levels of the bloom chain. Narrower, but cheaper.' " );
+
+    TwAddVarRW( Bar_General, "PostFXFusion", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererSettings.PostFXFusion, nullptr );
+    TwDefine( " General/PostFXFusion  min=0 max=2" );
+    TwDefine( " General/PostFXFusion  help='With HDR, 1 adds the godrays in the final composite and 2 also the heightfog, instead of extra fullscreen passes. Fused effects are drawn over particles and polystrips as well, 0 keeps the original look.' " );
+
+    TwAddVarRW( Bar_General, "ColorGrading", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.EnableColorGrading, nullptr );
+    TwDefine( " General/ColorGrading  help='Grades the image with system/GD3D11/Textures/ColorGrading.dds, a 256x16 LUT. Needs HDR.' " );
+
     TwAddVarRW( Bar_General, "WindStrength", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererSettings.GlobalWindStrength, nullptr );
     TwDefine( " General/WindStrength  step=0.01" );
 
@@ -268,6 +344,42 @@ XRESULT BaseAntTweakBar::Init() {
     TwAddVarRO( Bar_Info, "DrawnLights", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.FrameDrawnLights, nullptr );
     TwAddVarRO( Bar_Info, "SectionsDrawn", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.FrameNumSectionsDrawn, nullptr );
     TwAddVarRO( Bar_Info, "WorldMeshDrawCalls", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.WorldMeshDrawCalls, nullptr );
+    TwAddVarRO( Bar_Info, "ShadowCascadesRendered", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.FrameShadowCascadesRendered, nullptr );
+    TwAddVarRO( Bar_Info, "ShadowCastersCulled", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.FrameShadowCastersCulled, nullptr );
+    TwAddVarRO( Bar_Info, "SkeletalInstanceBatches", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.FrameSkeletalInstanceBatches, nullptr );
+    TwAddVarRO( Bar_Info, "SkeletalDrawCallsSaved", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.FrameSkeletalDrawCallsSaved, nullptr );
+    TwAddVarRO( Bar_Info, "SkeletalLOD0", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.FrameSkeletalLOD0, nullptr );
+    TwAddVarRO( Bar_Info, "SkeletalLOD1", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.FrameSkeletalLOD1, nullptr );
+    TwAddVarRO( Bar_Info, "SkeletalLOD2", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.FrameSkeletalLOD2, nullptr );
+    TwAddVarRO( Bar_Info, "SkeletalPoseUpdatesSkipped", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.FrameSkeletalPoseUpdatesSkipped, nullptr );
+    TwAddVarRO( Bar_Info, "WorldClustersDrawn", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.FrameWorldClustersDrawn, nullptr );
+    TwAddVarRO( Bar_Info, "WorldClustersCulled", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.FrameWorldClustersCulled, nullptr );
+    TwAddVarRO( Bar_Info, "WorldTrianglesCulled", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.FrameWorldTrianglesCulled, nullptr );
+    TwAddVarRO( Bar_Info, "CBMaps", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.FrameConstantBufferMaps, nullptr );
+    TwAddVarRO( Bar_Info, "CBBytes", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.FrameConstantBufferBytes, nullptr );
+    TwAddVarRO( Bar_Info, "CBUpdatesSkipped", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.FrameConstantBufferUpdatesSkipped, nullptr );
+    TwAddVarRO( Bar_Info, "HUDDrawCalls", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.FrameHUDDrawCalls, nullptr );
+    TwAddVarRO( Bar_Info, "HUDBatches", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.FrameHUDBatches, nullptr );
+    TwAddVarRO( Bar_Info, "VRAM_TotalMB", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.VideoMemoryTotalMB, nullptr );
+    TwAddVarRO( Bar_Info, "VRAM_BudgetMB", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.VideoMemoryBudgetMB, nullptr );
+    TwAddVarRO( Bar_Info, "VRAM_WorldMB", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.VideoMemoryWorldMB, nullptr );
+    TwAddVarRO( Bar_Info, "VRAM_VobsMB", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.VideoMemoryVobsMB, nullptr );
+    TwAddVarRO( Bar_Info, "VRAM_TexturesMB", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.VideoMemoryTexturesMB, nullptr );
+    TwAddVarRO( Bar_Info, "VRAM_ShadowMapsMB", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.VideoMemoryShadowMapsMB, nullptr );
+    TwAddVarRO( Bar_Info, "VRAM_RenderTargetsMB", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.VideoMemoryRenderTargetsMB, nullptr );
+    TwAddVarRO( Bar_Info, "VRAM_MipsEvicted", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.VideoMemoryMipsEvicted, nullptr );
+    TwAddVarRO( Bar_Info, "VRAM_TexturesRestored", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.VideoMemoryTexturesRestored, nullptr );
+    TwAddVarRO( Bar_Info, "VRAM_WorldPeakMB", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.VideoMemoryWorldPeakMB, nullptr );
+    TwAddVarRO( Bar_Info, "VRAM_TotalPeakMB", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.VideoMemoryTotalPeakMB, nullptr );
+    TwAddVarRO( Bar_Info, "SectionsResident", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.WorldSectionsResident, nullptr );
+    TwAddVarRO( Bar_Info, "SectionsUploaded", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.WorldSectionsUploaded, nullptr );
+    TwAddVarRO( Bar_Info, "SectionsEvicted", TW_TYPE_INT32, &Engine::GAPI->GetRendererState().RendererInfo.WorldSectionsEvicted, nullptr );
+    TwAddVarRO( Bar_Info, "FrameTimeP50", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererInfo.FrameTimeP50MS, nullptr );
+    TwAddVarRO( Bar_Info, "FrameTimeP95", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererInfo.FrameTimeP95MS, nullptr );
+    TwAddVarRO( Bar_Info, "FrameTimeP99", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererInfo.FrameTimeP99MS, nullptr );
+    TwAddVarRO( Bar_Info, "FrameJitter", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererInfo.FrameJitterMS, nullptr );
+    TwAddVarRO( Bar_Info, "PacingError", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererInfo.FramePacingErrorMS, nullptr );
+    TwAddVarRO( Bar_Info, "LimiterSpinPercent", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererInfo.FrameLimiterSpinPercent, nullptr );
 
     TwAddVarRO( Bar_Info, "FarPlane", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererInfo.FarPlane, nullptr );
     TwAddVarRO( Bar_Info, "NearPlane", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererInfo.NearPlane, nullptr );
@@ -297,42 +409,37 @@ XRESULT BaseAntTweakBar::Init() {
     TwAddVarRO( Bar_Info, "SC_SamplerState,", TW_TYPE_UINT32, &Engine::GAPI->GetRendererState().RendererInfo.StateChangesByState[GothicRendererInfo::SC_SMPL], nullptr );
     TwAddVarRO( Bar_Info, "SC_BlendState,", TW_TYPE_UINT32, &Engine::GAPI->GetRendererState().RendererInfo.StateChangesByState[GothicRendererInfo::SC_BS], nullptr );
 
-    Bar_HBAO = TwNewBar( "HBAO+" );
-    TwDefine( " HBAO+ position='1000 0'" );
+    Bar_HBAO = TwNewBar( "HBAO" );
+    TwDefine( " HBAO position='1000 0'" );
 
     /** --- hbao  --- */
-    TwAddVarRW( Bar_HBAO, "Enable HBAO+", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.HbaoSettings.Enabled, nullptr );
+    TwAddVarRW( Bar_HBAO, "Enable HBAO", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.HbaoSettings.Enabled, nullptr );
+
+    TwType hbaoQualityType = TwDefineEnumFromString( "HBAOQualityEnum", "0 {Low}, 1 {Medium}, 2 {High}, 3 {Ultra}" );
+    TwAddVarRW( Bar_HBAO, "Quality", hbaoQualityType, &Engine::GAPI->GetRendererState().RendererSettings.HbaoSettings.QualityTier, nullptr );
+
+    TwAddVarRW( Bar_HBAO, "Temporal", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.HbaoSettings.EnableTemporal, nullptr );
 
     TwAddVarRW( Bar_HBAO, "Radius", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererSettings.HbaoSettings.Radius, nullptr );
-    TwDefine( " HBAO+/Radius  step=0.01 min=0 " );
+    TwDefine( " HBAO/Radius  step=0.01 min=0 " );
 
     TwAddVarRW( Bar_HBAO, "MetersToViewSpaceUnits", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererSettings.HbaoSettings.MetersToViewSpaceUnits, nullptr );
-    TwDefine( " HBAO+/MetersToViewSpaceUnits  step=0.01 min=0 " );
+    TwDefine( " HBAO/MetersToViewSpaceUnits  step=0.01 min=0 " );
 
     TwAddVarRW( Bar_HBAO, "PowerExponent", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererSettings.HbaoSettings.PowerExponent, nullptr );
-    TwDefine( " HBAO+/PowerExponent  step=0.01 min=1.0 max=4.0 " );
+    TwDefine( " HBAO/PowerExponent  step=0.01 min=1.0 max=4.0 " );
 
     TwAddVarRW( Bar_HBAO, "Bias", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererSettings.HbaoSettings.Bias, nullptr );
-    TwDefine( " HBAO+/Bias  step=0.01 min=0.0 max=0.5 " );
+    TwDefine( " HBAO/Bias  step=0.01 min=0.0 max=0.5 " );
 
     TwAddVarRW( Bar_HBAO, "Enable Blur", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.HbaoSettings.EnableBlur, nullptr );
 
-    TwEnumVal hbaoBlurRadii[] = { {0, "2"}, {1, "4"} };
-    TwType hbaoBlurRadiiType = TwDefineEnum( "GFSDK_SSAO_BLUR_RADIUS", hbaoBlurRadii, 2 );
-    TwAddVarRW( Bar_HBAO, "SSAO radius", hbaoBlurRadiiType, &Engine::GAPI->GetRendererState().RendererSettings.HbaoSettings.SsaoBlurRadius, nullptr );
-
     TwAddVarRW( Bar_HBAO, "BlurSharpness", TW_TYPE_FLOAT, &Engine::GAPI->GetRendererState().RendererSettings.HbaoSettings.BlurSharpness, nullptr );
-    TwDefine( " HBAO+/BlurSharpness  step=0.01" );
+    TwDefine( " HBAO/BlurSharpness  step=0.01" );
 
     TwType tbm = TwDefineEnumFromString( "BlendModeEnum", "0 {Replace}, 1 {Multiply}" );
     TwAddVarRW( Bar_HBAO, "BlendMode", tbm, &Engine::GAPI->GetRendererState().RendererSettings.HbaoSettings.BlendMode, nullptr );
 
-    //TwAddVarRW( Bar_HBAO, "DualLayerAO", TW_TYPE_BOOLCPP, &Engine::GAPI->GetRendererState().RendererSettings.HbaoSettings.EnableDualLayerAO, nullptr );
-
-    TwEnumVal hbaoStepCounts[] = { {0, "4"}, {1, "8"} };
-    TwType hbaoStepCountType = TwDefineEnum( "GFSDK_SSAO_STEP_COUNT", hbaoStepCounts, 2 );
-    TwAddVarRW( Bar_HBAO, "SSAO steps", hbaoStepCountType, &Engine::GAPI->GetRendererState().RendererSettings.HbaoSettings.SsaoStepCount, nullptr );
-
     Bar_ShaderMakros = TwNewBar( "ShaderMakros" );
     TwDefine( " ShaderMakros position='1200 0'" );
 
@@ -525,6 +632,24 @@ void TW_CALL BaseAntTweakBar::OpenSettingsCallback( void* clientdata ) {
     Engine::GraphicsEngine->OnUIEvent( BaseGraphicsEngine::EUIEvent::UI_OpenSettings );
 }
 
+#ifndef PUBLIC_RELEASE
+void TW_CALL BaseAntTweakBar::VobCollectionBenchmarkCallback( void* clientdata ) {
+    VobPool::RunCollectionBenchmark();
+}
+
+void TW_CALL BaseAntTweakBar::LogBenchmarkCallback( void* clientdata ) {
+    LogWriter::RunProducerBenchmark();
+}
+
+void TW_CALL BaseAntTweakBar::RecordCameraPathCallback( void* clientdata ) {
+    WorldClusterCulling::SetRecording( !WorldClusterCulling::IsRecording() );
+}
+
+void TW_CALL BaseAntTweakBar::ReplayCameraPathCallback( void* clientdata ) {
+    WorldClusterCulling::ReplayPath();
+}
+#endif
+
 /** Resizes the anttweakbar */
 XRESULT BaseAntTweakBar::OnResize( INT2 newRes ) {
     TwWindowSize( newRes.x, newRes.y );
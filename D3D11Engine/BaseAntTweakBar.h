@@ -60,6 +60,20 @@ protected:
     /** Called on load ZEN resources */
     static void TW_CALL OpenSettingsCallback( void* clientdata );
 
+#ifndef PUBLIC_RELEASE
+    /** Called on "Benchmark vob collection"-Buttonpress */
+    static void TW_CALL VobCollectionBenchmarkCallback( void* clientdata );
+
+    /** Called on "Benchmark logging"-Buttonpress */
+    static void TW_CALL LogBenchmarkCallback( void* clientdata );
+
+    /** Called on "Record camera path"-Buttonpress */
+    static void TW_CALL RecordCameraPathCallback( void* clientdata );
+
+    /** Called on "Replay camera path"-Buttonpress */
+    static void TW_CALL ReplayCameraPathCallback( void* clientdata );
+#endif
+
     /** Tweak bars */
     TwBar* Bar_Sky;
 
@@ -134,12 +134,21 @@ public:
     virtual XRESULT DrawVertexBufferFF( D3D11VertexBuffer* vb, unsigned int numVertices, unsigned int startVertex, unsigned int stride = sizeof( ExVertexStruct ) ) { return XR_SUCCESS; };
 
     /** Draws a vertexbuffer, non-indexed */
-    virtual XRESULT DrawVertexBufferIndexed( D3D11VertexBuffer* vb, D3D11VertexBuffer* ib, unsigned int numIndices, unsigned int indexOffset = 0 ) { return XR_SUCCESS; };
+    virtual XRESULT DrawVertexBufferIndexed( D3D11VertexBuffer* vb, D3D11VertexBuffer* ib, unsigned int numIndices, unsigned int indexOffset = 0, unsigned int vertexStride = sizeof( ExVertexStruct ) ) { return XR_SUCCESS; };
     virtual XRESULT DrawVertexBufferIndexedUINT( D3D11VertexBuffer* vb, D3D11VertexBuffer* ib, unsigned int numIndices, unsigned int indexOffset ) { return XR_SUCCESS; };
 
     /** Draws a skeletal mesh */
     virtual XRESULT DrawSkeletalMesh( SkeletalVobInfo* vi, const std::vector<XMFLOAT4X4>& transforms, float4 color, float fatness = 1.0f ) { return XR_SUCCESS; };
 
+    /** Starts collecting skeletal meshes, so instances of the same visual can be drawn together */
+    virtual void BeginSkeletalMeshInstancing() {};
+
+    /** Draws all collected skeletal meshes */
+    virtual void FlushSkeletalMeshInstances() {};
+
+    /** Draws all queued HUD geometry. Must be called before anything else gets drawn or textures change. */
+    virtual void FlushHUDBatch() {};
+
     /** Draws a vertexarray, non-indexed */
     virtual XRESULT DrawIndexedVertexArray( ExVertexStruct* vertices, unsigned int numVertices, D3D11VertexBuffer* ib, unsigned int numIndices, unsigned int stride = sizeof( ExVertexStruct ) ) { return XR_SUCCESS; };
 
@@ -122,6 +122,22 @@ struct LumAdaptConstantBuffer {
     float3 LC_Pad;
 };
 
+struct LumHistogramConstantBuffer {
+    float LH_MinLog2Luminance;
+    float LH_Log2LuminanceRange;
+    float LH_MinLuminance;
+    float LH_MaxAdaptedLuminance;
+
+    float LH_LowPercentile;
+    float LH_HighPercentile;
+    float LH_DeltaTime;
+    float LH_AdaptionRate;
+
+    UINT LH_Width;
+    UINT LH_Height;
+    float2 LH_Pad;
+};
+
 struct GodRayZoomConstantBuffer {
     float GR_Decay;
     float GR_Weight;
@@ -138,6 +154,34 @@ struct HDRSettingsConstantBuffer {
     float HDR_BloomStrength;
 };
 
+struct HBAOConstantBuffer {
+    /** cos, sin and step offset of each slot of the interleaved pattern */
+    float4 AO_Jitter[16];
+
+    /** Maps a view-space position of this frame into clip-space of the last one */
+    XMFLOAT4X4 AO_ViewToPrevClip;
+
+    /** x and y scale of the projection, and z/w = z + w / viewZ */
+    float4 AO_ProjParams;
+
+    float2 AO_InvSize;
+    float2 AO_Size;
+
+    float2 AO_FullSize;
+    float AO_RadiusToScreen;
+    float AO_NegInvRadius2;
+
+    float AO_Bias;
+    float AO_PowerExponent;
+    int AO_NumDirections;
+    int AO_NumSteps;
+
+    float AO_BlurSharpness;
+    float AO_UpsampleRadius;
+    float AO_HistoryValid;
+    float AO_Pad;
+};
+
 struct ViewportInfoConstantBuffer {
     float2 VPI_ViewportSize;
     float2 VPI_pad;
@@ -162,6 +206,9 @@ struct DS_PointLightConstantBuffer {
     float PL_Pad3;
 };
 
+/** Maximum number of cascades of the sun shadowmap */
+const int MAX_SHADOW_CASCADES = 4;
+
 struct DS_ScreenQuadConstantBuffer {
     XMFLOAT4X4 SQ_InvProj; // Optimize out!
     XMFLOAT4X4 SQ_InvView;
@@ -186,6 +233,11 @@ struct DS_ScreenQuadConstantBuffer {
     float SQ_ShadowAOStrength;
     float SQ_WorldAOStrength;
     float SQ_Pad;
+
+    XMFLOAT4X4 SQ_CascadeViewProj[MAX_SHADOW_CASCADES];
+    float SQ_CascadeBias[MAX_SHADOW_CASCADES];
+    float SQ_NumShadowCascades;
+    float3 SQ_CascadePad;
 };
 
 struct CloudConstantBuffer {
@@ -241,6 +293,27 @@ struct VS_ExConstantBuffer_PerInstanceSkeletal {
     float3 PI_Pad1;
 };
 
+/** Per-instance data of an instanced skeletal mesh, read from a structured buffer */
+struct SkeletalMeshInstanceInfo {
+    XMFLOAT4X4 World;
+    float4 ModelColor;
+    float ModelFatness;
+    UINT BoneOffset;
+    float2 Pad;
+};
+
+struct VS_ExConstantBuffer_SkeletalInstancing {
+    UINT SI_InstanceOffset;
+    UINT SI_Pad[3];
+};
+
+/** Dequantization parameters for ExVertexStructCompressed */
+struct VS_ExConstantBuffer_VertexDecode {
+    float4 VD_PositionScale;
+    float4 VD_PositionOffset;
+    float4 VD_TexCoordScaleOffset;
+};
+
 struct ScreenFadeConstantBuffer {
     float GA_Alpha;
     float3 GA_Pad;
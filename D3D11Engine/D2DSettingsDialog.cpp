@@ -135,8 +135,8 @@ XRESULT D2DSettingsDialog::InitControls() {
 	SV_Checkbox* hbaoCheckbox = new SV_Checkbox( MainView, MainPanel );
 	hbaoCheckbox->SetSize( D2D1::SizeF( 160, 20 ) );
     switch ( userLanguage ) {
-    case LANGUAGE_POLISH: hbaoCheckbox->SetCaption( L"HBAO+" ); break;
-    default: hbaoCheckbox->SetCaption( L"Enable HBAO+" ); break;
+    case LANGUAGE_POLISH: hbaoCheckbox->SetCaption( L"HBAO" ); break;
+    default: hbaoCheckbox->SetCaption( L"Enable HBAO" ); break;
     }
 	hbaoCheckbox->SetDataToUpdate( &Engine::GAPI->GetRendererState().RendererSettings.HbaoSettings.Enabled );
 	hbaoCheckbox->AlignUnder( numpadCheckbox, 5 );
@@ -4,85 +4,204 @@
 #include "Engine.h"
 #include "GothicAPI.h"
 
-D3D11ConstantBuffer::D3D11ConstantBuffer( int size, void* data ) {
-    D3D11GraphicsEngineBase* engine = reinterpret_cast<D3D11GraphicsEngineBase*>(Engine::GraphicsEngine);
+/** Sets/gets one constantbuffer slot of a stage, with the offset for slices of the ring */
+static void SetStageConstantBuffer( ID3D11DeviceContext1* context, int stage, UINT slot, ID3D11Buffer* buffer, const UINT* first, const UINT* num ) {
+    switch ( stage ) {
+    case 0: context->VSSetConstantBuffers1( slot, 1, &buffer, first, num ); break;
+    case 1: context->PSSetConstantBuffers1( slot, 1, &buffer, first, num ); break;
+    case 2: context->DSSetConstantBuffers1( slot, 1, &buffer, first, num ); break;
+    case 3: context->HSSetConstantBuffers1( slot, 1, &buffer, first, num ); break;
+    case 4: context->GSSetConstantBuffers1( slot, 1, &buffer, first, num ); break;
+    case 5: context->CSSetConstantBuffers1( slot, 1, &buffer, first, num ); break;
+    }
+}
 
-    char* dd = reinterpret_cast<char*>(data);
+static void GetStageConstantBuffer( ID3D11DeviceContext1* context, int stage, UINT slot, ID3D11Buffer** buffer, UINT* first, UINT* num ) {
+    switch ( stage ) {
+    case 0: context->VSGetConstantBuffers1( slot, 1, buffer, first, num ); break;
+    case 1: context->PSGetConstantBuffers1( slot, 1, buffer, first, num ); break;
+    case 2: context->DSGetConstantBuffers1( slot, 1, buffer, first, num ); break;
+    case 3: context->HSGetConstantBuffers1( slot, 1, buffer, first, num ); break;
+    case 4: context->GSGetConstantBuffers1( slot, 1, buffer, first, num ); break;
+    case 5: context->CSGetConstantBuffers1( slot, 1, buffer, first, num ); break;
+    }
+}
+
+D3D11ConstantBuffer::D3D11ConstantBuffer( int size, void* data, bool transient ) {
+    D3D11GraphicsEngineBase* engine = reinterpret_cast<D3D11GraphicsEngineBase*>(Engine::GraphicsEngine);
 
-    if ( !dd ) {
-        dd = new char[size];
-        ZeroMemory( dd, size );
+    ShadowData.resize( size );
+    if ( data ) {
+        memcpy( &ShadowData[0], data, size );
     }
 
     D3D11_SUBRESOURCE_DATA d;
-    d.pSysMem = dd;
+    d.pSysMem = &ShadowData[0];
     d.SysMemPitch = 0;
     d.SysMemSlicePitch = 0;
 
-    // Create constantbuffer
+    // Create constantbuffer. Persistent ones rarely change, so they can sit in video memory.
     HRESULT hr;
-    LE( engine->GetDevice()->CreateBuffer( &CD3D11_BUFFER_DESC( size, D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE ), &d, Buffer.GetAddressOf()));
+    if ( transient ) {
+        LE( engine->GetDevice()->CreateBuffer( &CD3D11_BUFFER_DESC( size, D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE ), &d, Buffer.GetAddressOf() ) );
+    } else {
+        LE( engine->GetDevice()->CreateBuffer( &CD3D11_BUFFER_DESC( size, D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DEFAULT ), &d, Buffer.GetAddressOf() ) );
+    }
     OriginalSize = size;
 
-    if ( !data )
-        delete[] dd;
-
     BufferDirty = false;
+    BufferUpToDate = true;
+    UploadSize = size;
+    Slice = {};
+    Transient = transient;
+    ZeroMemory( BoundSlots, sizeof( BoundSlots ) );
 }
 
 D3D11ConstantBuffer::~D3D11ConstantBuffer() {}
 
 /** Updates the buffer */
 void D3D11ConstantBuffer::UpdateBuffer( const void* data ) {
+    UpdateBuffer( data, OriginalSize );
+}
+
+void D3D11ConstantBuffer::UpdateBuffer( const void* data, UINT size ) {
+    // Nothing changed since the last upload
+    if ( size == UploadSize && memcmp( &ShadowData[0], data, size ) == 0 && IsUploaded() ) {
+        Engine::GAPI->GetRendererState().RendererInfo.FrameConstantBufferUpdatesSkipped++;
+        return;
+    }
+
+    memcpy( &ShadowData[0], data, size );
+    UploadSize = size;
+
+    ID3D11Buffer* oldBuffer = Slice.Buffer ? Slice.Buffer : Buffer.Get();
+    UINT oldFirstConstant = Slice.Buffer ? Slice.FirstConstant : 0;
+    Upload();
+
+    // The slots still point to the old slice, which doesn't have the new data
+    ID3D11Buffer* newBuffer = Slice.Buffer ? Slice.Buffer : Buffer.Get();
+    UINT newFirstConstant = Slice.Buffer ? Slice.FirstConstant : 0;
+    if ( newBuffer != oldBuffer || newFirstConstant != oldFirstConstant )
+        RebindBoundSlots( oldBuffer, oldFirstConstant );
+}
+
+/** Copies the shadow data to the GPU, into the constantbuffer ring if possible */
+void D3D11ConstantBuffer::Upload() {
     D3D11GraphicsEngineBase* engine = reinterpret_cast<D3D11GraphicsEngineBase*>(Engine::GraphicsEngine);
 
-    D3D11_MAPPED_SUBRESOURCE res;
-    if ( XR_SUCCESS == engine->GetContext()->Map( Buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &res ) ) {
-        // Copy data
-        memcpy( res.pData, data, OriginalSize );
-        engine->GetContext()->Unmap( Buffer.Get(), 0 );
+    if ( !Transient ) {
+        // Default usage buffers can only be replaced as a whole
+        engine->GetContext()->UpdateSubresource( Buffer.Get(), 0, nullptr, &ShadowData[0], 0, 0 );
 
+        BufferUpToDate = true;
         BufferDirty = true;
+
+        Engine::GAPI->GetRendererState().RendererInfo.FrameConstantBufferMaps++;
+        Engine::GAPI->GetRendererState().RendererInfo.FrameConstantBufferBytes += OriginalSize;
+        return;
     }
-}
 
-void D3D11ConstantBuffer::UpdateBuffer( const void* data, UINT size ) {
-    D3D11GraphicsEngineBase* engine = reinterpret_cast<D3D11GraphicsEngineBase*>(Engine::GraphicsEngine);
+    D3D11ConstantBufferRing* ring = engine->GetConstantBufferRing();
+    if ( ring && ring->IsActive() && ring->Allocate( &ShadowData[0], UploadSize, Slice ) ) {
+        BufferUpToDate = false;
+        BufferDirty = true;
+        return;
+    }
+
+    Slice.Buffer = nullptr;
 
     D3D11_MAPPED_SUBRESOURCE res;
     if ( XR_SUCCESS == engine->GetContext()->Map( Buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &res ) ) {
         // Copy data
-        memcpy( res.pData, data, size );
+        memcpy( res.pData, &ShadowData[0], UploadSize );
         engine->GetContext()->Unmap( Buffer.Get(), 0 );
 
+        BufferUpToDate = true;
         BufferDirty = true;
+
+        Engine::GAPI->GetRendererState().RendererInfo.FrameConstantBufferMaps++;
+        Engine::GAPI->GetRendererState().RendererInfo.FrameConstantBufferBytes += UploadSize;
+    }
+}
+
+/** Binds the new location of the data to the slots which still have the old one */
+void D3D11ConstantBuffer::RebindBoundSlots( ID3D11Buffer* oldBuffer, UINT oldFirstConstant ) {
+    ID3D11DeviceContext1* context = reinterpret_cast<D3D11GraphicsEngineBase*>(Engine::GraphicsEngine)->GetContext().Get();
+
+    ID3D11Buffer* buffer = Slice.Buffer ? Slice.Buffer : Buffer.Get();
+    for ( int stage = 0; stage < SS_NUM_STAGES; stage++ ) {
+        for ( UINT slot = 0; BoundSlots[stage] >> slot; slot++ ) {
+            if ( !(BoundSlots[stage] & (1 << slot)) )
+                continue;
+
+            // Leave the slot alone if something else got bound there in the meantime
+            Microsoft::WRL::ComPtr<ID3D11Buffer> bound;
+            UINT first = 0;
+            UINT num = 0;
+            GetStageConstantBuffer( context, stage, slot, bound.GetAddressOf(), &first, &num );
+            if ( bound.Get() != oldBuffer || first != oldFirstConstant ) {
+                BoundSlots[stage] &= ~(1 << slot);
+                continue;
+            }
+
+            SetStageConstantBuffer( context, stage, slot, buffer,
+                Slice.Buffer ? &Slice.FirstConstant : nullptr, Slice.Buffer ? &Slice.NumConstants : nullptr );
+        }
     }
 }
 
+/** Returns whether the latest shadow data is on the GPU */
+bool D3D11ConstantBuffer::IsUploaded() const {
+    if ( Slice.Buffer ) {
+        // Slices from older frames get overwritten at some point
+        D3D11ConstantBufferRing* ring = reinterpret_cast<D3D11GraphicsEngineBase*>(Engine::GraphicsEngine)->GetConstantBufferRing();
+        return ring && ring->IsActive() && ring->IsSliceValid( Slice );
+    }
+
+    return BufferUpToDate;
+}
+
+/** Makes sure the latest data is on the GPU and returns the buffer holding it */
+ID3D11Buffer* D3D11ConstantBuffer::PrepareBind() {
+    if ( !IsUploaded() )
+        Upload();
+
+    return Slice.Buffer ? Slice.Buffer : Buffer.Get();
+}
+
+/** Binds the buffer to a slot of a stage and remembers it */
+void D3D11ConstantBuffer::Bind( EShaderStage stage, int slot ) {
+    ID3D11Buffer* buffer = PrepareBind();
+    SetStageConstantBuffer( reinterpret_cast<D3D11GraphicsEngineBase*>(Engine::GraphicsEngine)->GetContext().Get(), stage, slot, buffer,
+        Slice.Buffer ? &Slice.FirstConstant : nullptr, Slice.Buffer ? &Slice.NumConstants : nullptr );
+
+    BoundSlots[stage] |= 1 << slot;
+    BufferDirty = false;
+}
+
 /** Binds the buffer */
 void D3D11ConstantBuffer::BindToVertexShader( int slot ) {
-    reinterpret_cast<D3D11GraphicsEngineBase*>(Engine::GraphicsEngine)->GetContext()->VSSetConstantBuffers( slot, 1, Buffer.GetAddressOf() );
-    BufferDirty = false;
+    Bind( SS_VERTEX, slot );
 }
 
 void D3D11ConstantBuffer::BindToPixelShader( int slot ) {
-    reinterpret_cast<D3D11GraphicsEngineBase*>(Engine::GraphicsEngine)->GetContext()->PSSetConstantBuffers( slot, 1, Buffer.GetAddressOf() );
-    BufferDirty = false;
+    Bind( SS_PIXEL, slot );
 }
 
 void D3D11ConstantBuffer::BindToDomainShader( int slot ) {
-    reinterpret_cast<D3D11GraphicsEngineBase*>(Engine::GraphicsEngine)->GetContext()->DSSetConstantBuffers( slot, 1, Buffer.GetAddressOf() );
-    BufferDirty = false;
+    Bind( SS_DOMAIN, slot );
 }
 
 void D3D11ConstantBuffer::BindToHullShader( int slot ) {
-    reinterpret_cast<D3D11GraphicsEngineBase*>(Engine::GraphicsEngine)->GetContext()->HSSetConstantBuffers( slot, 1, Buffer.GetAddressOf() );
-    BufferDirty = false;
+    Bind( SS_HULL, slot );
 }
 
 void D3D11ConstantBuffer::BindToGeometryShader( int slot ) {
-    reinterpret_cast<D3D11GraphicsEngineBase*>(Engine::GraphicsEngine)->GetContext()->GSSetConstantBuffers( slot, 1, Buffer.GetAddressOf() );
-    BufferDirty = false;
+    Bind( SS_GEOMETRY, slot );
+}
+
+void D3D11ConstantBuffer::BindToComputeShader( int slot ) {
+    Bind( SS_COMPUTE, slot );
 }
 
 /** Returns whether this buffer has been updated since the last bind */
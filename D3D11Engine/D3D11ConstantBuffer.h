@@ -1,11 +1,17 @@
 #pragma once
+#include "D3D11ConstantBufferRing.h"
 
+/** Constantbuffer with a copy of its last contents, so unchanged updates cost nothing.
+    Persistent buffers (per vob, per material, ...) live in their own default-usage buffer and are
+    only written when their data changes. Transient buffers, like the ones of the shaders which get
+    new data for every draw, go into the constantbuffer ring. Those have to be updated in every frame
+    they're used in, older slices of the ring get reused. */
 class D3D11ConstantBuffer {
 public:
-    D3D11ConstantBuffer( int size, void* data );
+    D3D11ConstantBuffer( int size, void* data, bool transient = false );
     ~D3D11ConstantBuffer();
 
-    /** Updates the buffer */
+    /** Updates the buffer. If the data moves to a new slice of the ring, the slots still holding the old one get it too. */
     void UpdateBuffer( const void* data );
     void UpdateBuffer( const void* data, UINT size );
 
@@ -15,6 +21,7 @@ public:
     void BindToDomainShader( int slot );
     void BindToHullShader( int slot );
     void BindToGeometryShader( int slot );
+    void BindToComputeShader( int slot );
 
     /** Binds the constantbuffer */
     Microsoft::WRL::ComPtr<ID3D11Buffer>& Get() { return Buffer; }
@@ -23,7 +30,49 @@ public:
     bool IsDirty();
 
 private:
+    enum EShaderStage {
+        SS_VERTEX,
+        SS_PIXEL,
+        SS_DOMAIN,
+        SS_HULL,
+        SS_GEOMETRY,
+        SS_COMPUTE,
+
+        SS_NUM_STAGES
+    };
+
+    /** Copies the shadow data to the GPU, into the constantbuffer ring if possible */
+    void Upload();
+
+    /** Binds the buffer to a slot of a stage and remembers it */
+    void Bind( EShaderStage stage, int slot );
+
+    /** Binds the new location of the data to the slots which still have the old one */
+    void RebindBoundSlots( ID3D11Buffer* oldBuffer, UINT oldFirstConstant );
+
+    /** Returns whether the latest shadow data is on the GPU */
+    bool IsUploaded() const;
+
+    /** Makes sure the latest data is on the GPU and returns the buffer holding it */
+    ID3D11Buffer* PrepareBind();
+
     Microsoft::WRL::ComPtr<ID3D11Buffer> Buffer;
     int OriginalSize; // Buffersize must be a multiple of 16
     bool BufferDirty;
+
+    /** Last data passed to UpdateBuffer, to skip uploads which wouldn't change anything */
+    std::vector<char> ShadowData;
+    UINT UploadSize;
+
+    /** Where the data lives if it went into the ring. Buffer is nullptr if it's in our own buffer. */
+    ConstantBufferSlice Slice;
+
+    /** Whether our own buffer holds the shadow data */
+    bool BufferUpToDate;
+
+    /** Whether this buffer uses the ring. Persistent ones never do. */
+    bool Transient;
+
+    /** Slots this buffer was bound to, per stage. Might be outdated, someone else could have bound something there since. */
+    UINT BoundSlots[SS_NUM_STAGES];
 };
@@ -0,0 +1,128 @@
+#include "pch.h"
+#include "D3D11ConstantBufferRing.h"
+#include "D3D11GraphicsEngineBase.h"
+#include "Engine.h"
+#include "GothicAPI.h"
+#include <string_view>
+
+/** Constantbuffer offsets must be multiples of 16 constants */
+const UINT CB_SLICE_ALIGNMENT = 256;
+
+D3D11ConstantBufferRing::D3D11ConstantBufferRing() {
+    BufferSize = 0;
+    CurrentBuffer = 0;
+    Position = 0;
+    NextGeneration = 0;
+}
+
+D3D11ConstantBufferRing::~D3D11ConstantBufferRing() {}
+
+/** Creates the buffers. Fails if the device can't bind constantbuffers by offset. */
+XRESULT D3D11ConstantBufferRing::Init( ID3D11Device1* device, UINT bufferSize, UINT numBuffers ) {
+    D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+    if ( FAILED( device->CheckFeatureSupport( D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof( options ) ) )
+        || !options.ConstantBufferOffsetting || !options.MapNoOverwriteOnDynamicConstantBuffer ) {
+        LogInfo() << "Device can't bind constantbuffers by offset, not using the constantbuffer ring";
+        return XR_FAILED;
+    }
+
+    Buffers.resize( numBuffers );
+    for ( RingBuffer& b : Buffers ) {
+        HRESULT hr;
+        LE( device->CreateBuffer( &CD3D11_BUFFER_DESC( bufferSize, D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE ), nullptr, b.Buffer.GetAddressOf() ) );
+        if ( FAILED( hr ) ) {
+            Buffers.clear();
+            return XR_FAILED;
+        }
+
+        b.Mirror.resize( bufferSize );
+        b.Generation = 0;
+    }
+
+    BufferSize = bufferSize;
+    CurrentBuffer = numBuffers - 1;
+    MoveToNextBuffer();
+
+    LogInfo() << "Created constantbuffer ring with " << numBuffers << " buffers of " << bufferSize / 1024 << " KB";
+    return XR_SUCCESS;
+}
+
+/** Called once per frame */
+void D3D11ConstantBufferRing::OnBeginFrame() {
+    if ( !Buffers.empty() && Position > 0 )
+        MoveToNextBuffer();
+}
+
+/** Starts writing to the next buffer, discarding its old contents */
+void D3D11ConstantBufferRing::MoveToNextBuffer() {
+    CurrentBuffer = (CurrentBuffer + 1) % Buffers.size();
+    Buffers[CurrentBuffer].Generation = ++NextGeneration;
+    Position = 0;
+    WrittenSlices.clear();
+}
+
+/** Copies the data into the ring */
+bool D3D11ConstantBufferRing::Allocate( const void* data, UINT size, ConstantBufferSlice& outSlice ) {
+    UINT alignedSize = (size + CB_SLICE_ALIGNMENT - 1) & ~(CB_SLICE_ALIGNMENT - 1);
+    if ( Buffers.empty() || alignedSize > BufferSize )
+        return false;
+
+    auto& info = Engine::GAPI->GetRendererState().RendererInfo;
+
+    // Someone uploaded the exact same data before, just point to that
+    size_t hash = std::hash<std::string_view>()(std::string_view( reinterpret_cast<const char*>(data), size ));
+    auto range = WrittenSlices.equal_range( hash );
+    for ( auto it = range.first; it != range.second; ++it ) {
+        UINT offset = it->second.first;
+        if ( it->second.second == size && memcmp( &Buffers[CurrentBuffer].Mirror[offset], data, size ) == 0 ) {
+            outSlice.Buffer = Buffers[CurrentBuffer].Buffer.Get();
+            outSlice.FirstConstant = offset / 16;
+            outSlice.NumConstants = alignedSize / 16;
+            outSlice.BufferIndex = CurrentBuffer;
+            outSlice.Generation = Buffers[CurrentBuffer].Generation;
+
+            info.FrameConstantBufferUpdatesSkipped++;
+            return true;
+        }
+    }
+
+    // Moving on would discard a buffer whose slices might still be bound this frame, let the caller use its own buffer instead
+    if ( Position + alignedSize > BufferSize )
+        return false;
+
+    RingBuffer& rb = Buffers[CurrentBuffer];
+    D3D11GraphicsEngineBase* engine = reinterpret_cast<D3D11GraphicsEngineBase*>(Engine::GraphicsEngine);
+
+    // Only the first write to a buffer may throw away its contents, the slices before must stay intact
+    D3D11_MAPPED_SUBRESOURCE res;
+    if ( FAILED( engine->GetContext()->Map( rb.Buffer.Get(), 0, Position == 0 ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &res ) ) )
+        return false;
+
+    memcpy( reinterpret_cast<char*>(res.pData) + Position, data, size );
+    engine->GetContext()->Unmap( rb.Buffer.Get(), 0 );
+
+    memcpy( &rb.Mirror[Position], data, size );
+    WrittenSlices.emplace( hash, std::make_pair( Position, size ) );
+
+    outSlice.Buffer = rb.Buffer.Get();
+    outSlice.FirstConstant = Position / 16;
+    outSlice.NumConstants = alignedSize / 16;
+    outSlice.BufferIndex = CurrentBuffer;
+    outSlice.Generation = rb.Generation;
+
+    Position += alignedSize;
+
+    info.FrameConstantBufferMaps++;
+    info.FrameConstantBufferBytes += size;
+    return true;
+}
+
+/** Returns whether the slice wasn't overwritten yet */
+bool D3D11ConstantBufferRing::IsSliceValid( const ConstantBufferSlice& slice ) const {
+    return slice.BufferIndex < Buffers.size() && Buffers[slice.BufferIndex].Generation == slice.Generation;
+}
+
+/** Returns whether the ring was created and is enabled */
+bool D3D11ConstantBufferRing::IsActive() const {
+    return !Buffers.empty() && Engine::GAPI->GetRendererState().RendererSettings.EnableConstantBufferRing;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+/** Part of a ring buffer holding the contents of one constantbuffer */
+struct ConstantBufferSlice {
+    ID3D11Buffer* Buffer;
+    UINT FirstConstant;
+    UINT NumConstants;
+
+    /** Which ring buffer this was written to and which use of that buffer */
+    UINT BufferIndex;
+    unsigned int Generation;
+};
+
+/** Suballocates 256-byte aligned slices from a few large dynamic buffers, which can be bound
+    by offset with *SSetConstantBuffers1. Moves on to the next buffer every frame, so slices
+    written during the last frames stay valid. Only meant for transient constantbuffers. */
+class D3D11ConstantBufferRing {
+public:
+    D3D11ConstantBufferRing();
+    ~D3D11ConstantBufferRing();
+
+    /** Creates the buffers. Fails if the device can't bind constantbuffers by offset. */
+    XRESULT Init( ID3D11Device1* device, UINT bufferSize = 1024 * 1024, UINT numBuffers = 4 );
+
+    /** Called once per frame */
+    void OnBeginFrame();
+
+    /** Copies the data into the ring. Identical data written to the current buffer before is
+        reused instead. Returns false if the data doesn't fit into what's left of this frame's buffer. */
+    bool Allocate( const void* data, UINT size, ConstantBufferSlice& outSlice );
+
+    /** Returns whether the slice wasn't overwritten yet */
+    bool IsSliceValid( const ConstantBufferSlice& slice ) const;
+
+    /** Returns whether the ring was created and is enabled */
+    bool IsActive() const;
+
+private:
+    /** Starts writing to the next buffer, discarding its old contents */
+    void MoveToNextBuffer();
+
+    struct RingBuffer {
+        Microsoft::WRL::ComPtr<ID3D11Buffer> Buffer;
+
+        /** Copy of everything written this generation, to check for duplicates */
+        std::vector<char> Mirror;
+        unsigned int Generation;
+    };
+
+    std::vector<RingBuffer> Buffers;
+    UINT BufferSize;
+    UINT CurrentBuffer;
+    UINT Position;
+    unsigned int NextGeneration;
+
+    /** Hash -> (offset, size) of everything written to the current buffer */
+    std::unordered_multimap<size_t, std::pair<UINT, UINT>> WrittenSlices;
+};
@@ -265,6 +265,7 @@ XRESULT D3D11Effect::LoadRainResources()
         SetDebugName( RainShadowmap->GetDepthStencilView().Get(), "RainShadowmap->DepthStencilView" );
         SetDebugName( RainShadowmap->GetShaderResView().Get(), "RainShadowmap->ShaderResView" );
         SetDebugName( RainShadowmap->GetTexture().Get(), "RainShadowmap->Texture" );
+        RainShadowmap->SetMemoryCategory( ResidencyManager::C_SHADOW_MAPS );
     }
 
     return XR_SUCCESS;
@@ -333,6 +334,7 @@ XRESULT D3D11Effect::DrawRainShadowmap() {
     Engine::GAPI->GetRendererState().GraphicsState.FF_AlphaRef = oldAlphaRef;
     if ( PS_Diffuse ) {
         PS_Diffuse->GetConstantBuffer()[0]->UpdateBuffer( &Engine::GAPI->GetRendererState().GraphicsState );
+        PS_Diffuse->GetConstantBuffer()[0]->BindToPixelShader( 0 );
     }
 
     e->SetDefaultStates();
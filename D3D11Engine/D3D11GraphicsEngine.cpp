@@ -4,6 +4,7 @@
 #include "BaseAntTweakBar.h"
 #include "D2DEditorView.h"
 #include "D2DView.h"
+#include "D3D11ConstantBufferRing.h"
 #include "D3D11Effect.h"
 #include "D3D11GShader.h"
 #include "D3D11HDShader.h"
@@ -19,9 +20,13 @@
 #include "GOcean.h"
 #include "GSky.h"
 #include "RenderToTextureBuffer.h"
+#include "ResidencyManager.h"
+#include "WorldClusterCulling.h"
+#include "WorldStreamer.h"
 #include "zCParticleFX.h"
 #include "zCDecal.h"
 #include "zCMaterial.h"
+#include "zCModel.h"
 #include "zCQuadMark.h"
 #include "zCTexture.h"
 #include "zCView.h"
@@ -82,6 +87,15 @@ D3D11GraphicsEngine::D3D11GraphicsEngine() {
     m_lowlatency = false;
     m_isWindowActive = false;
 
+    ShadowCascadeFrame = 0;
+    ShadowCascadesValid = false;
+    for ( ShadowCascadeInfo& cascade : ShadowCascades ) {
+        cascade = {};
+    }
+
+    SkeletalMeshInstancingActive = false;
+    HUDBatchBufferPosition = 0;
+
     // Match the resolution with the current desktop resolution
     Resolution =
         Engine::GAPI->GetRendererState().RendererSettings.LoadedResolution;
@@ -201,6 +215,7 @@ XRESULT D3D11GraphicsEngine::Init() {
     std::string deviceDescription( wDeviceDescription.begin(), wDeviceDescription.end() );
     DeviceDescription = deviceDescription;
     LogInfo() << "Rendering on: " << deviceDescription.c_str();
+    ResidencyManager::SetAdapterMemory( adpDesc.DedicatedVideoMemory );
 
     D3D_FEATURE_LEVEL maxFeatureLevel = D3D_FEATURE_LEVEL::D3D_FEATURE_LEVEL_9_1;
     D3D_FEATURE_LEVEL featureLevels[] = {
@@ -250,14 +265,35 @@ XRESULT D3D11GraphicsEngine::Init() {
     FeatureLevel10Compatibility = (maxFeatureLevel < D3D_FEATURE_LEVEL::D3D_FEATURE_LEVEL_11_0);
     FetchDisplayModeList();
 
+    ConstantBufferRing = std::make_unique<D3D11ConstantBufferRing>();
+    if ( XR_SUCCESS != ConstantBufferRing->Init( Device.Get() ) ) {
+        ConstantBufferRing.reset();
+    }
+
     LogInfo() << "Creating ShaderManager";
     ShaderManager = std::make_unique<D3D11ShaderManager>();
     ShaderManager->Init();
     ShaderManager->LoadShaders();
 
-    PS_DiffuseNormalmapped = ShaderManager->GetPShader( "PS_DiffuseNormalmapped" );
+    HotShaders.VS_Ex = ShaderManager->GetVShaderHandle( "VS_Ex" );
+    HotShaders.VS_ExCompressed = ShaderManager->GetVShaderHandle( "VS_ExCompressed" );
+    HotShaders.VS_ExSkeletal = ShaderManager->GetVShaderHandle( "VS_ExSkeletal" );
+    HotShaders.VS_ExSkeletalCube = ShaderManager->GetVShaderHandle( "VS_ExSkeletalCube" );
+    HotShaders.VS_ExSkeletalInstanced = ShaderManager->GetVShaderHandle( "VS_ExSkeletalInstanced" );
+    HotShaders.VS_ExMode = ShaderManager->GetVShaderHandle( "VS_ExMode" );
+    HotShaders.VS_ExNodeCube = ShaderManager->GetVShaderHandle( "VS_ExNodeCube" );
+    HotShaders.VS_TransformedEx = ShaderManager->GetVShaderHandle( "VS_TransformedEx" );
+    HotShaders.VS_ParticlePoint = ShaderManager->GetVShaderHandle( "VS_ParticlePoint" );
+    HotShaders.PS_Simple = ShaderManager->GetPShaderHandle( "PS_Simple" );
+    HotShaders.PS_DiffuseAlphaTest = ShaderManager->GetPShaderHandle( "PS_DiffuseAlphaTest" );
+    HotShaders.PS_FixedFunctionPipe = ShaderManager->GetPShaderHandle( "PS_FixedFunctionPipe" );
+    HotShaders.PS_ParticleDistortion = ShaderManager->GetPShaderHandle( "PS_ParticleDistortion" );
+    HotShaders.PS_PFX_ApplyParticleDistortion = ShaderManager->GetPShaderHandle( "PS_PFX_ApplyParticleDistortion" );
+    HotShaders.PS_Diffuse = ShaderManager->GetPermutationHandle( "PS_Diffuse" );
+    HotShaders.PS_DS_AtmosphericScattering = ShaderManager->GetPermutationHandle( "PS_DS_AtmosphericScattering" );
+    FixedFunctionPipeShader = ShaderManager->GetPermutationHandle( "PS_FixedFunctionPipe" );
+
     PS_Diffuse = ShaderManager->GetPShader( "PS_Diffuse" );
-    PS_DiffuseNormalmappedAlphatest = ShaderManager->GetPShader( "PS_DiffuseNormalmappedAlphaTest" );
     PS_DiffuseAlphatest = ShaderManager->GetPShader( "PS_DiffuseAlphaTest" );
 
     PS_PortalDiffuse = ShaderManager->GetPShader( "PS_PortalDiffuse" );
@@ -306,6 +342,12 @@ XRESULT D3D11GraphicsEngine::Init() {
     SetDebugName( TempHUDVertexBuffer->GetShaderResourceView().Get(), "TempVertexBuffer->ShaderResourceView" );
     SetDebugName( TempHUDVertexBuffer->GetVertexBuffer().Get(), "TempVertexBuffer->VertexBuffer" );
 
+    HUDBatchVertexBuffer = std::make_unique<D3D11VertexBuffer>();
+    HUDBatchVertexBuffer->Init(
+        nullptr, HUD_BATCH_BUFFER_SIZE, D3D11VertexBuffer::B_VERTEXBUFFER,
+        D3D11VertexBuffer::U_DYNAMIC, D3D11VertexBuffer::CA_WRITE );
+    SetDebugName( HUDBatchVertexBuffer->GetVertexBuffer().Get(), "HUDBatchVertexBuffer->VertexBuffer" );
+
     DynamicInstancingBuffer = std::make_unique<D3D11VertexBuffer>();
     DynamicInstancingBuffer->Init(
         nullptr, INSTANCING_BUFFER_SIZE, D3D11VertexBuffer::B_VERTEXBUFFER,
@@ -313,6 +355,12 @@ XRESULT D3D11GraphicsEngine::Init() {
     SetDebugName( DynamicInstancingBuffer->GetShaderResourceView().Get(), "DynamicInstancingBuffer->ShaderResourceView" );
     SetDebugName( DynamicInstancingBuffer->GetVertexBuffer().Get(), "DynamicInstancingBuffer->VertexBuffer" );
 
+    ShadowInstancingBuffer = std::make_unique<D3D11VertexBuffer>();
+    ShadowInstancingBuffer->Init(
+        nullptr, INSTANCING_BUFFER_SIZE, D3D11VertexBuffer::B_VERTEXBUFFER,
+        D3D11VertexBuffer::U_DYNAMIC, D3D11VertexBuffer::CA_WRITE );
+    SetDebugName( ShadowInstancingBuffer->GetVertexBuffer().Get(), "ShadowInstancingBuffer->VertexBuffer" );
+
     D3D11_SAMPLER_DESC samplerDesc;
     samplerDesc.Filter = D3D11_FILTER_ANISOTROPIC;
     samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
@@ -546,6 +594,8 @@ int D3D11GraphicsEngine::GetWindowMode() {
 
 /** Called on window resize/resolution change */
 XRESULT D3D11GraphicsEngine::OnResize( INT2 newSize ) {
+    FlushHUDBatch();
+
     HRESULT hr;
 
     if ( dxgi_1_5 ) {
@@ -877,12 +927,7 @@ XRESULT D3D11GraphicsEngine::OnResize( INT2 newSize ) {
         (Engine::GAPI->GetRendererState().RendererSettings.CompressBackBuffer ? DXGI_FORMAT_R11G11B10_FLOAT : DXGI_FORMAT_R16G16B16A16_FLOAT) );
 
     int s = std::min<int>( std::max<int>( Engine::GAPI->GetRendererState().RendererSettings.ShadowMapSize, 512 ), (FeatureLevel10Compatibility ? 8192 : 16384) );
-    WorldShadowmap1 = std::make_unique<RenderToDepthStencilBuffer>(
-        GetDevice().Get(), s, s, DXGI_FORMAT_R16_TYPELESS, nullptr, DXGI_FORMAT_D16_UNORM,
-        DXGI_FORMAT_R16_UNORM );
-    SetDebugName( WorldShadowmap1->GetTexture().Get(), "WorldShadowmap1->Texture" );
-    SetDebugName( WorldShadowmap1->GetShaderResView().Get(), "WorldShadowmap1->ShaderResView" );
-    SetDebugName( WorldShadowmap1->GetDepthStencilView().Get(), "WorldShadowmap1->DepthStencilView" );
+    CreateWorldShadowmap( s, Engine::GAPI->GetRendererState().RendererSettings.NumShadowCascades );
 
     Engine::AntTweakBar->OnResize( newSize );
 
@@ -892,6 +937,9 @@ XRESULT D3D11GraphicsEngine::OnResize( INT2 newSize ) {
 /** Called when the game wants to render a new frame */
 XRESULT D3D11GraphicsEngine::OnBeginFrame() {
     Engine::GAPI->GetRendererState().RendererInfo.Timing.StartTotal();
+    if ( ConstantBufferRing ) {
+        ConstantBufferRing->OnBeginFrame();
+    }
     if ( !m_isWindowActive && Engine::GAPI->GetRendererState().RendererSettings.EnableInactiveFpsLock ) {
         m_FrameLimiter->SetLimit( 20 );
         m_FrameLimiter->Start();
@@ -927,10 +975,14 @@ XRESULT D3D11GraphicsEngine::OnBeginFrame() {
         }
         makros.push_back( m );
 
-        ShaderInfo si = ShaderInfo( "PS_PFX_HDR", "PS_PFX_HDR.hlsl", "p", makros );
-        si.cBufferSizes.push_back( sizeof( HDRSettingsConstantBuffer ) );
-        ShaderManager->UpdateShaderInfo( si );
-        si = ShaderInfo( "PS_PFX_Tonemap", "PS_PFX_Tonemap.hlsl", "p", makros );
+        // Recompiles the composite variants in the background
+        ShaderInfo hdr = ShaderInfo( "PS_PFX_HDR", "PS_PFX_HDR.hlsl", "p", makros );
+        hdr.cBufferSizes.push_back( sizeof( HDRSettingsConstantBuffer ) );
+        hdr.cBufferSizes.push_back( sizeof( AtmosphereConstantBuffer ) );
+        hdr.cBufferSizes.push_back( sizeof( HeightfogConstantBuffer ) );
+        ShaderManager->UpdatePermutationInfo( hdr );
+
+        ShaderInfo si = ShaderInfo( "PS_PFX_Tonemap", "PS_PFX_Tonemap.hlsl", "p", makros );
         si.cBufferSizes.push_back( sizeof( HDRSettingsConstantBuffer ) );
         ShaderManager->UpdateShaderInfo( si );
     }
@@ -971,6 +1023,12 @@ XRESULT D3D11GraphicsEngine::OnBeginFrame() {
     Engine::GAPI->SetFrameProcessedTexturesReady();
     Engine::GAPI->LeaveResourceCriticalSection();
 
+    // Upload the world sections around the camera, before the residency manager looks at the memory usage
+    WorldStreamer::Update();
+
+    // Keep the video memory inside the budget, once the textures of this frame are in
+    ResidencyManager::Update();
+
     // Check for editorpanel
     if ( !UIView ) {
         if ( Engine::GAPI->GetRendererState().RendererSettings.EnableEditorPanel ) {
@@ -980,22 +1038,19 @@ XRESULT D3D11GraphicsEngine::OnBeginFrame() {
 
     // Check for shadowmap resize
     int s = Engine::GAPI->GetRendererState().RendererSettings.ShadowMapSize;
+    int numCascades = Engine::GAPI->GetRendererState().RendererSettings.NumShadowCascades;
 
-    if ( WorldShadowmap1->GetSizeX() != s ) {
+    if ( WorldShadowmap1->GetSizeX() != s || static_cast<int>(WorldShadowmap1->GetArraySize()) != numCascades ) {
         s = std::min<int>(std::max<int>(s, 512), (FeatureLevel10Compatibility ? 8192 : 16384));
 
-        int old = WorldShadowmap1->GetSizeX();
-        LogInfo() << "Shadowmapresolution changed to: " << s << "x" << s;
-        WorldShadowmap1 = std::make_unique<RenderToDepthStencilBuffer>(
-            GetDevice().Get(), s, s, DXGI_FORMAT_R16_TYPELESS, nullptr, DXGI_FORMAT_D16_UNORM, DXGI_FORMAT_R16_UNORM );
-        SetDebugName( WorldShadowmap1->GetTexture().Get(), "WorldShadowmap1->Texture" );
-        SetDebugName( WorldShadowmap1->GetShaderResView().Get(), "WorldShadowmap1->ShaderResView" );
-        SetDebugName( WorldShadowmap1->GetDepthStencilView().Get(), "WorldShadowmap1->DepthStencilView" );
+        UINT old = WorldShadowmap1->GetSizeX();
+        CreateWorldShadowmap( s, numCascades );
 
-        Engine::GAPI->GetRendererState().RendererSettings.WorldShadowRangeScale =
-            Toolbox::GetRecommendedWorldShadowRangeScaleForSize( s );
-
-        Engine::GAPI->GetRendererState().RendererSettings.ShadowMapSize = s;
+        if ( WorldShadowmap1->GetSizeX() != old ) {
+            LogInfo() << "Shadowmapresolution changed to: " << WorldShadowmap1->GetSizeX() << "x" << WorldShadowmap1->GetSizeX();
+            Engine::GAPI->GetRendererState().RendererSettings.WorldShadowRangeScale =
+                Toolbox::GetRecommendedWorldShadowRangeScaleForSize( WorldShadowmap1->GetSizeX() );
+        }
     }
 
     // Force the mode
@@ -1027,17 +1082,6 @@ XRESULT D3D11GraphicsEngine::OnBeginFrame() {
     SetActivePixelShader( "PS_Simple" );
     SetActiveVertexShader( "VS_Ex" );
 
-    if ( Engine::GAPI->GetRendererState().RendererSettings.AllowNormalmaps ) {
-        PS_DiffuseNormalmappedFxMap = ShaderManager->GetPShader( "PS_DiffuseNormalmappedFxMap" );
-        PS_DiffuseNormalmappedAlphatestFxMap = ShaderManager->GetPShader( "PS_DiffuseNormalmappedAlphaTestFxMap" );
-        PS_DiffuseNormalmapped = ShaderManager->GetPShader( "PS_DiffuseNormalmapped" );
-        PS_DiffuseNormalmappedAlphatest = ShaderManager->GetPShader( "PS_DiffuseNormalmappedAlphaTest" );
-    } else {
-        PS_DiffuseNormalmappedFxMap = ShaderManager->GetPShader( "PS_Diffuse" );
-        PS_DiffuseNormalmappedAlphatestFxMap = ShaderManager->GetPShader( "PS_DiffuseAlphaTest" );
-        PS_DiffuseNormalmapped = ShaderManager->GetPShader( "PS_Diffuse" );
-        PS_DiffuseNormalmappedAlphatest = ShaderManager->GetPShader( "PS_DiffuseAlphaTest" );
-    }
     PS_Diffuse = ShaderManager->GetPShader( "PS_Diffuse" );
     PS_DiffuseAlphatest = ShaderManager->GetPShader( "PS_DiffuseAlphaTest" );
     PS_Simple = ShaderManager->GetPShader( "PS_Simple" );
@@ -1053,12 +1097,23 @@ XRESULT D3D11GraphicsEngine::OnEndFrame() {
     Engine::GAPI->GetRendererState().RendererInfo.Timing.StopTotal();
     if ( !Engine::GAPI->GetRendererState().RendererSettings.BinkVideoRunning ) {
         m_FrameLimiter->Wait();
+
+        const FramePacingStats& pacing = m_FrameLimiter->GetStats();
+        GothicRendererInfo& info = Engine::GAPI->GetRendererState().RendererInfo;
+        info.FrameTimeP50MS = pacing.FrameTimeP50MS;
+        info.FrameTimeP95MS = pacing.FrameTimeP95MS;
+        info.FrameTimeP99MS = pacing.FrameTimeP99MS;
+        info.FrameJitterMS = pacing.JitterMS;
+        info.FramePacingErrorMS = pacing.PacingErrorMS;
+        info.FrameLimiterSpinPercent = pacing.SpinPercent;
     }
     return XR_SUCCESS;
 }
 
 /** Called when the game wants to clear the bound rendertarget */
 XRESULT D3D11GraphicsEngine::Clear( const float4& color ) {
+    FlushHUDBatch();
+
     const Microsoft::WRL::ComPtr<ID3D11DeviceContext1>& context = GetContext();
     context->ClearDepthStencilView( DepthStencilBuffer->GetDepthStencilView().Get(),
         D3D11_CLEAR_DEPTH, 0, 0 );
@@ -1215,6 +1270,8 @@ D3D11GraphicsEngine::GetDisplayModeList( std::vector<DisplayModeInfo>* modeList,
 
 /** Presents the current frame to the screen */
 XRESULT D3D11GraphicsEngine::Present() {
+    FlushHUDBatch();
+
     D3D11_VIEWPORT vp;
     vp.TopLeftX = 0.0f;
     vp.TopLeftY = 0.0f;
@@ -1355,6 +1412,8 @@ XRESULT D3D11GraphicsEngine::SetViewport( const ViewportInfo& viewportInfo ) {
 
 /** Draws a vertexbuffer, non-indexed (World)*/
 XRESULT D3D11GraphicsEngine::DrawVertexBuffer( D3D11VertexBuffer* vb, unsigned int numVertices, unsigned int stride ) {
+    FlushHUDBatch();
+
 #ifdef RECORD_LAST_DRAWCALL
     g_LastDrawCall.Type = DrawcallInfo::VB;
     g_LastDrawCall.NumElements = numVertices;
@@ -1380,7 +1439,10 @@ XRESULT D3D11GraphicsEngine::DrawVertexBuffer( D3D11VertexBuffer* vb, unsigned i
 XRESULT D3D11GraphicsEngine::DrawVertexBufferIndexed( D3D11VertexBuffer* vb,
     D3D11VertexBuffer* ib,
     unsigned int numIndices,
-    unsigned int indexOffset ) {
+    unsigned int indexOffset,
+    unsigned int vertexStride ) {
+    FlushHUDBatch();
+
 #ifdef RECORD_LAST_DRAWCALL
     g_LastDrawCall.Type = DrawcallInfo::VB_IX;
     g_LastDrawCall.NumElements = numIndices;
@@ -1391,7 +1453,7 @@ XRESULT D3D11GraphicsEngine::DrawVertexBufferIndexed( D3D11VertexBuffer* vb,
 
     if ( vb ) {
         UINT offset = 0;
-        UINT uStride = sizeof( ExVertexStruct );
+        UINT uStride = vertexStride;
         GetContext()->IASetVertexBuffers( 0, 1, vb->GetVertexBuffer().GetAddressOf(), &uStride, &offset );
 
         if ( sizeof( VERTEX_INDEX ) == sizeof( unsigned short ) ) {
@@ -1416,6 +1478,8 @@ XRESULT D3D11GraphicsEngine::DrawVertexBufferIndexed( D3D11VertexBuffer* vb,
 XRESULT D3D11GraphicsEngine::DrawVertexBufferIndexedUINT(
     D3D11VertexBuffer* vb, D3D11VertexBuffer* ib, unsigned int numIndices,
     unsigned int indexOffset ) {
+    FlushHUDBatch();
+
 #ifdef RECORD_LAST_DRAWCALL
     g_LastDrawCall.Type = DrawcallInfo::VB_IX_UINT;
     g_LastDrawCall.NumElements = numIndices;
@@ -1473,8 +1537,31 @@ XRESULT D3D11GraphicsEngine::BindViewportInformation( const std::string& shader,
     return XR_SUCCESS;
 }
 
+/** Binds viewport information to the given constantbuffer slot of a vertex shader */
+XRESULT D3D11GraphicsEngine::BindViewportInformation( ShaderHandle vertexShader, int slot ) {
+    D3D11_VIEWPORT vp;
+    UINT num = 1;
+    GetContext()->RSGetViewports( &num, &vp );
+
+    float scale =
+        Engine::GAPI->GetRendererState().RendererSettings.GothicUIScale;
+    Temp2Float2[0].x = vp.TopLeftX / scale;
+    Temp2Float2[0].y = vp.TopLeftY / scale;
+    Temp2Float2[1].x = vp.Width / scale;
+    Temp2Float2[1].y = vp.Height / scale;
+
+    if ( D3D11VShader* vs = ShaderManager->GetVShader( vertexShader ).get() ) {
+        vs->GetConstantBuffer()[slot]->UpdateBuffer( Temp2Float2 );
+        vs->GetConstantBuffer()[slot]->BindToVertexShader( slot );
+    }
+
+    return XR_SUCCESS;
+}
+
 /** Draws a screen fade effects */
 XRESULT D3D11GraphicsEngine::DrawScreenFade( void* c ) {
+    FlushHUDBatch();
+
     zCCamera* camera = reinterpret_cast<zCCamera*>(c);
 
     bool ResetStates = false;
@@ -1595,16 +1682,26 @@ XRESULT D3D11GraphicsEngine::DrawVertexArray( ExVertexStruct* vertices,
     unsigned int numVertices,
     unsigned int startVertex,
     unsigned int stride ) {
+    Engine::GAPI->GetRendererState().RendererInfo.FrameHUDDrawCalls++;
+
+    if ( stride == sizeof( ExVertexStruct ) && startVertex == 0 && QueueHUDVertices( vertices, numVertices ) )
+        return XR_SUCCESS;
+
+    // Keep the drawing order
+    FlushHUDBatch();
+
     UpdateRenderStates();
-    auto vShader = ActiveVS;
-    // ShaderManager->GetVShader("VS_TransformedEx");
 
     // Bind the FF-Info to the first PS slot
-    ActivePS->GetConstantBuffer()[0]->UpdateBuffer(
+    const auto& ps = SelectFixedFunctionPipeVariant( ActivePS, Engine::GAPI->GetRendererState().GraphicsState );
+    ps->GetConstantBuffer()[0]->UpdateBuffer(
         &Engine::GAPI->GetRendererState().GraphicsState );
-    ActivePS->GetConstantBuffer()[0]->BindToPixelShader( 0 );
+    ps->GetConstantBuffer()[0]->BindToPixelShader( 0 );
 
     SetupVS_ExMeshDrawCall();
+    if ( ps != ActivePS ) {
+        ps->Apply();
+    }
 
     EnsureTempVertexBufferSize( TempHUDVertexBuffer, stride * numVertices );
     TempHUDVertexBuffer->UpdateBuffer( vertices, stride * numVertices );
@@ -1618,15 +1715,184 @@ XRESULT D3D11GraphicsEngine::DrawVertexArray( ExVertexStruct* vertices,
 
     Engine::GAPI->GetRendererState().RendererInfo.FrameDrawnTriangles +=
         numVertices / 3;
+    Engine::GAPI->GetRendererState().RendererInfo.FrameHUDBatches++;
 
     return XR_SUCCESS;
 }
 
+/** Returns true if draws queued with the other state can go into the same batch */
+bool HUDBatchState::IsCompatible( const HUDBatchState& other ) const {
+    return Textures[0] == other.Textures[0] && Textures[1] == other.Textures[1]
+        && Sampler == other.Sampler
+        && RenderTarget == other.RenderTarget && DepthStencil == other.DepthStencil
+        && BlendState == other.BlendState && RasterizerState == other.RasterizerState && DepthStencilState == other.DepthStencilState
+        && memcmp( BlendFactor, other.BlendFactor, sizeof( BlendFactor ) ) == 0
+        && SampleMask == other.SampleMask && StencilRef == other.StencilRef
+        && memcmp( &Viewport, &other.Viewport, sizeof( Viewport ) ) == 0
+        && UIScale == other.UIScale
+        && memcmp( &GraphicsState, &other.GraphicsState, sizeof( GraphicsState ) ) == 0;
+}
+
+/** Reads the context state a HUD batch depends on */
+void D3D11GraphicsEngine::CaptureHUDBatchState( HUDBatchState& state ) {
+    ID3D11ShaderResourceView* textures[2];
+    GetContext()->PSGetShaderResources( 0, 2, textures );
+    state.Textures[0].Attach( textures[0] );
+    state.Textures[1].Attach( textures[1] );
+    GetContext()->PSGetSamplers( 0, 1, state.Sampler.ReleaseAndGetAddressOf() );
+    GetContext()->OMGetRenderTargets( 1, state.RenderTarget.ReleaseAndGetAddressOf(), state.DepthStencil.ReleaseAndGetAddressOf() );
+    GetContext()->OMGetBlendState( state.BlendState.ReleaseAndGetAddressOf(), state.BlendFactor, &state.SampleMask );
+    GetContext()->OMGetDepthStencilState( state.DepthStencilState.ReleaseAndGetAddressOf(), &state.StencilRef );
+    GetContext()->RSGetState( state.RasterizerState.ReleaseAndGetAddressOf() );
+
+    UINT numViewports = 1;
+    GetContext()->RSGetViewports( &numViewports, &state.Viewport );
+
+    state.UIScale = Engine::GAPI->GetRendererState().RendererSettings.GothicUIScale;
+    state.GraphicsState = Engine::GAPI->GetRendererState().GraphicsState;
+}
+
+/** Binds the context state a HUD batch depends on */
+void D3D11GraphicsEngine::ApplyHUDBatchState( const HUDBatchState& state ) {
+    ID3D11ShaderResourceView* textures[2] = { state.Textures[0].Get(), state.Textures[1].Get() };
+    GetContext()->PSSetShaderResources( 0, 2, textures );
+    GetContext()->PSSetSamplers( 0, 1, state.Sampler.GetAddressOf() );
+    GetContext()->OMSetRenderTargets( 1, state.RenderTarget.GetAddressOf(), state.DepthStencil.Get() );
+    GetContext()->OMSetBlendState( state.BlendState.Get(), state.BlendFactor, state.SampleMask );
+    GetContext()->OMSetDepthStencilState( state.DepthStencilState.Get(), state.StencilRef );
+    GetContext()->RSSetState( state.RasterizerState.Get() );
+    GetContext()->RSSetViewports( 1, &state.Viewport );
+}
+
+/** Queues HUD geometry drawn with VS_TransformedEx and PS_FixedFunctionPipe */
+bool D3D11GraphicsEngine::QueueHUDVertices( const ExVertexStruct* vertices, unsigned int numVertices ) {
+    if ( !Engine::GAPI->GetRendererState().RendererSettings.EnableHUDBatching || !HUDBatchVertexBuffer )
+        return false;
+
+    // Only the fixed function HUD path can be replayed later, everything else is drawn right away
+    if ( ActiveVS != ShaderManager->GetVShader( HotShaders.VS_TransformedEx )
+        || ActivePS != ShaderManager->GetPShader( HotShaders.PS_FixedFunctionPipe ) )
+        return false;
+
+    if ( numVertices == 0 || numVertices * sizeof( ExVertexStruct ) > HUD_BATCH_BUFFER_SIZE )
+        return false;
+
+    UpdateRenderStates();
+
+    HUDBatchState state;
+    CaptureHUDBatchState( state );
+
+    if ( !HUDBatchVertices.empty() ) {
+        bool full = (HUDBatchVertices.size() + numVertices) * sizeof( ExVertexStruct ) > HUD_BATCH_BUFFER_SIZE;
+        if ( full || !HUDBatch.IsCompatible( state ) )
+            FlushHUDBatch();
+    }
+
+    if ( HUDBatchVertices.empty() )
+        HUDBatch = state;
+
+    HUDBatchVertices.insert( HUDBatchVertices.end(), vertices, vertices + numVertices );
+    return true;
+}
+
+/** Draws all queued HUD geometry with the state it was queued with and restores the current state afterwards */
+void D3D11GraphicsEngine::FlushHUDBatch() {
+    if ( HUDBatchVertices.empty() )
+        return;
+
+    UINT size = static_cast<UINT>(HUDBatchVertices.size() * sizeof( ExVertexStruct ));
+
+    // Append behind the last batch, so the GPU can still read from it. Start over when the buffer is full.
+    int mapFlags = D3D11VertexBuffer::M_WRITE_NO_OVERWRITE;
+    if ( HUDBatchBufferPosition + size > HUD_BATCH_BUFFER_SIZE ) {
+        mapFlags = D3D11VertexBuffer::M_WRITE_DISCARD;
+        HUDBatchBufferPosition = 0;
+    }
+
+    void* data;
+    UINT bufferSize;
+    if ( XR_SUCCESS != HUDBatchVertexBuffer->Map( mapFlags, &data, &bufferSize ) ) {
+        HUDBatchVertices.clear();
+        HUDBatch = HUDBatchState();
+        return;
+    }
+
+    memcpy( reinterpret_cast<char*>(data) + HUDBatchBufferPosition, &HUDBatchVertices[0], size );
+    HUDBatchVertexBuffer->Unmap();
+
+    // Save everything the batch overwrites, since other code might rely on it
+    HUDBatchState savedState;
+    CaptureHUDBatchState( savedState );
+
+    Microsoft::WRL::ComPtr<ID3D11InputLayout> savedLayout;
+    Microsoft::WRL::ComPtr<ID3D11VertexShader> savedVS;
+    Microsoft::WRL::ComPtr<ID3D11PixelShader> savedPS;
+    Microsoft::WRL::ComPtr<ID3D11Buffer> savedVB, savedVSCB, savedPSCB;
+    D3D11_PRIMITIVE_TOPOLOGY savedTopology;
+    UINT savedStride, savedOffset;
+    UINT savedVSCBFirst, savedVSCBNum, savedPSCBFirst, savedPSCBNum;
+    GetContext()->IAGetInputLayout( savedLayout.GetAddressOf() );
+    GetContext()->IAGetPrimitiveTopology( &savedTopology );
+    GetContext()->IAGetVertexBuffers( 0, 1, savedVB.GetAddressOf(), &savedStride, &savedOffset );
+    GetContext()->VSGetShader( savedVS.GetAddressOf(), nullptr, nullptr );
+    GetContext()->PSGetShader( savedPS.GetAddressOf(), nullptr, nullptr );
+    GetContext()->VSGetConstantBuffers1( 0, 1, savedVSCB.GetAddressOf(), &savedVSCBFirst, &savedVSCBNum );
+    GetContext()->PSGetConstantBuffers1( 0, 1, savedPSCB.GetAddressOf(), &savedPSCBFirst, &savedPSCBNum );
+
+    ApplyHUDBatchState( HUDBatch );
+
+    const auto& vs = ShaderManager->GetVShader( HotShaders.VS_TransformedEx );
+    const auto& ps = SelectFixedFunctionPipeVariant( ShaderManager->GetPShader( HotShaders.PS_FixedFunctionPipe ), HUDBatch.GraphicsState );
+    vs->Apply();
+    ps->Apply();
+
+    Temp2Float2[0].x = HUDBatch.Viewport.TopLeftX / HUDBatch.UIScale;
+    Temp2Float2[0].y = HUDBatch.Viewport.TopLeftY / HUDBatch.UIScale;
+    Temp2Float2[1].x = HUDBatch.Viewport.Width / HUDBatch.UIScale;
+    Temp2Float2[1].y = HUDBatch.Viewport.Height / HUDBatch.UIScale;
+    vs->GetConstantBuffer()[0]->UpdateBuffer( Temp2Float2 );
+    vs->GetConstantBuffer()[0]->BindToVertexShader( 0 );
+
+    ps->GetConstantBuffer()[0]->UpdateBuffer( &HUDBatch.GraphicsState );
+    ps->GetConstantBuffer()[0]->BindToPixelShader( 0 );
+
+    UINT stride = sizeof( ExVertexStruct );
+    UINT offset = 0;
+    GetContext()->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+    GetContext()->IASetVertexBuffers( 0, 1, HUDBatchVertexBuffer->GetVertexBuffer().GetAddressOf(), &stride, &offset );
+
+    GetContext()->Draw( static_cast<UINT>(HUDBatchVertices.size()), HUDBatchBufferPosition / sizeof( ExVertexStruct ) );
+
+    // Put back what was bound before
+    ApplyHUDBatchState( savedState );
+    GetContext()->IASetInputLayout( savedLayout.Get() );
+    GetContext()->IASetPrimitiveTopology( savedTopology );
+    GetContext()->IASetVertexBuffers( 0, 1, savedVB.GetAddressOf(), &savedStride, &savedOffset );
+    GetContext()->VSSetShader( savedVS.Get(), nullptr, 0 );
+    GetContext()->PSSetShader( savedPS.Get(), nullptr, 0 );
+    if ( savedVSCB ) {
+        GetContext()->VSSetConstantBuffers1( 0, 1, savedVSCB.GetAddressOf(), &savedVSCBFirst, &savedVSCBNum );
+    }
+    if ( savedPSCB ) {
+        GetContext()->PSSetConstantBuffers1( 0, 1, savedPSCB.GetAddressOf(), &savedPSCBFirst, &savedPSCBNum );
+    }
+
+    Engine::GAPI->GetRendererState().RendererInfo.FrameDrawnTriangles += HUDBatchVertices.size() / 3;
+    Engine::GAPI->GetRendererState().RendererInfo.FrameHUDBatches++;
+
+    HUDBatchBufferPosition += size;
+    HUDBatchVertices.clear();
+
+    // Don't keep the textures and rendertargets alive
+    HUDBatch = HUDBatchState();
+}
+
 /** Draws a vertexarray, morphed mesh*/
 XRESULT D3D11GraphicsEngine::DrawVertexArrayMM( ExVertexStruct* vertices,
     unsigned int numVertices,
     unsigned int startVertex,
     unsigned int stride ) {
+    FlushHUDBatch();
 
     // Most morphed heads can fit into <= 3072 vertices buffer but some requires larger so let's have 2 different buffers and choose the appropriate one
     if ( numVertices > 3072 ) {
@@ -1660,9 +1926,9 @@ XRESULT D3D11GraphicsEngine::DrawIndexedVertexArray( ExVertexStruct* vertices,
     D3D11VertexBuffer* ib,
     unsigned int numIndices,
     unsigned int stride ) {
+    FlushHUDBatch();
 
     UpdateRenderStates();
-    auto vShader = ActiveVS;  // ShaderManager->GetVShader("VS_TransformedEx");
 
     // Bind the FF-Info to the first PS slot
 
@@ -1700,12 +1966,19 @@ XRESULT D3D11GraphicsEngine::DrawVertexBufferFF( D3D11VertexBuffer* vb,
     unsigned int numVertices,
     unsigned int startVertex,
     unsigned int stride ) {
+    FlushHUDBatch();
+
     SetupVS_ExMeshDrawCall();
 
+    const auto& ps = SelectFixedFunctionPipeVariant( ActivePS, Engine::GAPI->GetRendererState().GraphicsState );
+    if ( ps != ActivePS ) {
+        ps->Apply();
+    }
+
     // Bind the FF-Info to the first PS slot
-    ActivePS->GetConstantBuffer()[0]->UpdateBuffer(
+    ps->GetConstantBuffer()[0]->UpdateBuffer(
         &Engine::GAPI->GetRendererState().GraphicsState );
-    ActivePS->GetConstantBuffer()[0]->BindToPixelShader( 0 );
+    ps->GetConstantBuffer()[0]->BindToPixelShader( 0 );
 
     UINT offset = 0;
     UINT uStride = stride;
@@ -1830,10 +2103,19 @@ XRESULT  D3D11GraphicsEngine::DrawSkeletalVertexNormals( SkeletalVobInfo* vi,
 /** Draws a skeletal mesh */
 XRESULT  D3D11GraphicsEngine::DrawSkeletalMesh( SkeletalVobInfo* vi,
     const std::vector<XMFLOAT4X4>& transforms, float4 color, float fatness ) {
+    if ( SkeletalMeshInstancingActive && RenderingStage == DES_MAIN && !transforms.empty()
+#if ENABLE_TESSELATION > 0
+        && !Engine::GAPI->GetRendererState().RendererSettings.EnableTesselation
+#endif
+        ) {
+        QueueSkeletalMeshInstance( vi, transforms, color, fatness );
+        return XR_SUCCESS;
+    }
+
     if ( GetRenderingStage() == DES_SHADOWMAP_CUBE ) {
-        SetActiveVertexShader( "VS_ExSkeletalCube" );
+        SetActiveVertexShader( HotShaders.VS_ExSkeletalCube );
     } else {
-        SetActiveVertexShader( "VS_ExSkeletal" );
+        SetActiveVertexShader( HotShaders.VS_ExSkeletal );
     }
 
     InfiniteRangeConstantBuffer->BindToPixelShader( 3 );
@@ -1914,8 +2196,7 @@ XRESULT  D3D11GraphicsEngine::DrawSkeletalMesh( SkeletalVobInfo* vi,
 #endif
             {
                 vb = mesh->MeshVertexBuffer;
-                ib = mesh->MeshIndexBuffer;
-                numIndices = mesh->Indices.size();
+                ib = mesh->GetIndexBufferForLOD( vi->LODLevel, numIndices );
             }
 
             UINT offset = 0;
@@ -1941,11 +2222,211 @@ XRESULT  D3D11GraphicsEngine::DrawSkeletalMesh( SkeletalVobInfo* vi,
     return XR_SUCCESS;
 }
 
+/** Starts collecting skeletal meshes, so instances of the same visual can be drawn together */
+void D3D11GraphicsEngine::BeginSkeletalMeshInstancing() {
+    SkeletalMeshInstancingActive = Engine::GAPI->GetRendererState().RendererSettings.EnableSkeletalMeshInstancing;
+    SkeletalInstanceRecords.clear();
+    SkeletalInstanceKeys.clear();
+    SkeletalInstances.clear();
+    SkeletalBonePalette.clear();
+}
+
+/** Stores a skeletal mesh for drawing it later in FlushSkeletalMeshInstances */
+void D3D11GraphicsEngine::QueueSkeletalMeshInstance( SkeletalVobInfo* vi,
+    const std::vector<XMFLOAT4X4>& transforms, float4 color, float fatness ) {
+    SkeletalMeshVisualInfo* visual = static_cast<SkeletalMeshVisualInfo*>(vi->VisualInfo);
+
+    // Every NPC owns its visual info, so the key is made from what actually defines
+    // the geometry (the softskins) and the textures of its current body variation
+    SkeletalInstanceRecord record;
+    record.Visual = visual;
+    record.Hash = 0;
+    record.KeyOffset = static_cast<unsigned int>(SkeletalInstanceKeys.size());
+    record.Instance = static_cast<unsigned int>(SkeletalInstances.size());
+    record.LODLevel = vi->LODLevel;
+
+    zCModel* model = static_cast<zCModel*>(vi->Vob->GetVisual());
+    zCArray<zCMeshSoftSkin*>* skins = model ? model->GetMeshSoftSkinList() : nullptr;
+    if ( skins && skins->NumInArray > 0 ) {
+        for ( int i = 0; i < skins->NumInArray; i++ ) {
+            SkeletalInstanceKeys.push_back( skins->Array[i] );
+        }
+    } else {
+        SkeletalInstanceKeys.push_back( visual );
+    }
+    record.NumSkins = static_cast<unsigned int>(SkeletalInstanceKeys.size()) - record.KeyOffset;
+
+    for ( auto const& itm : visual->SkeletalMeshes ) {
+        zCMaterial* mat = itm.first;
+        SkeletalInstanceKeys.push_back( mat ? mat->GetAniTexture() : nullptr );
+    }
+    record.NumTextures = static_cast<unsigned int>(SkeletalInstanceKeys.size()) - record.KeyOffset - record.NumSkins;
+
+    for ( unsigned int i = record.KeyOffset; i < SkeletalInstanceKeys.size(); i++ ) {
+        Toolbox::hash_combine( record.Hash, static_cast<DWORD>(reinterpret_cast<uintptr_t>(SkeletalInstanceKeys[i])) );
+    }
+    Toolbox::hash_combine( record.Hash, static_cast<DWORD>(record.LODLevel) );
+
+    SkeletalMeshInstanceInfo instance = {};
+    instance.World = Engine::GAPI->GetRendererState().TransformState.TransformWorld;
+    instance.ModelColor = color;
+    instance.ModelFatness = fatness;
+    instance.BoneOffset = static_cast<UINT>(SkeletalBonePalette.size());
+
+    SkeletalInstances.push_back( instance );
+    SkeletalInstanceRecords.push_back( record );
+    SkeletalBonePalette.insert( SkeletalBonePalette.end(), transforms.begin(), transforms.end() );
+}
+
+/** Draws all collected skeletal meshes, one instanced drawcall per visual and material */
+void D3D11GraphicsEngine::FlushSkeletalMeshInstances() {
+    SkeletalMeshInstancingActive = false;
+    if ( SkeletalInstanceRecords.empty() ) {
+        return;
+    }
+
+    auto sameKey = [this]( const SkeletalInstanceRecord& a, const SkeletalInstanceRecord& b ) {
+        if ( a.Hash != b.Hash || a.LODLevel != b.LODLevel || a.NumSkins != b.NumSkins || a.NumTextures != b.NumTextures ) {
+            return false;
+        }
+        return std::equal( SkeletalInstanceKeys.begin() + a.KeyOffset,
+            SkeletalInstanceKeys.begin() + a.KeyOffset + a.NumSkins + a.NumTextures,
+            SkeletalInstanceKeys.begin() + b.KeyOffset );
+    };
+
+    std::stable_sort( SkeletalInstanceRecords.begin(), SkeletalInstanceRecords.end(),
+        []( const SkeletalInstanceRecord& a, const SkeletalInstanceRecord& b ) { return a.Hash < b.Hash; } );
+
+    // Put the instances into drawing order
+    std::vector<SkeletalMeshInstanceInfo> sortedInstances;
+    sortedInstances.reserve( SkeletalInstances.size() );
+    for ( const SkeletalInstanceRecord& record : SkeletalInstanceRecords ) {
+        sortedInstances.push_back( SkeletalInstances[record.Instance] );
+    }
+
+    const UINT instanceBytes = static_cast<UINT>(sizeof( SkeletalMeshInstanceInfo ) * sortedInstances.size());
+    const UINT boneBytes = static_cast<UINT>(sizeof( XMFLOAT4X4 ) * SkeletalBonePalette.size());
+
+    // Grow the buffers if needed, with some extra space so this doesn't happen every frame
+    if ( !SkeletalInstanceBuffer || SkeletalInstanceBuffer->GetSizeInBytes() < instanceBytes ) {
+        SkeletalInstanceBuffer = std::make_unique<D3D11VertexBuffer>();
+        SkeletalInstanceBuffer->Init(
+            nullptr, instanceBytes + sizeof( SkeletalMeshInstanceInfo ) * 32, D3D11VertexBuffer::B_SHADER_RESOURCE,
+            D3D11VertexBuffer::U_DYNAMIC, D3D11VertexBuffer::CA_WRITE, "SkeletalInstanceBuffer", sizeof( SkeletalMeshInstanceInfo ) );
+    }
+
+    if ( !SkeletalBoneBuffer || SkeletalBoneBuffer->GetSizeInBytes() < boneBytes ) {
+        SkeletalBoneBuffer = std::make_unique<D3D11VertexBuffer>();
+        SkeletalBoneBuffer->Init(
+            nullptr, boneBytes + sizeof( XMFLOAT4X4 ) * NUM_MAX_BONES * 8, D3D11VertexBuffer::B_SHADER_RESOURCE,
+            D3D11VertexBuffer::U_DYNAMIC, D3D11VertexBuffer::CA_WRITE, "SkeletalBoneBuffer", sizeof( XMFLOAT4X4 ) );
+    }
+
+    SkeletalInstanceBuffer->UpdateBuffer( &sortedInstances[0], instanceBytes );
+    SkeletalBoneBuffer->UpdateBuffer( &SkeletalBonePalette[0], boneBytes );
+
+    SetActiveVertexShader( HotShaders.VS_ExSkeletalInstanced );
+    InfiniteRangeConstantBuffer->BindToPixelShader( 3 );
+
+    SetupVS_ExMeshDrawCall();
+    SetupVS_ExConstantBuffer();
+
+    GetContext()->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+    ActiveVS->Apply();
+
+    ID3D11ShaderResourceView* srvs[2] = {
+        SkeletalInstanceBuffer->GetShaderResourceView().Get(),
+        SkeletalBoneBuffer->GetShaderResourceView().Get() };
+    GetContext()->VSSetShaderResources( 0, 2, srvs );
+
+    bool linearDepth = (Engine::GAPI->GetRendererState().GraphicsState.FF_GSwitches & GSWITCH_LINEAR_DEPTH) != 0;
+    if ( linearDepth ) {
+        ActivePS = PS_LinDepth;
+        ActivePS->Apply();
+    } else {
+        // It is only to indicate that we want pixel shader(to populate gbuffer)
+        // the actual shader will be activated before drawing
+        ActivePS = PS_LinDepth;
+    }
+
+    if ( ActiveHDS ) {
+        GetContext()->DSSetShader( nullptr, nullptr, 0 );
+        GetContext()->HSSetShader( nullptr, nullptr, 0 );
+        ActiveHDS = nullptr;
+    }
+
+    GothicRendererInfo& info = Engine::GAPI->GetRendererState().RendererInfo;
+
+    size_t first = 0;
+    while ( first < SkeletalInstanceRecords.size() ) {
+        size_t last = first + 1;
+        while ( last < SkeletalInstanceRecords.size() && sameKey( SkeletalInstanceRecords[first], SkeletalInstanceRecords[last] ) ) {
+            last++;
+        }
+
+        const SkeletalInstanceRecord& record = SkeletalInstanceRecords[first];
+        const UINT numInstances = static_cast<UINT>(last - first);
+
+        VS_ExConstantBuffer_SkeletalInstancing cb = {};
+        cb.SI_InstanceOffset = static_cast<UINT>(first);
+        ActiveVS->GetConstantBuffer()[1]->UpdateBuffer( &cb );
+        ActiveVS->GetConstantBuffer()[1]->BindToVertexShader( 1 );
+
+        unsigned int materialIndex = 0;
+        for ( auto const& itm : record.Visual->SkeletalMeshes ) {
+            // Textures were resolved when the mesh got queued, since they change per NPC
+            zCTexture* tex = static_cast<zCTexture*>(const_cast<void*>(
+                SkeletalInstanceKeys[record.KeyOffset + record.NumSkins + materialIndex]));
+            materialIndex++;
+
+            if ( itm.first && tex ) {
+                if ( !BindTextureNRFX( tex, true ) ) {
+                    continue;
+                }
+            }
+
+            for ( auto& mesh : itm.second ) {
+                UINT offset = 0;
+                UINT uStride = sizeof( ExSkelVertexStruct );
+                GetContext()->IASetVertexBuffers( 0, 1, mesh->MeshVertexBuffer->GetVertexBuffer().GetAddressOf(), &uStride, &offset );
+
+                unsigned int numIndices;
+                D3D11VertexBuffer* ib = mesh->GetIndexBufferForLOD( record.LODLevel, numIndices );
+                if ( sizeof( VERTEX_INDEX ) == sizeof( unsigned short ) ) {
+                    GetContext()->IASetIndexBuffer( ib->GetVertexBuffer().Get(),
+                        DXGI_FORMAT_R16_UINT, 0 );
+                } else {
+                    GetContext()->IASetIndexBuffer( ib->GetVertexBuffer().Get(),
+                        DXGI_FORMAT_R32_UINT, 0 );
+                }
+
+                GetContext()->DrawIndexedInstanced( numIndices, numInstances, 0, 0, 0 );
+
+                info.FrameDrawnTriangles += (numIndices / 3) * numInstances;
+                info.FrameSkeletalDrawCallsSaved += numInstances - 1;
+            }
+        }
+
+        info.FrameSkeletalInstanceBatches++;
+        first = last;
+    }
+
+    ID3D11ShaderResourceView* nullSrvs[2] = { nullptr, nullptr };
+    GetContext()->VSSetShaderResources( 0, 2, nullSrvs );
+
+    SkeletalInstanceRecords.clear();
+    SkeletalInstanceKeys.clear();
+    SkeletalInstances.clear();
+    SkeletalBonePalette.clear();
+}
+
 /** Draws a batch of instanced geometry */
 XRESULT D3D11GraphicsEngine::DrawInstanced(
     D3D11VertexBuffer* vb, D3D11VertexBuffer* ib, unsigned int numIndices,
     void* instanceData, unsigned int instanceDataStride,
     unsigned int numInstances, unsigned int vertexStride ) {
+    FlushHUDBatch();
+
     UpdateRenderStates();
 
     // Check buffersize
@@ -2024,6 +2505,8 @@ XRESULT D3D11GraphicsEngine::DrawInstanced(
     D3D11VertexBuffer* instanceData, unsigned int instanceDataStride,
     unsigned int numInstances, unsigned int vertexStride,
     unsigned int startInstanceNum, unsigned int indexOffset ) {
+    FlushHUDBatch();
+
     // Bind shader and pipeline flags
     UINT offset[] = { 0, 0 };
     UINT uStride[] = { vertexStride, instanceDataStride };
@@ -2070,6 +2553,21 @@ XRESULT D3D11GraphicsEngine::SetActiveVertexShader( const std::string& shader )
     return XR_SUCCESS;
 }
 
+/** Applies vs or its compressed variant, depending on the vertex format of the given static mesh visual */
+UINT D3D11GraphicsEngine::ApplyStaticMeshVertexShader( MeshVisualInfo* visual, const std::shared_ptr<D3D11VShader>& vs, const std::shared_ptr<D3D11VShader>& vsCompressed ) {
+    const std::shared_ptr<D3D11VShader>& wanted = visual->VertexDecodeBuffer ? vsCompressed : vs;
+    if ( ActiveVS != wanted ) {
+        ActiveVS = wanted;
+        ActiveVS->Apply();
+    }
+
+    if ( visual->VertexDecodeBuffer ) {
+        visual->VertexDecodeBuffer->BindToVertexShader( 2 );
+        return sizeof( ExVertexStructCompressed );
+    }
+    return sizeof( ExVertexStruct );
+}
+
 XRESULT D3D11GraphicsEngine::SetActiveHDShader( const std::string& shader ) {
     ActiveHDS = ShaderManager->GetHDShader( shader );
 
@@ -2166,6 +2664,8 @@ XRESULT D3D11GraphicsEngine::UpdateRenderStates() {
 
 /** Called when we started to render the world */
 XRESULT D3D11GraphicsEngine::OnStartWorldRendering() {
+    FlushHUDBatch();
+
     SetDefaultStates();
 
     if ( Engine::GAPI->GetRendererState().RendererSettings.DisableRendering )
@@ -2335,6 +2835,9 @@ XRESULT D3D11GraphicsEngine::OnStartWorldRendering() {
     if ( Engine::GAPI->GetRendererState().RendererSettings.EnableSMAA ) {
         PfxRenderer->RenderSMAA();
         GetContext()->PSSetSamplers( 0, 1, DefaultSamplerState.GetAddressOf() );
+    } else {
+        // T2x may have left a jitter behind
+        Engine::GAPI->SetProjectionJitter( XMFLOAT2( 0, 0 ) );
     }
 
     PresentPending = true;
@@ -2690,6 +3193,37 @@ XRESULT D3D11GraphicsEngine::DrawMeshInfoListAlphablended(
     return XR_SUCCESS;
 }
 
+/** Culls the clusters of the given world mesh and fills its VisibleClusterRanges */
+bool D3D11GraphicsEngine::CullWorldMeshClusters( WorldMeshInfo* mesh, const XMFLOAT4* frustumPlanes, const XMFLOAT3& cameraPosition, float maxDistance ) {
+    auto& ranges = mesh->VisibleClusterRanges;
+    ranges.clear();
+
+    if ( mesh->Clusters.empty() || !Engine::GAPI->GetRendererState().RendererSettings.EnableWorldMeshClusterCulling ) {
+        ranges.emplace_back( 0, mesh->Indices.size() );
+        return true;
+    }
+
+    auto& info = Engine::GAPI->GetRendererState().RendererInfo;
+    for ( const WorldMeshCluster& cluster : mesh->Clusters ) {
+        if ( WorldClusterCulling::TestCluster( cluster, frustumPlanes, cameraPosition, maxDistance ) != WorldClusterCulling::CR_VISIBLE ) {
+            info.FrameWorldClustersCulled++;
+            info.FrameWorldTrianglesCulled += cluster.NumIndices / 3;
+            continue;
+        }
+
+        info.FrameWorldClustersDrawn++;
+
+        // Clusters are sorted by their offset, so neighbours can go into a single drawcall
+        if ( !ranges.empty() && ranges.back().first + ranges.back().second == cluster.IndexOffset ) {
+            ranges.back().second += cluster.NumIndices;
+        } else {
+            ranges.emplace_back( cluster.IndexOffset, cluster.NumIndices );
+        }
+    }
+
+    return !ranges.empty();
+}
+
 XRESULT D3D11GraphicsEngine::DrawWorldMesh( bool noTextures ) {
     if ( !Engine::GAPI->GetRendererState().RendererSettings.DrawWorldMesh )
         return XR_SUCCESS;
@@ -2727,6 +3261,16 @@ XRESULT D3D11GraphicsEngine::DrawWorldMesh( bool noTextures ) {
     static std::vector<WorldMeshSectionInfo*> renderList; renderList.clear();
     Engine::GAPI->CollectVisibleSections( renderList );
 
+    // Side planes of the view frustum for cluster culling, taken from the transposed viewproj-matrix
+    XMFLOAT4X4 viewProj;
+    XMStoreFloat4x4( &viewProj, XMMatrixMultiply( XMLoadFloat4x4( &Engine::GAPI->GetProjectionMatrix() ), XMLoadFloat4x4( &Engine::GAPI->GetRendererState().TransformState.TransformView ) ) );
+    XMFLOAT4 frustumPlanes[4];
+    WorldClusterCulling::GetFrustumSidePlanes( viewProj, frustumPlanes );
+
+    XMFLOAT3 cameraPosition = Engine::GAPI->GetCameraPosition();
+    float clusterDrawDistance = Engine::GAPI->GetRendererState().RendererSettings.SectionDrawRadius * WORLD_SECTION_SIZE;
+    WorldClusterCulling::RecordFrame( cameraPosition, viewProj, clusterDrawDistance );
+
     MeshInfo* meshInfo = Engine::GAPI->GetWrappedWorldMesh();
     DrawVertexBufferIndexedUINT( meshInfo->MeshVertexBuffer, meshInfo->MeshIndexBuffer, 0, 0 );
 
@@ -2773,6 +3317,9 @@ XRESULT D3D11GraphicsEngine::DrawWorldMesh( bool noTextures ) {
                     worldMesh.first.Material->GetAlphaFunc() != zMAT_ALPHA_FUNC_TEST ) {
                     FrameTransparencyMeshes.push_back( worldMesh );
                 } else {
+                    if ( !CullWorldMeshClusters( worldMesh.second, frustumPlanes, cameraPosition, clusterDrawDistance ) )
+                        continue;
+
                     // Create a new pair using the animated texture
                     meshList.emplace_back( key, worldMesh.second );
                     std::push_heap( meshList.begin(), meshList.end(), CompareMesh );
@@ -2800,7 +3347,9 @@ XRESULT D3D11GraphicsEngine::DrawWorldMesh( bool noTextures ) {
                 continue;  // Don't pre-render tesselated surfaces
 #endif
 
-            DrawVertexBufferIndexedUINT( nullptr, nullptr, mesh.second->Indices.size(), mesh.second->BaseIndexLocation );
+            for ( auto const& range : mesh.second->VisibleClusterRanges ) {
+                DrawVertexBufferIndexedUINT( nullptr, nullptr, range.second, mesh.second->BaseIndexLocation + range.first );
+            }
         }
     }
 
@@ -2925,9 +3474,13 @@ XRESULT D3D11GraphicsEngine::DrawWorldMesh( bool noTextures ) {
             } else
 #endif
             {
+                // Bind the buffers, then draw what survived the cluster culling
                 DrawVertexBufferIndexed( mesh.second->MeshVertexBuffer,
-                    mesh.second->MeshIndexBuffer,
-                    mesh.second->Indices.size() );
+                    mesh.second->MeshIndexBuffer, 0 );
+
+                for ( auto const& range : mesh.second->VisibleClusterRanges ) {
+                    DrawVertexBufferIndexed( nullptr, nullptr, range.second, range.first );
+                }
             }
         }
 
@@ -3405,6 +3958,9 @@ void XM_CALLCONV D3D11GraphicsEngine::DrawWorldAround(
         } else {
             for ( auto&& itx : Engine::GAPI->GetWorldSections() ) {
                 for ( auto&& ity : itx.second ) {
+                    if ( ity.second.StreamingState != WorldMeshSectionInfo::SS_RESIDENT )
+                        continue;
+
                     float vLen; XMStoreFloat( &vLen, XMVector3Length( XMVectorSet( static_cast<float>(itx.first - s.x), static_cast<float>(ity.first - s.y), 0, 0 ) ) );
 
                     if ( vLen < 2 ) {
@@ -3473,14 +4029,14 @@ void XM_CALLCONV D3D11GraphicsEngine::DrawWorldAround(
                     // Check vob range
 
                     float dist;
-                    XMStoreFloat( &dist, XMVector3Length( position - XMLoadFloat3( &it->LastRenderPosition ) ) );
+                    XMStoreFloat( &dist, XMVector3Length( position - XMLoadFloat3( &it->GetLastRenderPosition() ) ) );
                     if ( dist > range ) {
                         continue;
                     }
 
                     // Check for inside vob. Don't render inside-vobs when the light is
                     // outside and vice-versa.
-                    if ( isOutdoor && it->IsIndoorVob != indoor ) {
+                    if ( isOutdoor && it->IsIndoorVob() != indoor ) {
                         continue;
                     }
                     rndVob.emplace_back( it );
@@ -3492,7 +4048,15 @@ void XM_CALLCONV D3D11GraphicsEngine::DrawWorldAround(
 
         // At this point either renderedVobs or rndVob is filled with something
         std::list<VobInfo*>& rl = renderedVobs != nullptr ? *renderedVobs : rndVob;
+
+        // Compressed visuals need the decoding variant of whatever shader the caller set up
+        std::shared_ptr<D3D11VShader> vobVS = ActiveVS;
+        std::shared_ptr<D3D11VShader> vobVSCompressed = ShaderManager->GetVShader(
+            vobVS == ShaderManager->GetVShader( "VS_ExCube" ) ? "VS_ExCubeCompressed" : "VS_ExCompressed" );
+
         for ( auto const& vobInfo : rl ) {
+            UINT vertexStride = ApplyStaticMeshVertexShader( static_cast<MeshVisualInfo*>(vobInfo->VisualInfo), vobVS, vobVSCompressed );
+
             // Bind per-instance buffer
             vobInfo->VobConstantBuffer->BindToVertexShader( 1 );
 
@@ -3513,10 +4077,15 @@ void XM_CALLCONV D3D11GraphicsEngine::DrawWorldAround(
                     DrawVertexBufferIndexed(
                         meshInfo->MeshVertexBuffer,
                         meshInfo->MeshIndexBuffer,
-                        meshInfo->Indices.size() );
+                        meshInfo->Indices.size(), 0, vertexStride );
                 }
             }
         }
+
+        if ( ActiveVS != vobVS ) {
+            ActiveVS = vobVS;
+            ActiveVS->Apply();
+        }
     }
 
     bool renderNPCs = !noNPCs;
@@ -3606,7 +4175,7 @@ void XM_CALLCONV D3D11GraphicsEngine::DrawWorldAround(
 /** Draws everything around the given position */
 void XM_CALLCONV D3D11GraphicsEngine::DrawWorldAround( FXMVECTOR position,
     int sectionRange, float vobXZRange,
-    bool cullFront, bool dontCull ) {
+    bool cullFront, bool dontCull, const ShadowCascadeInfo* cascade ) {
     // Setup renderstates
     Engine::GAPI->GetRendererState().RasterizerState.SetDefault();
     Engine::GAPI->GetRendererState().RasterizerState.CullMode =
@@ -3683,6 +4252,8 @@ void XM_CALLCONV D3D11GraphicsEngine::DrawWorldAround( FXMVECTOR position,
         Engine::GAPI->GetRendererState().BlendState.ColorWritesEnabled;
     float alphaRef = Engine::GAPI->GetRendererState().GraphicsState.FF_AlphaRef;
 
+    int& culledCasters = Engine::GAPI->GetRendererState().RendererInfo.FrameShadowCastersCulled;
+
     if ( Engine::GAPI->GetRendererState().RendererSettings.DrawWorldMesh ) {
         // Bind wrapped mesh vertex buffers
         DrawVertexBufferIndexedUINT(
@@ -3695,10 +4266,24 @@ void XM_CALLCONV D3D11GraphicsEngine::DrawWorldAround( FXMVECTOR position,
         for ( const auto& itx : Engine::GAPI->GetWorldSections() ) {
             for ( const auto& ity : itx.second ) {
 
-                float len;
-                XMStoreFloat( &len, XMVector2Length( XMVectorSet( static_cast<float>(itx.first - s.x), static_cast<float>(ity.first - s.y), 0, 0 ) ) );
-                if ( len < sectionRange ) {
-                    const WorldMeshSectionInfo& section = ity.second;
+                const WorldMeshSectionInfo& section = ity.second;
+                if ( section.StreamingState != WorldMeshSectionInfo::SS_RESIDENT )
+                    continue;
+
+                bool drawSection;
+                if ( cascade ) {
+                    // Shadow cascades cull the sections against their own box instead of using the range
+                    drawSection = section.BoundingBox.Min.x <= section.BoundingBox.Max.x &&
+                        cascade->IntersectsBox( section.BoundingBox );
+                    if ( !drawSection )
+                        culledCasters++;
+                } else {
+                    float len;
+                    XMStoreFloat( &len, XMVector2Length( XMVectorSet( static_cast<float>(itx.first - s.x), static_cast<float>(ity.first - s.y), 0, 0 ) ) );
+                    drawSection = len < sectionRange;
+                }
+
+                if ( drawSection ) {
 
                     if ( Engine::GAPI->GetRendererState().RendererSettings.FastShadows ) {
                         // Draw world mesh
@@ -3747,55 +4332,27 @@ void XM_CALLCONV D3D11GraphicsEngine::DrawWorldAround( FXMVECTOR position,
         const std::unordered_map<zCProgMeshProto*, MeshVisualInfo*>& staticMeshVisuals =
             Engine::GAPI->GetStaticMeshVisuals();
 
-        for ( auto const& it : RenderedVobs ) {
-            if ( !it->IsIndoorVob ) {
-                //VobInstanceInfo vii;
-                //vii.world = it->WorldMatrix;
-                //static_cast<MeshVisualInfo*>(it->VisualInfo)->Instances.emplace_back( vii );
-
-                // We don't need vob world matrix because the data is already in buffer
-                static_cast<MeshVisualInfo*>(it->VisualInfo)->Instances.emplace_back();
-            }
-        }
-
         // Apply instancing shader
         SetActiveVertexShader( "VS_ExInstancedObj" );
         // SetActivePixelShader("PS_DiffuseAlphaTest");
         ActiveVS->Apply();
 
+        std::shared_ptr<D3D11VShader> vsInstanced = ActiveVS;
+        std::shared_ptr<D3D11VShader> vsInstancedCompressed = ShaderManager->GetVShader( "VS_ExInstancedObjCompressed" );
+
         if ( !linearDepth )  // Only unbind when not rendering linear depth
         {
             // Unbind PS
             GetContext()->PSSetShader( nullptr, nullptr, 0 );
         }
 
-        // Static meshes should already be in buffer from main stage rendering
-        /*size_t ByteWidth = DynamicInstancingBuffer->GetSizeInBytes();
-        byte* data;
-        UINT size;
-        UINT loc = 0;
-        DynamicInstancingBuffer->Map( D3D11VertexBuffer::M_WRITE_DISCARD,
-            reinterpret_cast<void**>(&data), &size );
-        for ( auto const& staticMeshVisual : staticMeshVisuals ) {
-            if ( staticMeshVisual.second->Instances.empty() ) continue;
-
-            if ( (loc + staticMeshVisual.second->Instances.size()) * sizeof( VobInstanceInfo ) >= ByteWidth )
-                break;  // Should never happen
-
-            staticMeshVisual.second->StartInstanceNum = loc;
-            memcpy( data + loc * sizeof( VobInstanceInfo ), &staticMeshVisual.second->Instances[0],
-                sizeof( VobInstanceInfo ) * staticMeshVisual.second->Instances.size() );
-            loc += staticMeshVisual.second->Instances.size();
-        }
-        DynamicInstancingBuffer->Unmap();*/
-
-        // Draw all vobs the player currently sees
-        for ( auto const& staticMeshVisual : staticMeshVisuals ) {
-            if ( staticMeshVisual.second->Instances.empty() ) continue;
+        // Draws all instances of a visual, returns false if the visual has alphablended parts
+        auto drawVisualInstanced = [&]( MeshVisualInfo* visual, D3D11VertexBuffer* instanceBuffer, UINT numInstances, UINT startInstance ) {
+            UINT vertexStride = ApplyStaticMeshVertexShader( visual, vsInstanced, vsInstancedCompressed );
 
             bool doReset = true;
-            for ( auto const& itt : staticMeshVisual.second->MeshesByTexture ) {
-                std::vector<MeshInfo*>& mlist = staticMeshVisual.second->MeshesByTexture[itt.first];
+            for ( auto const& itt : visual->MeshesByTexture ) {
+                const std::vector<MeshInfo*>& mlist = itt.second;
                 if ( mlist.empty() ) continue;
 
                 for ( unsigned int i = 0; i < mlist.size(); i++ ) {
@@ -3831,17 +4388,90 @@ void XM_CALLCONV D3D11GraphicsEngine::DrawWorldAround( FXMVECTOR position,
 
                     // Draw batch
                     DrawInstanced( mi->MeshVertexBuffer, mi->MeshIndexBuffer,
-                        mi->Indices.size(), DynamicInstancingBuffer.get(),
-                        sizeof( VobInstanceInfo ), staticMeshVisual.second->Instances.size(),
-                        sizeof( ExVertexStruct ), staticMeshVisual.second->StartInstanceNum );
+                        mi->Indices.size(), instanceBuffer,
+                        sizeof( VobInstanceInfo ), numInstances,
+                        vertexStride, startInstance );
 
-                    Engine::GAPI->GetRendererState().RendererInfo.FrameDrawnVobs +=
-                        staticMeshVisual.second->Instances.size();
+                    Engine::GAPI->GetRendererState().RendererInfo.FrameDrawnVobs += numInstances;
                 }
             }
 
-            // Reset visual
-            if ( doReset ) staticMeshVisual.second->StartNewFrame();
+            return doReset;
+        };
+
+        if ( cascade ) {
+            // Only use the vobs inside this cascade. The main-stage instancing data can't be
+            // used for this, so the casters get their own buffer, sorted by visual.
+            static std::vector<VobInfo*> casterVobs;
+            casterVobs.clear();
+
+            for ( auto const& it : RenderedVobs ) {
+                if ( it->IsIndoorVob() ) continue;
+
+                if ( cascade->IntersectsBox( it->Vob->GetBBox() ) )
+                    casterVobs.push_back( it );
+                else
+                    culledCasters++;
+            }
+
+            std::sort( casterVobs.begin(), casterVobs.end(), []( const VobInfo* a, const VobInfo* b ) {
+                return a->VisualInfo < b->VisualInfo;
+                } );
+
+            if ( ShadowInstancingBuffer->GetSizeInBytes() < sizeof( VobInstanceInfo ) * casterVobs.size() ) {
+                ShadowInstancingBuffer->Init(
+                    nullptr, sizeof( VobInstanceInfo ) * casterVobs.size(),
+                    D3D11VertexBuffer::B_VERTEXBUFFER, D3D11VertexBuffer::U_DYNAMIC,
+                    D3D11VertexBuffer::CA_WRITE );
+                SetDebugName( ShadowInstancingBuffer->GetVertexBuffer().Get(), "ShadowInstancingBuffer->VertexBuffer" );
+            }
+
+            if ( !casterVobs.empty() ) {
+                VobInstanceInfo* data;
+                UINT size;
+                ShadowInstancingBuffer->Map( D3D11VertexBuffer::M_WRITE_DISCARD,
+                    reinterpret_cast<void**>(&data), &size );
+                for ( size_t i = 0; i < casterVobs.size(); i++ ) {
+                    data[i].world = casterVobs[i]->GetWorldMatrix();
+                    data[i].color = casterVobs[i]->GetGroundColor();
+                }
+                ShadowInstancingBuffer->Unmap();
+            }
+
+            // Draw one batch per visual
+            size_t first = 0;
+            while ( first < casterVobs.size() ) {
+                size_t last = first + 1;
+                while ( last < casterVobs.size() && casterVobs[last]->VisualInfo == casterVobs[first]->VisualInfo )
+                    last++;
+
+                drawVisualInstanced( static_cast<MeshVisualInfo*>(casterVobs[first]->VisualInfo),
+                    ShadowInstancingBuffer.get(), static_cast<UINT>(last - first), static_cast<UINT>(first) );
+                first = last;
+            }
+        } else {
+            for ( auto const& it : RenderedVobs ) {
+                if ( !it->IsIndoorVob() ) {
+                    //VobInstanceInfo vii;
+                    //vii.world = it->WorldMatrix;
+                    //static_cast<MeshVisualInfo*>(it->VisualInfo)->Instances.emplace_back( vii );
+
+                    // We don't need vob world matrix because the data is already in buffer
+                    static_cast<MeshVisualInfo*>(it->VisualInfo)->Instances.emplace_back();
+                }
+            }
+
+            // Static meshes should already be in buffer from main stage rendering
+            // Draw all vobs the player currently sees
+            for ( auto const& staticMeshVisual : staticMeshVisuals ) {
+                if ( staticMeshVisual.second->Instances.empty() ) continue;
+
+                bool doReset = drawVisualInstanced( staticMeshVisual.second, DynamicInstancingBuffer.get(),
+                    staticMeshVisual.second->Instances.size(), staticMeshVisual.second->StartInstanceNum );
+
+                // Reset visual
+                if ( doReset ) staticMeshVisual.second->StartNewFrame();
+            }
         }
     }
 
@@ -3859,6 +4489,11 @@ void XM_CALLCONV D3D11GraphicsEngine::DrawWorldAround( FXMVECTOR position,
             if ( dist > Engine::GAPI->GetRendererState().RendererSettings.IndoorVobDrawRadius )
                 continue;  // Skip out of range
 
+            if ( cascade && !cascade->IntersectsBox( skeletalMeshVob->Vob->GetBBox() ) ) {
+                culledCasters++;
+                continue;
+            }
+
             Engine::GAPI->DrawSkeletalMeshVob( skeletalMeshVob, FLT_MAX );
         }
     }
@@ -3919,6 +4554,9 @@ XRESULT D3D11GraphicsEngine::DrawVOBsInstanced() {
     SetupVS_ExMeshDrawCall();
     SetupVS_ExConstantBuffer();
 
+    std::shared_ptr<D3D11VShader> vsInstanced = ActiveVS;
+    std::shared_ptr<D3D11VShader> vsInstancedCompressed = ShaderManager->GetVShader( "VS_ExInstancedObjCompressed" );
+
 #if ENABLE_TESSELATION > 0
     bool tesselationEnabled =
         Engine::GAPI->GetRendererState().RendererSettings.EnableTesselation;
@@ -3978,7 +4616,7 @@ XRESULT D3D11GraphicsEngine::DrawVOBsInstanced() {
         DynamicInstancingBuffer->Unmap();
 
         for ( unsigned int i = 0; i < vobs.size(); i++ ) {
-            vobs[i]->VisibleInRenderPass = false;  // Reset this for the next frame
+            vobs[i]->SetVisibleInRenderPass( false );  // Reset this for the next frame
             RenderedVobs.push_back( vobs[i] );
         }
 
@@ -4109,8 +4747,11 @@ XRESULT D3D11GraphicsEngine::DrawVOBsInstanced() {
                     }
 
 #if ENABLE_TESSELATION > 0
+                    // The PNAEN shaders read ExVertexStruct, compressed visuals are drawn untesselated. Tesselation
+                    // can be turned on in the editor after the visual was compressed.
                     if ( tesselationEnabled && !mi->IndicesPNAEN.empty() &&
                         RenderingStage == DES_MAIN &&
+                        !staticMeshVisual.second->VertexDecodeBuffer &&
                         staticMeshVisual.second->TesselationInfo.buffer.VT_TesselationFactor > 0.0f ) {
                         Setup_PNAEN( PNAEN_Instanced );
                         staticMeshVisual.second->TesselationInfo.Constantbuffer->BindToDomainShader( 1 );
@@ -4134,11 +4775,13 @@ XRESULT D3D11GraphicsEngine::DrawVOBsInstanced() {
                     } else
 #endif
                     {
+                        UINT vertexStride = ApplyStaticMeshVertexShader( staticMeshVisual.second, vsInstanced, vsInstancedCompressed );
+
                         // Draw batch
                         DrawInstanced( mi->MeshVertexBuffer, mi->MeshIndexBuffer,
                             mi->Indices.size(), DynamicInstancingBuffer.get(),
                             sizeof( VobInstanceInfo ), staticMeshVisual.second->Instances.size(),
-                            sizeof( ExVertexStruct ), staticMeshVisual.second->StartInstanceNum );
+                            vertexStride, staticMeshVisual.second->StartInstanceNum );
                     }
                 }
             }
@@ -4200,6 +4843,8 @@ XRESULT D3D11GraphicsEngine::DrawVOBsInstanced() {
     SetupVS_ExMeshDrawCall();
     SetupVS_ExConstantBuffer();
 
+    vsInstanced = ActiveVS;
+
     GetContext()->OMSetRenderTargets( 1, HDRBackBuffer->GetRenderTargetView().GetAddressOf(),
         DepthStencilBuffer->GetDepthStencilView().Get() );
 
@@ -4254,10 +4899,12 @@ XRESULT D3D11GraphicsEngine::DrawVOBsInstanced() {
             info->Constantbuffer->BindToPixelShader( 2 );
         }
 
+        UINT vertexStride = ApplyStaticMeshVertexShader( vi, vsInstanced, vsInstancedCompressed );
+
         // Draw batch
         DrawInstanced( mi->MeshVertexBuffer, mi->MeshIndexBuffer, mi->Indices.size(),
             DynamicInstancingBuffer.get(), sizeof( VobInstanceInfo ),
-            instances, sizeof( ExVertexStruct ),
+            instances, vertexStride,
             vi->StartInstanceNum );
 
         // Reset visual
@@ -4567,6 +5214,8 @@ XRESULT D3D11GraphicsEngine::OnKeyDown( unsigned int key ) {
 
 /** Reloads shaders */
 XRESULT D3D11GraphicsEngine::ReloadShaders() {
+    FlushHUDBatch();
+
     XRESULT xr = ShaderManager->ReloadShaders();
 
     return xr;
@@ -4585,9 +5234,6 @@ XRESULT D3D11GraphicsEngine::DrawLighting( std::vector<VobLightInfo*>& lights )
     // ********************************
     // Draw world shadows
     // ********************************
-    CameraReplacement cr;
-    XMFLOAT3 cameraPosition;
-    XMStoreFloat3( &cameraPosition, Engine::GAPI->GetCameraPositionXM() );
     FXMVECTOR vPlayerPosition =
         Engine::GAPI->GetPlayerVob() != nullptr
         ? Engine::GAPI->GetPlayerVob()->GetPositionWorldXM()
@@ -4688,51 +5334,10 @@ XRESULT D3D11GraphicsEngine::DrawLighting( std::vector<VobLightInfo*>& lights )
         dir = XMVectorDivide( _mm_cvtepi32_ps( _mm_cvtps_epi32( XMVectorMultiply( dir, scale ) ) ), scale );
     }
 
-    static XMVECTOR oldP = XMVectorZero();
-    XMVECTOR WorldShadowCP;
-    // Update position
-    // Try to update only if the camera went 200 units away from the last position
-    float len;
-    XMStoreFloat( &len, XMVector3Length( oldP - XMLoadFloat3( &cameraPosition ) ) );
-    if ( (len < 64 &&
-        // And is on even space
-        (cameraPosition.x - static_cast<int>(cameraPosition.x)) < 0.1f &&
-        // but don't let it go too far
-        (cameraPosition.y - static_cast<int>(cameraPosition.y)) < 0.1f) || len < 200.0f ) {
-        WorldShadowCP = oldP;
-    } else {
-        oldP = XMLoadFloat3( &cameraPosition );
-        WorldShadowCP = oldP;
-    }
-
-    // Set the camera height to the highest point in this section
-    FXMVECTOR p = WorldShadowCP + dir * 10000.0f;
-
-    FXMVECTOR lookAt = WorldShadowCP;
-
-    // Create shadowmap view-matrix
-    static const XMVECTORF32 c_XM_Up = { { { 0, 1, 0, 0 } } };
-    XMMATRIX crViewRepl = XMMatrixTranspose( XMMatrixLookAtLH( p, lookAt, c_XM_Up ) );
-
-    XMMATRIX crProjRepl =
-        XMMatrixTranspose( XMMatrixOrthographicLH(
-            WorldShadowmap1->GetSizeX() * Engine::GAPI->GetRendererState().RendererSettings.WorldShadowRangeScale,
-            WorldShadowmap1->GetSizeX() * Engine::GAPI->GetRendererState().RendererSettings.WorldShadowRangeScale,
-            1.f,
-            20000.f ) );
-
-    XMStoreFloat4x4( &cr.ViewReplacement, crViewRepl );
-    XMStoreFloat4x4( &cr.ProjectionReplacement, crProjRepl );
-    XMStoreFloat3( &cr.PositionReplacement, p );
-    XMStoreFloat3( &cr.LookAtReplacement, lookAt );
-
-    // Replace gothics camera
-    Engine::GAPI->SetCameraReplacementPtr( &cr );
-
     // Indoor worlds don't need shadowmaps for the world
     static zTBspMode lastBspMode = zBSP_MODE_OUTDOOR;
     if ( Engine::GAPI->GetLoadedWorldInfo()->BspTree->GetBspTreeMode() == zBSP_MODE_OUTDOOR ) {
-        RenderShadowmaps( WorldShadowCP, nullptr, true );
+        RenderShadowCascades( dir );
         lastBspMode = zBSP_MODE_OUTDOOR;
     } else if ( Engine::GAPI->GetRendererState().RendererSettings.EnableShadows ) {
         // We need to clear shadowmap to avoid some glitches in indoor locations
@@ -4924,18 +5529,22 @@ XRESULT D3D11GraphicsEngine::DrawLighting( std::vector<VobLightInfo*>& lights )
     float rain = Engine::GAPI->GetRainFXWeight();
     float wetness = Engine::GAPI->GetSceneWetness();
 
-    // Switch global light shader when raining
+    GSky* sky = Engine::GAPI->GetSky();
+
+    // Switch global light shader when raining, and skip the shadowmaps while the sun is below the horizon
+    unsigned int sunFeatures = 0;
     if ( wetness > 0.0f ) {
-        SetActivePixelShader( "PS_DS_AtmosphericScattering_Rain" );
-    } else {
-        SetActivePixelShader( "PS_DS_AtmosphericScattering" );
+        sunFeatures |= DSF_RAIN;
     }
+    if ( sky->GetAtmosphereCB().AC_LightPos.y <= 0.0f ) {
+        sunFeatures |= DSF_NIGHT;
+    }
+    SetActivePixelShader( ShaderManager->GetPermutationVariant( HotShaders.PS_DS_AtmosphericScattering, sunFeatures ) );
 
     SetActiveVertexShader( "VS_PFX" );
 
     SetupVS_ExMeshDrawCall();
 
-    GSky* sky = Engine::GAPI->GetSky();
     ActivePS->GetConstantBuffer()[1]->UpdateBuffer( &sky->GetAtmosphereCB() );
     ActivePS->GetConstantBuffer()[1]->BindToPixelShader( 1 );
 
@@ -4958,10 +5567,17 @@ XRESULT D3D11GraphicsEngine::DrawLighting( std::vector<VobLightInfo*>& lights )
 
     scb.SQ_LightColor = float4( sunColor.x, sunColor.y, sunColor.z, sunStrength );
 
-    scb.SQ_ShadowView = cr.ViewReplacement;
-    scb.SQ_ShadowProj = cr.ProjectionReplacement;
+    scb.SQ_ShadowView = ShadowCascades[0].Camera.ViewReplacement;
+    scb.SQ_ShadowProj = ShadowCascades[0].Camera.ProjectionReplacement;
     scb.SQ_ShadowmapSize = static_cast<float>(WorldShadowmap1->GetSizeX());
 
+    int numCascades = static_cast<int>(WorldShadowmap1->GetArraySize());
+    for ( int i = 0; i < numCascades; i++ ) {
+        scb.SQ_CascadeViewProj[i] = ShadowCascades[i].ViewProj;
+        scb.SQ_CascadeBias[i] = ShadowCascades[i].DepthBias;
+    }
+    scb.SQ_NumShadowCascades = static_cast<float>(numCascades);
+
     // Get rain matrix
     scb.SQ_RainView = Effects->GetRainShadowmapCameraRepl().ViewReplacement;
     scb.SQ_RainProj = Effects->GetRainShadowmapCameraRepl().ProjectionReplacement;
@@ -5096,7 +5712,8 @@ void XM_CALLCONV D3D11GraphicsEngine::RenderShadowmaps( FXMVECTOR cameraPosition
     RenderToDepthStencilBuffer* target,
     bool cullFront, bool dontCull,
     Microsoft::WRL::ComPtr<ID3D11DepthStencilView> dsvOverwrite,
-    Microsoft::WRL::ComPtr<ID3D11RenderTargetView> debugRTV ) {
+    Microsoft::WRL::ComPtr<ID3D11RenderTargetView> debugRTV,
+    const ShadowCascadeInfo* cascade ) {
     if ( !target ) {
         target = WorldShadowmap1.get();
     }
@@ -5145,7 +5762,7 @@ void XM_CALLCONV D3D11GraphicsEngine::RenderShadowmaps( FXMVECTOR cameraPosition
         GetContext()->ClearDepthStencilView( dsvOverwrite.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0 );
 
         // Draw the world mesh without textures
-        DrawWorldAround( cameraPosition, 2, 10000.0f, cullFront, dontCull );
+        DrawWorldAround( cameraPosition, 2, 10000.0f, cullFront, dontCull, cascade );
     } else {
         if ( Engine::GAPI->GetSky()->GetAtmoshpereSettings().LightDirection.y <= 0 ) {
             GetContext()->ClearDepthStencilView( dsvOverwrite.Get(), D3D11_CLEAR_DEPTH, 0.0f,
@@ -5166,8 +5783,148 @@ void XM_CALLCONV D3D11GraphicsEngine::RenderShadowmaps( FXMVECTOR cameraPosition
         WORLD_SECTION_SIZE );
 }
 
+/** Returns true if the given world-space box touches the light-space box of this cascade */
+bool ShadowCascadeInfo::IntersectsBox( const zTBBox3D& box ) const {
+    XMVECTOR bbMin = XMLoadFloat3( &box.Min );
+    XMVECTOR bbMax = XMLoadFloat3( &box.Max );
+
+    // Test the bounding sphere of the box, this is stable under the light rotation
+    float radius;
+    XMStoreFloat( &radius, XMVector3Length( bbMax - bbMin ) );
+    radius *= 0.5f;
+
+    XMFLOAT3 center;
+    XMStoreFloat3( &center, XMVector3Transform( (bbMin + bbMax) * 0.5f, XMLoadFloat4x4( &LightView ) ) );
+
+    return center.x + radius >= LightSpaceMin.x && center.x - radius <= LightSpaceMax.x &&
+        center.y + radius >= LightSpaceMin.y && center.y - radius <= LightSpaceMax.y &&
+        center.z + radius >= LightSpaceMin.z && center.z - radius <= LightSpaceMax.z;
+}
+
+/** (Re)creates the cascaded sun shadowmap */
+void D3D11GraphicsEngine::CreateWorldShadowmap( int size, int numCascades ) {
+    GothicRendererSettings& settings = Engine::GAPI->GetRendererState().RendererSettings;
+
+    numCascades = std::min<int>( std::max<int>( numCascades, 1 ), MAX_SHADOW_CASCADES );
+
+    // Every cascade gets a full slice, so keep the total size in check
+    if ( numCascades > 1 )
+        size = std::min<int>( size, 8192 );
+
+    WorldShadowmap1 = std::make_unique<RenderToDepthStencilBuffer>(
+        GetDevice().Get(), size, size, DXGI_FORMAT_R16_TYPELESS, nullptr, DXGI_FORMAT_D16_UNORM,
+        DXGI_FORMAT_R16_UNORM, numCascades, true );
+    SetDebugName( WorldShadowmap1->GetTexture().Get(), "WorldShadowmap1->Texture" );
+    SetDebugName( WorldShadowmap1->GetShaderResView().Get(), "WorldShadowmap1->ShaderResView" );
+    SetDebugName( WorldShadowmap1->GetDepthStencilView().Get(), "WorldShadowmap1->DepthStencilView" );
+    WorldShadowmap1->SetMemoryCategory( ResidencyManager::C_SHADOW_MAPS );
+
+    settings.ShadowMapSize = size;
+    settings.NumShadowCascades = numCascades;
+
+    // Everything has to be rendered again before it can be used
+    ShadowCascadesValid = false;
+}
+
+/** Fits the sun shadow cascades to the camera frustum and renders the ones due this frame */
+void XM_CALLCONV D3D11GraphicsEngine::RenderShadowCascades( FXMVECTOR lightDir ) {
+    const GothicRendererSettings& settings = Engine::GAPI->GetRendererState().RendererSettings;
+
+    // Offset towards the sun to catch shadowcasters outside of the cascade
+    const float SHADOW_CASTER_DISTANCE = 10000.0f;
+    // Start of the logarithmic part of the split scheme
+    const float CASCADE_SPLIT_NEAR = 100.0f;
+
+    int numCascades = static_cast<int>(WorldShadowmap1->GetArraySize());
+    float shadowmapSize = static_cast<float>(WorldShadowmap1->GetSizeX());
+
+    // Cover the same distance the single shadowmap covered before
+    float maxDistance = std::max( shadowmapSize * settings.WorldShadowRangeScale * 0.5f, CASCADE_SPLIT_NEAR * 2.0f );
+    float lambda = std::min( std::max( settings.ShadowCascadeSplitLambda, 0.0f ), 1.0f );
+
+    // Get the camera frustum. Gothics matrices are transposed, so the rows hold the camera axes.
+    XMVECTOR camPos = Engine::GAPI->GetCameraPositionXM();
+    XMMATRIX camView = Engine::GAPI->GetViewMatrixXM();
+    XMVECTOR camForward = XMVector3Normalize( XMVectorSetW( camView.r[2], 0.0f ) );
+    const XMFLOAT4X4& camProj = Engine::GAPI->GetProjectionMatrix();
+    float tanHalfX = 1.0f / camProj._11;
+    float tanHalfY = 1.0f / camProj._22;
+    float tanSq = tanHalfX * tanHalfX + tanHalfY * tanHalfY;
+
+    // Rotation-only view matrix of the sun. The cascades are snapped to texels in this space.
+    static const XMVECTORF32 c_XM_Up = { { { 0, 1, 0, 0 } } };
+    static const XMVECTORF32 c_XM_Forward = { { { 0, 0, 1, 0 } } };
+    float dirY = fabsf( XMVectorGetY( lightDir ) );
+    XMMATRIX lightView = XMMatrixLookAtLH( g_XMZero, -lightDir, dirY > 0.99f ? c_XM_Forward : c_XM_Up );
+    XMMATRIX invLightView = XMMatrixInverse( nullptr, lightView );
+
+    ++ShadowCascadeFrame;
+
+    float splitNear = 0.0f;
+    for ( int i = 0; i < numCascades; i++ ) {
+        // Practical split scheme: Blend between logarithmic and uniform distribution
+        float ratio = static_cast<float>(i + 1) / numCascades;
+        float logSplit = CASCADE_SPLIT_NEAR * powf( maxDistance / CASCADE_SPLIT_NEAR, ratio );
+        float uniformSplit = CASCADE_SPLIT_NEAR + (maxDistance - CASCADE_SPLIT_NEAR) * ratio;
+        float splitFar = Toolbox::lerp( uniformSplit, logSplit, lambda );
+
+        float sliceNear = splitNear;
+        splitNear = splitFar;
+
+        // Far cascades only get updated every other frame, one of them at a time
+        bool update = !ShadowCascadesValid || !settings.ShadowCascadeAlternateUpdates ||
+            i < 2 || ((ShadowCascadeFrame + i) & 1) == 0;
+        if ( !update )
+            continue;
+
+        // Bounding sphere of the frustum slice. It only depends on the split distances,
+        // so its size doesn't change when the camera rotates and the shadows stay stable.
+        float centerDist = std::min( (1.0f + tanSq) * (sliceNear + splitFar) * 0.5f, splitFar );
+        float radius = sqrtf( (splitFar - centerDist) * (splitFar - centerDist) + splitFar * splitFar * tanSq );
+        radius = ceilf( radius / 16.0f ) * 16.0f;
+
+        // Snap the center to whole shadowmap texels, to avoid shimmering on camera movement
+        float texelSize = (2.0f * radius) / shadowmapSize;
+        XMFLOAT3 center;
+        XMStoreFloat3( &center, XMVector3Transform( camPos + camForward * centerDist, lightView ) );
+        center.x = floorf( center.x / texelSize ) * texelSize;
+        center.y = floorf( center.y / texelSize ) * texelSize;
+
+        ShadowCascadeInfo& cascade = ShadowCascades[i];
+        cascade.SplitFar = splitFar;
+        cascade.LightSpaceMin = XMFLOAT3( center.x - radius, center.y - radius, center.z - radius - SHADOW_CASTER_DISTANCE );
+        cascade.LightSpaceMax = XMFLOAT3( center.x + radius, center.y + radius, center.z + radius );
+        XMStoreFloat4x4( &cascade.LightView, lightView );
+
+        XMMATRIX proj = XMMatrixOrthographicOffCenterLH(
+            cascade.LightSpaceMin.x, cascade.LightSpaceMax.x,
+            cascade.LightSpaceMin.y, cascade.LightSpaceMax.y,
+            cascade.LightSpaceMin.z, cascade.LightSpaceMax.z );
+
+        // Roughly one world unit plus a part of a texel, in shadowmap depth
+        cascade.DepthBias = (1.0f + 0.2f * texelSize) / (cascade.LightSpaceMax.z - cascade.LightSpaceMin.z);
+
+        XMStoreFloat4x4( &cascade.Camera.ViewReplacement, XMMatrixTranspose( lightView ) );
+        XMStoreFloat4x4( &cascade.Camera.ProjectionReplacement, XMMatrixTranspose( proj ) );
+        XMStoreFloat4x4( &cascade.ViewProj, XMMatrixTranspose( lightView * proj ) );
+        XMStoreFloat3( &cascade.Camera.PositionReplacement,
+            XMVector3Transform( XMVectorSet( center.x, center.y, cascade.LightSpaceMin.z, 1.0f ), invLightView ) );
+        XMStoreFloat3( &cascade.Camera.LookAtReplacement,
+            XMVector3Transform( XMVectorSet( center.x, center.y, center.z, 1.0f ), invLightView ) );
+
+        Engine::GAPI->SetCameraReplacementPtr( &cascade.Camera );
+        RenderShadowmaps( camPos, WorldShadowmap1.get(), true, false, WorldShadowmap1->GetDSVArraySlice( i ), nullptr, &cascade );
+
+        Engine::GAPI->GetRendererState().RendererInfo.FrameShadowCascadesRendered++;
+    }
+
+    ShadowCascadesValid = true;
+}
+
 /** Draws a fullscreenquad, copying the given texture to the viewport */
 void D3D11GraphicsEngine::DrawQuad( INT2 position, INT2 size ) {
+    FlushHUDBatch();
+
     wrl::ComPtr<ID3D11ShaderResourceView> srv;
     GetContext()->PSGetShaderResources( 0, 1, srv.GetAddressOf() );
 
@@ -5193,6 +5950,8 @@ D3D11ENGINE_RENDER_STAGE D3D11GraphicsEngine::GetRenderingStage() {
 
 /** Draws a VOB (used for inventory) */
 void D3D11GraphicsEngine::DrawVobSingle( VobInfo* vob, zCCamera& camera ) {
+    FlushHUDBatch();
+
     Engine::GAPI->SetViewTransformXM( XMLoadFloat4x4( &camera.GetTransformDX( zCCamera::ETransformType::TT_VIEW ) ) );
     GetContext()->OMSetRenderTargets( 1, HDRBackBuffer->GetRenderTargetView().GetAddressOf(),
         DepthStencilBuffer->GetDepthStencilView().Get() );
@@ -5210,6 +5969,9 @@ void D3D11GraphicsEngine::DrawVobSingle( VobInfo* vob, zCCamera& camera ) {
 
     ActiveVS->GetConstantBuffer()[1]->UpdateBuffer( vob->Vob->GetWorldMatrixPtr() );
     ActiveVS->GetConstantBuffer()[1]->BindToVertexShader( 1 );
+
+    UINT vertexStride = ApplyStaticMeshVertexShader( static_cast<MeshVisualInfo*>(vob->VisualInfo),
+        ActiveVS, ShaderManager->GetVShader( HotShaders.VS_ExCompressed ) );
         
     for ( auto const& itm : vob->VisualInfo->Meshes ) {
         // Cache & bind texture
@@ -5227,7 +5989,7 @@ void D3D11GraphicsEngine::DrawVobSingle( VobInfo* vob, zCCamera& camera ) {
             // Draw instances
             DrawVertexBufferIndexed(
                 itm2nd->MeshVertexBuffer, itm2nd->MeshIndexBuffer,
-                itm2nd->Indices.size() );
+                itm2nd->Indices.size(), 0, vertexStride );
         }
     }
 
@@ -5471,6 +6233,8 @@ void D3D11GraphicsEngine::OnUIEvent( EUIEvent uiEvent ) {
 
 /** Returns the data of the backbuffer */
 void D3D11GraphicsEngine::GetBackbufferData( byte** data, INT2& buffersize, int& pixelsize ) {
+    FlushHUDBatch();
+
     buffersize = Resolution;
     byte* d = new byte[Resolution.x * Resolution.y * 4];
 
@@ -5566,18 +6330,21 @@ void D3D11GraphicsEngine::BindShaderForTexture( zCTexture* texture,
         newShader = PS_LinDepth;
     } else if ( blendAdd || blendBlend ) {
         newShader = PS_Simple;
-    } else if ( texture->HasAlphaChannel() || forceAlphaTest ) {
-        if ( texture->GetSurface()->GetFxMap() ) {
-            newShader = PS_DiffuseNormalmappedAlphatestFxMap;
-        } else {
-            newShader = PS_DiffuseNormalmappedAlphatest;
-        }
     } else {
-        if ( texture->GetSurface()->GetFxMap() ) {
-            newShader = PS_DiffuseNormalmappedFxMap;
-        } else {
-            newShader = PS_DiffuseNormalmapped;
+        // Pick the variant with exactly the features this texture needs, instead of branching in the shader
+        unsigned int features = 0;
+        if ( Engine::GAPI->GetRendererState().RendererSettings.AllowNormalmaps ) {
+            features |= DF_NORMALMAPPING;
+            if ( texture->GetSurface()->GetFxMap() ) {
+                features |= DF_FXMAP;
+            }
+        }
+
+        if ( texture->HasAlphaChannel() || forceAlphaTest ) {
+            features |= DF_ALPHATEST;
         }
+
+        newShader = ShaderManager->GetPShader( ShaderManager->GetPermutationVariant( HotShaders.PS_Diffuse, features ) );
     }
 
     // Bind, if changed
@@ -5937,8 +6704,8 @@ void D3D11GraphicsEngine::DrawFrameParticleMeshes( std::unordered_map<zCVob*, Me
     if ( progMeshes.empty() ) return;
     SetDefaultStates();
 
-    SetActivePixelShader( "PS_Simple" );
-    SetActiveVertexShader( "VS_Ex" );
+    SetActivePixelShader( HotShaders.PS_Simple );
+    SetActiveVertexShader( HotShaders.VS_Ex );
 
     GothicRendererState& state = Engine::GAPI->GetRendererState();
     state.DepthState.DepthWriteEnabled = false;
@@ -6051,7 +6818,7 @@ void D3D11GraphicsEngine::DrawFrameParticles(
     ricb.RI_CameraPosition = Engine::GAPI->GetCameraPosition();
     ricb.RI_Far = Engine::GAPI->GetFarPlane();
 
-    SetActivePixelShader( "PS_ParticleDistortion" );
+    SetActivePixelShader( HotShaders.PS_ParticleDistortion );
     ActivePS->Apply();
     ActivePS->GetConstantBuffer()[0]->UpdateBuffer( &ricb );
     ActivePS->GetConstantBuffer()[0]->BindToPixelShader( 0 );
@@ -6095,7 +6862,7 @@ void D3D11GraphicsEngine::DrawFrameParticles(
     GS_Billboard->GetConstantBuffer()[0]->UpdateBuffer( &gcb );
     GS_Billboard->GetConstantBuffer()[0]->BindToGeometryShader( 2 );
 
-    SetActiveVertexShader( "VS_ParticlePoint" );
+    SetActiveVertexShader( HotShaders.VS_ParticlePoint );
     ActiveVS->Apply();
 
     // Rendering points only
@@ -6125,7 +6892,7 @@ void D3D11GraphicsEngine::DrawFrameParticles(
     }
 
     // Set usual rendering for everything else. Alphablending mostly.
-    SetActivePixelShader( "PS_Simple" );
+    SetActivePixelShader( HotShaders.PS_Simple );
     PS_Simple->Apply();
 
     GetContext()->OMSetRenderTargets( 1, HDRBackBuffer->GetRenderTargetView().GetAddressOf(),
@@ -6179,7 +6946,7 @@ void D3D11GraphicsEngine::DrawFrameParticles(
         HDRBackBuffer->GetShaderResView(),
         PfxRenderer->GetTempBuffer().GetRenderTargetView() );
 
-    SetActivePixelShader( "PS_PFX_ApplyParticleDistortion" );
+    SetActivePixelShader( HotShaders.PS_PFX_ApplyParticleDistortion );
     ActivePS->Apply();
 
     // Copy it back, putting distortion behind it
@@ -6453,8 +7220,8 @@ void D3D11GraphicsEngine::DrawString( const std::string& str, float x, float y,
     // Setup Shaders
     //
 
-    SetActiveVertexShader( "VS_TransformedEx" );
-    SetActivePixelShader( "PS_FixedFunctionPipe" );
+    SetActiveVertexShader( HotShaders.VS_TransformedEx );
+    SetActivePixelShader( HotShaders.PS_FixedFunctionPipe );
 
     GothicGraphicsState& graphicState = Engine::GAPI->GetRendererState().GraphicsState;
     FixedFunctionStage::EColorOp copyColorOp = graphicState.FF_Stages[0].ColorOp;
@@ -6476,7 +7243,7 @@ void D3D11GraphicsEngine::DrawString( const std::string& str, float x, float y,
     // Set vertex type
     GetContext()->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
 
-    BindViewportInformation( "VS_TransformedEx", 0 );
+    BindViewportInformation( HotShaders.VS_TransformedEx, 0 );
 
     //
     // Convert the characters to verticies which mask the Font-Texture alias
@@ -6490,16 +7257,22 @@ void D3D11GraphicsEngine::DrawString( const std::string& str, float x, float y,
     // Bind the texture.
     tx->Bind( 0 );
 
-    //
-    // Populate TempVertexBuffer
-    //
-    EnsureTempVertexBufferSize( TempVertexBuffer, sizeof( ExVertexStruct ) * vertices.size() );
-    TempVertexBuffer->UpdateBuffer( &vertices[0], sizeof( ExVertexStruct ) * vertices.size() );
+    Engine::GAPI->GetRendererState().RendererInfo.FrameHUDDrawCalls++;
 
-    //
-    // Draw the verticies
-    //
-    DrawVertexBuffer( TempVertexBuffer.get(), vertices.size(), sizeof( ExVertexStruct ) );
+    // Strings using the same font usually end up in one batch
+    if ( !QueueHUDVertices( &vertices[0], static_cast<unsigned int>(vertices.size()) ) ) {
+        //
+        // Populate TempVertexBuffer
+        //
+        EnsureTempVertexBufferSize( TempVertexBuffer, sizeof( ExVertexStruct ) * vertices.size() );
+        TempVertexBuffer->UpdateBuffer( &vertices[0], sizeof( ExVertexStruct ) * vertices.size() );
+
+        //
+        // Draw the verticies
+        //
+        DrawVertexBuffer( TempVertexBuffer.get(), vertices.size(), sizeof( ExVertexStruct ) );
+        Engine::GAPI->GetRendererState().RendererInfo.FrameHUDBatches++;
+    }
 
     oldDepthState.ApplyTo( Engine::GAPI->GetRendererState().DepthState );
     Engine::GAPI->GetRendererState().DepthState.SetDirty();
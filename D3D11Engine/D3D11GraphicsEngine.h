@@ -23,6 +23,7 @@ const unsigned int PARTICLES_BUFFER_SIZE = 3072 * sizeof( ParticleInstanceInfo )
 const unsigned int MORPHEDMESH_SMALL_BUFFER_SIZE = 3072 * sizeof( ExVertexStruct );
 const unsigned int MORPHEDMESH_HIGH_BUFFER_SIZE = 20480 * sizeof( ExVertexStruct );
 const unsigned int HUD_BUFFER_SIZE = 6 * sizeof( ExVertexStruct );
+const unsigned int HUD_BATCH_BUFFER_SIZE = 8192 * sizeof( ExVertexStruct );
 const int NUM_MAX_BONES = 96;
 const int unsigned INSTANCING_BUFFER_SIZE = sizeof( VobInstanceInfo ) * 2048;
 
@@ -45,6 +46,93 @@ struct MeshInfo;
 struct RenderToTextureBuffer;
 class D3D11Effect;
 
+/** One cascade of the sun shadowmap, stored in a slice of WorldShadowmap1 */
+struct ShadowCascadeInfo {
+    /** Returns true if the given world-space box touches the light-space box of this cascade */
+    bool IntersectsBox( const zTBBox3D& box ) const;
+
+    /** Camera used to render this cascade (transposed, like gothics matrices) */
+    CameraReplacement Camera;
+
+    /** Rotation-only light-view matrix and the orthographic box in its space */
+    XMFLOAT4X4 LightView;
+    XMFLOAT3 LightSpaceMin;
+    XMFLOAT3 LightSpaceMax;
+
+    /** Transposed view-projection matrix for the lighting shader */
+    XMFLOAT4X4 ViewProj;
+
+    /** View-space distance this cascade reaches to */
+    float SplitFar;
+
+    /** Depth bias in shadowmap-space */
+    float DepthBias;
+};
+
+/** A skeletal mesh queued for instanced drawing */
+struct SkeletalInstanceRecord {
+    /** Visual used to draw the whole batch */
+    SkeletalMeshVisualInfo* Visual;
+
+    /** Hash over the key, so equal meshes end up next to each other */
+    size_t Hash;
+
+    /** Range in SkeletalInstanceKeys: softskins first, then one texture per material */
+    unsigned int KeyOffset;
+    unsigned int NumSkins;
+    unsigned int NumTextures;
+
+    /** Index into SkeletalInstances */
+    unsigned int Instance;
+
+    /** Detail level the batch is drawn with */
+    int LODLevel;
+};
+
+/** Handles of shaders which are set on hot paths, resolved once after loading the shaders */
+struct HotShaderHandles {
+    ShaderHandle VS_Ex;
+    ShaderHandle VS_ExCompressed;
+    ShaderHandle VS_ExSkeletal;
+    ShaderHandle VS_ExSkeletalCube;
+    ShaderHandle VS_ExSkeletalInstanced;
+    ShaderHandle VS_ExMode;
+    ShaderHandle VS_ExNodeCube;
+    ShaderHandle VS_TransformedEx;
+    ShaderHandle VS_ParticlePoint;
+    ShaderHandle PS_Simple;
+    ShaderHandle PS_DiffuseAlphaTest;
+    ShaderHandle PS_FixedFunctionPipe;
+    ShaderHandle PS_ParticleDistortion;
+    ShaderHandle PS_PFX_ApplyParticleDistortion;
+
+    /** Variants are picked per draw */
+    PermutationHandle PS_Diffuse;
+    PermutationHandle PS_DS_AtmosphericScattering;
+};
+
+/** Context state a HUD draw depends on. Draws with equal state are merged into one batch. */
+struct HUDBatchState {
+    /** Returns true if draws queued with the other state can go into the same batch */
+    bool IsCompatible( const HUDBatchState& other ) const;
+
+    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Textures[2];
+    Microsoft::WRL::ComPtr<ID3D11SamplerState> Sampler;
+    Microsoft::WRL::ComPtr<ID3D11RenderTargetView> RenderTarget;
+    Microsoft::WRL::ComPtr<ID3D11DepthStencilView> DepthStencil;
+    Microsoft::WRL::ComPtr<ID3D11BlendState> BlendState;
+    Microsoft::WRL::ComPtr<ID3D11RasterizerState> RasterizerState;
+    Microsoft::WRL::ComPtr<ID3D11DepthStencilState> DepthStencilState;
+    float BlendFactor[4];
+    UINT SampleMask;
+    UINT StencilRef;
+    D3D11_VIEWPORT Viewport;
+    float UIScale;
+
+    /** Copy of the FF-Info for PS_FixedFunctionPipe */
+    GothicGraphicsState GraphicsState;
+};
+
 class D3D11GraphicsEngine : public D3D11GraphicsEngineBase {
 public:
     D3D11GraphicsEngine();
@@ -111,7 +199,7 @@ public:
     virtual XRESULT DrawVertexBuffer( D3D11VertexBuffer* vb, unsigned int numVertices, unsigned int stride = sizeof( ExVertexStruct ) ) override;
 
     /** Draws a vertexbuffer, non-indexed */
-    virtual XRESULT DrawVertexBufferIndexed( D3D11VertexBuffer* vb, D3D11VertexBuffer* ib, unsigned int numIndices, unsigned int indexOffset = 0 ) override;
+    virtual XRESULT DrawVertexBufferIndexed( D3D11VertexBuffer* vb, D3D11VertexBuffer* ib, unsigned int numIndices, unsigned int indexOffset = 0, unsigned int vertexStride = sizeof( ExVertexStruct ) ) override;
     virtual XRESULT DrawVertexBufferIndexedUINT( D3D11VertexBuffer* vb, D3D11VertexBuffer* ib, unsigned int numIndices, unsigned int indexOffset ) override;
 
     /** Draws a vertexbuffer, non-indexed, binding the FF-Pipe values */
@@ -120,6 +208,9 @@ public:
     /** Binds viewport information to the given constantbuffer slot */
     virtual XRESULT BindViewportInformation( const std::string& shader, int slot ) override;
 
+    /** Binds viewport information to the given constantbuffer slot of a vertex shader */
+    XRESULT BindViewportInformation( ShaderHandle vertexShader, int slot );
+
     /** Sets up a draw call for a VS_Ex-Mesh */
     void SetupVS_ExMeshDrawCall();
     void SetupVS_ExConstantBuffer();
@@ -154,6 +245,26 @@ public:
     XRESULT DrawSkeletalVertexNormals( SkeletalVobInfo* vi, const std::vector<XMFLOAT4X4>& transforms, float4 color, float fatness = 1.0f );
     virtual XRESULT DrawSkeletalMesh( SkeletalVobInfo* vi, const std::vector<XMFLOAT4X4>& transforms, float4 color, float fatness = 1.0f ) override;
 
+    /** Starts collecting skeletal meshes, so instances of the same visual can be drawn together */
+    virtual void BeginSkeletalMeshInstancing() override;
+
+    /** Draws all collected skeletal meshes, one instanced drawcall per visual and material */
+    virtual void FlushSkeletalMeshInstances() override;
+
+    /** Stores a skeletal mesh for drawing it later in FlushSkeletalMeshInstances */
+    void QueueSkeletalMeshInstance( SkeletalVobInfo* vi, const std::vector<XMFLOAT4X4>& transforms, float4 color, float fatness );
+
+    /** Draws all queued HUD geometry with the state it was queued with and restores the current state afterwards */
+    virtual void FlushHUDBatch() override;
+
+    /** Queues HUD geometry drawn with VS_TransformedEx and PS_FixedFunctionPipe, flushing the previous batch
+        if the state changed. Returns false if the vertices have to be drawn right away. */
+    bool QueueHUDVertices( const ExVertexStruct* vertices, unsigned int numVertices );
+
+    /** Applies vs or its compressed variant, depending on the vertex format of the given static mesh visual.
+        Returns the vertex stride to draw the visual with. */
+    UINT ApplyStaticMeshVertexShader( MeshVisualInfo* visual, const std::shared_ptr<D3D11VShader>& vs, const std::shared_ptr<D3D11VShader>& vsCompressed );
+
     /** Draws a screen fade effects */
     virtual XRESULT DrawScreenFade( void* camera ) override;
 
@@ -175,10 +286,15 @@ public:
     virtual XRESULT OnKeyDown( unsigned int key ) override;
 
     /** Sets the active pixel shader object */
+    using D3D11GraphicsEngineBase::SetActivePixelShader;
+    using D3D11GraphicsEngineBase::SetActiveVertexShader;
     virtual XRESULT SetActivePixelShader( const std::string& shader );
     virtual XRESULT SetActiveVertexShader( const std::string& shader );
     XRESULT SetActiveHDShader( const std::string& shader );
 
+    /** Returns the handles of shaders used on hot paths */
+    const HotShaderHandles& GetHotShaders() const { return HotShaders; }
+
     /** Binds the active PixelShader */
     virtual XRESULT BindActivePixelShader();
     virtual XRESULT BindActiveVertexShader();
@@ -225,6 +341,10 @@ public:
     /** Draws the world mesh */
     virtual XRESULT DrawWorldMesh( bool noTextures = false );
 
+    /** Culls the clusters of the given world mesh and fills its VisibleClusterRanges.
+        frustumPlanes are the 4 side planes of the view. Returns false if nothing of the mesh is visible. */
+    bool CullWorldMeshClusters( WorldMeshInfo* mesh, const XMFLOAT4* frustumPlanes, const XMFLOAT3& cameraPosition, float maxDistance );
+
     /** Draws a list of mesh infos */
     XRESULT DrawMeshInfoListAlphablended( const std::vector<std::pair<MeshKey, MeshInfo*>>& list );
 
@@ -240,7 +360,7 @@ public:
     virtual void DrawVobSingle( VobInfo* vob, zCCamera& camera ) override;
 
     /** Draws everything around the given position */
-    void XM_CALLCONV DrawWorldAround( FXMVECTOR position, int sectionRange, float vobXZRange, bool cullFront = true, bool dontCull = false );
+    void XM_CALLCONV DrawWorldAround( FXMVECTOR position, int sectionRange, float vobXZRange, bool cullFront = true, bool dontCull = false, const ShadowCascadeInfo* cascade = nullptr );
     void XM_CALLCONV DrawWorldAround( FXMVECTOR position,
         float range,
         bool cullFront = true,
@@ -264,7 +384,13 @@ public:
     virtual XRESULT DrawSky();
 
     /** Renders the shadowmaps for the sun */
-    void XM_CALLCONV RenderShadowmaps( FXMVECTOR cameraPosition, RenderToDepthStencilBuffer* target = nullptr, bool cullFront = true, bool dontCull = false, Microsoft::WRL::ComPtr<ID3D11DepthStencilView> dsvOverwrite = nullptr, Microsoft::WRL::ComPtr<ID3D11RenderTargetView> debugRTV = nullptr );
+    void XM_CALLCONV RenderShadowmaps( FXMVECTOR cameraPosition, RenderToDepthStencilBuffer* target = nullptr, bool cullFront = true, bool dontCull = false, Microsoft::WRL::ComPtr<ID3D11DepthStencilView> dsvOverwrite = nullptr, Microsoft::WRL::ComPtr<ID3D11RenderTargetView> debugRTV = nullptr, const ShadowCascadeInfo* cascade = nullptr );
+
+    /** Fits the sun shadow cascades to the camera frustum and renders the ones due this frame */
+    void XM_CALLCONV RenderShadowCascades( FXMVECTOR lightDir );
+
+    /** (Re)creates the cascaded sun shadowmap */
+    void CreateWorldShadowmap( int size, int numCascades );
 
     /** Renders the shadowmaps for a pointlight */
     void XM_CALLCONV RenderShadowCube( FXMVECTOR position,
@@ -350,6 +476,10 @@ protected:
     /** Test draw world */
     void TestDrawWorldMesh();
 
+    /** Reads/binds the context state a HUD batch depends on */
+    void CaptureHUDBatchState( HUDBatchState& state );
+    void ApplyHUDBatchState( const HUDBatchState& state );
+
     D3D11PointLight* DebugPointlight;
 
     // Using a list here to determine which lights to update, since we don't want to update every light every frame.
@@ -390,6 +520,19 @@ protected:
     /** Shadowing */
     std::unique_ptr<RenderToDepthStencilBuffer> WorldShadowmap1;
     std::vector<VobInfo*> RenderedVobs;
+    ShadowCascadeInfo ShadowCascades[MAX_SHADOW_CASCADES];
+    unsigned int ShadowCascadeFrame;
+    bool ShadowCascadesValid;
+    std::unique_ptr<D3D11VertexBuffer> ShadowInstancingBuffer;
+
+    /** Skeletal mesh instancing */
+    bool SkeletalMeshInstancingActive;
+    std::vector<SkeletalInstanceRecord> SkeletalInstanceRecords;
+    std::vector<const void*> SkeletalInstanceKeys;
+    std::vector<SkeletalMeshInstanceInfo> SkeletalInstances;
+    std::vector<XMFLOAT4X4> SkeletalBonePalette;
+    std::unique_ptr<D3D11VertexBuffer> SkeletalInstanceBuffer;
+    std::unique_ptr<D3D11VertexBuffer> SkeletalBoneBuffer;
 
     /** Modulate Quad Marks */
     std::vector<std::pair<zCQuadMark*, const QuadMarkInfo*>> MulQuadMarks;
@@ -403,6 +546,15 @@ protected:
     /** List of water surfaces for this frame */
     std::unordered_map<zCTexture*, std::vector<WorldMeshInfo*>> FrameWaterSurfaces;
 
+    /** Shaders used on hot paths */
+    HotShaderHandles HotShaders;
+
+    /** HUD batching */
+    std::vector<ExVertexStruct> HUDBatchVertices;
+    HUDBatchState HUDBatch;
+    std::unique_ptr<D3D11VertexBuffer> HUDBatchVertexBuffer;
+    UINT HUDBatchBufferPosition;
+
     /** List of worldmeshes we have to render using alphablending */
     std::vector<std::pair<MeshKey, MeshInfo*>> FrameTransparencyMeshes;
 
@@ -1,6 +1,7 @@
 #include "D3D11GraphicsEngineBase.h"
 
 #include "BaseAntTweakBar.h"
+#include "D3D11ConstantBufferRing.h"
 #include "D3D11LineRenderer.h"
 #include "D3D11PipelineStates.h"
 #include "D3D11PointLight.h"
@@ -295,7 +296,7 @@ void D3D11GraphicsEngineBase::SetDefaultStates() {
 XRESULT D3D11GraphicsEngineBase::DrawVertexArray( ExVertexStruct* vertices, unsigned int numVertices, unsigned int startVertex, unsigned int stride ) {
     UpdateRenderStates();
     auto vShader = ShaderManager->GetVShader( "VS_TransformedEx" );
-    auto pShader = ShaderManager->GetPShader( "PS_FixedFunctionPipe" );
+    auto pShader = SelectFixedFunctionPipeVariant( ShaderManager->GetPShader( "PS_FixedFunctionPipe" ), Engine::GAPI->GetRendererState().GraphicsState );
 
     // Bind the FF-Info to the first PS slot
     pShader->GetConstantBuffer()[0]->UpdateBuffer( &Engine::GAPI->GetRendererState().GraphicsState );
@@ -417,6 +418,10 @@ void D3D11GraphicsEngineBase::ConstructShaderMakroList( std::vector<D3D_SHADER_M
     m.Definition = s.EnableSoftShadows ? "1" : "0";
     list.push_back( m );
 
+    m.Name = "USE_LUM_HISTOGRAM";
+    m.Definition = FeatureLevel10Compatibility ? "0" : "1";
+    list.push_back( m );
+
     m.Name = nullptr;
     m.Definition = nullptr;
     list.push_back( m );
@@ -477,6 +482,23 @@ XRESULT D3D11GraphicsEngineBase::SetActiveGShader( const std::string& shader ) {
     return XR_SUCCESS;
 }
 
+/** Sets the active shader by handle */
+XRESULT D3D11GraphicsEngineBase::SetActivePixelShader( ShaderHandle shader ) {
+    const std::shared_ptr<D3D11PShader>& ps = ShaderManager->GetPShader( shader );
+    if ( ActivePS != ps ) {
+        ActivePS = ps;
+    }
+    return XR_SUCCESS;
+}
+
+XRESULT D3D11GraphicsEngineBase::SetActiveVertexShader( ShaderHandle shader ) {
+    const std::shared_ptr<D3D11VShader>& vs = ShaderManager->GetVShader( shader );
+    if ( ActiveVS != vs ) {
+        ActiveVS = vs;
+    }
+    return XR_SUCCESS;
+}
+
 //int D3D11GraphicsEngineBase::MeasureString(std::string str, zFont* zFont)
 //{
 //	return 0;
@@ -521,9 +543,14 @@ XRESULT D3D11GraphicsEngineBase::CreateShadowedPointLight( BaseShadowedPointLigh
 XRESULT D3D11GraphicsEngineBase::DrawVertexBufferFF( D3D11VertexBuffer* vb, unsigned int numVertices, unsigned int startVertex, unsigned int stride ) {
     SetupVS_ExMeshDrawCall();
 
+    const auto& ps = SelectFixedFunctionPipeVariant( ActivePS, Engine::GAPI->GetRendererState().GraphicsState );
+    if ( ps != ActivePS ) {
+        ps->Apply();
+    }
+
     // Bind the FF-Info to the first PS slot
-    ActivePS->GetConstantBuffer()[0]->UpdateBuffer( &Engine::GAPI->GetRendererState().GraphicsState );
-    ActivePS->GetConstantBuffer()[0]->BindToPixelShader( 0 );
+    ps->GetConstantBuffer()[0]->UpdateBuffer( &Engine::GAPI->GetRendererState().GraphicsState );
+    ps->GetConstantBuffer()[0]->BindToPixelShader( 0 );
 
     UINT offset = 0;
     UINT uStride = stride;
@@ -537,6 +564,23 @@ XRESULT D3D11GraphicsEngineBase::DrawVertexBufferFF( D3D11VertexBuffer* vb, unsi
     return XR_SUCCESS;
 }
 
+/** Returns the variant of PS_FixedFunctionPipe with exactly the stages and switches the state uses.
+    Any other shader is returned as it is. */
+const std::shared_ptr<D3D11PShader>& D3D11GraphicsEngineBase::SelectFixedFunctionPipeVariant( const std::shared_ptr<D3D11PShader>& ps, const GothicGraphicsState& state ) {
+    // Everything sets the base variant, the real one depends on the states of the draw
+    if ( !ps || ps != ShaderManager->GetPShader( ShaderManager->GetPermutationVariant( FixedFunctionPipeShader, 0 ) ) )
+        return ps;
+
+    unsigned int features = 0;
+    if ( state.FF_GSwitches & GSWITCH_ALPHAREF ) {
+        features |= FFF_ALPHATEST;
+    }
+    if ( state.FF_Stages[1].ColorOp != FixedFunctionStage::EColorOp::CO_DISABLE ) {
+        features |= FFF_SECOND_STAGE;
+    }
+    return ShaderManager->GetPShader( ShaderManager->GetPermutationVariant( FixedFunctionPipeShader, features ) );
+}
+
 /** Binds viewport information to the given constantbuffer slot */
 XRESULT D3D11GraphicsEngineBase::BindViewportInformation( const std::string& shader, int slot ) {
     D3D11_VIEWPORT vp;
@@ -13,11 +13,13 @@ class D3D11GShader;
 
 struct RenderToTextureBuffer;
 struct RenderToDepthStencilBuffer;
+struct GothicGraphicsState;
 class D3D11ShaderManager;
 
 class D3D11VertexBuffer;
 class D3D11LineRenderer;
 class D3D11ConstantBuffer;
+class D3D11ConstantBufferRing;
 
 class D3D11GraphicsEngineBase : public BaseGraphicsEngine {
 public:
@@ -95,6 +97,9 @@ public:
     const Microsoft::WRL::ComPtr<ID3D11Device1>& GetDevice() { return Device; }
     const Microsoft::WRL::ComPtr<ID3D11DeviceContext1>& GetContext() { return Context; }
 
+    /** Returns the ring constantbuffers get suballocated from. nullptr if the device doesn't support it. */
+    D3D11ConstantBufferRing* GetConstantBufferRing() { return ConstantBufferRing.get(); }
+
     /** Pixel Shader functions */
     void UnbindActivePS() { ActivePS = nullptr; }
     std::shared_ptr<D3D11PShader>& GetActivePS() { return ActivePS; }
@@ -125,6 +130,10 @@ public:
     virtual XRESULT SetActiveVertexShader( const std::string& shader );
     virtual XRESULT SetActiveHDShader( const std::string& shader );
     virtual XRESULT SetActiveGShader( const std::string& shader );
+
+    /** Sets the active shader by handle. Only touches the refcount if the shader actually changes. */
+    XRESULT SetActivePixelShader( ShaderHandle shader );
+    XRESULT SetActiveVertexShader( ShaderHandle shader );
     //virtual int MeasureString(std::string str, zFont* zFont);
 
     void ResetPresentPending() { PresentPending = false; }
@@ -133,6 +142,10 @@ protected:
     /** Updates the transformsCB with new values from the GAPI */
     void UpdateTransformsCB();
 
+    /** Returns the variant of PS_FixedFunctionPipe with exactly the stages and switches the state uses.
+        Any other shader is returned as it is. */
+    const std::shared_ptr<D3D11PShader>& SelectFixedFunctionPipeVariant( const std::shared_ptr<D3D11PShader>& ps, const GothicGraphicsState& state );
+
     /** Device-objects */
     Microsoft::WRL::ComPtr<IDXGIFactory2> DXGIFactory2;
     Microsoft::WRL::ComPtr<IDXGIAdapter2> DXGIAdapter2;
@@ -173,13 +186,10 @@ protected:
 
     /** Constantbuffers */
     std::unique_ptr<D3D11ConstantBuffer> TransformsCB; // Holds View/Proj-Transforms
+    std::unique_ptr<D3D11ConstantBufferRing> ConstantBufferRing;
 
     /** Shaders */
-    std::shared_ptr<D3D11PShader> PS_DiffuseNormalmapped;
-    std::shared_ptr<D3D11PShader> PS_DiffuseNormalmappedFxMap;
     std::shared_ptr<D3D11PShader> PS_Diffuse;
-    std::shared_ptr<D3D11PShader> PS_DiffuseNormalmappedAlphatest;
-    std::shared_ptr<D3D11PShader> PS_DiffuseNormalmappedAlphatestFxMap;
     std::shared_ptr<D3D11PShader> PS_DiffuseAlphatest;
     std::shared_ptr<D3D11PShader> PS_Simple;
     std::shared_ptr<D3D11PShader> PS_SimpleAlphaTest;
@@ -193,6 +203,9 @@ protected:
     std::shared_ptr<D3D11PShader> PS_PortalDiffuse;
     std::shared_ptr<D3D11PShader> PS_WaterfallFoam;
 
+    /** Set with the other shaders, its variants are picked per draw from the FF-State */
+    PermutationHandle FixedFunctionPipeShader = 0;
+
     std::shared_ptr<D3D11VShader> ActiveVS;
     std::shared_ptr<D3D11PShader> ActivePS;
     std::shared_ptr<D3D11HDShader> ActiveHDS;
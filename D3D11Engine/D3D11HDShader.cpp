@@ -27,7 +27,7 @@ XRESULT D3D11HDShader::LoadShader( const char* hullShader, const char* domainSha
     Microsoft::WRL::ComPtr<ID3DBlob> dsBlob;
 
     if ( Engine::GAPI->GetRendererState().RendererSettings.EnableDebugLog )
-        LogInfo() << "Compilling hull shader: " << hullShader;
+        LogInfoCh( LC_SHADERS ) << "Compilling hull shader: " << hullShader;
 
     // Compile shaders
     if ( FAILED( D3D11ShaderManager::CompileShaderFromFile( hullShader, "HSMain", "hs_5_0", hsBlob.GetAddressOf(), {} ) ) ) {
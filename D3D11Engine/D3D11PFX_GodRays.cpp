@@ -11,6 +11,7 @@
 #include "ConstantBufferStructs.h"
 #include "GothicAPI.h"
 #include "GSky.h"
+#include "D3D11PFX_HDR.h"
 
 D3D11PFX_GodRays::D3D11PFX_GodRays( D3D11PfxRenderer* rnd ) : D3D11PFX_Effect( rnd ) {}
 
@@ -98,11 +99,16 @@ XRESULT D3D11PFX_GodRays::Render( RenderToTextureBuffer* fxbuffer ) {
 
     FxRenderer->CopyTextureToRTV( FxRenderer->GetTempBufferDS4_1().GetShaderResView(), FxRenderer->GetTempBufferDS4_2().GetRenderTargetView(), INT2( 0, 0 ), true );
 
-	// Upscale and blend
-	Engine::GAPI->GetRendererState().BlendState.SetAdditiveBlending();
-	Engine::GAPI->GetRendererState().BlendState.SetDirty();
+	if ( FxRenderer->IsFusedIntoComposite( D3D11PFX_HDR::CP_GODRAYS ) ) {
+		// The HDR composite adds the rays from DS4_2, saves reading and writing the backbuffer once more
+		FxRenderer->AddPendingComposite( D3D11PFX_HDR::CP_GODRAYS );
+	} else {
+		// Upscale and blend
+		Engine::GAPI->GetRendererState().BlendState.SetAdditiveBlending();
+		Engine::GAPI->GetRendererState().BlendState.SetDirty();
 
-    FxRenderer->CopyTextureToRTV( FxRenderer->GetTempBufferDS4_2().GetShaderResView(), oldRTV, INT2( engine->GetResolution().x, engine->GetResolution().y ) );
+		FxRenderer->CopyTextureToRTV( FxRenderer->GetTempBufferDS4_2().GetShaderResView(), oldRTV, INT2( engine->GetResolution().x, engine->GetResolution().y ) );
+	}
 
 	vp.Width = static_cast<float>(engine->GetResolution().x);
 	vp.Height = static_cast<float>(engine->GetResolution().y);
@@ -0,0 +1,172 @@
+#include "pch.h"
+#include "D3D11PFX_HBAO.h"
+#include "Engine.h"
+#include "D3D11GraphicsEngine.h"
+#include "D3D11PfxRenderer.h"
+#include "RenderToTextureBuffer.h"
+#include "D3D11ShaderManager.h"
+#include "D3D11VShader.h"
+#include "D3D11PShader.h"
+#include "D3D11ConstantBuffer.h"
+#include "ConstantBufferStructs.h"
+#include "GothicAPI.h"
+#include "HBAOKernel.h"
+
+D3D11PFX_HBAO::D3D11PFX_HBAO( D3D11PfxRenderer* rnd ) : D3D11PFX_Effect( rnd ) {
+	CurrentHistory = 0;
+	HistoryValid = false;
+	BufferSize = INT2( 0, 0 );
+	XMStoreFloat4x4( &LastViewProj, XMMatrixIdentity() );
+	FrameIndex = 0;
+
+	D3D11ShaderManager& shaders = reinterpret_cast<D3D11GraphicsEngine*>(Engine::GraphicsEngine)->GetShaderManager();
+	AOShader = shaders.GetPShaderHandle( "PS_PFX_HBAO" );
+	TemporalShader = shaders.GetPShaderHandle( "PS_PFX_HBAOTemporal" );
+	UpsampleShader = shaders.GetPShaderHandle( "PS_PFX_HBAOUpsample" );
+}
+
+D3D11PFX_HBAO::~D3D11PFX_HBAO() {}
+
+/** (Re)creates the AO buffers for the given size */
+void D3D11PFX_HBAO::CreateBuffers( const INT2& size ) {
+	D3D11GraphicsEngine* engine = reinterpret_cast<D3D11GraphicsEngine*>(Engine::GraphicsEngine);
+
+	// AO and view-space depth, the depth keeps the temporal and upsampling passes from reading the full depthbuffer again
+	AOTex = std::make_unique<RenderToTextureBuffer>( engine->GetDevice(), size.x, size.y, DXGI_FORMAT_R16G16_FLOAT );
+	HistoryTex[0] = std::make_unique<RenderToTextureBuffer>( engine->GetDevice(), size.x, size.y, DXGI_FORMAT_R16G16_FLOAT );
+	HistoryTex[1] = std::make_unique<RenderToTextureBuffer>( engine->GetDevice(), size.x, size.y, DXGI_FORMAT_R16G16_FLOAT );
+
+	BufferSize = size;
+	HistoryValid = false;
+}
+
+/** Renders the AO from the depth and normal G-buffer and blends it onto the given RTV */
+XRESULT D3D11PFX_HBAO::RenderPostFX( const Microsoft::WRL::ComPtr<ID3D11RenderTargetView>& rtv ) {
+	D3D11GraphicsEngine* engine = reinterpret_cast<D3D11GraphicsEngine*>(Engine::GraphicsEngine);
+	HBAOSettings& settings = Engine::GAPI->GetRendererState().RendererSettings.HbaoSettings;
+
+	HBAOKernel::QualityTier tier = HBAOKernel::GetQualityTier( settings.QualityTier );
+	INT2 resolution = engine->GetResolution();
+	INT2 size = INT2( (resolution.x + tier.Downsample - 1) / tier.Downsample, (resolution.y + tier.Downsample - 1) / tier.Downsample );
+	if ( !AOTex || size.x != BufferSize.x || size.y != BufferSize.y ) {
+		CreateBuffers( size );
+	}
+
+	engine->SetDefaultStates();
+	engine->UpdateRenderStates();
+
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> oldRTV;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> oldDSV;
+	engine->GetContext()->OMGetRenderTargets( 1, oldRTV.GetAddressOf(), oldDSV.GetAddressOf() );
+
+	D3D11_VIEWPORT oldVP;
+	UINT numViewports = 1;
+	engine->GetContext()->RSGetViewports( &numViewports, &oldVP );
+
+	// Matrices, without the jitter of SMAA T2x
+	XMFLOAT4X4 proj = Engine::GAPI->GetProjectionMatrix();
+	proj._13 = 0.0f;
+	proj._23 = 0.0f;
+	XMMATRIX view = XMLoadFloat4x4( &Engine::GAPI->GetRendererState().TransformState.TransformView );
+	XMMATRIX viewProj = XMMatrixMultiply( XMLoadFloat4x4( &proj ), view );
+
+	HBAOConstantBuffer cb = {};
+	for ( int i = 0; i < HBAOKernel::PATTERN_LENGTH; i++ ) {
+		HBAOKernel::Jitter jitter = HBAOKernel::GetInterleavedJitter( i, tier.NumDirections, settings.EnableTemporal ? FrameIndex : 0 );
+		cb.AO_Jitter[i] = float4( jitter.CosAngle, jitter.SinAngle, jitter.StepOffset, 0.0f );
+	}
+
+	// Stored transposed like all matrices here, so last frame's view-projection goes first
+	XMStoreFloat4x4( &cb.AO_ViewToPrevClip, XMMatrixMultiply( XMLoadFloat4x4( &LastViewProj ), XMMatrixInverse( nullptr, view ) ) );
+
+	float radius = settings.Radius * settings.MetersToViewSpaceUnits;
+	cb.AO_ProjParams = float4( proj._11, proj._22, proj._33, proj._34 );
+	cb.AO_InvSize = float2( 1.0f / size.x, 1.0f / size.y );
+	cb.AO_Size = float2( static_cast<float>(size.x), static_cast<float>(size.y) );
+	cb.AO_FullSize = float2( static_cast<float>(resolution.x), static_cast<float>(resolution.y) );
+	cb.AO_RadiusToScreen = radius * 0.5f * size.x * proj._11;
+	cb.AO_NegInvRadius2 = -1.0f / std::max( radius * radius, 1e-6f );
+	cb.AO_Bias = std::min( settings.Bias, 0.99f );
+	cb.AO_PowerExponent = settings.PowerExponent;
+	cb.AO_NumDirections = tier.NumDirections;
+	cb.AO_NumSteps = tier.NumSteps;
+	cb.AO_BlurSharpness = settings.BlurSharpness;
+	cb.AO_UpsampleRadius = settings.EnableBlur ? 2.0f : 1.0f;
+	cb.AO_HistoryValid = HistoryValid ? 1.0f : 0.0f;
+
+	auto& aoPS = engine->GetShaderManager().GetPShader( AOShader );
+	auto& temporalPS = engine->GetShaderManager().GetPShader( TemporalShader );
+	auto& upsamplePS = engine->GetShaderManager().GetPShader( UpsampleShader );
+
+	engine->GetShaderManager().GetVShader( "VS_PFX" )->Apply();
+
+	// The depthbuffer is read, so it can't stay bound
+	engine->GetContext()->OMSetRenderTargets( 1, AOTex->GetRenderTargetView().GetAddressOf(), nullptr );
+	engine->GetDepthBuffer()->BindToPixelShader( engine->GetContext().Get(), 0 );
+	engine->GetGBuffer1().BindToPixelShader( engine->GetContext().Get(), 1 );
+
+	D3D11_VIEWPORT vp = {};
+	vp.MaxDepth = 1.0f;
+	vp.Width = static_cast<float>(size.x);
+	vp.Height = static_cast<float>(size.y);
+	engine->GetContext()->RSSetViewports( 1, &vp );
+
+	/** First pass - AO at low resolution */
+	aoPS->Apply();
+	aoPS->GetConstantBuffer()[0]->UpdateBuffer( &cb );
+	aoPS->GetConstantBuffer()[0]->BindToPixelShader( 0 );
+	FxRenderer->DrawFullScreenQuad();
+
+	/** Second pass - Blend with the reprojected history */
+	RenderToTextureBuffer* result = AOTex.get();
+	if ( settings.EnableTemporal ) {
+		engine->GetContext()->OMSetRenderTargets( 1, HistoryTex[CurrentHistory]->GetRenderTargetView().GetAddressOf(), nullptr );
+		AOTex->BindToPixelShader( engine->GetContext().Get(), 2 );
+		HistoryTex[CurrentHistory ^ 1]->BindToPixelShader( engine->GetContext().Get(), 3 );
+
+		temporalPS->Apply();
+		temporalPS->GetConstantBuffer()[0]->UpdateBuffer( &cb );
+		temporalPS->GetConstantBuffer()[0]->BindToPixelShader( 0 );
+		FxRenderer->DrawFullScreenQuad();
+
+		result = HistoryTex[CurrentHistory].get();
+		CurrentHistory ^= 1;
+		HistoryValid = true;
+	} else {
+		HistoryValid = false;
+	}
+	FxRenderer->UnbindPSResources( 4 );
+
+	/** Third pass - Depth-aware upsampling onto the target */
+	if ( settings.BlendMode == 1 ) {
+		Engine::GAPI->GetRendererState().BlendState.SetModulateBlending();
+	} else {
+		Engine::GAPI->GetRendererState().BlendState.SetDefault();
+	}
+	Engine::GAPI->GetRendererState().BlendState.SetDirty();
+	engine->UpdateRenderStates();
+
+	engine->GetContext()->OMSetRenderTargets( 1, rtv.GetAddressOf(), nullptr );
+	engine->GetDepthBuffer()->BindToPixelShader( engine->GetContext().Get(), 0 );
+	result->BindToPixelShader( engine->GetContext().Get(), 2 );
+
+	vp.Width = static_cast<float>(resolution.x);
+	vp.Height = static_cast<float>(resolution.y);
+	engine->GetContext()->RSSetViewports( 1, &vp );
+
+	upsamplePS->Apply();
+	upsamplePS->GetConstantBuffer()[0]->UpdateBuffer( &cb );
+	upsamplePS->GetConstantBuffer()[0]->BindToPixelShader( 0 );
+	FxRenderer->DrawFullScreenQuad();
+
+	FxRenderer->UnbindPSResources( 4 );
+
+	XMStoreFloat4x4( &LastViewProj, viewProj );
+	FrameIndex++;
+
+	engine->GetContext()->RSSetViewports( 1, &oldVP );
+	engine->GetContext()->OMSetRenderTargets( 1, oldRTV.GetAddressOf(), oldDSV.Get() );
+	engine->SetDefaultStates();
+
+	return XR_SUCCESS;
+}
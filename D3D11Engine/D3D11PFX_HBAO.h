@@ -0,0 +1,42 @@
+#pragma once
+#include "d3d11pfx_effect.h"
+
+struct RenderToTextureBuffer;
+class D3D11PFX_HBAO :
+    public D3D11PFX_Effect {
+public:
+    D3D11PFX_HBAO( D3D11PfxRenderer* rnd );
+    ~D3D11PFX_HBAO();
+
+    /** Draws this effect to the given buffer */
+    XRESULT Render( RenderToTextureBuffer* fxbuffer ) { return XR_SUCCESS; };
+
+    /** Renders the AO from the depth and normal G-buffer and blends it onto the given RTV */
+    XRESULT RenderPostFX( const Microsoft::WRL::ComPtr<ID3D11RenderTargetView>& rtv );
+
+private:
+    /** (Re)creates the AO buffers for the given size */
+    void CreateBuffers( const INT2& size );
+
+    /** Raw AO and view-space depth of this frame, at a fraction of the resolution */
+    std::unique_ptr<RenderToTextureBuffer> AOTex;
+
+    /** Accumulated AO, alternating between this and last frame */
+    std::unique_ptr<RenderToTextureBuffer> HistoryTex[2];
+    int CurrentHistory;
+    bool HistoryValid;
+
+    /** Size of the AO buffers */
+    INT2 BufferSize;
+
+    /** View-projection of the last frame, for the reprojection */
+    XMFLOAT4X4 LastViewProj;
+
+    /** Advances the interleaved pattern */
+    unsigned int FrameIndex;
+
+    /** Resolved once, the passes run every frame */
+    ShaderHandle AOShader;
+    ShaderHandle TemporalShader;
+    ShaderHandle UpsampleShader;
+};
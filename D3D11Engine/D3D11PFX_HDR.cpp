@@ -7,14 +7,118 @@
 #include "D3D11ShaderManager.h"
 #include "D3D11VShader.h"
 #include "D3D11PShader.h"
+#include "D3D11CShader.h"
 #include "D3D11ConstantBuffer.h"
 #include "ConstantBufferStructs.h"
 #include "GothicAPI.h"
+#include "LuminanceHistogram.h"
+#include "D3D11PFX_HeightFog.h"
+#include "D3D11Texture.h"
+#include "GSky.h"
 
 const int LUM_SIZE = 512;
 
+/** Threads per group of CS_PFX_LumHistogram in each direction */
+const int LUM_HISTOGRAM_GROUP_SIZE = 16;
+
+/** Levels of the bloom chain at the highest quality, every tier below drops the smallest one */
+const int MAX_BLOOM_LEVELS = 6;
+const int MAX_BLOOM_QUALITY = 2;
+
+const char* COLOR_GRADING_LUT_FILE = "system\\GD3D11\\Textures\\ColorGrading.dds";
+
+/** Bytes per pixel of the depthbuffer, read by the heightfog */
+const int DEPTH_BYTES_PER_PIXEL = 4;
+
 D3D11PFX_HDR::D3D11PFX_HDR( D3D11PfxRenderer* rnd ) : D3D11PFX_Effect( rnd ) {
 	D3D11GraphicsEngine* engine = reinterpret_cast<D3D11GraphicsEngine*>(Engine::GraphicsEngine);
+	HRESULT hr;
+
+	LumBuffer1 = nullptr;
+	LumBuffer2 = nullptr;
+	LumBuffer3 = nullptr;
+	ActiveLumBuffer = 0;
+	CurrentLum = nullptr;
+	UsedLumHistogram = false;
+	LastCompositePasses = -1;
+	CompositeShader = engine->GetShaderManager().GetPermutationHandle( "PS_PFX_HDR" );
+
+	// Grading is optional, only enabled if a LUT is installed
+	if ( Toolbox::FileExists( COLOR_GRADING_LUT_FILE ) ) {
+		D3D11Texture* lut;
+		engine->CreateTexture( &lut );
+		ColorGradingLUT.reset( lut );
+		if ( XR_SUCCESS != ColorGradingLUT->Init( COLOR_GRADING_LUT_FILE ) ) {
+			LogWarn() << "Failed to load the color grading LUT " << COLOR_GRADING_LUT_FILE;
+			ColorGradingLUT.reset();
+		}
+	}
+
+	if ( !FeatureLevel10Compatibility ) {
+		// Histogram bins, raw so the shaders can use atomics on them
+		UINT bins[LuminanceHistogram::NUM_BINS] = {};
+		D3D11_SUBRESOURCE_DATA binData = {};
+		binData.pSysMem = bins;
+
+		D3D11_BUFFER_DESC bd = {};
+		bd.ByteWidth = sizeof( bins );
+		bd.Usage = D3D11_USAGE_DEFAULT;
+		bd.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+		bd.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+		LE( engine->GetDevice()->CreateBuffer( &bd, &binData, LumHistogram.GetAddressOf() ) );
+
+		D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+		uavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+		uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+		uavDesc.Buffer.NumElements = LuminanceHistogram::NUM_BINS;
+		uavDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+		if ( LumHistogram.Get() ) {
+			LE( engine->GetDevice()->CreateUnorderedAccessView( LumHistogram.Get(), &uavDesc, LumHistogramUAV.GetAddressOf() ) );
+		}
+
+		// The adapted luminance, as typed buffer so ps_4_0 can read it. Zero means nothing adapted yet.
+		float adaptedLum = 0.0f;
+		D3D11_SUBRESOURCE_DATA lumData = {};
+		lumData.pSysMem = &adaptedLum;
+
+		bd.ByteWidth = sizeof( float );
+		bd.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+		bd.MiscFlags = 0;
+		LE( engine->GetDevice()->CreateBuffer( &bd, &lumData, AdaptedLum.GetAddressOf() ) );
+
+		if ( AdaptedLum.Get() ) {
+			uavDesc.Format = DXGI_FORMAT_R32_FLOAT;
+			uavDesc.Buffer.NumElements = 1;
+			uavDesc.Buffer.Flags = 0;
+			LE( engine->GetDevice()->CreateUnorderedAccessView( AdaptedLum.Get(), &uavDesc, AdaptedLumUAV.GetAddressOf() ) );
+
+			D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+			srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+			srvDesc.Buffer.NumElements = 1;
+			LE( engine->GetDevice()->CreateShaderResourceView( AdaptedLum.Get(), &srvDesc, AdaptedLumSRV.GetAddressOf() ) );
+
+			D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
+			rtvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+			rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_BUFFER;
+			rtvDesc.Buffer.NumElements = 1;
+			LE( engine->GetDevice()->CreateRenderTargetView( AdaptedLum.Get(), &rtvDesc, AdaptedLumRTV.GetAddressOf() ) );
+		}
+		return;
+	}
+
+	CreateLumBuffers();
+}
+
+D3D11PFX_HDR::~D3D11PFX_HDR() {
+	delete LumBuffer1;
+	delete LumBuffer2;
+	delete LumBuffer3;
+}
+
+/** Creates the buffers the mip luminance works on */
+void D3D11PFX_HDR::CreateLumBuffers() {
+	D3D11GraphicsEngine* engine = reinterpret_cast<D3D11GraphicsEngine*>(Engine::GraphicsEngine);
 
 	// Create lum-buffer
 	LumBuffer1 = new RenderToTextureBuffer( engine->GetDevice().Get(), LUM_SIZE, LUM_SIZE, DXGI_FORMAT_R16_FLOAT, nullptr,
@@ -27,13 +131,6 @@ D3D11PFX_HDR::D3D11PFX_HDR( D3D11PfxRenderer* rnd ) : D3D11PFX_Effect( rnd ) {
 	engine->GetContext()->ClearRenderTargetView( LumBuffer1->GetRenderTargetView().Get(), reinterpret_cast<float*>(&float4( 0, 0, 0, 0 )) );
 	engine->GetContext()->ClearRenderTargetView( LumBuffer2->GetRenderTargetView().Get(), reinterpret_cast<float*>(&float4( 0, 0, 0, 0 )) );
 	engine->GetContext()->ClearRenderTargetView( LumBuffer3->GetRenderTargetView().Get(), reinterpret_cast<float*>(&float4( 0, 0, 0, 0 )) );
-	ActiveLumBuffer = 0;
-}
-
-D3D11PFX_HDR::~D3D11PFX_HDR() {
-	delete LumBuffer1;
-	delete LumBuffer2;
-	delete LumBuffer3;
 }
 
 /** Draws this effect to the given buffer */
@@ -49,49 +146,149 @@ XRESULT D3D11PFX_HDR::Render( RenderToTextureBuffer* fxbuffer ) {
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> oldDSV;
 	engine->GetContext()->OMGetRenderTargets( 1, oldRTV.GetAddressOf(), oldDSV.GetAddressOf() );
 
-	RenderToTextureBuffer* lum = CalcLuminance();
-	CreateBloom( lum );
+	CalcLuminance();
+	CreateBloom();
 
 	// Copy the original image to our temp-buffer
     FxRenderer->CopyTextureToRTV( engine->GetHDRBackBuffer().GetShaderResView(), FxRenderer->GetTempBuffer().GetRenderTargetView(), engine->GetResolution() );
 
 	// Bind scene and luminance
 	FxRenderer->GetTempBuffer().BindToPixelShader( engine->GetContext().Get(), 0 );
-	lum->BindToPixelShader( engine->GetContext().Get(), 1 );
+	BindLuminance( 1 );
 
 	// Bind bloom
-	FxRenderer->GetTempBufferDS4_1().BindToPixelShader( engine->GetContext().Get(), 2 );
+	if ( !BloomLevels.empty() ) {
+		BloomLevels[0]->BindToPixelShader( engine->GetContext().Get(), 2 );
+	}
+
+	// Fog and godrays may have left their composite to us
+	int passes = FxRenderer->GetPendingComposite();
+	if ( Engine::GAPI->GetRendererState().RendererSettings.EnableColorGrading && ColorGradingLUT ) {
+		passes |= CP_COLOR_GRADING;
+	}
 
 	// Draw the HDR-Shader
-	auto hps = engine->GetShaderManager().GetPShader( "PS_PFX_HDR" );
+	D3D11ShaderManager& shaderManager = engine->GetShaderManager();
+	auto hps = shaderManager.GetPShader( shaderManager.GetPermutationVariant( CompositeShader, passes ) );
 	hps->Apply();
 
 	HDRSettingsConstantBuffer hcb;
 	hcb.HDR_LumWhite = Engine::GAPI->GetRendererState().RendererSettings.HDRLumWhite;
 	hcb.HDR_MiddleGray = Engine::GAPI->GetRendererState().RendererSettings.HDRMiddleGray;
 	hcb.HDR_Threshold = Engine::GAPI->GetRendererState().RendererSettings.BloomThreshold;
-	hcb.HDR_BloomStrength = Engine::GAPI->GetRendererState().RendererSettings.BloomStrength;
+	// The first level holds the sum of all levels
+	hcb.HDR_BloomStrength = Engine::GAPI->GetRendererState().RendererSettings.BloomStrength / std::max( 1, GetNumBloomLevels() );
 	hps->GetConstantBuffer()[0]->UpdateBuffer( &hcb );
 	hps->GetConstantBuffer()[0]->BindToPixelShader( 0 );
 
+	if ( passes & CP_HEIGHTFOG ) {
+		HeightfogConstantBuffer fcb;
+		D3D11PFX_HeightFog::FillConstantBuffer( fcb );
+		hps->GetConstantBuffer()[1]->UpdateBuffer( &Engine::GAPI->GetSky()->GetAtmosphereCB() );
+		hps->GetConstantBuffer()[1]->BindToPixelShader( 1 );
+		hps->GetConstantBuffer()[2]->UpdateBuffer( &fcb );
+		hps->GetConstantBuffer()[2]->BindToPixelShader( 2 );
+
+		// Can't read the depthbuffer while it's bound
+		engine->GetContext()->OMSetRenderTargets( 1, oldRTV.GetAddressOf(), nullptr );
+		engine->GetDepthBuffer()->BindToPixelShader( engine->GetContext().Get(), 3 );
+	}
+
+	if ( passes & CP_GODRAYS ) {
+		FxRenderer->GetTempBufferDS4_2().BindToPixelShader( engine->GetContext().Get(), 4 );
+	}
+
+	if ( passes & CP_COLOR_GRADING ) {
+		ColorGradingLUT->BindToPixelShader( 5 );
+	}
+
     FxRenderer->CopyTextureToRTV( FxRenderer->GetTempBuffer().GetShaderResView(), oldRTV, engine->GetResolution(), true );
 
 	// Show lumBuffer
 	//FxRenderer->CopyTextureToRTV(currentLum->GetShaderResView(), oldRTV, INT2(LUM_SIZE,LUM_SIZE), false);
 
 	// Restore rendertargets
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
-	engine->GetContext()->PSSetShaderResources( 1, 1, srv.GetAddressOf() );
+	ID3D11ShaderResourceView* noSRVs[5] = {};
+	engine->GetContext()->PSSetShaderResources( 1, 5, noSRVs );
 	engine->GetContext()->OMSetRenderTargets( 1, oldRTV.GetAddressOf(), oldDSV.Get() );
 
+	LogCompositeBandwidth( passes );
+
 	return XR_SUCCESS;
 }
 
-/** Blurs the backbuffer and puts the result into TempBufferDS4_2*/
-void D3D11PFX_HDR::CreateBloom( RenderToTextureBuffer* lum ) {
+/** Logs the full resolution traffic of the composite against running its passes on their own */
+void D3D11PFX_HDR::LogCompositeBandwidth( int passes ) {
+	if ( passes == LastCompositePasses )
+		return;
+
+	LastCompositePasses = passes;
+	if ( !(passes & (CP_GODRAYS | CP_HEIGHTFOG)) )
+		return;
+
 	D3D11GraphicsEngine* engine = reinterpret_cast<D3D11GraphicsEngine*>(Engine::GraphicsEngine);
+	int bpp = Engine::GAPI->GetRendererState().RendererSettings.CompressBackBuffer ? 4 : 8;
+
+	// The composite copies the backbuffer and writes it back, a blended pass reads and writes it once
+	int fusedBytes = 4 * bpp;
+	int separateBytes = 4 * bpp;
+	if ( passes & CP_HEIGHTFOG ) {
+		fusedBytes += DEPTH_BYTES_PER_PIXEL;
+		separateBytes += DEPTH_BYTES_PER_PIXEL + 2 * bpp;
+	}
+
+	if ( passes & CP_GODRAYS ) {
+		separateBytes += 2 * bpp;
+	}
+
+	float pixelsMB = static_cast<float>(engine->GetResolution().x * engine->GetResolution().y) / (1024.0f * 1024.0f);
+	LogInfo() << "HDR composite " << engine->GetShaderManager().GetPermutationVariantName( CompositeShader, passes ) << " moves " << fusedBytes * pixelsMB
+		<< " MB per frame at full resolution, " << separateBytes * pixelsMB << " MB with separate passes";
+}
+
+/** Called on resize, recreates the bloom chain */
+void D3D11PFX_HDR::OnResize( const INT2& newResolution ) {
+	D3D11GraphicsEngine* engine = reinterpret_cast<D3D11GraphicsEngine*>(Engine::GraphicsEngine);
+	HRESULT hr;
+
+	// Sized relative to the resolution, so the radius of the bloom stays the same on screen
+	BloomLevels.clear();
+	for ( int i = 0; i < MAX_BLOOM_LEVELS; i++ ) {
+		UINT sizeX = std::max( 1, newResolution.x >> (2 + i) );
+		UINT sizeY = std::max( 1, newResolution.y >> (2 + i) );
+		BloomLevels.emplace_back( new RenderToTextureBuffer( engine->GetDevice(), sizeX, sizeY, DXGI_FORMAT_R11G11B10_FLOAT, nullptr ) );
+	}
+
+	BloomPrefilter.Reset();
+	BloomPrefilterUAV.Reset();
+	BloomPrefilterSRV.Reset();
+	if ( !AdaptedLumSRV.Get() )
+		return;
+
+	D3D11_TEXTURE2D_DESC desc = CD3D11_TEXTURE2D_DESC( DXGI_FORMAT_R16G16B16A16_FLOAT, BloomLevels[0]->GetSizeX(), BloomLevels[0]->GetSizeY(),
+		1, 1, D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE );
+	LE( engine->GetDevice()->CreateTexture2D( &desc, nullptr, BloomPrefilter.GetAddressOf() ) );
+	if ( !BloomPrefilter.Get() )
+		return;
+
+	LE( engine->GetDevice()->CreateUnorderedAccessView( BloomPrefilter.Get(), nullptr, BloomPrefilterUAV.GetAddressOf() ) );
+	LE( engine->GetDevice()->CreateShaderResourceView( BloomPrefilter.Get(), nullptr, BloomPrefilterSRV.GetAddressOf() ) );
+}
+
+/** Returns how many levels of the bloom chain the quality setting uses */
+int D3D11PFX_HDR::GetNumBloomLevels() {
+	int quality = std::min( std::max( Engine::GAPI->GetRendererState().RendererSettings.BloomQuality, 0 ), MAX_BLOOM_QUALITY );
+	return std::min( static_cast<int>(BloomLevels.size()), MAX_BLOOM_LEVELS - (MAX_BLOOM_QUALITY - quality) );
+}
+
+/** Bright pass into the bloom chain, then downsamples it and adds all levels back up into the first one */
+void D3D11PFX_HDR::CreateBloom() {
+	D3D11GraphicsEngine* engine = reinterpret_cast<D3D11GraphicsEngine*>(Engine::GraphicsEngine);
+
+	int numLevels = GetNumBloomLevels();
+	if ( numLevels == 0 )
+		return;
 
-	INT2 dsRes = INT2( Engine::GraphicsEngine->GetResolution().x / 4, Engine::GraphicsEngine->GetResolution().y / 4 );
 	engine->GetShaderManager().GetVShader( "VS_PFX" )->Apply();
 	auto tonemapPS = engine->GetShaderManager().GetPShader( "PS_PFX_Tonemap" );
 	tonemapPS->Apply();
@@ -103,46 +300,134 @@ void D3D11PFX_HDR::CreateBloom( RenderToTextureBuffer* lum ) {
 	tonemapPS->GetConstantBuffer()[0]->UpdateBuffer( &hcb );
 	tonemapPS->GetConstantBuffer()[0]->BindToPixelShader( 0 );
 
-	lum->BindToPixelShader( engine->GetContext().Get(), 1 );
-	FxRenderer->CopyTextureToRTV( engine->GetHDRBackBuffer().GetShaderResView(), FxRenderer->GetTempBufferDS4_1().GetRenderTargetView(), dsRes, true );
+	BindLuminance( 1 );
 
-	auto gaussPS = engine->GetShaderManager().GetPShader( "PS_PFX_GaussBlur" );
+	// Bright pass into the first level. With compute shaders the histogram pass has already box filtered the backbuffer,
+	// otherwise the tonemap shader does it. If the histogram pass was skipped the prefilter is stale, the backbuffer
+	// is then sampled directly, as the tonemap shader was compiled without its own box filter.
+	INT2 levelRes = INT2( BloomLevels[0]->GetSizeX(), BloomLevels[0]->GetSizeY() );
+	if ( UsedLumHistogram && BloomPrefilterSRV.Get() ) {
+		FxRenderer->CopyTextureToRTV( BloomPrefilterSRV, BloomLevels[0]->GetRenderTargetView(), levelRes, true );
+	} else {
+		FxRenderer->CopyTextureToRTV( engine->GetHDRBackBuffer().GetShaderResView(), BloomLevels[0]->GetRenderTargetView(), levelRes, true );
+	}
 
+	/** Pass 1: Down the chain */
+	engine->GetShaderManager().GetPShader( "PS_PFX_BloomDownsample" )->Apply();
+	for ( int i = 1; i < numLevels; i++ ) {
+		levelRes = INT2( BloomLevels[i]->GetSizeX(), BloomLevels[i]->GetSizeY() );
+		FxRenderer->CopyTextureToRTV( BloomLevels[i - 1]->GetShaderResView(), BloomLevels[i]->GetRenderTargetView(), levelRes, true );
+	}
 
-	/** Pass 1: Blur-H */
-	// Apply PFX-VS
-	auto simplePS = engine->GetShaderManager().GetPShader( "PS_PFX_Simple" );
+	/** Pass 2: Back up, adding each level onto the next larger one */
+	Engine::GAPI->GetRendererState().BlendState.SetAdditiveBlending();
+	Engine::GAPI->GetRendererState().BlendState.SetDirty();
 
-	// Apply blur-H shader
-	gaussPS->Apply();
+	engine->GetShaderManager().GetPShader( "PS_PFX_BloomUpsample" )->Apply();
+	for ( int i = numLevels - 2; i >= 0; i-- ) {
+		levelRes = INT2( BloomLevels[i]->GetSizeX(), BloomLevels[i]->GetSizeY() );
+		FxRenderer->CopyTextureToRTV( BloomLevels[i + 1]->GetShaderResView(), BloomLevels[i]->GetRenderTargetView(), levelRes, true );
+	}
 
-	// Update settings 
-	BlurConstantBuffer bcb;
-	bcb.B_BlurSize = 1.0f;
-	bcb.B_PixelSize = float2( 1.0f / FxRenderer->GetTempBufferDS4_1().GetSizeX(), 0.0f );
-    //bcb.B_ColorMod = float4( 1.0f, 1.0f, 1.0f, 1.0f );
-	gaussPS->GetConstantBuffer()[0]->UpdateBuffer( &bcb );
-	gaussPS->GetConstantBuffer()[0]->BindToPixelShader( 0 );
+	Engine::GAPI->GetRendererState().BlendState.BlendEnabled = false;
+	Engine::GAPI->GetRendererState().BlendState.SetDirty();
 
-	// Copy
-    FxRenderer->CopyTextureToRTV( FxRenderer->GetTempBufferDS4_1().GetShaderResView(), FxRenderer->GetTempBufferDS4_2().GetRenderTargetView(), dsRes, true );
+	// The last upsample happens in the HDR-Shader
+}
 
-	/** Pass 2: Blur V */
+/** Calcualtes the luminance */
+void D3D11PFX_HDR::CalcLuminance() {
+	UsedLumHistogram = AdaptedLumSRV.Get() && CalcLuminanceHistogram();
+	if ( UsedLumHistogram )
+		return;
 
-	// Update settings
-	bcb.B_BlurSize = 1.0f;
-	bcb.B_PixelSize = float2( 0.0f, 1.0f / FxRenderer->GetTempBufferDS4_1().GetSizeY() );
-	bcb.B_Threshold = 0.0f;
-	gaussPS->GetConstantBuffer()[0]->UpdateBuffer( &bcb );
-	gaussPS->GetConstantBuffer()[0]->BindToPixelShader( 0 );
+	if ( !LumBuffer1 )
+		CreateLumBuffers();
 
-	// Copy
-    FxRenderer->CopyTextureToRTV( FxRenderer->GetTempBufferDS4_2().GetShaderResView(), FxRenderer->GetTempBufferDS4_1().GetRenderTargetView(), dsRes, true );
+	CurrentLum = CalcLuminanceMips();
 
+	// The shaders were compiled to read the adapted luminance from the histogram buffer, so put it there.
+	// Runs the adaption a second time on the same inputs, as the texture can't be copied into a buffer.
+	if ( AdaptedLumRTV.Get() ) {
+		FxRenderer->CopyTextureToRTV( nullptr, AdaptedLumRTV, INT2( 1, 1 ), true );
+	}
 }
 
-/** Calcualtes the luminance */
-RenderToTextureBuffer* D3D11PFX_HDR::CalcLuminance() {
+/** Builds the luminance histogram of the backbuffer and adapts the exposure from it, without any rendertarget switch */
+bool D3D11PFX_HDR::CalcLuminanceHistogram() {
+	D3D11GraphicsEngine* engine = reinterpret_cast<D3D11GraphicsEngine*>(Engine::GraphicsEngine);
+	const GothicRendererSettings& settings = Engine::GAPI->GetRendererState().RendererSettings;
+
+	auto histogramCS = engine->GetShaderManager().GetCShader( "CS_PFX_LumHistogram" );
+	auto exposureCS = engine->GetShaderManager().GetCShader( "CS_PFX_LumExposure" );
+	if ( !histogramCS || !exposureCS ) {
+		static bool warned = false;
+		if ( !warned ) {
+			LogWarnCh( LC_SHADERS ) << "Luminance histogram shaders missing, falling back to the mip luminance";
+			warned = true;
+		}
+		return false;
+	}
+
+	// The backbuffer can't be bound as output while we read it
+	engine->GetContext()->OMSetRenderTargets( 0, nullptr, nullptr );
+
+	INT2 res = engine->GetResolution();
+
+	LumHistogramConstantBuffer lcb;
+	lcb.LH_MinLog2Luminance = LuminanceHistogram::MIN_LOG2_LUMINANCE;
+	lcb.LH_Log2LuminanceRange = LuminanceHistogram::MAX_LOG2_LUMINANCE - LuminanceHistogram::MIN_LOG2_LUMINANCE;
+	lcb.LH_MinLuminance = LuminanceHistogram::MIN_LUMINANCE;
+	lcb.LH_MaxAdaptedLuminance = LuminanceHistogram::MAX_ADAPTED_LUMINANCE;
+	lcb.LH_LowPercentile = std::min( std::max( settings.HDRLumLowPercentile, 0.0f ), 1.0f );
+	lcb.LH_HighPercentile = std::min( std::max( settings.HDRLumHighPercentile, 0.0f ), 1.0f );
+	lcb.LH_DeltaTime = Engine::GAPI->GetDeltaTime();
+	lcb.LH_AdaptionRate = LuminanceHistogram::ADAPTION_RATE;
+	lcb.LH_Width = static_cast<UINT>(res.x);
+	lcb.LH_Height = static_cast<UINT>(res.y);
+	lcb.LH_Pad = float2( 0, 0 );
+
+	engine->GetContext()->CSSetShaderResources( 0, 1, engine->GetHDRBackBuffer().GetShaderResView().GetAddressOf() );
+
+	// Pass 1: Histogram of the whole backbuffer in a single dispatch, also prefilters the bloom
+	ID3D11UnorderedAccessView* histogramUAVs[] = { LumHistogramUAV.Get(), BloomPrefilterUAV.Get() };
+	engine->GetContext()->CSSetUnorderedAccessViews( 0, 2, histogramUAVs, nullptr );
+	histogramCS->Apply();
+	histogramCS->GetConstantBuffer()[0]->UpdateBuffer( &lcb );
+	histogramCS->GetConstantBuffer()[0]->BindToComputeShader( 0 );
+	engine->GetContext()->Dispatch( (res.x + LUM_HISTOGRAM_GROUP_SIZE - 1) / LUM_HISTOGRAM_GROUP_SIZE,
+		(res.y + LUM_HISTOGRAM_GROUP_SIZE - 1) / LUM_HISTOGRAM_GROUP_SIZE, 1 );
+
+	// Pass 2: Clipped average and adaption, also clears the bins
+	ID3D11UnorderedAccessView* exposureUAVs[] = { LumHistogramUAV.Get(), AdaptedLumUAV.Get() };
+	engine->GetContext()->CSSetUnorderedAccessViews( 0, 2, exposureUAVs, nullptr );
+	exposureCS->Apply();
+	exposureCS->GetConstantBuffer()[0]->UpdateBuffer( &lcb );
+	exposureCS->GetConstantBuffer()[0]->BindToComputeShader( 0 );
+	engine->GetContext()->Dispatch( 1, 1, 1 );
+
+	// Unbind, so the pixelshaders can read the adapted luminance
+	ID3D11UnorderedAccessView* noUAVs[] = { nullptr, nullptr };
+	ID3D11ShaderResourceView* noSRV = nullptr;
+	engine->GetContext()->CSSetUnorderedAccessViews( 0, 2, noUAVs, nullptr );
+	engine->GetContext()->CSSetShaderResources( 0, 1, &noSRV );
+	engine->GetContext()->CSSetShader( nullptr, nullptr, 0 );
+	return true;
+}
+
+/** Binds the adapted luminance to the given pixelshader slot */
+void D3D11PFX_HDR::BindLuminance( int slot ) {
+	D3D11GraphicsEngine* engine = reinterpret_cast<D3D11GraphicsEngine*>(Engine::GraphicsEngine);
+
+	if ( AdaptedLumSRV.Get() ) {
+		engine->GetContext()->PSSetShaderResources( slot, 1, AdaptedLumSRV.GetAddressOf() );
+	} else if ( CurrentLum ) {
+		CurrentLum->BindToPixelShader( engine->GetContext().Get(), slot );
+	}
+}
+
+/** Feature level 10 fallback, averages a downsampled luminance buffer through its mips */
+RenderToTextureBuffer* D3D11PFX_HDR::CalcLuminanceMips() {
 	D3D11GraphicsEngine* engine = reinterpret_cast<D3D11GraphicsEngine*>(Engine::GraphicsEngine);
 
 	RenderToTextureBuffer* lumRTV = nullptr;
@@ -2,25 +2,87 @@
 #include "d3d11pfx_effect.h"
 
 struct RenderToTextureBuffer;
+class D3D11Texture;
 class D3D11PFX_HDR :
     public D3D11PFX_Effect {
 public:
+    /** Work the final composite can do on top of the tonemapping, as feature bits of PS_PFX_HDR */
+    enum ECompositePass {
+        CP_GODRAYS = 1,
+        CP_HEIGHTFOG = 2,
+        CP_COLOR_GRADING = 4
+    };
+
     D3D11PFX_HDR( D3D11PfxRenderer* rnd );
     ~D3D11PFX_HDR();
 
     /** Draws this effect to the given buffer */
     XRESULT Render( RenderToTextureBuffer* fxbuffer );
 
+    /** Called on resize, recreates the bloom chain */
+    void OnResize( const INT2& newResolution );
+
 protected:
     /** Calcualtes the luminance */
-    RenderToTextureBuffer* CalcLuminance();
+    void CalcLuminance();
+
+    /** Builds the luminance histogram of the backbuffer and adapts the exposure from it, without any rendertarget switch.
+    Returns false if the compute shaders aren't available. */
+    bool CalcLuminanceHistogram();
+
+    /** Creates the buffers the mip luminance works on */
+    void CreateLumBuffers();
+
+    /** Feature level 10 fallback, averages a downsampled luminance buffer through its mips */
+    RenderToTextureBuffer* CalcLuminanceMips();
+
+    /** Binds the adapted luminance to the given pixelshader slot */
+    void BindLuminance( int slot );
+
+    /** Bright pass into the bloom chain, then downsamples it and adds all levels back up into the first one */
+    void CreateBloom();
+
+    /** Returns how many levels of the bloom chain the quality setting uses */
+    int GetNumBloomLevels();
 
-    /** Blurs the backbuffer and puts the result into TempBufferDS4_1*/
-    void CreateBloom( RenderToTextureBuffer* lum );
+    /** Logs the full resolution traffic of the composite against running its passes on their own */
+    void LogCompositeBandwidth( int passes );
 
+    /** Only used by the fallback */
     RenderToTextureBuffer* LumBuffer1;
     RenderToTextureBuffer* LumBuffer2;
     RenderToTextureBuffer* LumBuffer3;
     int ActiveLumBuffer;
+    RenderToTextureBuffer* CurrentLum;
+
+    /** Histogram bins and the adapted luminance, both stay on the GPU */
+    Microsoft::WRL::ComPtr<ID3D11Buffer> LumHistogram;
+    Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> LumHistogramUAV;
+    Microsoft::WRL::ComPtr<ID3D11Buffer> AdaptedLum;
+    Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> AdaptedLumUAV;
+    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AdaptedLumSRV;
+
+    /** Lets the mip luminance write into the adapted luminance, for when the histogram shaders failed to compile */
+    Microsoft::WRL::ComPtr<ID3D11RenderTargetView> AdaptedLumRTV;
+
+    /** Whether the histogram pass ran this frame, otherwise the bloom prefilter wasn't written either */
+    bool UsedLumHistogram;
+
+    /** Each level half the size of the one before, starting at a quarter of the resolution */
+    std::vector<std::unique_ptr<RenderToTextureBuffer>> BloomLevels;
+
+    /** 4x4 box filtered backbuffer, written by the histogram pass */
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> BloomPrefilter;
+    Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> BloomPrefilterUAV;
+    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> BloomPrefilterSRV;
+
+    /** 256x16 grading LUT, optional */
+    std::unique_ptr<D3D11Texture> ColorGradingLUT;
+
+    /** Composite passes of the last frame, to log the bandwidth on changes */
+    int LastCompositePasses;
+
+    /** PS_PFX_HDR with its composite passes as features */
+    PermutationHandle CompositeShader;
 };
 
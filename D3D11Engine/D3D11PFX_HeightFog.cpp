@@ -32,6 +32,42 @@ XRESULT D3D11PFX_HeightFog::Render( RenderToTextureBuffer* fxbuffer ) {
 	vs->Apply();
 
 	HeightfogConstantBuffer cb;
+	FillConstantBuffer( cb );
+
+	hfPS->GetConstantBuffer()[0]->UpdateBuffer( &cb );
+	hfPS->GetConstantBuffer()[0]->BindToPixelShader( 0 );
+
+	GSky* sky = Engine::GAPI->GetSky();
+	hfPS->GetConstantBuffer()[1]->UpdateBuffer( &sky->GetAtmosphereCB() );
+	hfPS->GetConstantBuffer()[1]->BindToPixelShader( 1 );
+
+	engine->GetContext()->OMSetRenderTargets( 1, oldRTV.GetAddressOf(), nullptr );
+
+	// Bind depthbuffer
+	engine->GetDepthBuffer()->BindToPixelShader( engine->GetContext().Get(), 1 );
+
+    engine->SetDefaultStates();
+    Engine::GAPI->GetRendererState().RasterizerState.CullMode = GothicRasterizerStateInfo::CM_CULL_NONE;
+    Engine::GAPI->GetRendererState().RasterizerState.SetDirty();
+	Engine::GAPI->GetRendererState().BlendState.SetDefault();
+	//Engine::GAPI->GetRendererState().BlendState.SetAdditiveBlending();
+	Engine::GAPI->GetRendererState().BlendState.BlendEnabled = true;
+	Engine::GAPI->GetRendererState().BlendState.SetDirty();
+
+	// Copy
+	FxRenderer->DrawFullScreenQuad();
+
+	// Restore rendertargets
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	engine->GetContext()->PSSetShaderResources( 1, 1, srv.GetAddressOf() );
+
+	engine->GetContext()->OMSetRenderTargets( 1, oldRTV.GetAddressOf(), oldDSV.Get() );
+
+	return XR_SUCCESS;
+}
+
+/** Fills the fog parameters of the current frame, also used by the fused HDR composite */
+void D3D11PFX_HeightFog::FillConstantBuffer( HeightfogConstantBuffer& cb ) {
 	XMStoreFloat4x4( &cb.InvProj, XMMatrixInverse( nullptr, XMLoadFloat4x4(&Engine::GAPI->GetProjectionMatrix()) ) );
 
 	XMStoreFloat4x4( &cb.InvView, XMMatrixInverse( nullptr, Engine::GAPI->GetViewMatrixXM() ) );
@@ -95,36 +131,4 @@ XRESULT D3D11PFX_HeightFog::Render( RenderToTextureBuffer* fxbuffer ) {
 	cb.HF_FogColorMod = FogColorMod;
 	// Raining Density, only when not in fogzone
 	cb.HF_GlobalDensity = Toolbox::lerp( cb.HF_GlobalDensity, Engine::GAPI->GetRendererState().RendererSettings.RainFogDensity, rain * (1.0f - Engine::GAPI->GetFogOverride()) );
-
-
-	hfPS->GetConstantBuffer()[0]->UpdateBuffer( &cb );
-	hfPS->GetConstantBuffer()[0]->BindToPixelShader( 0 );
-
-	GSky* sky = Engine::GAPI->GetSky();
-	hfPS->GetConstantBuffer()[1]->UpdateBuffer( &sky->GetAtmosphereCB() );
-	hfPS->GetConstantBuffer()[1]->BindToPixelShader( 1 );
-
-	engine->GetContext()->OMSetRenderTargets( 1, oldRTV.GetAddressOf(), nullptr );
-
-	// Bind depthbuffer
-	engine->GetDepthBuffer()->BindToPixelShader( engine->GetContext().Get(), 1 );
-
-    engine->SetDefaultStates();
-    Engine::GAPI->GetRendererState().RasterizerState.CullMode = GothicRasterizerStateInfo::CM_CULL_NONE;
-    Engine::GAPI->GetRendererState().RasterizerState.SetDirty();
-	Engine::GAPI->GetRendererState().BlendState.SetDefault();
-	//Engine::GAPI->GetRendererState().BlendState.SetAdditiveBlending();
-	Engine::GAPI->GetRendererState().BlendState.BlendEnabled = true;
-	Engine::GAPI->GetRendererState().BlendState.SetDirty();
-
-	// Copy
-	FxRenderer->DrawFullScreenQuad();
-
-	// Restore rendertargets
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
-	engine->GetContext()->PSSetShaderResources( 1, 1, srv.GetAddressOf() );
-
-	engine->GetContext()->OMSetRenderTargets( 1, oldRTV.GetAddressOf(), oldDSV.Get() );
-
-	return XR_SUCCESS;
 }
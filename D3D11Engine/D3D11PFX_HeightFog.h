@@ -1,6 +1,7 @@
 #pragma once
 #include "d3d11pfx_effect.h"
 
+struct HeightfogConstantBuffer;
 class D3D11PFX_HeightFog :
     public D3D11PFX_Effect {
 public:
@@ -9,5 +10,8 @@ public:
 
     /** Draws this effect to the given buffer */
     XRESULT Render( RenderToTextureBuffer* fxbuffer );
+
+    /** Fills the fog parameters of the current frame, also used by the fused HDR composite */
+    static void FillConstantBuffer( HeightfogConstantBuffer& cb );
 };
 
@@ -12,9 +12,41 @@
 #include <d3dcompiler.h>
 #include <DDSTextureLoader.h>
 
+/** Subpixel offsets of the two T2x frames, in pixels. Must match the subsample indices in SMAA.fxh. */
+static const XMFLOAT2 SMAA_T2X_JITTER[2] = { XMFLOAT2( 0.25f, -0.25f ), XMFLOAT2( -0.25f, 0.25f ) };
+
+/** Frames between two logs of the pass statistics */
+static const int SMAA_STATS_LOG_INTERVAL = 600;
+
+static const char* SMAA_PASS_NAMES[] = { "edges", "weights", "blending", "resolve" };
+
 D3D11PFX_SMAA::D3D11PFX_SMAA( D3D11PfxRenderer* rnd ) : D3D11PFX_Effect( rnd ) {
 	EdgesTex = nullptr;
 	BlendTex = nullptr;
+	CurrentHistory = 0;
+	HistoryValid = false;
+	JitterIndex = -1;
+	XMStoreFloat4x4( &LastViewProj, XMMatrixIdentity() );
+	PredicationEnabled = false;
+	TemporalResolve = nullptr;
+
+	StatsEnabled = false;
+
+	D3D11GraphicsEngine* engine = reinterpret_cast<D3D11GraphicsEngine*>(Engine::GraphicsEngine);
+	for ( FrameQueries& frame : Queries ) {
+		D3D11_QUERY_DESC qd = {};
+		qd.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+		engine->GetDevice()->CreateQuery( &qd, frame.Disjoint.GetAddressOf() );
+
+		for ( PassQueries& pass : frame.Passes ) {
+			qd.Query = D3D11_QUERY_PIPELINE_STATISTICS;
+			engine->GetDevice()->CreateQuery( &qd, pass.Statistics.GetAddressOf() );
+			qd.Query = D3D11_QUERY_TIMESTAMP;
+			engine->GetDevice()->CreateQuery( &qd, pass.Begin.GetAddressOf() );
+			engine->GetDevice()->CreateQuery( &qd, pass.End.GetAddressOf() );
+		}
+	}
+	ResetStats();
 
 	Init();
 }
@@ -86,10 +118,127 @@ bool D3D11PFX_SMAA::Init() {
 	LumaEdgeDetection = SMAAShader->GetTechniqueByName( "LumaEdgeDetection" );
 	BlendingWeightCalculation = SMAAShader->GetTechniqueByName( "BlendingWeightCalculation" );
 	NeighborhoodBlending = SMAAShader->GetTechniqueByName( "NeighborhoodBlending" );
+	TemporalResolve = SMAAShader->GetTechniqueByName( "TemporalResolve" );
 
 	return true;
 }
 
+/** Returns the unjittered view-projection of this frame, for row-vectors */
+XMMATRIX XM_CALLCONV D3D11PFX_SMAA::GetUnjitteredViewProj() {
+	XMFLOAT4X4 proj = Engine::GAPI->GetProjectionMatrix();
+	proj._13 = 0.0f;
+	proj._23 = 0.0f;
+
+	return XMMatrixTranspose( XMMatrixMultiply( XMLoadFloat4x4( &proj ), XMLoadFloat4x4( &Engine::GAPI->GetRendererState().TransformState.TransformView ) ) );
+}
+
+/** Starts and ends the queries of a pass */
+void D3D11PFX_SMAA::BeginPass( ESMAAPass pass ) {
+	D3D11GraphicsEngine* engine = reinterpret_cast<D3D11GraphicsEngine*>(Engine::GraphicsEngine);
+	PassQueries& queries = Queries[QueryFrame].Passes[pass];
+	if ( !StatsEnabled || !queries.Statistics.Get() || !queries.Begin.Get() )
+		return;
+
+	engine->GetContext()->Begin( queries.Statistics.Get() );
+	engine->GetContext()->End( queries.Begin.Get() );
+}
+
+void D3D11PFX_SMAA::EndPass( ESMAAPass pass ) {
+	D3D11GraphicsEngine* engine = reinterpret_cast<D3D11GraphicsEngine*>(Engine::GraphicsEngine);
+	PassQueries& queries = Queries[QueryFrame].Passes[pass];
+	if ( !StatsEnabled || !queries.Statistics.Get() || !queries.End.Get() )
+		return;
+
+	engine->GetContext()->End( queries.End.Get() );
+	engine->GetContext()->End( queries.Statistics.Get() );
+	queries.Issued = true;
+}
+
+/** Reads the queries of an older frame and logs the averages every few seconds */
+void D3D11PFX_SMAA::CollectQueries() {
+	D3D11GraphicsEngine* engine = reinterpret_cast<D3D11GraphicsEngine*>(Engine::GraphicsEngine);
+
+	// The slot about to be reused holds the oldest frame. Don't stall if the GPU isn't done with it yet, just skip it.
+	FrameQueries& frame = Queries[QueryFrame];
+	if ( frame.Issued ) {
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+		if ( engine->GetContext()->GetData( frame.Disjoint.Get(), &disjoint, sizeof( disjoint ), D3D11_ASYNC_GETDATA_DONOTFLUSH ) == S_OK && !disjoint.Disjoint ) {
+			for ( int i = 0; i < SP_NUM_PASSES; i++ ) {
+				PassQueries& pass = frame.Passes[i];
+				if ( !pass.Issued )
+					continue;
+
+				UINT64 begin, end;
+				D3D11_QUERY_DATA_PIPELINE_STATISTICS stats;
+				if ( engine->GetContext()->GetData( pass.Begin.Get(), &begin, sizeof( begin ), D3D11_ASYNC_GETDATA_DONOTFLUSH ) != S_OK
+					|| engine->GetContext()->GetData( pass.End.Get(), &end, sizeof( end ), D3D11_ASYNC_GETDATA_DONOTFLUSH ) != S_OK
+					|| engine->GetContext()->GetData( pass.Statistics.Get(), &stats, sizeof( stats ), D3D11_ASYNC_GETDATA_DONOTFLUSH ) != S_OK )
+					continue;
+
+				PassTimeSumMS[i] += static_cast<double>(end - begin) * 1000.0 / static_cast<double>(disjoint.Frequency);
+				PassPixelSum[i] += stats.PSInvocations;
+				PassSampleCount[i]++;
+			}
+		}
+	}
+
+	frame.Issued = false;
+	for ( PassQueries& pass : frame.Passes ) {
+		pass.Issued = false;
+	}
+
+	if ( ++StatsFrames < SMAA_STATS_LOG_INTERVAL )
+		return;
+
+	std::stringstream ss;
+	ss << "SMAA at " << engine->GetResolution().x << "x" << engine->GetResolution().y << ":";
+	for ( int i = 0; i < SP_NUM_PASSES; i++ ) {
+		if ( PassSampleCount[i] == 0 )
+			continue;
+
+		ss << " " << SMAA_PASS_NAMES[i] << " " << (PassPixelSum[i] / PassSampleCount[i]) << " px "
+			<< static_cast<float>(PassTimeSumMS[i] / PassSampleCount[i]) << " ms;";
+
+		PassTimeSumMS[i] = 0.0;
+		PassPixelSum[i] = 0;
+		PassSampleCount[i] = 0;
+	}
+	LogInfoCh( LC_POSTFX ) << ss.str();
+
+	StatsFrames = 0;
+}
+
+/** Drops all queries in flight and the averages so far */
+void D3D11PFX_SMAA::ResetStats() {
+	QueryFrame = 0;
+	StatsFrames = 0;
+	for ( FrameQueries& frame : Queries ) {
+		frame.Issued = false;
+		for ( PassQueries& pass : frame.Passes ) {
+			pass.Issued = false;
+		}
+	}
+
+	for ( int i = 0; i < SP_NUM_PASSES; i++ ) {
+		PassTimeSumMS[i] = 0.0;
+		PassPixelSum[i] = 0;
+		PassSampleCount[i] = 0;
+	}
+}
+
+/** Creates the two buffers T2x alternates between */
+void D3D11PFX_SMAA::CreateHistory( const INT2& size ) {
+	D3D11GraphicsEngine* engine = reinterpret_cast<D3D11GraphicsEngine*>(Engine::GraphicsEngine);
+
+	HRESULT hr = S_OK;
+	for ( auto& history : HistoryTex ) {
+		history = std::make_unique<RenderToTextureBuffer>( engine->GetDevice().Get(), size.x, size.y, engine->GetBackBufferFormat(), &hr );
+		LE( hr );
+	}
+
+	HistoryValid = false;
+}
+
 /** Renders the PostFX */
 void D3D11PFX_SMAA::RenderPostFX(const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& renderTargetSRV ) {
 	D3D11GraphicsEngine* engine = reinterpret_cast<D3D11GraphicsEngine*>(Engine::GraphicsEngine);
@@ -108,8 +257,28 @@ void D3D11PFX_SMAA::RenderPostFX(const Microsoft::WRL::ComPtr<ID3D11ShaderResour
 
 	RenderToTextureBuffer& TempRTV = FxRenderer->GetTempBuffer();
 
+	const GothicRendererSettings& settings = Engine::GAPI->GetRendererState().RendererSettings;
+	INT2 resolution = INT2( engine->GetResolution().x, engine->GetResolution().y );
 	if ( !EdgesTex ) {
-		OnResize( INT2( engine->GetResolution().x, engine->GetResolution().y ) );
+		OnResize( resolution );
+	} else if ( settings.SMAAPredication != PredicationEnabled ) {
+		CreateEffect( resolution );
+	}
+
+	bool temporal = settings.EnableSMAAT2x && TemporalResolve && TemporalResolve->IsValid();
+	if ( temporal && !HistoryTex[0] ) {
+		CreateHistory( resolution );
+	}
+
+	// The queries cost a little GPU time each pass, so they only run while someone looks at the numbers
+	if ( settings.LogSMAAStats != StatsEnabled ) {
+		ResetStats();
+		StatsEnabled = settings.LogSMAAStats;
+	}
+
+	if ( StatsEnabled ) {
+		CollectQueries();
+		engine->GetContext()->Begin( Queries[QueryFrame].Disjoint.Get() );
 	}
 
 	engine->GetContext()->ClearRenderTargetView( EdgesTex->GetRenderTargetView().Get(), reinterpret_cast<float*>(&float4( 0, 0, 0, 0 )) );
@@ -120,41 +289,96 @@ void D3D11PFX_SMAA::RenderPostFX(const Microsoft::WRL::ComPtr<ID3D11ShaderResour
 	ID3D11ShaderResourceView* const NoSRV[3] = { nullptr, nullptr, nullptr };
 
 	engine->GetContext()->OMGetRenderTargets( 1, OldRTV.GetAddressOf(), OldDSV.GetAddressOf() );
-	engine->GetContext()->ClearDepthStencilView( OldDSV.Get(), D3D11_CLEAR_STENCIL, 0, 0 );
+	engine->GetContext()->ClearDepthStencilView( EdgeStencil->GetDepthStencilView().Get(), D3D11_CLEAR_STENCIL, 0, 0 );
+
+	// The scene depth is read for predication and reprojection, so it must not stay bound as target
+	const XMFLOAT4X4& proj = Engine::GAPI->GetProjectionMatrix();
+	float depthProjAB[2] = { proj._33, proj._34 };
+	SMAAShader->GetVariableByName( "depthTex" )->AsShaderResource()->SetResource( engine->GetDepthBuffer()->GetShaderResView().Get() );
+	SMAAShader->GetVariableByName( "depthProjAB" )->AsVector()->SetFloatVector( depthProjAB );
+
+	// This frame was rendered with the jitter set last frame, tell the blending weights which subsample that was
+	int subsample = temporal && JitterIndex >= 0 ? JitterIndex + 1 : 0;
+	int subsampleIndices[4] = { subsample, subsample, subsample, 0 };
+	SMAAShader->GetVariableByName( "subsampleIndices" )->AsVector()->SetIntVector( subsampleIndices );
 
 	/** First pass - Edge detection */
-	engine->GetContext()->OMSetRenderTargets( 1, EdgesTex->GetRenderTargetView().GetAddressOf(), OldDSV.Get() );
+	engine->GetContext()->OMSetRenderTargets( 1, EdgesTex->GetRenderTargetView().GetAddressOf(), EdgeStencil->GetDepthStencilView().Get() );
 
 	SMAAShader->GetVariableByName( "colorTexGamma" )->AsShaderResource()->SetResource( renderTargetSRV.Get() );
 
+	BeginPass( SP_EDGE_DETECTION );
 	LumaEdgeDetection->GetPassByIndex( 0 )->Apply( 0, engine->GetContext().Get() );
 	FxRenderer->DrawFullScreenQuad();
-
-	//FxRenderer->CopyTextureToRTV(renderTargetSRV, RTV, INT2(0, 0), true);
+	EndPass( SP_EDGE_DETECTION );
 
 	engine->GetContext()->PSSetShaderResources( 0, 3, NoSRV );
 
-	/** Second pass - BlendingWeightCalculation */
-	engine->GetContext()->OMSetRenderTargets( 1, BlendTex->GetRenderTargetView().GetAddressOf(), OldDSV.Get() );
+	/** Second pass - BlendingWeightCalculation, only where the first pass marked an edge in the stencil */
+	engine->GetContext()->OMSetRenderTargets( 1, BlendTex->GetRenderTargetView().GetAddressOf(), EdgeStencil->GetDepthStencilView().Get() );
 
 	SMAAShader->GetVariableByName( "edgesTex" )->AsShaderResource()->SetResource( EdgesTex->GetShaderResView().Get() );
 
+	BeginPass( SP_BLENDING_WEIGHTS );
 	BlendingWeightCalculation->GetPassByIndex( 0 )->Apply( 0, engine->GetContext().Get() );
 	FxRenderer->DrawFullScreenQuad();
+	EndPass( SP_BLENDING_WEIGHTS );
 
     engine->GetContext()->PSSetShaderResources( 0, 3, NoSRV );
 
-	/** Third pass - NeighborhoodBlending */
-	engine->GetContext()->OMSetRenderTargets( 1, TempRTV.GetRenderTargetView().GetAddressOf(), OldDSV.Get() );
+	/** Third pass - NeighborhoodBlending, into the history for T2x */
+	RenderToTextureBuffer& blendTarget = temporal ? *HistoryTex[CurrentHistory] : TempRTV;
+	engine->GetContext()->OMSetRenderTargets( 1, blendTarget.GetRenderTargetView().GetAddressOf(), nullptr );
 
 	SMAAShader->GetVariableByName( "colorTex" )->AsShaderResource()->SetResource( renderTargetSRV.Get() );
 	SMAAShader->GetVariableByName( "blendTex" )->AsShaderResource()->SetResource( BlendTex->GetShaderResView().Get() );
 
+	BeginPass( SP_NEIGHBORHOOD_BLENDING );
 	NeighborhoodBlending->GetPassByIndex( 0 )->Apply( 0, engine->GetContext().Get() );
 	FxRenderer->DrawFullScreenQuad();
+	EndPass( SP_NEIGHBORHOOD_BLENDING );
 
     engine->GetContext()->PSSetShaderResources( 0, 3, NoSRV );
 
+	XMMATRIX viewProj = GetUnjitteredViewProj();
+	if ( temporal ) {
+		/** Fourth pass - Blend with the reprojected last frame */
+		engine->GetContext()->OMSetRenderTargets( 1, TempRTV.GetRenderTargetView().GetAddressOf(), nullptr );
+
+		XMFLOAT4X4 reprojection;
+		XMStoreFloat4x4( &reprojection, XMMatrixMultiply( XMMatrixInverse( nullptr, viewProj ), XMLoadFloat4x4( &LastViewProj ) ) );
+		SMAAShader->GetVariableByName( "reprojection" )->AsMatrix()->SetMatrix( reinterpret_cast<float*>(&reprojection) );
+		SMAAShader->GetVariableByName( "historyWeight" )->AsScalar()->SetFloat( HistoryValid ? 1.0f : 0.0f );
+		SMAAShader->GetVariableByName( "colorTex" )->AsShaderResource()->SetResource( HistoryTex[CurrentHistory]->GetShaderResView().Get() );
+		SMAAShader->GetVariableByName( "colorTexPrev" )->AsShaderResource()->SetResource( HistoryTex[CurrentHistory ^ 1]->GetShaderResView().Get() );
+
+		BeginPass( SP_TEMPORAL_RESOLVE );
+		TemporalResolve->GetPassByIndex( 0 )->Apply( 0, engine->GetContext().Get() );
+		FxRenderer->DrawFullScreenQuad();
+		EndPass( SP_TEMPORAL_RESOLVE );
+
+		engine->GetContext()->PSSetShaderResources( 0, 3, NoSRV );
+
+		HistoryValid = true;
+		CurrentHistory ^= 1;
+
+		// Alternate the subpixel offset of the next frame
+		JitterIndex = JitterIndex == 0 ? 1 : 0;
+		const XMFLOAT2& jitter = SMAA_T2X_JITTER[JitterIndex];
+		Engine::GAPI->SetProjectionJitter( XMFLOAT2( 2.0f * jitter.x / resolution.x, 2.0f * jitter.y / resolution.y ) );
+	} else {
+		HistoryValid = false;
+		JitterIndex = -1;
+		Engine::GAPI->SetProjectionJitter( XMFLOAT2( 0, 0 ) );
+	}
+	XMStoreFloat4x4( &LastViewProj, viewProj );
+
+	if ( StatsEnabled ) {
+		engine->GetContext()->End( Queries[QueryFrame].Disjoint.Get() );
+		Queries[QueryFrame].Issued = true;
+		QueryFrame = (QueryFrame + 1) % NUM_QUERY_FRAMES;
+	}
+
 	/** Copy back to main RTV */
 	engine->GetContext()->OMSetRenderTargets( 1, OldRTV.GetAddressOf(), nullptr );
     engine->GetContext()->PSSetShaderResources( 0, 1, TempRTV.GetShaderResView().GetAddressOf() );
@@ -192,13 +416,29 @@ void D3D11PFX_SMAA::OnResize( const INT2& size ) {
 
 	HRESULT hr = S_OK;
 
-	// Create Edges- and Blend-Textures
-	EdgesTex = new RenderToTextureBuffer( engine->GetDevice().Get(), size.x, size.y, DXGI_FORMAT_B8G8R8A8_UNORM, &hr );
+	// Create Edges- and Blend-Textures. Edges only need two channels.
+	EdgesTex = new RenderToTextureBuffer( engine->GetDevice().Get(), size.x, size.y, DXGI_FORMAT_R8G8_UNORM, &hr );
 	LE( hr );
 
 	BlendTex = new RenderToTextureBuffer( engine->GetDevice().Get(), size.x, size.y, DXGI_FORMAT_B8G8R8A8_UNORM, &hr );
 	LE( hr );
 
+	EdgeStencil = std::make_unique<RenderToDepthStencilBuffer>( engine->GetDevice().Get(), size.x, size.y, DXGI_FORMAT_R24G8_TYPELESS, &hr, DXGI_FORMAT_D24_UNORM_S8_UINT, DXGI_FORMAT_R24_UNORM_X8_TYPELESS );
+	LE( hr );
+
+	// Recreated on the next T2x frame
+	HistoryTex[0].reset();
+	HistoryTex[1].reset();
+	HistoryValid = false;
+
+	CreateEffect( size );
+}
+
+/** Compiles the effect for the given resolution and the current settings */
+void D3D11PFX_SMAA::CreateEffect( const INT2& size ) {
+	D3D11GraphicsEngine* engine = reinterpret_cast<D3D11GraphicsEngine*>(Engine::GraphicsEngine);
+
+	HRESULT hr = S_OK;
 	std::vector<D3D_SHADER_MACRO> Makros;
 
 	char ResStr[256];
@@ -239,6 +479,13 @@ void D3D11PFX_SMAA::OnResize( const INT2& size ) {
 	}
 	break;
 	}
+
+	PredicationEnabled = Engine::GAPI->GetRendererState().RendererSettings.SMAAPredication;
+	if ( PredicationEnabled ) {
+		D3D_SHADER_MACRO Predication = { "SMAA_PREDICATION", "1" };
+		Makros.push_back( Predication );
+	}
+
 	D3D_SHADER_MACRO Null = { nullptr, nullptr };
 	Makros.push_back( Null );
 
@@ -258,4 +505,5 @@ void D3D11PFX_SMAA::OnResize( const INT2& size ) {
 	LumaEdgeDetection = SMAAShader->GetTechniqueByName( "LumaEdgeDetection" );
 	BlendingWeightCalculation = SMAAShader->GetTechniqueByName( "BlendingWeightCalculation" );
 	NeighborhoodBlending = SMAAShader->GetTechniqueByName( "NeighborhoodBlending" );
+	TemporalResolve = SMAAShader->GetTechniqueByName( "TemporalResolve" );
 }
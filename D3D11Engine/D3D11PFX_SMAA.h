@@ -4,6 +4,7 @@
 #include "d3d11pfx_effect.h"
 
 struct RenderToTextureBuffer;
+struct RenderToDepthStencilBuffer;
 class D3D11PFX_SMAA :
     public D3D11PFX_Effect {
 public:
@@ -23,15 +24,83 @@ public:
     XRESULT Render( RenderToTextureBuffer* fxbuffer ) { return XR_SUCCESS; };
 
 private:
+    enum ESMAAPass {
+        SP_EDGE_DETECTION,
+        SP_BLENDING_WEIGHTS,
+        SP_NEIGHBORHOOD_BLENDING,
+        SP_TEMPORAL_RESOLVE,
+
+        SP_NUM_PASSES
+    };
+
+    /** Frames the queries stay in flight before they are read */
+    static const int NUM_QUERY_FRAMES = 3;
+
+    /** Shaded pixels and GPU time of one pass */
+    struct PassQueries {
+        Microsoft::WRL::ComPtr<ID3D11Query> Statistics;
+        Microsoft::WRL::ComPtr<ID3D11Query> Begin;
+        Microsoft::WRL::ComPtr<ID3D11Query> End;
+        bool Issued;
+    };
+
+    struct FrameQueries {
+        Microsoft::WRL::ComPtr<ID3D11Query> Disjoint;
+        PassQueries Passes[SP_NUM_PASSES];
+        bool Issued;
+    };
+
+    /** Compiles the effect for the given resolution and the current settings */
+    void CreateEffect( const INT2& size );
+
+    /** Creates the two buffers T2x alternates between */
+    void CreateHistory( const INT2& size );
+
+    /** Returns the unjittered view-projection of this frame, for row-vectors */
+    XMMATRIX XM_CALLCONV GetUnjitteredViewProj();
+
+    /** Starts and ends the queries of a pass */
+    void BeginPass( ESMAAPass pass );
+    void EndPass( ESMAAPass pass );
+
+    /** Reads the queries of an older frame and logs the averages every few seconds */
+    void CollectQueries();
+
+    /** Drops all queries in flight and the averages so far */
+    void ResetStats();
+
     Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AreaTextureSRV;
     Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> SearchTextureSRV;
 
     RenderToTextureBuffer* EdgesTex;
     RenderToTextureBuffer* BlendTex;
 
+    /** Marks the pixels with edges, so the blending weights are only computed there. The scene depthbuffer has no stencil. */
+    std::unique_ptr<RenderToDepthStencilBuffer> EdgeStencil;
+
+    /** Antialiased frames for T2x, the older one gets reprojected */
+    std::unique_ptr<RenderToTextureBuffer> HistoryTex[2];
+    int CurrentHistory;
+    bool HistoryValid;
+
+    /** Jitter the frame was rendered with, -1 if none */
+    int JitterIndex;
+    XMFLOAT4X4 LastViewProj;
+
+    /** Whether the effect was compiled with predication */
+    bool PredicationEnabled;
+
     Microsoft::WRL::ComPtr<ID3DX11Effect> SMAAShader;
     ID3DX11EffectTechnique* LumaEdgeDetection;
     ID3DX11EffectTechnique* BlendingWeightCalculation;
     ID3DX11EffectTechnique* NeighborhoodBlending;
-};
+    ID3DX11EffectTechnique* TemporalResolve;
 
+    FrameQueries Queries[NUM_QUERY_FRAMES];
+    int QueryFrame;
+    double PassTimeSumMS[SP_NUM_PASSES];
+    UINT64 PassPixelSum[SP_NUM_PASSES];
+    int PassSampleCount[SP_NUM_PASSES];
+    int StatsFrames;
+    bool StatsEnabled;
+};
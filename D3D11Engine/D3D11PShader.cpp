@@ -23,7 +23,7 @@ XRESULT D3D11PShader::LoadShader( const char* pixelShader, const std::vector<D3D
     Microsoft::WRL::ComPtr<ID3DBlob> psBlob;
 
     if ( Engine::GAPI->GetRendererState().RendererSettings.EnableDebugLog )
-        LogInfo() << "Compilling pixel shader: " << pixelShader;
+        LogInfoCh( LC_SHADERS ) << "Compilling pixel shader: " << pixelShader;
 
     // Compile shaders
     if ( FAILED( D3D11ShaderManager::CompileShaderFromFile( pixelShader, "PSMain", "ps_4_0", psBlob.GetAddressOf(), makros ) ) ) {
@@ -10,22 +10,23 @@
 #include "D3D11PFX_HeightFog.h"
 #include "D3D11PFX_DistanceBlur.h"
 #include "D3D11PFX_HDR.h"
-#include "D3D11NVHBAO.h"
+#include "D3D11PFX_HBAO.h"
 #include "D3D11PFX_SMAA.h"
 #include "D3D11PFX_GodRays.h"
+#include "GothicAPI.h"
 
 D3D11PfxRenderer::D3D11PfxRenderer() {
+    PendingComposite = 0;
+
     FX_Blur = std::make_unique<D3D11PFX_Blur>( this );
     FX_HeightFog = std::make_unique<D3D11PFX_HeightFog>( this );
     //FX_DistanceBlur = new D3D11PFX_DistanceBlur(this);
     FX_HDR = std::make_unique<D3D11PFX_HDR>( this );
     FX_GodRays = std::make_unique<D3D11PFX_GodRays>( this );
+    FX_HBAO = std::make_unique<D3D11PFX_HBAO>( this );
 
     if ( !FeatureLevel10Compatibility ) {
         FX_SMAA = std::make_unique<D3D11PFX_SMAA>( this );
-
-        NvHBAO = std::make_unique<D3D11NVHBAO>();
-        NvHBAO->Init();
     }
 }
 
@@ -47,6 +48,11 @@ XRESULT D3D11PfxRenderer::BlurTexture( RenderToTextureBuffer* texture, bool leav
 
 /** Renders the heightfog */
 XRESULT D3D11PfxRenderer::RenderHeightfog() {
+    if ( IsFusedIntoComposite( D3D11PFX_HDR::CP_HEIGHTFOG ) ) {
+        AddPendingComposite( D3D11PFX_HDR::CP_HEIGHTFOG );
+        return XR_SUCCESS;
+    }
+
     return FX_HeightFog->Render( nullptr );
 }
 
@@ -57,7 +63,27 @@ XRESULT D3D11PfxRenderer::RenderGodRays() {
 
 /** Renders the HDR-Effect */
 XRESULT D3D11PfxRenderer::RenderHDR() {
-    return FX_HDR->Render( nullptr );
+    XRESULT xr = FX_HDR->Render( nullptr );
+    PendingComposite = 0;
+    return xr;
+}
+
+/** Returns whether the given D3D11PFX_HDR::ECompositePass is left to the HDR composite instead of its own pass */
+bool D3D11PfxRenderer::IsFusedIntoComposite( int pass ) {
+    const GothicRendererSettings& settings = Engine::GAPI->GetRendererState().RendererSettings;
+    if ( !settings.EnableHDR )
+        return false;
+
+    switch ( pass ) {
+    case D3D11PFX_HDR::CP_GODRAYS:
+        return settings.PostFXFusion >= 1;
+
+    case D3D11PFX_HDR::CP_HEIGHTFOG:
+        return settings.PostFXFusion >= 2;
+
+    default:
+        return false;
+    }
 }
 
 /** Renders the SMAA-Effect */
@@ -152,6 +178,8 @@ XRESULT D3D11PfxRenderer::OnResize( const INT2& newResolution ) {
     TempBufferDS4_1.reset( new RenderToTextureBuffer( engine->GetDevice(), newResolution.x / 4, newResolution.y / 4, bbufferFormat, nullptr ) );
     TempBufferDS4_2.reset( new RenderToTextureBuffer( engine->GetDevice(), newResolution.x / 4, newResolution.y / 4, bbufferFormat, nullptr ) );
 
+    FX_HDR->OnResize( newResolution );
+
     if ( !FeatureLevel10Compatibility ) {
         FX_SMAA->OnResize( newResolution );
     }
@@ -161,5 +189,5 @@ XRESULT D3D11PfxRenderer::OnResize( const INT2& newResolution ) {
 
 /** Draws the HBAO-Effect to the given buffer */
 XRESULT D3D11PfxRenderer::DrawHBAO( const Microsoft::WRL::ComPtr<ID3D11RenderTargetView>& rtv ) {
-    return NvHBAO->Render( rtv.Get() );
+    return FX_HBAO->RenderPostFX( rtv );
 }
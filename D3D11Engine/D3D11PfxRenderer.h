@@ -8,7 +8,7 @@ class D3D11PFX_DistanceBlur;
 class D3D11PFX_HDR;
 class D3D11PFX_SMAA;
 class D3D11PFX_GodRays;
-class D3D11NVHBAO;
+class D3D11PFX_HBAO;
 class D3D11PfxRenderer {
 public:
     D3D11PfxRenderer();
@@ -35,6 +35,13 @@ public:
     /** Renders the godrays-Effect */
     XRESULT RenderGodRays();
 
+    /** Returns whether the given D3D11PFX_HDR::ECompositePass is left to the HDR composite instead of its own pass */
+    bool IsFusedIntoComposite( int pass );
+
+    /** Passes whose results the HDR composite still has to apply this frame */
+    int GetPendingComposite() { return PendingComposite; }
+    void AddPendingComposite( int pass ) { PendingComposite |= pass; }
+
     /** Copies the given texture to the given RTV */
     XRESULT CopyTextureToRTV( const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& texture, const Microsoft::WRL::ComPtr<ID3D11RenderTargetView>& rtv, INT2 targetResolution = INT2( 0, 0 ), bool useCustomPS = false, INT2 offset = INT2( 0, 0 ) );
 
@@ -67,8 +74,9 @@ private:
     std::unique_ptr<D3D11PFX_HDR> FX_HDR;
     std::unique_ptr<D3D11PFX_SMAA> FX_SMAA;
     std::unique_ptr<D3D11PFX_GodRays> FX_GodRays;
+    std::unique_ptr<D3D11PFX_HBAO> FX_HBAO;
 
-    /** Nivida HBAO+ */
-    std::unique_ptr<D3D11NVHBAO> NvHBAO;
+    /** Bits of D3D11PFX_HDR::ECompositePass, reset after each composite */
+    int PendingComposite;
 };
 
@@ -65,6 +65,7 @@ void D3D11PointLight::InitResources() {
         DXGI_FORMAT_D16_UNORM,
         DXGI_FORMAT_R16_UNORM,
         6 );
+    DepthCubemap->SetMemoryCategory( ResidencyManager::C_SHADOW_MAPS );
 
     // Create constantbuffer for the view-matrices
     D3D11ConstantBuffer* cb = nullptr;
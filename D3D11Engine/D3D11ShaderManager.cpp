@@ -10,9 +10,12 @@
 #include "GothicAPI.h"
 #include "Engine.h"
 #include "Threadpool.h"
+#include "FileWatcher.h"
 
 #include "D3D11GraphicsEngineBase.h"
 #include <d3dcompiler.h>
+#include <filesystem>
+#include <algorithm>
 
 // Patch HLSL-Compiler for http://support.microsoft.com/kb/2448404
 #if D3DX_VERSION == 0xa2b
@@ -21,11 +24,305 @@
 
 const int NUM_MAX_BONES = 96;
 
+const uint32_t SHADER_CACHE_MAGIC = MAKEFOURCC( 'G', 'D', 'S', 'C' );
+const uint32_t SHADER_CACHE_VERSION = 1;
+const char* SHADER_CACHE_FOLDER = "system\\GD3D11\\shaders\\cache\\";
+const char* SHADER_FOLDER = "system\\GD3D11\\shaders\\";
+
+/** Header of a compiled shader in the cache */
+struct ShaderCacheHeader {
+    uint32_t Magic;
+    uint32_t Version;
+    uint64_t KeyHash;
+    uint32_t DataSize;
+    uint32_t Pad;
+};
+
+static std::atomic<unsigned int> NumShadersCompiled = 0;
+static std::atomic<unsigned int> NumShaderCacheHits = 0;
+
+/** Cache files read or written since the shaders started loading, in lowercase. Everything else in the cache folder is stale. */
+static std::mutex UsedCacheFilesMutex;
+static std::set<std::string> UsedCacheFiles;
+
+/** Which files each shader file includes directly, relative to the shader folder and in lowercase. Collected
+    from every compilation, so a file changed on disk can be traced up to the shaders it ends up in. */
+static std::mutex IncludeGraphMutex;
+static std::unordered_map<std::string, std::set<std::string>> IncludeGraph;
+
+/** Returns the path relative to the shader folder in lowercase, the way the include graph keys it */
+static std::string GetIncludeGraphKey( const std::filesystem::path& file ) {
+    std::string key = file.lexically_normal().lexically_relative( Engine::GAPI->GetStartDirectory() + "\\" + SHADER_FOLDER ).string();
+    std::transform( key.begin(), key.end(), key.begin(), ::tolower );
+    return key;
+}
+
+/** Adds all files which include one of the given files, directly or through others */
+static void AddIncludingFiles( std::set<std::string>& files ) {
+    std::unique_lock<std::mutex> lock( IncludeGraphMutex );
+
+    bool added = true;
+    while ( added ) {
+        added = false;
+        for ( auto const& node : IncludeGraph ) {
+            if ( files.count( node.first ) )
+                continue;
+
+            for ( const std::string& include : node.second ) {
+                if ( files.count( include ) ) {
+                    files.insert( node.first );
+                    added = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/** FNV-1a over the given data, continuing from hash */
+static uint64_t HashShaderData( uint64_t hash, const void* data, size_t size ) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    for ( size_t i = 0; i < size; i++ ) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/** Identifies the d3dcompiler DLL which is actually loaded. D3D_COMPILER_VERSION is only the one of the headers
+    we were built with, the game folder or the system may come with a different build of the DLL. */
+static uint64_t GetCompilerIdentity() {
+    static const uint64_t identity = []() {
+        uint64_t hash = 14695981039346656037ull;
+
+        const int compilerVersion = D3D_COMPILER_VERSION;
+        hash = HashShaderData( hash, &compilerVersion, sizeof( compilerVersion ) );
+
+        char path[MAX_PATH];
+        WIN32_FILE_ATTRIBUTE_DATA attributes;
+        HMODULE compiler = GetModuleHandleA( D3DCOMPILER_DLL_A );
+        if ( compiler && GetModuleFileNameA( compiler, path, MAX_PATH ) && GetFileAttributesExA( path, GetFileExInfoStandard, &attributes ) ) {
+            hash = HashShaderData( hash, path, strlen( path ) );
+            hash = HashShaderData( hash, &attributes.nFileSizeHigh, sizeof( attributes.nFileSizeHigh ) );
+            hash = HashShaderData( hash, &attributes.nFileSizeLow, sizeof( attributes.nFileSizeLow ) );
+            hash = HashShaderData( hash, &attributes.ftLastWriteTime, sizeof( attributes.ftLastWriteTime ) );
+        } else {
+            LogWarnCh( LC_SHADERS ) << "Couldn't find the loaded " << D3DCOMPILER_DLL_A << ", the shader cache only checks the compiler version";
+        }
+        return hash;
+    }();
+    return identity;
+}
+
+/** Everything the bytecode depends on. The preprocessed source already contains the includes and defines. */
+static uint64_t GetShaderCacheKey( ID3DBlob* preprocessed, LPCSTR szEntryPoint, LPCSTR szShaderModel, DWORD flags ) {
+    uint64_t hash = 14695981039346656037ull;
+    hash = HashShaderData( hash, preprocessed->GetBufferPointer(), preprocessed->GetBufferSize() );
+    hash = HashShaderData( hash, szEntryPoint, strlen( szEntryPoint ) + 1 );
+    hash = HashShaderData( hash, szShaderModel, strlen( szShaderModel ) + 1 );
+    hash = HashShaderData( hash, &flags, sizeof( flags ) );
+
+    const uint64_t compiler = GetCompilerIdentity();
+    return HashShaderData( hash, &compiler, sizeof( compiler ) );
+}
+
+/** Remembers that the cache file is still in use */
+static void MarkCacheFileUsed( const std::string& file ) {
+    std::string name = std::filesystem::path( file ).filename().string();
+    std::transform( name.begin(), name.end(), name.begin(), ::tolower );
+
+    std::unique_lock<std::mutex> lock( UsedCacheFilesMutex );
+    UsedCacheFiles.insert( name );
+}
+
+/** Deletes the cache files nothing was loaded from or written to since the shaders started loading */
+static void PruneShaderCache() {
+    std::set<std::string> used;
+    {
+        std::unique_lock<std::mutex> lock( UsedCacheFilesMutex );
+        used = UsedCacheFiles;
+    }
+
+    std::error_code ec;
+    unsigned int numRemoved = 0;
+    for ( const auto& entry : std::filesystem::directory_iterator( Engine::GAPI->GetStartDirectory() + "\\" + SHADER_CACHE_FOLDER, ec ) ) {
+        std::string name = entry.path().filename().string();
+        std::transform( name.begin(), name.end(), name.begin(), ::tolower );
+        if ( entry.path().extension() != ".gdsc" || used.count( name ) )
+            continue;
+
+        std::error_code removeError;
+        if ( std::filesystem::remove( entry.path(), removeError ) )
+            numRemoved++;
+    }
+
+    if ( numRemoved > 0 ) {
+        LogInfoCh( LC_SHADERS ) << "Removed " << numRemoved << " outdated files from the shader cache";
+    }
+}
+
+/** Returns the file the given shader is cached in */
+static std::string GetShaderCacheFile( const CHAR* szFileName, uint64_t key ) {
+    char hex[17];
+    sprintf_s( hex, "%016llx", static_cast<unsigned long long>(key) );
+    return Engine::GAPI->GetStartDirectory() + "\\" + SHADER_CACHE_FOLDER + std::filesystem::path( szFileName ).stem().string() + "_" + hex + ".gdsc";
+}
+
+/** Loads bytecode compiled before with the same key */
+static bool LoadShaderFromCache( const CHAR* szFileName, uint64_t key, ID3DBlob** ppBlobOut ) {
+    std::string file = GetShaderCacheFile( szFileName, key );
+    FILE* f = fopen( file.c_str(), "rb" );
+    if ( !f )
+        return false;
+
+    ShaderCacheHeader header;
+    bool ok = fread( &header, sizeof( header ), 1, f ) == 1
+        && header.Magic == SHADER_CACHE_MAGIC && header.Version == SHADER_CACHE_VERSION
+        && header.KeyHash == key && header.DataSize > 0
+        && SUCCEEDED( D3DCreateBlob( header.DataSize, ppBlobOut ) );
+
+    if ( ok && fread( (*ppBlobOut)->GetBufferPointer(), header.DataSize, 1, f ) != 1 ) {
+        (*ppBlobOut)->Release();
+        *ppBlobOut = nullptr;
+        ok = false;
+    }
+
+    fclose( f );
+
+    if ( ok )
+        MarkCacheFileUsed( file );
+    return ok;
+}
+
+/** Stores the bytecode, so the next start can skip compiling it */
+static void SaveShaderToCache( const CHAR* szFileName, uint64_t key, ID3DBlob* blob ) {
+    std::error_code ec;
+    std::filesystem::create_directories( Engine::GAPI->GetStartDirectory() + "\\" + SHADER_CACHE_FOLDER, ec );
+
+    std::string file = GetShaderCacheFile( szFileName, key );
+    FILE* f = fopen( file.c_str(), "wb" );
+    if ( !f ) {
+        LogWarnCh( LC_SHADERS ) << "Failed to open shader cache file " << file << " for writing";
+        return;
+    }
+
+    ShaderCacheHeader header = {};
+    header.Magic = SHADER_CACHE_MAGIC;
+    header.Version = SHADER_CACHE_VERSION;
+    header.KeyHash = key;
+    header.DataSize = static_cast<uint32_t>(blob->GetBufferSize());
+
+    fwrite( &header, sizeof( header ), 1, f );
+    fwrite( blob->GetBufferPointer(), blob->GetBufferSize(), 1, f );
+    fclose( f );
+
+    MarkCacheFileUsed( file );
+}
+
+/** Names of the variants requested in earlier runs, one per line. They load together with the other shaders,
+    so they come from the cache right away instead of being compiled again once they're drawn. */
+static std::string GetRequestedVariantsFile() {
+    return Engine::GAPI->GetStartDirectory() + "\\" + SHADER_CACHE_FOLDER + "variants.txt";
+}
+
+static std::set<std::string> LoadRequestedVariants() {
+    std::set<std::string> names;
+    FILE* f = fopen( GetRequestedVariantsFile().c_str(), "r" );
+    if ( !f )
+        return names;
+
+    char line[256];
+    while ( fgets( line, sizeof( line ), f ) ) {
+        std::string name = line;
+        name.erase( name.find_last_not_of( "\r\n" ) + 1 );
+        if ( !name.empty() )
+            names.insert( name );
+    }
+    fclose( f );
+    return names;
+}
+
+static void SaveRequestedVariant( const std::string& name ) {
+    std::error_code ec;
+    std::filesystem::create_directories( Engine::GAPI->GetStartDirectory() + "\\" + SHADER_CACHE_FOLDER, ec );
+
+    FILE* f = fopen( GetRequestedVariantsFile().c_str(), "a" );
+    if ( !f )
+        return;
+
+    fprintf( f, "%s\n", name.c_str() );
+    fclose( f );
+}
+
+/** Reads the whole file */
+static bool ReadShaderSource( const CHAR* szFileName, std::vector<char>& source ) {
+    FILE* f = fopen( szFileName, "rb" );
+    if ( !f )
+        return false;
+
+    fseek( f, 0, SEEK_END );
+    long size = ftell( f );
+    fseek( f, 0, SEEK_SET );
+
+    source.resize( std::max( size, 0L ) );
+    bool ok = size > 0 && fread( &source[0], size, 1, f ) == 1;
+    fclose( f );
+    return ok;
+}
+
+/** Resolves includes relative to the including file, then to the shader folder, without touching the current
+    directory of the process. Records every include in the include graph. */
+class ShaderIncludeHandler : public ID3DInclude {
+public:
+    ShaderIncludeHandler( const std::filesystem::path& rootFile ) : RootFile( rootFile ) {}
+
+    HRESULT __stdcall Open( D3D_INCLUDE_TYPE IncludeType, LPCSTR pFileName, LPCVOID pParentData, LPCVOID* ppData, UINT* pBytes ) override {
+        auto parent = OpenFiles.find( pParentData );
+        const std::filesystem::path& parentFile = parent != OpenFiles.end() ? parent->second.first : RootFile;
+
+        std::filesystem::path file = parentFile.parent_path() / pFileName;
+        std::vector<char> source;
+        if ( !ReadShaderSource( file.string().c_str(), source ) ) {
+            file = std::filesystem::path( Engine::GAPI->GetStartDirectory() ) / SHADER_FOLDER / pFileName;
+            if ( !ReadShaderSource( file.string().c_str(), source ) )
+                return E_FAIL;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock( IncludeGraphMutex );
+            IncludeGraph[GetIncludeGraphKey( parentFile )].insert( GetIncludeGraphKey( file ) );
+        }
+
+        *ppData = &source[0];
+        *pBytes = static_cast<UINT>(source.size());
+        OpenFiles[*ppData] = std::make_pair( file, std::move( source ) );
+        return S_OK;
+    }
+
+    HRESULT __stdcall Close( LPCVOID pData ) override {
+        OpenFiles.erase( pData );
+        return S_OK;
+    }
+
+private:
+    std::filesystem::path RootFile;
+
+    /** Path and contents of the includes still open, by their data */
+    std::map<LPCVOID, std::pair<std::filesystem::path, std::vector<char>>> OpenFiles;
+};
+
 D3D11ShaderManager::D3D11ShaderManager() {
     ReloadShadersNextFrame = false;
 }
 
 D3D11ShaderManager::~D3D11ShaderManager() {
+    SourceWatcher.reset();
+    CompilePool.reset();
+
+    // Drop what finished after the last frame
+    for ( auto& swap : PendingSwaps ) {
+        swap();
+    }
     DeleteShaders();
 }
 
@@ -35,9 +332,8 @@ D3D11ShaderManager::~D3D11ShaderManager() {
 HRESULT D3D11ShaderManager::CompileShaderFromFile( const CHAR* szFileName, LPCSTR szEntryPoint, LPCSTR szShaderModel, ID3DBlob** ppBlobOut, const std::vector<D3D_SHADER_MACRO>& makros ) {
     HRESULT hr = S_OK;
 
-    char dir[260];
-    GetCurrentDirectoryA( 260, dir );
-    SetCurrentDirectoryA( Engine::GAPI->GetStartDirectory().c_str() );
+    // Relative to the game, don't rely on the current directory. Other threads may compile at the same time.
+    std::filesystem::path file = std::filesystem::path( Engine::GAPI->GetStartDirectory() ) / szFileName;
 
     DWORD dwShaderFlags = 0;
 #if defined(DEBUG) || defined(_DEBUG)
@@ -57,27 +353,49 @@ HRESULT D3D11ShaderManager::CompileShaderFromFile( const CHAR* szFileName, LPCST
     // Push these to the front
     m.insert( m.begin(), makros.begin(), makros.end() );
 
+    std::vector<char> source;
+    if ( !ReadShaderSource( file.string().c_str(), source ) ) {
+        LogErrorCh( LC_SHADERS ) << "Failed to read shader " << szFileName;
+        return E_FAIL;
+    }
+
+    // Preprocess first, so the cache key covers the includes and the defines
+    ShaderIncludeHandler includes( file );
+    Microsoft::WRL::ComPtr<ID3DBlob> preprocessed;
     Microsoft::WRL::ComPtr<ID3DBlob> pErrorBlob;
-    hr = D3DCompileFromFile( Toolbox::ToWideChar( szFileName ).c_str(), &m[0], D3D_COMPILE_STANDARD_FILE_INCLUDE, szEntryPoint, szShaderModel, dwShaderFlags, 0, ppBlobOut, &pErrorBlob );
+    hr = D3DPreprocess( &source[0], source.size(), szFileName, &m[0], &includes, preprocessed.GetAddressOf(), pErrorBlob.GetAddressOf() );
+    if ( SUCCEEDED( hr ) ) {
+        uint64_t key = GetShaderCacheKey( preprocessed.Get(), szEntryPoint, szShaderModel, dwShaderFlags );
+        if ( LoadShaderFromCache( szFileName, key, ppBlobOut ) ) {
+            NumShaderCacheHits++;
+            return S_OK;
+        }
+
+        hr = D3DCompile( preprocessed->GetBufferPointer(), preprocessed->GetBufferSize(), szFileName, nullptr, nullptr,
+            szEntryPoint, szShaderModel, dwShaderFlags, 0, ppBlobOut, pErrorBlob.ReleaseAndGetAddressOf() );
+        if ( SUCCEEDED( hr ) ) {
+            NumShadersCompiled++;
+            SaveShaderToCache( szFileName, key, *ppBlobOut );
+        }
+    }
+
     if ( FAILED( hr ) ) {
-        LogInfo() << "Shader compilation failed!";
+        LogInfoCh( LC_SHADERS ) << "Shader compilation failed!";
         if ( pErrorBlob.Get() ) {
             LogErrorBox() << reinterpret_cast<char*>(pErrorBlob->GetBufferPointer()) << "\n\n (You can ignore the next error from Gothic about too small video memory!)";
         }
 
-        SetCurrentDirectoryA( dir );
         return hr;
     }
 
-    SetCurrentDirectoryA( dir );
     return S_OK;
 }
 
 /** Creates list with ShaderInfos */
 XRESULT D3D11ShaderManager::Init() {
     Shaders = std::vector<ShaderInfo>();
-    VShaders = std::unordered_map<std::string, std::shared_ptr<D3D11VShader>>();
-    PShaders = std::unordered_map<std::string, std::shared_ptr<D3D11PShader>>();
+    Permutations.clear();
+    PermutationHandles.clear();
 
     Shaders.push_back( ShaderInfo( "VS_Ex", "VS_Ex.hlsl", "v", 1 ) );
     Shaders.back().cBufferSizes.push_back( sizeof( VS_ExConstantBuffer_PerFrame ) );
@@ -145,6 +463,10 @@ XRESULT D3D11ShaderManager::Init() {
     Shaders.back().cBufferSizes.push_back( sizeof( VS_ExConstantBuffer_PerInstanceSkeletal ) );
     Shaders.back().cBufferSizes.push_back( NUM_MAX_BONES * sizeof( XMFLOAT4X4 ) );
 
+    Shaders.push_back( ShaderInfo( "VS_ExSkeletalInstanced", "VS_ExSkeletalInstanced.hlsl", "v", 3 ) );
+    Shaders.back().cBufferSizes.push_back( sizeof( VS_ExConstantBuffer_PerFrame ) );
+    Shaders.back().cBufferSizes.push_back( sizeof( VS_ExConstantBuffer_SkeletalInstancing ) );
+
     Shaders.push_back( ShaderInfo( "VS_ExSkeletalVN", "VS_ExSkeletalVN.hlsl", "v", 3 ) );
     Shaders.back().cBufferSizes.push_back( sizeof( VS_ExConstantBuffer_PerFrame ) );
     Shaders.back().cBufferSizes.push_back( sizeof( VS_ExConstantBuffer_PerInstanceSkeletal ) );
@@ -283,14 +605,30 @@ XRESULT D3D11ShaderManager::Init() {
     m.Definition = "4";
     makros.push_back( m );
 
-    Shaders.push_back( ShaderInfo( "PS_PFX_HDR", "PS_PFX_HDR.hlsl", "p", makros ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( HDRSettingsConstantBuffer ) );
+    // Feature order matches D3D11PFX_HDR::ECompositePass
+    DeclarePermutations( ShaderInfo( "PS_PFX_HDR", "PS_PFX_HDR.hlsl", "p", makros ), {
+        { "FUSE_GODRAYS", "_GodRays" },
+        { "FUSE_HEIGHTFOG", "_Fog" },
+        { "COLOR_GRADING", "_Grading" } } );
+    Permutations.back().base.cBufferSizes.push_back( sizeof( HDRSettingsConstantBuffer ) );
+    Permutations.back().base.cBufferSizes.push_back( sizeof( AtmosphereConstantBuffer ) );
+    Permutations.back().base.cBufferSizes.push_back( sizeof( HeightfogConstantBuffer ) );
     makros.clear();
 
+    Shaders.push_back( ShaderInfo( "PS_PFX_BloomDownsample", "PS_PFX_BloomDownsample.hlsl", "p" ) );
+    Shaders.push_back( ShaderInfo( "PS_PFX_BloomUpsample", "PS_PFX_BloomUpsample.hlsl", "p" ) );
+
     Shaders.push_back( ShaderInfo( "PS_PFX_GodRayMask", "PS_PFX_GodRayMask.hlsl", "p" ) );
     Shaders.push_back( ShaderInfo( "PS_PFX_GodRayZoom", "PS_PFX_GodRayZoom.hlsl", "p" ) );
     Shaders.back().cBufferSizes.push_back( sizeof( GodRayZoomConstantBuffer ) );
 
+    Shaders.push_back( ShaderInfo( "PS_PFX_HBAO", "PS_PFX_HBAO.hlsl", "p" ) );
+    Shaders.back().cBufferSizes.push_back( sizeof( HBAOConstantBuffer ) );
+    Shaders.push_back( ShaderInfo( "PS_PFX_HBAOTemporal", "PS_PFX_HBAOTemporal.hlsl", "p" ) );
+    Shaders.back().cBufferSizes.push_back( sizeof( HBAOConstantBuffer ) );
+    Shaders.push_back( ShaderInfo( "PS_PFX_HBAOUpsample", "PS_PFX_HBAOUpsample.hlsl", "p" ) );
+    Shaders.back().cBufferSizes.push_back( sizeof( HBAOConstantBuffer ) );
+
     m.Name = "USE_TONEMAP";
     m.Definition = "4";
     makros.push_back( m );
@@ -317,8 +655,10 @@ XRESULT D3D11ShaderManager::Init() {
     Shaders.push_back( ShaderInfo( "PS_WorldLightmapped", "PS_WorldLightmapped.hlsl", "p" ) );
     Shaders.back().cBufferSizes.push_back( sizeof( GothicGraphicsState ) );
 
-    Shaders.push_back( ShaderInfo( "PS_FixedFunctionPipe", "PS_FixedFunctionPipe.hlsl", "p" ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( GothicGraphicsState ) );
+    DeclarePermutations( ShaderInfo( "PS_FixedFunctionPipe", "PS_FixedFunctionPipe.hlsl", "p" ), {
+        { "FF_ALPHATEST", "AlphaTest" },
+        { "FF_SECOND_STAGE", "TwoStages" } } );
+    Permutations.back().base.cBufferSizes.push_back( sizeof( GothicGraphicsState ) );
 
     Shaders.push_back( ShaderInfo( "PS_Video", "PS_Video.hlsl", "p" ) );
     Shaders.back().cBufferSizes.push_back( sizeof( GothicGraphicsState ) );
@@ -329,9 +669,11 @@ XRESULT D3D11ShaderManager::Init() {
     Shaders.push_back( ShaderInfo( "PS_DS_PointLightDynShadow", "PS_DS_PointLightDynShadow.hlsl", "p" ) );
     Shaders.back().cBufferSizes.push_back( sizeof( DS_PointLightConstantBuffer ) );
 
-    Shaders.push_back( ShaderInfo( "PS_DS_AtmosphericScattering", "PS_DS_AtmosphericScattering.hlsl", "p" ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( DS_ScreenQuadConstantBuffer ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( AtmosphereConstantBuffer ) );
+    DeclarePermutations( ShaderInfo( "PS_DS_AtmosphericScattering", "PS_DS_AtmosphericScattering.hlsl", "p" ), {
+        { "APPLY_RAIN_EFFECTS", "_Rain" },
+        { "SUN_BELOW_HORIZON", "_Night" } } );
+    Permutations.back().base.cBufferSizes.push_back( sizeof( DS_ScreenQuadConstantBuffer ) );
+    Permutations.back().base.cBufferSizes.push_back( sizeof( AtmosphereConstantBuffer ) );
 
     Shaders.push_back( ShaderInfo( "PS_DS_SimpleSunlight", "PS_DS_SimpleSunlight.hlsl", "p" ) );
     Shaders.back().cBufferSizes.push_back( sizeof( DS_ScreenQuadConstantBuffer ) );
@@ -351,131 +693,24 @@ XRESULT D3D11ShaderManager::Init() {
     Shaders.push_back( ShaderInfo( "GS_ParticleStreamOut", "VS_AdvanceRain.hlsl", "g", 13 ) );
     Shaders.back().cBufferSizes.push_back( sizeof( ParticleGSInfoConstantBuffer ) );
 
-    m.Name = "NORMALMAPPING";
-    m.Definition = "0";
-    makros.push_back( m );
-
-    m.Name = "ALPHATEST";
-    m.Definition = "0";
-    makros.push_back( m );
-    
-    Shaders.push_back( ShaderInfo( "PS_Diffuse", "PS_Diffuse.hlsl", "p", makros ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( GothicGraphicsState ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( AtmosphereConstantBuffer ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( MaterialInfo::Buffer ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( PerObjectState ) );
+    DeclarePermutations( ShaderInfo( "PS_Diffuse", "PS_Diffuse.hlsl", "p" ), {
+        { "NORMALMAPPING", "Normalmapped" },
+        { "ALPHATEST", "AlphaTest" },
+        { "FXMAP", "FxMap" } } );
+    Permutations.back().base.cBufferSizes.push_back( sizeof( GothicGraphicsState ) );
+    Permutations.back().base.cBufferSizes.push_back( sizeof( AtmosphereConstantBuffer ) );
+    Permutations.back().base.cBufferSizes.push_back( sizeof( MaterialInfo::Buffer ) );
+    Permutations.back().base.cBufferSizes.push_back( sizeof( PerObjectState ) );
 
     Shaders.push_back( ShaderInfo( "PS_PortalDiffuse", "PS_PortalDiffuse.hlsl", "p" ) ); //forest portals, doors, etc.
     Shaders.push_back( ShaderInfo( "PS_WaterfallFoam", "PS_WaterfallFoam.hlsl", "p" ) );     //foam on at the base of waterfalls
 
-    makros.clear();
-
-    m.Name = "APPLY_RAIN_EFFECTS";
-    m.Definition = "1";
-    makros.push_back( m );
-
-    m.Name = "SHD_ENABLE";
-    m.Definition = "1";
-    makros.push_back( m );
-
-    Shaders.push_back( ShaderInfo( "PS_DS_AtmosphericScattering_Rain", "PS_DS_AtmosphericScattering.hlsl", "p", makros ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( DS_ScreenQuadConstantBuffer ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( AtmosphereConstantBuffer ) );
-
-    makros.clear();
-
     Shaders.push_back( ShaderInfo( "PS_LinDepth", "PS_LinDepth.hlsl", "p" ) );
     Shaders.back().cBufferSizes.push_back( sizeof( GothicGraphicsState ) );
     Shaders.back().cBufferSizes.push_back( sizeof( AtmosphereConstantBuffer ) );
     Shaders.back().cBufferSizes.push_back( sizeof( MaterialInfo::Buffer ) );
     Shaders.back().cBufferSizes.push_back( sizeof( PerObjectState ) );
 
-
-    m.Name = "NORMALMAPPING";
-    m.Definition = "1";
-    makros.push_back( m );
-
-    m.Name = "ALPHATEST";
-    m.Definition = "0";
-    makros.push_back( m );
-
-    Shaders.push_back( ShaderInfo( "PS_DiffuseNormalmapped", "PS_Diffuse.hlsl", "p", makros ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( GothicGraphicsState ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( AtmosphereConstantBuffer ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( MaterialInfo::Buffer ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( PerObjectState ) );
-
-    makros.clear();
-    m.Name = "NORMALMAPPING";
-    m.Definition = "1";
-    makros.push_back( m );
-
-    m.Name = "ALPHATEST";
-    m.Definition = "0";
-    makros.push_back( m );
-
-    m.Name = "FXMAP";
-    m.Definition = "1";
-    makros.push_back( m );
-
-    Shaders.push_back( ShaderInfo( "PS_DiffuseNormalmappedFxMap", "PS_Diffuse.hlsl", "p", makros ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( GothicGraphicsState ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( AtmosphereConstantBuffer ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( MaterialInfo::Buffer ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( PerObjectState ) );
-
-    makros.clear();
-    m.Name = "NORMALMAPPING";
-    m.Definition = "0";
-    makros.push_back( m );
-
-    m.Name = "ALPHATEST";
-    m.Definition = "1";
-    makros.push_back( m );
-
-    Shaders.push_back( ShaderInfo( "PS_DiffuseAlphaTest", "PS_Diffuse.hlsl", "p", makros ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( GothicGraphicsState ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( AtmosphereConstantBuffer ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( MaterialInfo::Buffer ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( PerObjectState ) );
-
-    makros.clear();
-    m.Name = "NORMALMAPPING";
-    m.Definition = "1";
-    makros.push_back( m );
-
-    m.Name = "ALPHATEST";
-    m.Definition = "1";
-    makros.push_back( m );
-
-    Shaders.push_back( ShaderInfo( "PS_DiffuseNormalmappedAlphaTest", "PS_Diffuse.hlsl", "p", makros ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( GothicGraphicsState ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( AtmosphereConstantBuffer ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( MaterialInfo::Buffer ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( PerObjectState ) );
-
-    makros.clear();
-    m.Name = "NORMALMAPPING";
-    m.Definition = "1";
-    makros.push_back( m );
-
-    m.Name = "ALPHATEST";
-    m.Definition = "1";
-    makros.push_back( m );
-
-    m.Name = "FXMAP";
-    m.Definition = "1";
-    makros.push_back( m );
-
-    Shaders.push_back( ShaderInfo( "PS_DiffuseNormalmappedAlphaTestFxMap", "PS_Diffuse.hlsl", "p", makros ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( GothicGraphicsState ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( AtmosphereConstantBuffer ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( MaterialInfo::Buffer ) );
-    Shaders.back().cBufferSizes.push_back( sizeof( PerObjectState ) );
-
-
-
-
     makros.clear();
     m.Name = "RENDERMODE";
     m.Definition = "0";
@@ -502,6 +737,22 @@ XRESULT D3D11ShaderManager::Init() {
     Shaders.push_back( ShaderInfo( "PS_PFX_GammaCorrectInv", "PS_PFX_GammaCorrectInv.hlsl", "p" ) );
     Shaders.back().cBufferSizes.push_back( sizeof( GammaCorrectConstantBuffer ) );
 
+    // --- Compressed static mesh vertices (ExVertexStructCompressed)
+    makros.clear();
+    m.Name = "COMPRESSED_VERTICES";
+    m.Definition = "1";
+    makros.push_back( m );
+
+    Shaders.push_back( ShaderInfo( "VS_ExCompressed", "VS_Ex.hlsl", "v", 14, makros ) );
+    Shaders.back().cBufferSizes.push_back( sizeof( VS_ExConstantBuffer_PerFrame ) );
+    Shaders.back().cBufferSizes.push_back( sizeof( VS_ExConstantBuffer_PerInstance ) );
+
+    Shaders.push_back( ShaderInfo( "VS_ExCubeCompressed", "VS_ExCube.hlsl", "v", 14, makros ) );
+    Shaders.back().cBufferSizes.push_back( sizeof( VS_ExConstantBuffer_PerFrame ) );
+    Shaders.back().cBufferSizes.push_back( sizeof( VS_ExConstantBuffer_PerInstance ) );
+
+    Shaders.push_back( ShaderInfo( "VS_ExInstancedObjCompressed", "VS_ExInstancedObj.hlsl", "v", 15, makros ) );
+    Shaders.back().cBufferSizes.push_back( sizeof( VS_ExConstantBuffer_PerFrame ) );
 
     // --- LPP
     makros.clear();
@@ -524,6 +775,12 @@ XRESULT D3D11ShaderManager::Init() {
         //Shaders.push_back( ShaderInfo( "DefaultTess", "DefaultTess.hlsl", "hd" ) );
         //Shaders.back().cBufferSizes.push_back( sizeof( DefaultHullShaderConstantBuffer ) );
 
+        Shaders.push_back( ShaderInfo( "CS_PFX_LumHistogram", "CS_PFX_LumHistogram.hlsl", "c" ) );
+        Shaders.back().cBufferSizes.push_back( sizeof( LumHistogramConstantBuffer ) );
+
+        Shaders.push_back( ShaderInfo( "CS_PFX_LumExposure", "CS_PFX_LumExposure.hlsl", "c" ) );
+        Shaders.back().cBufferSizes.push_back( sizeof( LumHistogramConstantBuffer ) );
+
         Shaders.push_back( ShaderInfo( "OceanTess", "OceanTess.hlsl", "hd" ) );
         Shaders.back().cBufferSizes.push_back( sizeof( DefaultHullShaderConstantBuffer ) );
         Shaders.back().cBufferSizes.push_back( sizeof( OceanSettingsConstantBuffer ) );
@@ -534,10 +791,59 @@ XRESULT D3D11ShaderManager::Init() {
 #endif
     }
 
+    // The base of each permutation and what earlier runs drew load with the rest, everything else once it's requested
+    std::set<std::string> requestedVariants = LoadRequestedVariants();
+    for ( PermutationHandle permutation = 0; permutation < Permutations.size(); permutation++ ) {
+        ShaderPermutationInfo& p = Permutations[permutation];
+        for ( unsigned int mask = 0; mask < p.variants.size(); mask++ ) {
+            if ( mask == 0 || requestedVariants.count( GetPermutationVariantName( permutation, mask ) ) ) {
+                p.requested[mask] = true;
+                Shaders.push_back( GetPermutationVariantInfo( permutation, mask ) );
+            }
+        }
+    }
+
+    CreateShaderSlots();
+
     return XR_SUCCESS;
 }
 
-XRESULT D3D11ShaderManager::CompileShader( const ShaderInfo& si ) {
+/** Creates the slots of all shaders and variants */
+void D3D11ShaderManager::CreateShaderSlots() {
+    std::unique_lock<std::mutex> vsLock( _VShaderMutex );
+    std::unique_lock<std::mutex> psLock( _PShaderMutex );
+    std::unique_lock<std::mutex> hdsLock( _HDShaderMutex );
+    std::unique_lock<std::mutex> gsLock( _GShaderMutex );
+    std::unique_lock<std::mutex> csLock( _CShaderMutex );
+
+    std::vector<std::pair<std::string, std::string>> names;
+    for ( const ShaderInfo& si : Shaders ) {
+        names.emplace_back( si.type, si.name );
+    }
+
+    // Variants get their slot even if they aren't requested yet, so requesting one doesn't resize anything
+    for ( PermutationHandle permutation = 0; permutation < Permutations.size(); permutation++ ) {
+        for ( unsigned int mask = 0; mask < Permutations[permutation].variants.size(); mask++ ) {
+            names.emplace_back( Permutations[permutation].base.type, GetPermutationVariantName( permutation, mask ) );
+        }
+    }
+
+    for ( const auto& [type, name] : names ) {
+        if ( type == "v" ) {
+            AddShaderSlot( VShaderHandles, VShaders, name );
+        } else if ( type == "p" ) {
+            AddShaderSlot( PShaderHandles, PShaders, name );
+        } else if ( type == "hd" ) {
+            AddShaderSlot( HDShaderHandles, HDShaders, name );
+        } else if ( type == "g" ) {
+            AddShaderSlot( GShaderHandles, GShaders, name );
+        } else if ( type == "c" ) {
+            AddShaderSlot( CShaderHandles, CShaders, name );
+        }
+    }
+}
+
+XRESULT D3D11ShaderManager::CompileShader( const ShaderInfo& si, bool deferSwap ) {
     //Check if shader src-file exists
     std::string fileName = Engine::GAPI->GetStartDirectory() + "\\system\\GD3D11\\shaders\\" + si.fileName;
     if ( FILE* f = fopen( fileName.c_str(), "r" ) ) {
@@ -547,86 +853,114 @@ XRESULT D3D11ShaderManager::CompileShader( const ShaderInfo& si ) {
             D3D11VShader* vs = new D3D11VShader();
             if ( IsVShaderKnown( si.name ) ) {
                 if ( Engine::GAPI->GetRendererState().RendererSettings.EnableDebugLog )
-                    LogInfo() << "Reloading shader: " << si.name;
+                    LogInfoCh( LC_SHADERS ) << "Reloading shader: " << si.name;
 
                 if ( XR_SUCCESS != vs->LoadShader( ("system\\GD3D11\\shaders\\" + si.fileName).c_str(), si.layout, si.shaderMakros ) ) {
-                    LogError() << "Failed to reload shader: " << si.fileName;
+                    LogErrorCh( LC_SHADERS ) << "Failed to reload shader: " << si.fileName;
 
                     delete vs;
                 } else {
                     // Compilation succeeded, switch the shader
 
                     for ( unsigned int j = 0; j < si.cBufferSizes.size(); j++ ) {
-                        vs->GetConstantBuffer().push_back( new D3D11ConstantBuffer( si.cBufferSizes[j], nullptr ) );
+                        vs->GetConstantBuffer().push_back( new D3D11ConstantBuffer( si.cBufferSizes[j], nullptr, true ) );
                     }
-                    UpdateVShader( si.name, vs );
+                    SwapShader( deferSwap, [this, name = si.name, vs]() { UpdateVShader( name, vs ); } );
                 }
             } else {
                 if ( Engine::GAPI->GetRendererState().RendererSettings.EnableDebugLog )
-                    LogInfo() << "Loading shader: " << si.name;
+                    LogInfoCh( LC_SHADERS ) << "Loading shader: " << si.name;
 
                 XLE( vs->LoadShader( ("system\\GD3D11\\shaders\\" + si.fileName).c_str(), si.layout, si.shaderMakros ) );
                 for ( unsigned int j = 0; j < si.cBufferSizes.size(); j++ ) {
-                    vs->GetConstantBuffer().push_back( new D3D11ConstantBuffer( si.cBufferSizes[j], nullptr ) );
+                    vs->GetConstantBuffer().push_back( new D3D11ConstantBuffer( si.cBufferSizes[j], nullptr, true ) );
                 }
-                UpdateVShader( si.name, vs );
+                SwapShader( deferSwap, [this, name = si.name, vs]() { UpdateVShader( name, vs ); } );
             }
         } else if ( si.type == "p" ) {
             // See if this is a reload
             D3D11PShader* ps = new D3D11PShader();
             if ( IsPShaderKnown( si.name ) ) {
                 if ( Engine::GAPI->GetRendererState().RendererSettings.EnableDebugLog )
-                    LogInfo() << "Reloading shader: " << si.name;
+                    LogInfoCh( LC_SHADERS ) << "Reloading shader: " << si.name;
 
                 if ( XR_SUCCESS != ps->LoadShader( ("system\\GD3D11\\shaders\\" + si.fileName).c_str(), si.shaderMakros ) ) {
-                    LogError() << "Failed to reload shader: " << si.fileName;
+                    LogErrorCh( LC_SHADERS ) << "Failed to reload shader: " << si.fileName;
 
                     delete ps;
                 } else {
                     // Compilation succeeded, switch the shader
 
                     for ( unsigned int j = 0; j < si.cBufferSizes.size(); j++ ) {
-                        ps->GetConstantBuffer().push_back( new D3D11ConstantBuffer( si.cBufferSizes[j], nullptr ) );
+                        ps->GetConstantBuffer().push_back( new D3D11ConstantBuffer( si.cBufferSizes[j], nullptr, true ) );
                     }
-                    UpdatePShader( si.name, ps );
+                    SwapShader( deferSwap, [this, name = si.name, ps]() { UpdatePShader( name, ps ); } );
                 }
             } else {
                 if ( Engine::GAPI->GetRendererState().RendererSettings.EnableDebugLog )
-                    LogInfo() << "Loading shader: " << si.name;
+                    LogInfoCh( LC_SHADERS ) << "Loading shader: " << si.name;
 
                 XLE( ps->LoadShader( ("system\\GD3D11\\shaders\\" + si.fileName).c_str(), si.shaderMakros ) );
                 for ( unsigned int j = 0; j < si.cBufferSizes.size(); j++ ) {
-                    ps->GetConstantBuffer().push_back( new D3D11ConstantBuffer( si.cBufferSizes[j], nullptr ) );
+                    ps->GetConstantBuffer().push_back( new D3D11ConstantBuffer( si.cBufferSizes[j], nullptr, true ) );
                 }
-                UpdatePShader( si.name, ps );
+                SwapShader( deferSwap, [this, name = si.name, ps]() { UpdatePShader( name, ps ); } );
             }
         } else if ( si.type == "g" ) {
             // See if this is a reload
             D3D11GShader* gs = new D3D11GShader();
             if ( IsGShaderKnown( si.name ) ) {
                 if ( Engine::GAPI->GetRendererState().RendererSettings.EnableDebugLog )
-                    LogInfo() << "Reloading shader: " << si.name;
+                    LogInfoCh( LC_SHADERS ) << "Reloading shader: " << si.name;
 
                 if ( XR_SUCCESS != gs->LoadShader( ("system\\GD3D11\\shaders\\" + si.fileName).c_str(), si.shaderMakros, si.layout != 0, si.layout ) ) {
-                    LogError() << "Failed to reload shader: " << si.fileName;
+                    LogErrorCh( LC_SHADERS ) << "Failed to reload shader: " << si.fileName;
 
                     delete gs;
                 } else {
                     // Compilation succeeded, switch the shader
                     for ( unsigned int j = 0; j < si.cBufferSizes.size(); j++ ) {
-                        gs->GetConstantBuffer().push_back( new D3D11ConstantBuffer( si.cBufferSizes[j], nullptr ) );
+                        gs->GetConstantBuffer().push_back( new D3D11ConstantBuffer( si.cBufferSizes[j], nullptr, true ) );
                     }
-                    UpdateGShader( si.name, gs );
+                    SwapShader( deferSwap, [this, name = si.name, gs]() { UpdateGShader( name, gs ); } );
                 }
             } else {
                 if ( Engine::GAPI->GetRendererState().RendererSettings.EnableDebugLog )
-                    LogInfo() << "Loading shader: " << si.name;
+                    LogInfoCh( LC_SHADERS ) << "Loading shader: " << si.name;
 
                 XLE( gs->LoadShader( ("system\\GD3D11\\shaders\\" + si.fileName).c_str(), si.shaderMakros, si.layout != 0, si.layout ) );
                 for ( unsigned int j = 0; j < si.cBufferSizes.size(); j++ ) {
-                    gs->GetConstantBuffer().push_back( new D3D11ConstantBuffer( si.cBufferSizes[j], nullptr ) );
+                    gs->GetConstantBuffer().push_back( new D3D11ConstantBuffer( si.cBufferSizes[j], nullptr, true ) );
                 }
-                UpdateGShader( si.name, gs );
+                SwapShader( deferSwap, [this, name = si.name, gs]() { UpdateGShader( name, gs ); } );
+            }
+        } else if ( si.type == "c" ) {
+            // See if this is a reload
+            D3D11CShader* cs = new D3D11CShader();
+            if ( IsCShaderKnown( si.name ) ) {
+                if ( Engine::GAPI->GetRendererState().RendererSettings.EnableDebugLog )
+                    LogInfoCh( LC_SHADERS ) << "Reloading shader: " << si.name;
+
+                if ( XR_SUCCESS != cs->LoadShader( ("system\\GD3D11\\shaders\\" + si.fileName).c_str(), si.shaderMakros ) ) {
+                    LogErrorCh( LC_SHADERS ) << "Failed to reload shader: " << si.fileName;
+
+                    delete cs;
+                } else {
+                    // Compilation succeeded, switch the shader
+                    for ( unsigned int j = 0; j < si.cBufferSizes.size(); j++ ) {
+                        cs->GetConstantBuffer().push_back( new D3D11ConstantBuffer( si.cBufferSizes[j], nullptr, true ) );
+                    }
+                    SwapShader( deferSwap, [this, name = si.name, cs]() { UpdateCShader( name, cs ); } );
+                }
+            } else {
+                if ( Engine::GAPI->GetRendererState().RendererSettings.EnableDebugLog )
+                    LogInfoCh( LC_SHADERS ) << "Loading shader: " << si.name;
+
+                XLE( cs->LoadShader( ("system\\GD3D11\\shaders\\" + si.fileName).c_str(), si.shaderMakros ) );
+                for ( unsigned int j = 0; j < si.cBufferSizes.size(); j++ ) {
+                    cs->GetConstantBuffer().push_back( new D3D11ConstantBuffer( si.cBufferSizes[j], nullptr, true ) );
+                }
+                SwapShader( deferSwap, [this, name = si.name, cs]() { UpdateCShader( name, cs ); } );
             }
         }
 
@@ -640,23 +974,23 @@ XRESULT D3D11ShaderManager::CompileShader( const ShaderInfo& si ) {
         if ( IsHDShaderKnown( si.name ) ) {
             if ( XR_SUCCESS != hds->LoadShader( ("system\\GD3D11\\shaders\\" + si.fileName).c_str(),
                 ("system\\GD3D11\\shaders\\" + si.fileName).c_str() ) ) {
-                LogError() << "Failed to reload shader: " << si.fileName;
+                LogErrorCh( LC_SHADERS ) << "Failed to reload shader: " << si.fileName;
 
                 delete hds;
             } else {
                 // Compilation succeeded, switch the shader
                 for ( unsigned int j = 0; j < si.cBufferSizes.size(); j++ ) {
-                    hds->GetConstantBuffer().push_back( new D3D11ConstantBuffer( si.cBufferSizes[j], nullptr ) );
+                    hds->GetConstantBuffer().push_back( new D3D11ConstantBuffer( si.cBufferSizes[j], nullptr, true ) );
                 }
-                UpdateHDShader( si.name, hds );
+                SwapShader( deferSwap, [this, name = si.name, hds]() { UpdateHDShader( name, hds ); } );
             }
         } else {
             XLE( hds->LoadShader( ("system\\GD3D11\\shaders\\" + si.fileName).c_str(),
                 ("system\\GD3D11\\shaders\\" + si.fileName).c_str() ) );
             for ( unsigned int j = 0; j < si.cBufferSizes.size(); j++ ) {
-                hds->GetConstantBuffer().push_back( new D3D11ConstantBuffer( si.cBufferSizes[j], nullptr ) );
+                hds->GetConstantBuffer().push_back( new D3D11ConstantBuffer( si.cBufferSizes[j], nullptr, true ) );
             }
-            UpdateHDShader( si.name, hds );
+            SwapShader( deferSwap, [this, name = si.name, hds]() { UpdateHDShader( name, hds ); } );
         }
     }
     return XR_SUCCESS;
@@ -664,23 +998,40 @@ XRESULT D3D11ShaderManager::CompileShader( const ShaderInfo& si ) {
 
 /** Loads/Compiles Shaderes from list */
 XRESULT D3D11ShaderManager::LoadShaders() {
-    // Temporarily disable multi-core shader compilation
+    // Compiling doesn't touch the current directory anymore, so the shaders can compile in parallel
+    if ( !CompilePool ) {
+        unsigned int numThreads = std::thread::hardware_concurrency();
+        CompilePool = std::make_unique<ThreadPool>( numThreads > 1 ? numThreads - 1 : 1 );
+    }
 
-    /*size_t numThreads = std::thread::hardware_concurrency();
-    if ( numThreads > 1 ) {
-        numThreads = numThreads - 1;
+    LogInfoCh( LC_SHADERS ) << "Compiling/Reloading shaders with " << CompilePool->getNumThreads() << " threads";
+    NumShadersCompiled = 0;
+    NumShaderCacheHits = 0;
+    {
+        std::unique_lock<std::mutex> lock( UsedCacheFilesMutex );
+        UsedCacheFiles.clear();
     }
-    auto compilationTP = std::make_unique<ThreadPool>( numThreads );
-    LogInfo() << "Compiling/Reloading shaders with " << compilationTP->getNumThreads() << " threads";
-    */
-    LogInfo() << "Compiling/Reloading shaders";
+
+    std::vector<std::future<XRESULT>> compiled;
     for ( const ShaderInfo& si : Shaders ) {
-        CompileShader( si );
-        // compilationTP->enqueue( [this, si]() { CompileShader( si ); } );
+        compiled.push_back( CompilePool->enqueue( [this, si]() { return CompileShader( si ); } ) );
+    }
+
+    for ( auto& result : compiled ) {
+        result.wait();
     }
+    LogInfoCh( LC_SHADERS ) << NumShadersCompiled << " shaders compiled, " << NumShaderCacheHits << " loaded from the cache";
 
-    // Join all threads (call Threadpool destructor)
-    // compilationTP.reset();
+    // Every shader and variant was just loaded, so whatever else is in the cache belongs to old sources, settings or compilers
+    PruneShaderCache();
+
+    // Reload shaders whose files change from now on
+    if ( !SourceWatcher ) {
+        SourceWatcher = std::make_unique<FileWatcher>();
+        if ( !SourceWatcher->Start( Engine::GAPI->GetStartDirectory() + "\\" + SHADER_FOLDER ) ) {
+            SourceWatcher.reset();
+        }
+    }
 
     return XR_SUCCESS;
 }
@@ -692,31 +1043,94 @@ XRESULT D3D11ShaderManager::ReloadShaders() {
     return XR_SUCCESS;
 }
 
+/** Recompiles the given shaders on the compile threads, they get switched in on a later frame start */
+void D3D11ShaderManager::QueueRecompile( const std::vector<ShaderInfo>& shaders ) {
+    for ( const ShaderInfo& si : shaders ) {
+        NumPendingCompiles++;
+        CompilePool->enqueue( [this, si]() {
+            CompileShader( si, true );
+            NumPendingCompiles--;
+        } );
+    }
+}
+
+/** Switches the shader in now, or at the next frame start if it was compiled in the background */
+void D3D11ShaderManager::SwapShader( bool deferSwap, std::function<void()> swap ) {
+    if ( !deferSwap ) {
+        swap();
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock( PendingSwapsMutex );
+    PendingSwaps.push_back( std::move( swap ) );
+}
+
 /** Called on frame start */
 XRESULT D3D11ShaderManager::OnFrameStart() {
     if ( ReloadShadersNextFrame ) {
-        LoadShaders();
+        LogInfoCh( LC_SHADERS ) << "Recompiling " << Shaders.size() << " shaders in the background";
+        QueueRecompile( Shaders );
         ReloadShadersNextFrame = false;
     }
 
+    // Only the shaders which ended up with a changed file recompile
+    if ( SourceWatcher ) {
+        std::vector<std::string> changed = SourceWatcher->PopChangedFiles();
+        if ( !changed.empty() ) {
+            std::set<std::string> files( changed.begin(), changed.end() );
+            AddIncludingFiles( files );
+
+            std::vector<ShaderInfo> dirty;
+            for ( const ShaderInfo& si : Shaders ) {
+                std::string key = si.fileName;
+                std::transform( key.begin(), key.end(), key.begin(), ::tolower );
+                if ( files.count( key ) ) {
+                    dirty.push_back( si );
+                }
+            }
+
+            if ( !dirty.empty() ) {
+                LogInfoCh( LC_SHADERS ) << changed.size() << " shader files changed, recompiling " << dirty.size() << " shaders";
+                QueueRecompile( dirty );
+            }
+        }
+    }
+
+    // Switch in what finished compiling. Between frames, so no draw sees half of a reload.
+    std::vector<std::function<void()>> swaps;
+    {
+        std::unique_lock<std::mutex> lock( PendingSwapsMutex );
+        swaps.swap( PendingSwaps );
+    }
+
+    for ( auto& swap : swaps ) {
+        swap();
+    }
+
+    if ( !swaps.empty() && NumPendingCompiles == 0 ) {
+        LogInfoCh( LC_SHADERS ) << "Shader reload done";
+    }
+
     return XR_SUCCESS;
 }
 
-/** Deletes all shaders */
+/** Deletes all shaders. Handles stay valid and get filled again on the next load. */
 XRESULT D3D11ShaderManager::DeleteShaders() {
-    for ( auto& [k, shader] : VShaders ) {
+    for ( auto& shader : VShaders ) {
         shader.reset();
     }
-    for ( auto& [k, shader] : PShaders ) {
+    for ( auto& shader : PShaders ) {
         shader.reset();
     }
-    for ( auto& [k, shader] : HDShaders ) {
+    for ( auto& shader : HDShaders ) {
+        shader.reset();
+    }
+    for ( auto& shader : GShaders ) {
+        shader.reset();
+    }
+    for ( auto& shader : CShaders ) {
         shader.reset();
     }
-
-    VShaders.clear();
-    PShaders.clear();
-    HDShaders.clear();
 
     return XR_SUCCESS;
 }
@@ -740,20 +1154,225 @@ void D3D11ShaderManager::UpdateShaderInfo( ShaderInfo& shader ) {
             return;
         }
     }
-    Shaders.push_back( shader );
-    CompileShader( shader );
+
+    // The handle tables are fixed after Init, so there'd be no slot for it
+    LogErrorCh( LC_SHADERS ) << "Can't update shader " << shader.name << ", it wasn't declared in Init";
+}
+
+/** Adds a shader with feature permutations. Init adds its variants to the shader list once the base is complete. */
+void D3D11ShaderManager::DeclarePermutations( const ShaderInfo& base, const std::vector<ShaderFeature>& features ) {
+    PermutationHandle permutation = static_cast<PermutationHandle>(Permutations.size());
+    Permutations.emplace_back( base, features );
+    PermutationHandles[base.name] = permutation;
+}
+
+/** Builds the info of a single variant */
+ShaderInfo D3D11ShaderManager::GetPermutationVariantInfo( PermutationHandle permutation, unsigned int features ) const {
+    const ShaderPermutationInfo& p = Permutations[permutation];
+
+    ShaderInfo si = p.base;
+    si.name = GetPermutationVariantName( permutation, features );
+
+    // Every feature is defined, so the shader can use #if instead of branching
+    for ( size_t i = 0; i < p.features.size(); i++ ) {
+        D3D_SHADER_MACRO m;
+        m.Name = p.features[i].define;
+        m.Definition = (features & (1 << i)) ? "1" : "0";
+        si.shaderMakros.push_back( m );
+    }
+    return si;
+}
+
+/** Returns the handle of a shader declared with permutations */
+PermutationHandle D3D11ShaderManager::GetPermutationHandle( const std::string& shader ) {
+    auto it = PermutationHandles.find( shader );
+    if ( it == PermutationHandles.end() ) {
+        LogErrorCh( LC_SHADERS ) << "Shader " << shader << " has no permutations";
+        return 0;
+    }
+    return it->second;
+}
+
+/** Returns the shader handle of the variant with exactly the given features. A variant which wasn't requested
+    before gets queued for compiling, until it's done this returns the loaded variant closest to it. */
+ShaderHandle D3D11ShaderManager::GetPermutationVariant( PermutationHandle permutation, unsigned int features ) {
+    ShaderPermutationInfo& p = Permutations[permutation];
+    if ( !p.requested[features] ) {
+        RequestPermutationVariant( permutation, features );
+    }
+
+    ShaderHandle handle = ResolvePermutationVariant( permutation, features );
+    if ( IsShaderLoaded( p.base.type, handle ) )
+        return handle;
+
+    // Still compiling. Draw with the loaded variant which has the most of the wanted features and nothing else,
+    // at worst that's the base, which always loads with the rest.
+    ShaderHandle fallback = ResolvePermutationVariant( permutation, 0 );
+    int fallbackFeatures = 0;
+    for ( unsigned int mask = 1; mask < p.variants.size(); mask++ ) {
+        if ( (mask & ~features) != 0 || !p.requested[mask] )
+            continue;
+
+        int numFeatures = 0;
+        for ( unsigned int bits = mask; bits; bits &= bits - 1 ) {
+            numFeatures++;
+        }
+        if ( numFeatures <= fallbackFeatures )
+            continue;
+
+        ShaderHandle candidate = ResolvePermutationVariant( permutation, mask );
+        if ( IsShaderLoaded( p.base.type, candidate ) ) {
+            fallback = candidate;
+            fallbackFeatures = numFeatures;
+        }
+    }
+    return fallback;
+}
+
+/** Adds the variant to the shader list, queues it for compiling and remembers it for the next start */
+void D3D11ShaderManager::RequestPermutationVariant( PermutationHandle permutation, unsigned int features ) {
+    Permutations[permutation].requested[features] = true;
+
+    // Keep it in the list, so reloading covers it
+    Shaders.push_back( GetPermutationVariantInfo( permutation, features ) );
+    SaveRequestedVariant( Shaders.back().name );
+
+    // Before the first load there's nothing to queue on yet, the load picks it up from the list
+    if ( CompilePool ) {
+        LogInfoCh( LC_SHADERS ) << "Compiling shader variant " << Shaders.back().name << " in the background";
+        QueueRecompile( { Shaders.back() } );
+    }
+}
+
+/** Returns whether the slot of the given type and handle holds a shader */
+bool D3D11ShaderManager::IsShaderLoaded( const std::string& type, ShaderHandle handle ) const {
+    if ( type == "v" ) {
+        return GetVShader( handle ) != nullptr;
+    } else if ( type == "p" ) {
+        return GetPShader( handle ) != nullptr;
+    } else if ( type == "hd" ) {
+        return GetHDShader( handle ) != nullptr;
+    } else if ( type == "g" ) {
+        return GetGShader( handle ) != nullptr;
+    } else if ( type == "c" ) {
+        return GetCShader( handle ) != nullptr;
+    }
+    return false;
+}
+
+/** Returns the shader handle of the variant, without requesting it */
+ShaderHandle D3D11ShaderManager::ResolvePermutationVariant( PermutationHandle permutation, unsigned int features ) {
+    ShaderPermutationInfo& p = Permutations[permutation];
+    if ( p.variants[features] == INVALID_SHADER_HANDLE ) {
+        std::string name = GetPermutationVariantName( permutation, features );
+        if ( p.base.type == "v" ) {
+            p.variants[features] = GetVShaderHandle( name );
+        } else if ( p.base.type == "p" ) {
+            p.variants[features] = GetPShaderHandle( name );
+        } else if ( p.base.type == "hd" ) {
+            p.variants[features] = GetHDShaderHandle( name );
+        } else if ( p.base.type == "g" ) {
+            p.variants[features] = GetGShaderHandle( name );
+        } else if ( p.base.type == "c" ) {
+            p.variants[features] = GetCShaderHandle( name );
+        }
+    }
+    return p.variants[features];
+}
+
+/** Returns the name of the variant with the given features */
+std::string D3D11ShaderManager::GetPermutationVariantName( PermutationHandle permutation, unsigned int features ) const {
+    const ShaderPermutationInfo& p = Permutations[permutation];
+
+    std::string name = p.base.name;
+    for ( size_t i = 0; i < p.features.size(); i++ ) {
+        if ( features & (1 << i) ) {
+            name += p.features[i].suffix;
+        }
+    }
+    return name;
+}
+
+/** Replaces the base info of a permutation, e.g. with new defines, and recompiles its requested variants in the background */
+void D3D11ShaderManager::UpdatePermutationInfo( const ShaderInfo& base ) {
+    PermutationHandle permutation = GetPermutationHandle( base.name );
+    Permutations[permutation].base = base;
+
+    std::vector<ShaderInfo> variants;
+    for ( unsigned int mask = 0; mask < Permutations[permutation].variants.size(); mask++ ) {
+        if ( !Permutations[permutation].requested[mask] )
+            continue;
+
+        variants.push_back( GetPermutationVariantInfo( permutation, mask ) );
+        for ( ShaderInfo& si : Shaders ) {
+            if ( si.name == variants.back().name ) {
+                si = variants.back();
+                break;
+            }
+        }
+    }
+
+    // The old variants keep drawing until the new ones are switched in. Before the first load there's nothing to recompile yet.
+    if ( CompilePool ) {
+        QueueRecompile( variants );
+    }
 }
 
 /** Return a specific shader */
 std::shared_ptr<D3D11VShader> D3D11ShaderManager::GetVShader( const std::string& shader ) {
-    return VShaders[shader];
+    return GetShaderSlot( VShaders, GetVShaderHandle( shader ) );
 }
 std::shared_ptr<D3D11PShader> D3D11ShaderManager::GetPShader( const std::string& shader ) {
-    return PShaders[shader];
+    return GetShaderSlot( PShaders, GetPShaderHandle( shader ) );
 }
 std::shared_ptr<D3D11HDShader> D3D11ShaderManager::GetHDShader( const std::string& shader ) {
-    return HDShaders[shader];
+    return GetShaderSlot( HDShaders, GetHDShaderHandle( shader ) );
 }
 std::shared_ptr<D3D11GShader> D3D11ShaderManager::GetGShader( const std::string& shader ) {
-    return GShaders[shader];
+    return GetShaderSlot( GShaders, GetGShaderHandle( shader ) );
+}
+std::shared_ptr<D3D11CShader> D3D11ShaderManager::GetCShader( const std::string& shader ) {
+    return GetShaderSlot( CShaders, GetCShaderHandle( shader ) );
+}
+
+/** Returns the handle of a shader, INVALID_SHADER_HANDLE for names Init didn't declare */
+ShaderHandle D3D11ShaderManager::GetVShaderHandle( const std::string& shader ) {
+    ShaderHandle handle = FindShaderHandle( VShaderHandles, shader );
+    if ( handle == INVALID_SHADER_HANDLE ) {
+        LogErrorCh( LC_SHADERS ) << "Unknown shader: " << shader;
+        return INVALID_SHADER_HANDLE;
+    }
+    return handle;
+}
+ShaderHandle D3D11ShaderManager::GetPShaderHandle( const std::string& shader ) {
+    ShaderHandle handle = FindShaderHandle( PShaderHandles, shader );
+    if ( handle == INVALID_SHADER_HANDLE ) {
+        LogErrorCh( LC_SHADERS ) << "Unknown shader: " << shader;
+        return INVALID_SHADER_HANDLE;
+    }
+    return handle;
+}
+ShaderHandle D3D11ShaderManager::GetHDShaderHandle( const std::string& shader ) {
+    ShaderHandle handle = FindShaderHandle( HDShaderHandles, shader );
+    if ( handle == INVALID_SHADER_HANDLE ) {
+        LogErrorCh( LC_SHADERS ) << "Unknown shader: " << shader;
+        return INVALID_SHADER_HANDLE;
+    }
+    return handle;
+}
+ShaderHandle D3D11ShaderManager::GetGShaderHandle( const std::string& shader ) {
+    ShaderHandle handle = FindShaderHandle( GShaderHandles, shader );
+    if ( handle == INVALID_SHADER_HANDLE ) {
+        LogErrorCh( LC_SHADERS ) << "Unknown shader: " << shader;
+        return INVALID_SHADER_HANDLE;
+    }
+    return handle;
+}
+ShaderHandle D3D11ShaderManager::GetCShaderHandle( const std::string& shader ) {
+    ShaderHandle handle = FindShaderHandle( CShaderHandles, shader );
+    if ( handle == INVALID_SHADER_HANDLE ) {
+        LogErrorCh( LC_SHADERS ) << "Unknown shader: " << shader;
+        return INVALID_SHADER_HANDLE;
+    }
+    return handle;
 }
@@ -4,13 +4,17 @@
 #include "D3D11PShader.h"
 #include "D3D11HDShader.h"
 #include "D3D11GShader.h"
+#include "D3D11CShader.h"
+
+class FileWatcher;
+class ThreadPool;
 
 /** Struct holds initial shader data for load operation*/
 struct ShaderInfo {
 public:
     std::string name;				//Shader's name, used as key in map
     std::string fileName;			//Shader's filename (without 'system\\GD3D11\\shaders\\')
-    std::string type;				//Shader's type: 'v' vertexShader, 'p' pixelShader
+    std::string type;				//Shader's type: 'v' vertexShader, 'p' pixelShader, 'g' geometryShader, 'hd' hull/domainShader, 'c' computeShader
     int layout;						//Shader's input layout
     std::vector<int> cBufferSizes;	//Vector with size for each constant buffer to be created for this shader
     std::vector<D3D_SHADER_MACRO> shaderMakros;
@@ -38,6 +42,46 @@ public:
     }
 };
 
+/** Optional part of a shader, compiled in or out by setting its define to 1 or 0 */
+struct ShaderFeature {
+    const char* define;
+    const char* suffix;				//Appended to the shader's name for variants with this feature
+};
+
+/** A shader together with its features. Bit i of a feature mask enables features[i]. Only the base and the
+    masks requested so far get compiled, the others on the compile threads once a draw asks for them. */
+struct ShaderPermutationInfo {
+public:
+    ShaderPermutationInfo( const ShaderInfo& b, const std::vector<ShaderFeature>& f ) : base( b ), features( f ) {
+        variants.resize( static_cast<size_t>(1) << features.size(), INVALID_SHADER_HANDLE );
+        requested.resize( variants.size(), false );
+    }
+
+    ShaderInfo base;
+    std::vector<ShaderFeature> features;
+    std::vector<ShaderHandle> variants;	//Handle of each feature mask, looked up on first use
+    std::vector<bool> requested;		//Whether the mask is in the shader list and gets compiled
+};
+
+/** Features of PS_Diffuse */
+enum EDiffuseFeature {
+    DF_NORMALMAPPING = 1,
+    DF_ALPHATEST = 2,
+    DF_FXMAP = 4
+};
+
+/** Features of PS_DS_AtmosphericScattering */
+enum EDeferredSunFeature {
+    DSF_RAIN = 1,
+    DSF_NIGHT = 2
+};
+
+/** Features of PS_FixedFunctionPipe */
+enum EFixedFunctionFeature {
+    FFF_ALPHATEST = 1,
+    FFF_SECOND_STAGE = 2
+};
+
 class D3D11ShaderManager {
 public:
     D3D11ShaderManager();
@@ -63,36 +107,150 @@ public:
     ShaderInfo GetShaderInfo( const std::string& shader, bool& ok );
     void UpdateShaderInfo( ShaderInfo& shader );
 
+    /** Returns the handle of a shader declared with permutations */
+    PermutationHandle GetPermutationHandle( const std::string& shader );
+
+    /** Returns the shader handle of the variant with exactly the given features. A variant which wasn't requested
+        before gets queued for compiling, until it's done this returns the loaded variant closest to it. */
+    ShaderHandle GetPermutationVariant( PermutationHandle permutation, unsigned int features );
+
+    /** Returns the name of the variant with the given features */
+    std::string GetPermutationVariantName( PermutationHandle permutation, unsigned int features ) const;
+
+    /** Replaces the base info of a permutation, e.g. with new defines, and recompiles its requested variants in the background */
+    void UpdatePermutationInfo( const ShaderInfo& base );
+
     /** Return a specific shader */
     std::shared_ptr<D3D11VShader> GetVShader( const std::string& shader );
     std::shared_ptr<D3D11PShader> GetPShader( const std::string& shader );
     std::shared_ptr<D3D11HDShader> GetHDShader( const std::string& shader );
     std::shared_ptr<D3D11GShader> GetGShader( const std::string& shader );
+    std::shared_ptr<D3D11CShader> GetCShader( const std::string& shader );
+
+    /** Returns the handle of a shader. The handles are all handed out by Init, unknown names give INVALID_SHADER_HANDLE. */
+    ShaderHandle GetVShaderHandle( const std::string& shader );
+    ShaderHandle GetPShaderHandle( const std::string& shader );
+    ShaderHandle GetHDShaderHandle( const std::string& shader );
+    ShaderHandle GetGShaderHandle( const std::string& shader );
+    ShaderHandle GetCShaderHandle( const std::string& shader );
+
+    /** Return a specific shader by handle. No string work and no copies. Empty for invalid handles. */
+    const std::shared_ptr<D3D11VShader>& GetVShader( ShaderHandle shader ) const { return GetShaderSlot( VShaders, shader ); }
+    const std::shared_ptr<D3D11PShader>& GetPShader( ShaderHandle shader ) const { return GetShaderSlot( PShaders, shader ); }
+    const std::shared_ptr<D3D11HDShader>& GetHDShader( ShaderHandle shader ) const { return GetShaderSlot( HDShaders, shader ); }
+    const std::shared_ptr<D3D11GShader>& GetGShader( ShaderHandle shader ) const { return GetShaderSlot( GShaders, shader ); }
+    const std::shared_ptr<D3D11CShader>& GetCShader( ShaderHandle shader ) const { return GetShaderSlot( CShaders, shader ); }
 private:
-    XRESULT CompileShader( const ShaderInfo& si );
+    /** Compiles the shader and switches it in. With deferSwap the switch waits for the next frame start. */
+    XRESULT CompileShader( const ShaderInfo& si, bool deferSwap = false );
+
+    /** Switches the shader in now, or at the next frame start if it was compiled in the background */
+    void SwapShader( bool deferSwap, std::function<void()> swap );
 
-    void UpdateVShader( const std::string& name, D3D11VShader* shader ) { std::unique_lock<std::mutex> lock( _VShaderMutex ); VShaders[name].reset( shader ); }
-    void UpdatePShader( const std::string& name, D3D11PShader* shader ) { std::unique_lock<std::mutex> lock( _PShaderMutex );  PShaders[name].reset( shader ); }
-    void UpdateHDShader( const std::string& name, D3D11HDShader* shader ) { std::unique_lock<std::mutex> lock( _HDShaderMutex );  HDShaders[name].reset( shader ); }
-    void UpdateGShader( const std::string& name, D3D11GShader* shader ) { std::unique_lock<std::mutex> lock( _GShaderMutex );  GShaders[name].reset( shader ); }
+    /** Recompiles the given shaders on the compile threads, they get switched in on a later frame start */
+    void QueueRecompile( const std::vector<ShaderInfo>& shaders );
 
-    bool IsVShaderKnown( const std::string& name ) { std::unique_lock<std::mutex> lock( _VShaderMutex ); return VShaders.count( name ) > 0; }
-    bool IsPShaderKnown( const std::string& name ) { std::unique_lock<std::mutex> lock( _PShaderMutex ); return PShaders.count( name ) > 0; }
-    bool IsHDShaderKnown( const std::string& name ) { std::unique_lock<std::mutex> lock( _HDShaderMutex ); return HDShaders.count( name ) > 0; }
-    bool IsGShaderKnown( const std::string& name ) { std::unique_lock<std::mutex> lock( _GShaderMutex ); return GShaders.count( name ) > 0; }
+    /** Adds a shader with feature permutations */
+    void DeclarePermutations( const ShaderInfo& base, const std::vector<ShaderFeature>& features );
+
+    /** Adds the variant to the shader list, queues it for compiling and remembers it for the next start */
+    void RequestPermutationVariant( PermutationHandle permutation, unsigned int features );
+
+    /** Returns the shader handle of the variant, without requesting it */
+    ShaderHandle ResolvePermutationVariant( PermutationHandle permutation, unsigned int features );
+
+    /** Returns whether the slot of the given type and handle holds a shader */
+    bool IsShaderLoaded( const std::string& type, ShaderHandle handle ) const;
+
+    /** Builds the info of a single variant */
+    ShaderInfo GetPermutationVariantInfo( PermutationHandle permutation, unsigned int features ) const;
+
+    /** Creates the slots of all shaders and variants. Only Init does this, afterwards the tables don't change size anymore,
+        so the handle getters can read them without locking while the compile threads fill the slots. */
+    void CreateShaderSlots();
+
+    /** Adds an empty slot for name, if it doesn't have one yet */
+    template<typename T>
+    static void AddShaderSlot( std::unordered_map<std::string, ShaderHandle>& handles, std::vector<std::shared_ptr<T>>& slots, const std::string& name ) {
+        if ( handles.find( name ) != handles.end() )
+            return;
+
+        handles.emplace( name, static_cast<ShaderHandle>(slots.size()) );
+        slots.emplace_back();
+    }
+
+    /** Returns the handle of name, INVALID_SHADER_HANDLE if it has no slot */
+    static ShaderHandle FindShaderHandle( const std::unordered_map<std::string, ShaderHandle>& handles, const std::string& name ) {
+        auto it = handles.find( name );
+        return it != handles.end() ? it->second : INVALID_SHADER_HANDLE;
+    }
+
+    template<typename T>
+    static const std::shared_ptr<T>& GetShaderSlot( const std::vector<std::shared_ptr<T>>& slots, ShaderHandle handle ) {
+        static const std::shared_ptr<T> none;
+        return handle < slots.size() ? slots[handle] : none;
+    }
+
+    /** Puts the shader into its slot. Shaders without one were never declared in Init and get dropped. */
+    template<typename T>
+    static void UpdateShaderSlot( const std::unordered_map<std::string, ShaderHandle>& handles, std::vector<std::shared_ptr<T>>& slots, const std::string& name, T* shader ) {
+        ShaderHandle handle = FindShaderHandle( handles, name );
+        if ( handle == INVALID_SHADER_HANDLE ) {
+            LogErrorCh( LC_SHADERS ) << "Shader " << name << " wasn't declared in Init, dropping it";
+            delete shader;
+            return;
+        }
+        slots[handle].reset( shader );
+    }
+
+    void UpdateVShader( const std::string& name, D3D11VShader* shader ) { std::unique_lock<std::mutex> lock( _VShaderMutex ); UpdateShaderSlot( VShaderHandles, VShaders, name, shader ); }
+    void UpdatePShader( const std::string& name, D3D11PShader* shader ) { std::unique_lock<std::mutex> lock( _PShaderMutex ); UpdateShaderSlot( PShaderHandles, PShaders, name, shader ); }
+    void UpdateHDShader( const std::string& name, D3D11HDShader* shader ) { std::unique_lock<std::mutex> lock( _HDShaderMutex ); UpdateShaderSlot( HDShaderHandles, HDShaders, name, shader ); }
+    void UpdateGShader( const std::string& name, D3D11GShader* shader ) { std::unique_lock<std::mutex> lock( _GShaderMutex ); UpdateShaderSlot( GShaderHandles, GShaders, name, shader ); }
+    void UpdateCShader( const std::string& name, D3D11CShader* shader ) { std::unique_lock<std::mutex> lock( _CShaderMutex ); UpdateShaderSlot( CShaderHandles, CShaders, name, shader ); }
+
+    bool IsVShaderKnown( const std::string& name ) { std::unique_lock<std::mutex> lock( _VShaderMutex ); auto it = VShaderHandles.find( name ); return it != VShaderHandles.end() && VShaders[it->second]; }
+    bool IsPShaderKnown( const std::string& name ) { std::unique_lock<std::mutex> lock( _PShaderMutex ); auto it = PShaderHandles.find( name ); return it != PShaderHandles.end() && PShaders[it->second]; }
+    bool IsHDShaderKnown( const std::string& name ) { std::unique_lock<std::mutex> lock( _HDShaderMutex ); auto it = HDShaderHandles.find( name ); return it != HDShaderHandles.end() && HDShaders[it->second]; }
+    bool IsGShaderKnown( const std::string& name ) { std::unique_lock<std::mutex> lock( _GShaderMutex ); auto it = GShaderHandles.find( name ); return it != GShaderHandles.end() && GShaders[it->second]; }
+    bool IsCShaderKnown( const std::string& name ) { std::unique_lock<std::mutex> lock( _CShaderMutex ); auto it = CShaderHandles.find( name ); return it != CShaderHandles.end() && CShaders[it->second]; }
 
 private:
-    std::vector<ShaderInfo> Shaders;							//Initial shader list for loading
-    std::unordered_map<std::string, std::shared_ptr<D3D11VShader>> VShaders;
-    std::unordered_map<std::string, std::shared_ptr<D3D11PShader>> PShaders;
-    std::unordered_map<std::string, std::shared_ptr<D3D11HDShader>> HDShaders;
-    std::unordered_map<std::string, std::shared_ptr<D3D11GShader>> GShaders;
+    std::vector<ShaderInfo> Shaders;							//Shader list for loading, including every variant
+
+    /** Shaders with feature permutations. Only the main thread touches these. */
+    std::vector<ShaderPermutationInfo> Permutations;
+    std::unordered_map<std::string, PermutationHandle> PermutationHandles;
+
+    /** Shader name -> handle, and the shaders indexed by handle. Both are only resized in Init. */
+    std::unordered_map<std::string, ShaderHandle> VShaderHandles;
+    std::unordered_map<std::string, ShaderHandle> PShaderHandles;
+    std::unordered_map<std::string, ShaderHandle> HDShaderHandles;
+    std::unordered_map<std::string, ShaderHandle> GShaderHandles;
+    std::unordered_map<std::string, ShaderHandle> CShaderHandles;
+    std::vector<std::shared_ptr<D3D11VShader>> VShaders;
+    std::vector<std::shared_ptr<D3D11PShader>> PShaders;
+    std::vector<std::shared_ptr<D3D11HDShader>> HDShaders;
+    std::vector<std::shared_ptr<D3D11GShader>> GShaders;
+    std::vector<std::shared_ptr<D3D11CShader>> CShaders;
 
     std::mutex _VShaderMutex;
     std::mutex _PShaderMutex;
     std::mutex _HDShaderMutex;
     std::mutex _GShaderMutex;
+    std::mutex _CShaderMutex;
 
     /** Whether we need to reload the shaders next frame or not */
     bool ReloadShadersNextFrame;
+
+    /** Reloads the shaders whose files or includes change on disk */
+    std::unique_ptr<FileWatcher> SourceWatcher;
+
+    /** Shaders compiled in the background, waiting to be switched in at frame start */
+    std::mutex PendingSwapsMutex;
+    std::vector<std::function<void()>> PendingSwaps;
+    std::atomic<int> NumPendingCompiles = 0;
+
+    /** Declared last, so its threads are gone before anything they use */
+    std::unique_ptr<ThreadPool> CompilePool;
 };
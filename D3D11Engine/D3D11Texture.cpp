@@ -35,6 +35,7 @@ XRESULT D3D11Texture::Init( INT2 size, ETextureFormat format, UINT mipMapCount,
 
     LE( engine->GetDevice()->CreateTexture2D( &textureDesc, nullptr, Texture.ReleaseAndGetAddressOf() ) );
     SetDebugName( Texture.Get(), "D3D11Texture(\"" + fileName + "\")->Texture" );
+    MemoryAllocation.Set( ResidencyManager::C_TEXTURES, ResidencyManager::GetTextureSize( TextureFormat, size.x, size.y, mipMapCount ) );
 
     D3D11_SHADER_RESOURCE_VIEW_DESC descRV = {};
     descRV.Format = DXGI_FORMAT_UNKNOWN;
@@ -52,7 +53,7 @@ XRESULT D3D11Texture::Init( const std::string& file ) {
     HRESULT hr;
     D3D11GraphicsEngineBase* engine = reinterpret_cast<D3D11GraphicsEngineBase*>(Engine::GraphicsEngine);
 
-    //LogInfo() << "Loading Engine-Texture: " << file;
+    //LogInfoCh( LC_TEXTURES ) << "Loading Engine-Texture: " << file;
 
     Microsoft::WRL::ComPtr<ID3D11Texture2D> res;
     LE( CreateDDSTextureFromFile( engine->GetDevice().Get(), Toolbox::ToWideChar( file.c_str() ).c_str(),
@@ -66,15 +67,82 @@ XRESULT D3D11Texture::Init( const std::string& file ) {
 
     Texture = res;
     TextureFormat = desc.Format;
+    MipMapCount = desc.MipLevels;
 
     TextureSize.x = desc.Width;
     TextureSize.y = desc.Height;
     SetDebugName( res.Get(), "D3D11Texture(\"" + file + "\")->Texture" );
+    MemoryAllocation.Set( ResidencyManager::C_TEXTURES, ResidencyManager::GetTextureSize( desc.Format, desc.Width, desc.Height, desc.MipLevels, desc.ArraySize ) );
     SetDebugName( ShaderResourceView.Get(), "D3D11Texture(\"" + file + "\")->ShaderResourceView" );
 
     return XR_SUCCESS;
 }
 
+/** Initializes the texture from DDS data in memory, e.g. inside a mapped texture archive */
+XRESULT D3D11Texture::InitFromMemory( const void* ddsData, UINT size, const std::string& name ) {
+    HRESULT hr;
+    D3D11GraphicsEngineBase* engine = reinterpret_cast<D3D11GraphicsEngineBase*>(Engine::GraphicsEngine);
+
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> res;
+    LE( CreateDDSTextureFromMemory( engine->GetDevice().Get(), reinterpret_cast<const uint8_t*>(ddsData), size,
+        reinterpret_cast<ID3D11Resource**>(res.ReleaseAndGetAddressOf()), ShaderResourceView.GetAddressOf() ) );
+
+    if ( !ShaderResourceView.Get() || !res.Get() )
+        return XR_FAILED;
+
+    D3D11_TEXTURE2D_DESC desc;
+    res->GetDesc( &desc );
+
+    Texture = res;
+    TextureFormat = desc.Format;
+    MipMapCount = desc.MipLevels;
+
+    TextureSize.x = desc.Width;
+    TextureSize.y = desc.Height;
+    SetDebugName( res.Get(), "D3D11Texture(\"" + name + "\")->Texture" );
+    MemoryAllocation.Set( ResidencyManager::C_TEXTURES, ResidencyManager::GetTextureSize( desc.Format, desc.Width, desc.Height, desc.MipLevels, desc.ArraySize ) );
+    SetDebugName( ShaderResourceView.Get(), "D3D11Texture(\"" + name + "\")->ShaderResourceView" );
+
+    return XR_SUCCESS;
+}
+
+/** Initializes an immutable texture with the given tightly packed mips. Doesn't need the immediate context. */
+XRESULT D3D11Texture::InitImmutable( INT2 size, ETextureFormat format, UINT mipMapCount, const void* const* mipData, const std::string& fileName ) {
+    D3D11GraphicsEngineBase* engine = reinterpret_cast<D3D11GraphicsEngineBase*>(Engine::GraphicsEngine);
+
+    TextureFormat = static_cast<DXGI_FORMAT>(format);
+    TextureSize = size;
+    MipMapCount = mipMapCount;
+
+    std::vector<D3D11_SUBRESOURCE_DATA> initData( mipMapCount );
+    for ( UINT mip = 0; mip < mipMapCount; mip++ ) {
+        initData[mip].pSysMem = mipData[mip];
+        initData[mip].SysMemPitch = GetRowPitchBytes( mip );
+        initData[mip].SysMemSlicePitch = 0;
+    }
+
+    CD3D11_TEXTURE2D_DESC textureDesc(
+        static_cast<DXGI_FORMAT>(format),
+        size.x,
+        size.y,
+        1,
+        mipMapCount,
+        D3D11_BIND_SHADER_RESOURCE, D3D11_USAGE_IMMUTABLE, 0, 1, 0, 0 );
+
+    if ( FAILED( engine->GetDevice()->CreateTexture2D( &textureDesc, &initData[0], Texture.ReleaseAndGetAddressOf() ) ) ) {
+        LogErrorCh( LC_TEXTURES ) << "Failed to create immutable texture " << fileName;
+        return XR_FAILED;
+    }
+    SetDebugName( Texture.Get(), "D3D11Texture(\"" + fileName + "\")->Texture" );
+    MemoryAllocation.Set( ResidencyManager::C_TEXTURES, ResidencyManager::GetTextureSize( TextureFormat, size.x, size.y, mipMapCount ) );
+
+    if ( FAILED( engine->GetDevice()->CreateShaderResourceView( Texture.Get(), nullptr, ShaderResourceView.ReleaseAndGetAddressOf() ) ) )
+        return XR_FAILED;
+    SetDebugName( ShaderResourceView.Get(), "D3D11Texture(\"" + fileName + "\")->ShaderResourceView" );
+
+    return XR_SUCCESS;
+}
+
 /** Updates the Texture-Object */
 XRESULT D3D11Texture::UpdateData( void* data, int mip ) {
     D3D11GraphicsEngineBase* engine = reinterpret_cast<D3D11GraphicsEngineBase*>(Engine::GraphicsEngine);
@@ -141,7 +209,7 @@ XRESULT D3D11Texture::UpdateDataDeferred( void* data, int mip ) {
 
 /** Returns the RowPitch-Bytes */
 UINT D3D11Texture::GetRowPitchBytes( int mip ) {
-    int px = (TextureSize.x >> mip);
+    int px = std::max( 1, TextureSize.x >> mip );
     //int py = (TextureSize.y >> mip);
 
     if ( TextureFormat == DXGI_FORMAT_R8_UNORM ) {
@@ -156,8 +224,8 @@ UINT D3D11Texture::GetRowPitchBytes( int mip ) {
 
 /** Returns the size of the texture in bytes */
 UINT D3D11Texture::GetSizeInBytes( int mip ) {
-    int px = (TextureSize.x >> mip);
-    int py = (TextureSize.y >> mip);
+    int px = std::max( 1, TextureSize.x >> mip );
+    int py = std::max( 1, TextureSize.y >> mip );
 
     if ( TextureFormat == DXGI_FORMAT_R8_UNORM ) {
         return px * py;
@@ -267,3 +335,47 @@ XRESULT D3D11Texture::GenerateMipMapsDeferred() {
 
     return XR_SUCCESS;
 }
+
+/** Returns true if the top mip can be dropped. Block compressed textures need to stay multiples of 4. */
+bool D3D11Texture::CanDropTopMip() const {
+    if ( !Texture.Get() || MipMapCount < 2 )
+        return false;
+
+    bool blockCompressed = TextureFormat == DXGI_FORMAT_BC1_UNORM || TextureFormat == DXGI_FORMAT_BC2_UNORM || TextureFormat == DXGI_FORMAT_BC3_UNORM;
+    return !blockCompressed || (((TextureSize.x >> 1) % 4) == 0 && ((TextureSize.y >> 1) % 4) == 0);
+}
+
+/** Replaces the texture with a copy of its mips below the top one, to free video memory. Needs the immediate context. */
+XRESULT D3D11Texture::DropTopMip() {
+    if ( !CanDropTopMip() )
+        return XR_FAILED;
+
+    D3D11GraphicsEngineBase* engine = reinterpret_cast<D3D11GraphicsEngineBase*>(Engine::GraphicsEngine);
+
+    D3D11_TEXTURE2D_DESC desc;
+    Texture->GetDesc( &desc );
+    desc.Width = std::max( 1u, desc.Width >> 1 );
+    desc.Height = std::max( 1u, desc.Height >> 1 );
+    desc.MipLevels = MipMapCount - 1;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.CPUAccessFlags = 0;
+    desc.MiscFlags = 0;
+
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> smaller;
+    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> smallerSRV;
+    if ( FAILED( engine->GetDevice()->CreateTexture2D( &desc, nullptr, smaller.GetAddressOf() ) )
+        || FAILED( engine->GetDevice()->CreateShaderResourceView( smaller.Get(), nullptr, smallerSRV.GetAddressOf() ) ) )
+        return XR_FAILED;
+
+    for ( UINT mip = 0; mip < desc.MipLevels; mip++ ) {
+        engine->GetContext()->CopySubresourceRegion( smaller.Get(), mip, 0, 0, 0, Texture.Get(), mip + 1, nullptr );
+    }
+
+    Texture = smaller;
+    ShaderResourceView = smallerSRV;
+    TextureSize = INT2( desc.Width, desc.Height );
+    MipMapCount = desc.MipLevels;
+    MemoryAllocation.Set( MemoryAllocation.GetCategory(), ResidencyManager::GetTextureSize( TextureFormat, desc.Width, desc.Height, desc.MipLevels ) );
+
+    return XR_SUCCESS;
+}
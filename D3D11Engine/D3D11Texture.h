@@ -1,5 +1,6 @@
 #pragma once
 #include <wrl/client.h>
+#include "ResidencyManager.h"
 
 class D3D11Texture {
 public:
@@ -21,6 +22,12 @@ public:
     /** Initializes the texture from a file */
     XRESULT Init( const std::string& file );
 
+    /** Initializes the texture from DDS data in memory, e.g. inside a mapped texture archive */
+    XRESULT InitFromMemory( const void* ddsData, UINT size, const std::string& name );
+
+    /** Initializes an immutable texture with the given tightly packed mips. Doesn't need the immediate context. */
+    XRESULT InitImmutable( INT2 size, ETextureFormat format, UINT mipMapCount, const void* const* mipData, const std::string& fileName = "" );
+
     /** Updates the Texture-Object */
     XRESULT UpdateData( void* data, int mip = 0 );
 
@@ -58,6 +65,18 @@ public:
     XRESULT GenerateMipMaps();
     XRESULT GenerateMipMapsDeferred();
 
+    /** Returns true if the top mip can be dropped. Block compressed textures need to stay multiples of 4. */
+    bool CanDropTopMip() const;
+
+    /** Replaces the texture with a copy of its mips below the top one, to free video memory. Needs the immediate context. */
+    XRESULT DropTopMip();
+
+    /** Returns the number of mips of this texture */
+    int GetMipMapCount() const { return MipMapCount; }
+
+    /** Returns the video memory used by this texture */
+    uint64_t GetVideoMemorySize() const { return MemoryAllocation.GetSize(); }
+
     /** Returns this textures ID */
     UINT16 GetID() { return ID; };
 
@@ -74,5 +93,8 @@ private:
 
     /** Thumbnail */
     Microsoft::WRL::ComPtr<ID3D11Texture2D> Thumbnail;
+
+    /** Registers the size of the texture with the residency manager */
+    ResidencyManager::Allocation MemoryAllocation;
 };
 
@@ -23,7 +23,7 @@ XRESULT D3D11VShader::LoadShader( const char* vertexShader, int layout, const st
     Microsoft::WRL::ComPtr<ID3DBlob> vsBlob;
 
     if ( Engine::GAPI->GetRendererState().RendererSettings.EnableDebugLog )
-        LogInfo() << "Compilling vertex shader: " << vertexShader;
+        LogInfoCh( LC_SHADERS ) << "Compilling vertex shader: " << vertexShader;
 
     // Compile shader
     if ( FAILED( D3D11ShaderManager::CompileShaderFromFile( vertexShader, "VSMain", "vs_4_0", vsBlob.GetAddressOf(), makros ) ) ) {
@@ -160,6 +160,29 @@ XRESULT D3D11VShader::LoadShader( const char* vertexShader, int layout, const st
         { "VELOCITY", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
     };
 
+    // ExVertexStructCompressed
+    const D3D11_INPUT_ELEMENT_DESC layout14[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R16G16_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "DIFFUSE", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    };
+
+    // ExVertexStructCompressed + VobInstanceInfo
+    const D3D11_INPUT_ELEMENT_DESC layout15[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R16G16_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "DIFFUSE", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "INSTANCE_WORLD_MATRIX", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        { "INSTANCE_WORLD_MATRIX", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        { "INSTANCE_WORLD_MATRIX", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        { "INSTANCE_WORLD_MATRIX", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+        { "INSTANCE_COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+    };
+
     switch ( layout ) {
     case 1:
         LE( engine->GetDevice()->CreateInputLayout( layout1, ARRAYSIZE( layout1 ), vsBlob->GetBufferPointer(),
@@ -225,6 +248,16 @@ XRESULT D3D11VShader::LoadShader( const char* vertexShader, int layout, const st
         LE( engine->GetDevice()->CreateInputLayout( layout13, ARRAYSIZE( layout13 ), vsBlob->GetBufferPointer(),
             vsBlob->GetBufferSize(), InputLayout.ReleaseAndGetAddressOf() ) );
         break;
+
+    case 14:
+        LE( engine->GetDevice()->CreateInputLayout( layout14, ARRAYSIZE( layout14 ), vsBlob->GetBufferPointer(),
+            vsBlob->GetBufferSize(), InputLayout.ReleaseAndGetAddressOf() ) );
+        break;
+
+    case 15:
+        LE( engine->GetDevice()->CreateInputLayout( layout15, ARRAYSIZE( layout15 ), vsBlob->GetBufferPointer(),
+            vsBlob->GetBufferSize(), InputLayout.ReleaseAndGetAddressOf() ) );
+        break;
     }
 
     return XR_SUCCESS;
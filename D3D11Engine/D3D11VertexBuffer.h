@@ -4,6 +4,7 @@
 #include <D3D11_4.h>
 
 #include "VertexTypes.h"
+#include "ResidencyManager.h"
 
 #include <wrl/client.h>
 
@@ -34,6 +35,7 @@ public:
         M_WRITE = 2,
         M_READ_WRITE = 3,
         M_WRITE_DISCARD = 4,
+        M_WRITE_NO_OVERWRITE = 5,
     };
 
     /** Layed out for D3D11*/
@@ -80,4 +82,7 @@ private:
 
     /** Size of the buffer in bytes */
     unsigned int SizeInBytes;
+
+    /** Registers the size of the buffer with the residency manager */
+    ResidencyManager::Allocation MemoryAllocation;
 };
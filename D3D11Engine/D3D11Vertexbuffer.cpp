@@ -54,6 +54,7 @@ XRESULT D3D11VertexBuffer::Init( void* initData, unsigned int sizeInBytes, EBind
         delete[] data;
         return XR_SUCCESS;
     }
+    MemoryAllocation.Set( ResidencyManager::GetBufferCategory( ResidencyManager::C_OTHER ), sizeInBytes );
     // Check for structured buffer again to create the SRV
     if ( (EBindFlags & EBindFlags::B_SHADER_RESOURCE) != 0 && structuredByteSize > 0 ) {
         D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
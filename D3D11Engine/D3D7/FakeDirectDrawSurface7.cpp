@@ -170,26 +170,26 @@ HRESULT FakeDirectDrawSurface7::Lock( LPRECT lpDestRect, LPDDSURFACEDESC2 lpDDSu
     DebugWrite( "FakeDirectDrawSurface7(%p)::Lock(%s, %s)" );
     *lpDDSurfaceDesc = OriginalDesc;
 
-    // Check for 16-bit surface. We allocate the texture as 32-bit, so we need to divide the size by two for that
     int redBits = Toolbox::GetNumberOfBits( OriginalDesc.ddpfPixelFormat.dwRBitMask );
     int greenBits = Toolbox::GetNumberOfBits( OriginalDesc.ddpfPixelFormat.dwGBitMask );
     int blueBits = Toolbox::GetNumberOfBits( OriginalDesc.ddpfPixelFormat.dwBBitMask );
     int alphaBits = Toolbox::GetNumberOfBits( OriginalDesc.ddpfPixelFormat.dwRGBAlphaBitMask );
 
     int bpp = redBits + greenBits + blueBits + alphaBits;
-    int divisor = 1;
 
-    if ( bpp == 16 )
-        divisor = 2;
+    int px = std::max( 1, static_cast<int>(OriginalDesc.dwWidth >> MipLevel) );
+    int py = std::max( 1, static_cast<int>(OriginalDesc.dwHeight >> MipLevel) );
+
+    // 16-bit surfaces are converted (and block compressed) later, their engine texture says nothing about what the
+    // game writes. Size the buffer from the surface's own 16-bit format instead.
+    UINT sizeInBytes = bpp == 16 ? px * py * 2 : Resource->GetLoadTarget()->GetSizeInBytes( MipLevel );
+    UINT rowPitch = bpp == 16 ? px * 2 : Resource->GetLoadTarget()->GetRowPitchBytes( MipLevel );
 
     // Allocate some temporary data
     delete [] Data;
-    Data = new unsigned char[Resource->GetEngineTexture()->GetSizeInBytes( MipLevel ) / divisor];
+    Data = new unsigned char[sizeInBytes];
     lpDDSurfaceDesc->lpSurface = Data;
-    lpDDSurfaceDesc->lPitch = Resource->GetEngineTexture()->GetRowPitchBytes( MipLevel ) / divisor;
-
-    int px = (OriginalDesc.dwWidth >> MipLevel);
-    int py = (OriginalDesc.dwHeight >> MipLevel);
+    lpDDSurfaceDesc->lPitch = rowPitch;
 
     lpDDSurfaceDesc->dwWidth = px;
     lpDDSurfaceDesc->dwHeight = py;
@@ -209,9 +209,9 @@ HRESULT FakeDirectDrawSurface7::Unlock( LPRECT lpRect ) {
 
     if ( bpp != 16 ) {
         if ( Engine::GAPI->GetMainThreadID() != GetCurrentThreadId() ) {
-            Resource->GetEngineTexture()->UpdateDataDeferred( Data, MipLevel );
+            Resource->GetLoadTarget()->UpdateDataDeferred( Data, MipLevel );
         } else {
-            Resource->GetEngineTexture()->UpdateData( Data, MipLevel );
+            Resource->GetLoadTarget()->UpdateData( Data, MipLevel );
         }
     }
 
@@ -1,15 +1,21 @@
 #include "MyDirectDrawSurface7.h"
 #include "../Engine.h"
 #include "../GothicAPI.h"
+#include "../TextureArchive.h"
 #include "../D3D11GraphicsEngineBase.h"
 #include "../D3D11Texture.h"
 #include "../zCTexture.h"
+#include "../TextureCompressor.h"
+#include "../ResidencyManager.h"
 #include "Conversions.h"
 
 #define DebugWriteTex(x)  DebugWrite(x)
 
 const std::string LEAF_SUBSTR[] = { "Treetop", "Bush", "Leaf" };
 
+/** Evicted textures keep at least this size, anything smaller isn't worth the reload */
+const UINT MIN_EVICTED_TEXTURE_SIZE = 32;
+
 MyDirectDrawSurface7::MyDirectDrawSurface7() {
     refCount = 1;
     EngineTexture = nullptr;
@@ -18,8 +24,17 @@ MyDirectDrawSurface7::MyDirectDrawSurface7() {
     LockedData = nullptr;
     GothicTexture = nullptr;
     IsReady = false;
+    IsImmutable = false;
     TextureType = ETextureType::TX_UNDEF;
     LockType = 0;
+    LastBoundFrame = 0;
+    EvictedMips = 0;
+    RestoreRequested = false;
+    RestoreTexture = nullptr;
+    RestoreIsImmutable = false;
+    RestoreSucceeded = false;
+
+    ResidencyManager::RegisterSurface( this );
 
     // Check for test-bind mode to figure out what zCTexture-Object we are associated with
     std::string bound;
@@ -30,6 +45,7 @@ MyDirectDrawSurface7::MyDirectDrawSurface7() {
 }
 
 MyDirectDrawSurface7::~MyDirectDrawSurface7() {
+    ResidencyManager::UnregisterSurface( this );
     Engine::GAPI->RemoveSurface( this );
 
     // Release mip-map chain first
@@ -41,6 +57,7 @@ MyDirectDrawSurface7::~MyDirectDrawSurface7() {
     delete[] LockedData;
 
     delete EngineTexture;
+    delete RestoreTexture;
     delete Normalmap;
     delete FxMap;
 }
@@ -50,6 +67,11 @@ D3D11Texture* MyDirectDrawSurface7::GetEngineTexture() {
     return EngineTexture;
 }
 
+/** Returns the texture the game's data goes into. That's the one being restored while the game loads it again. */
+D3D11Texture* MyDirectDrawSurface7::GetLoadTarget() {
+    return RestoreTexture ? RestoreTexture : EngineTexture;
+}
+
 /** Returns the engine texture of this surface */
 D3D11Texture* MyDirectDrawSurface7::GetNormalmap() {
     return Normalmap;
@@ -70,6 +92,12 @@ void MyDirectDrawSurface7::BindToSlot( int slot ) {
     if ( EngineTexture ) // Needed sometimes
         EngineTexture->BindToPixelShader( slot );
 
+    LastBoundFrame = Engine::GAPI->GetFrameNumber();
+    if ( EvictedMips && !RestoreRequested ) {
+        RestoreRequested = true;
+        ResidencyManager::RequestRestore( this );
+    }
+
     if ( Normalmap ) {
         Normalmap->BindToPixelShader( slot + 1 );
         Normalmap->BindToVertexShader( 0 );
@@ -79,6 +107,32 @@ void MyDirectDrawSurface7::BindToSlot( int slot ) {
     }
 }
 
+/** Loads a normal- or fx-map, straight out of its archive if it is packed */
+static D3D11Texture* LoadReplacementMap( const TextureReplacementSource& source ) {
+    if ( !source.IsValid() ) {
+        return nullptr;
+    }
+
+    // Create the texture object this is linked with
+    D3D11Texture* texture;
+    Engine::GraphicsEngine->CreateTexture( &texture );
+
+    XRESULT xr = XR_FAILED;
+    if ( source.Archive ) {
+        // Only this file is mapped, and only while the texture is created
+        if ( auto view = source.Archive->MapFile( source.ArchiveEntry ) ) {
+            xr = texture->InitFromMemory( view->GetData(), view->GetSize(), source.File );
+        }
+    } else {
+        xr = texture->Init( source.File );
+    }
+    if ( XR_SUCCESS != xr ) {
+        SAFE_DELETE( texture );
+        LogWarnCh( LC_TEXTURES ) << "Failed to load replacement map " << source.File;
+    }
+    return texture;
+}
+
 /** Loads additional resources if possible */
 void MyDirectDrawSurface7::LoadAdditionalResources( zCTexture* ownedTexture ) {
     if ( !GothicTexture ) {
@@ -105,64 +159,14 @@ void MyDirectDrawSurface7::LoadAdditionalResources( zCTexture* ownedTexture ) {
         return;
     }
 
-    D3D11Texture* fxMapTexture = nullptr;
-    D3D11Texture* nrmmapTexture = nullptr;
-
-    // Check for normalmap in our mods folder first, then in the original games
-    int j = 0;
-    std::string replacementsFolder = "system\\GD3D11\\textures\\replacements\\Normalmaps_" + std::to_string( j );
-    while ( Toolbox::FolderExists( replacementsFolder ) ) {
-        std::string normalmap = replacementsFolder + "\\" + TextureName + "_normal.dds";
-        if ( Toolbox::FileExists( normalmap ) ) {
-            // Create the texture object this is linked with
-            Engine::GraphicsEngine->CreateTexture( &nrmmapTexture );
-            if ( XR_SUCCESS != nrmmapTexture->Init( normalmap ) ) {
-                SAFE_DELETE( nrmmapTexture );
-                LogWarn() << "Failed to load normalmap!";
-            }
-            break; // No need to check the other folders
-        }
-        j++;
-        replacementsFolder = "system\\GD3D11\\textures\\replacements\\Normalmaps_" + std::to_string( j );
-    }
-    std::string normalmap = "system\\GD3D11\\textures\\replacements\\Normalmaps_" + Engine::GAPI->GetGameName() + "\\" + TextureName + "_normal.dds";
-    if ( !nrmmapTexture && Toolbox::FileExists( normalmap ) ) {
-        // Create the texture object this is linked with
-        Engine::GraphicsEngine->CreateTexture( &nrmmapTexture );
-        if ( XR_SUCCESS != nrmmapTexture->Init( normalmap ) ) {
-            SAFE_DELETE( nrmmapTexture );
-            LogWarn() << "Failed to load normalmap!";
-        }
-    }
-
-    j = 0;
-    replacementsFolder = "system\\GD3D11\\textures\\replacements\\Normalmaps_" + std::to_string( j );
-    while ( Toolbox::FolderExists( replacementsFolder ) ) {
-        std::string fxMap = replacementsFolder + "\\" + TextureName + "_fx.dds";
-        if ( Toolbox::FileExists( fxMap ) ) {
-            // Create the texture object this is linked with
-            Engine::GraphicsEngine->CreateTexture( &fxMapTexture );
-            if ( XR_SUCCESS != fxMapTexture->Init( fxMap ) ) {
-                SAFE_DELETE( fxMapTexture );
-                LogWarn() << "Failed to load normalmap!";
-            }
-            break; // No need to check the other folders
-        }
-        j++;
-        replacementsFolder = "system\\GD3D11\\textures\\replacements\\Normalmaps_" + std::to_string( j );
-    }
-    std::string fxMap = "system\\GD3D11\\textures\\replacements\\Normalmaps_" + Engine::GAPI->GetGameName() + "\\" + TextureName + "_fx.dds";
-    if ( !fxMapTexture && Toolbox::FileExists( fxMap ) ) {
-        // Create the texture object this is linked with
-        Engine::GraphicsEngine->CreateTexture( &fxMapTexture );
-        if ( XR_SUCCESS != fxMapTexture->Init( fxMap ) ) {
-            SAFE_DELETE( fxMapTexture );
-            LogWarn() << "Failed to load normalmap!";
-        }
+    // The index already knows which replacement folder wins, no need to touch the disk
+    TextureReplacementInfo replacement;
+    if ( !Engine::GAPI->GetTextureReplacement( TextureName, replacement ) ) {
+        return;
     }
 
-    Normalmap = nrmmapTexture;
-    FxMap = fxMapTexture;
+    Normalmap = LoadReplacementMap( replacement.Normalmap );
+    FxMap = LoadReplacementMap( replacement.FxMap );
 }
 
 HRESULT MyDirectDrawSurface7::QueryInterface( REFIID riid, LPVOID* ppvObj ) {
@@ -343,7 +347,8 @@ HRESULT MyDirectDrawSurface7::Lock( LPRECT lpDestRect, LPDDSURFACEDESC2 lpDDSurf
         return S_OK;
     }
 
-    if ( !EngineTexture )
+    D3D11Texture* target = GetLoadTarget();
+    if ( !target )
         return S_OK;
 
     // Check for 16-bit surface. We allocate the texture as 32-bit, so we need to divide the size by two for that
@@ -358,19 +363,23 @@ HRESULT MyDirectDrawSurface7::Lock( LPRECT lpDestRect, LPDDSURFACEDESC2 lpDDSurf
     if ( bpp == 16 )
         divisor = 2;
 
+    // 16-bit textures may have been recreated block compressed or with fewer mips, size those after the surface
+    UINT sizeInBytes = bpp == 16 ? OriginalSurfaceDesc.dwWidth * OriginalSurfaceDesc.dwHeight * 4 : target->GetSizeInBytes( 0 );
+    UINT rowPitch = bpp == 16 ? OriginalSurfaceDesc.dwWidth * 4 : target->GetRowPitchBytes( 0 );
+
     if ( bpp == 24 ) {
         // Handle movie frame,
         // don't deallocate the memory after unlock, since only the changing parts in videos will get updated
         if ( !LockedData )
-            LockedData = new unsigned char[EngineTexture->GetSizeInBytes( 0 )];
+            LockedData = new unsigned char[sizeInBytes];
     } else {
         // Allocate some temporary data
         delete[] LockedData;
-        LockedData = new unsigned char[EngineTexture->GetSizeInBytes( 0 ) / divisor];
+        LockedData = new unsigned char[sizeInBytes / divisor];
     }
 
     lpDDSurfaceDesc->lpSurface = LockedData;
-    lpDDSurfaceDesc->lPitch = EngineTexture->GetRowPitchBytes( 0 ) / divisor;
+    lpDDSurfaceDesc->lPitch = rowPitch / divisor;
 
     return S_OK;
 }
@@ -390,11 +399,17 @@ HRESULT MyDirectDrawSurface7::Unlock( LPRECT lpRect ) {
     }
 
     // Textureslot 7 is filled only on load-time. This is used to get the zCTexture from this Surface.
-    if ( Engine::GAPI->GetBoundTexture( 7 ) != nullptr ) {
+    // Restores keep their maps and don't come through CacheIn, so the slot belongs to some other texture then.
+    if ( !RestoreTexture && Engine::GAPI->GetBoundTexture( 7 ) != nullptr ) {
         // Comming from LoadResourceData
         LoadAdditionalResources( Engine::GAPI->GetBoundTexture( 7 ) );
     }
 
+    // Queued HUD geometry might still use the old contents
+    if ( Engine::GAPI->GetMainThreadID() == GetCurrentThreadId() ) {
+        Engine::GraphicsEngine->FlushHUDBatch();
+    }
+
     // If this is a 16-bit surface, we need to convert it to 32-bit first
     int redBits = Toolbox::GetNumberOfBits( OriginalSurfaceDesc.ddpfPixelFormat.dwRBitMask );
     int greenBits = Toolbox::GetNumberOfBits( OriginalSurfaceDesc.ddpfPixelFormat.dwGBitMask );
@@ -405,7 +420,7 @@ HRESULT MyDirectDrawSurface7::Unlock( LPRECT lpRect ) {
 
     if ( bpp == 16 ) {
         // Convert
-        UINT realDataSize = EngineTexture->GetSizeInBytes( 0 );
+        UINT realDataSize = OriginalSurfaceDesc.dwWidth * OriginalSurfaceDesc.dwHeight * 4;
         unsigned char* dst = new unsigned char[realDataSize];
         switch ( OriginalSurfaceDesc.ddpfPixelFormat.dwFourCC ) {
             case 1: Convert1555to8888( dst, LockedData, realDataSize ); break;
@@ -413,13 +428,20 @@ HRESULT MyDirectDrawSurface7::Unlock( LPRECT lpRect ) {
             default: Convert565to8888( dst, LockedData, realDataSize ); break;
         }
 
+        // Mips are built on the CPU if possible, so the texture can be created with its whole chain at once
+        D3D11Texture* target = GetLoadTarget();
+        bool& immutable = RestoreTexture ? RestoreIsImmutable : IsImmutable;
         if ( Engine::GAPI->GetMainThreadID() != GetCurrentThreadId() ) {
-            EngineTexture->UpdateDataDeferred( dst, 0 );
-            EngineTexture->GenerateMipMapsDeferred();
+            if ( !UploadWithMipChain( dst, target, immutable ) ) {
+                target->UpdateDataDeferred( dst, 0 );
+                target->GenerateMipMapsDeferred();
+            }
             Engine::GAPI->AddFrameLoadedTexture( this );
         } else {
-            EngineTexture->UpdateData( dst, 0 );
-            EngineTexture->GenerateMipMaps();
+            if ( !UploadWithMipChain( dst, target, immutable ) ) {
+                target->UpdateData( dst, 0 );
+                target->GenerateMipMaps();
+            }
             SetReady( true ); // No need to load other stuff to get this ready
         }
 
@@ -427,10 +449,10 @@ HRESULT MyDirectDrawSurface7::Unlock( LPRECT lpRect ) {
     } else {
         // No conversion needed
         if ( Engine::GAPI->GetMainThreadID() != GetCurrentThreadId() ) {
-            EngineTexture->UpdateDataDeferred( LockedData, 0 );
+            GetLoadTarget()->UpdateDataDeferred( LockedData, 0 );
             Engine::GAPI->AddFrameLoadedTexture( this );
         } else {
-            EngineTexture->UpdateData( LockedData, 0 );
+            GetLoadTarget()->UpdateData( LockedData, 0 );
             SetReady( true ); // No need to load other stuff to get this ready
         }
     }
@@ -445,6 +467,146 @@ HRESULT MyDirectDrawSurface7::Unlock( LPRECT lpRect ) {
 }
 #pragma warning(pop)
 
+/** Recreates the target texture with its mips generated on the CPU, block compressed if enabled.
+    Returns false if the GPU has to generate the mips instead. */
+bool MyDirectDrawSurface7::UploadWithMipChain( unsigned char* bgra, D3D11Texture* target, bool& immutable ) {
+    const GothicRendererSettings& settings = Engine::GAPI->GetRendererState().RendererSettings;
+    INT2 size( OriginalSurfaceDesc.dwWidth, OriginalSurfaceDesc.dwHeight );
+    MipMapGenerator::EFilter filter = static_cast<MipMapGenerator::EFilter>(settings.MipMapFilter);
+
+    // Textures without mips are drawn screen-aligned (menus, fonts) and may be updated often, keep those as they are
+    if ( GetOriginalMipMapCount() > 1 ) {
+        if ( settings.EnableTextureCompression && UploadCompressed( bgra, filter, target, immutable ) )
+            return true;
+
+        if ( settings.EnableCPUMipMapGeneration ) {
+            MipMapGenerator::MipChain chain;
+            MipMapGenerator::Generate( bgra, size, GetOriginalMipMapCount(), filter, chain );
+
+            immutable = true;
+            if ( XR_SUCCESS == target->InitImmutable( size, D3D11Texture::ETextureFormat::TF_B8G8R8A8, GetOriginalMipMapCount(),
+                reinterpret_cast<const void* const*>(&chain.Mips[0]), TextureName ) )
+                return true;
+        }
+    }
+
+    if ( immutable ) {
+        // The GPU path needs a texture it can write to
+        target->Init( size, D3D11Texture::ETextureFormat::TF_B8G8R8A8, GetOriginalMipMapCount(), nullptr, "DirectDrawSurface7" );
+        immutable = false;
+    }
+    return false;
+}
+
+/** Recreates the target texture block compressed. Returns false if the texture can't be compressed. */
+bool MyDirectDrawSurface7::UploadCompressed( unsigned char* bgra, MipMapGenerator::EFilter mipFilter, D3D11Texture* target, bool& immutable ) {
+    INT2 size( OriginalSurfaceDesc.dwWidth, OriginalSurfaceDesc.dwHeight );
+    UINT mipLevels = TextureCompressor::GetNumCompressibleMips( size, GetOriginalMipMapCount() );
+
+    // Only textures coming from the game's resource loader, anything else is likely rendered to
+    if ( TextureName.empty() || mipLevels == 0 )
+        return false;
+
+    // 565 and 1555 fit into BC1, the latter using its 1-bit alpha. 4444 needs BC3.
+    TextureCompressor::EBlockFormat format = OriginalSurfaceDesc.ddpfPixelFormat.dwFourCC == 2 ? TextureCompressor::BF_BC3 : TextureCompressor::BF_BC1;
+
+    TextureCompressor::CompressedTexture compressed;
+    uint64_t contentHash = TextureCompressor::HashData( LockedData, size.x * size.y * 2 );
+    if ( !TextureCompressor::LoadFromCache( TextureName, contentHash, format, size, mipLevels, mipFilter, compressed ) ) {
+        TextureCompressor::Compress( TextureName, bgra, size, mipLevels, format, mipFilter, compressed );
+        TextureCompressor::SaveToCache( TextureName, contentHash, compressed );
+    }
+
+    std::vector<const void*> mips( mipLevels );
+    for ( UINT mip = 0; mip < mipLevels; mip++ ) {
+        mips[mip] = &compressed.Data[compressed.MipOffsets[mip]];
+    }
+
+    immutable = true;
+    D3D11Texture::ETextureFormat textureFormat = format == TextureCompressor::BF_BC3 ? D3D11Texture::ETextureFormat::TF_DXT5 : D3D11Texture::ETextureFormat::TF_DXT1;
+    return XR_SUCCESS == target->InitImmutable( size, textureFormat, mipLevels, &mips[0], TextureName );
+}
+
+/** Returns true if the engine texture can give up its top mip to free video memory */
+bool MyDirectDrawSurface7::CanEvictMip() {
+    // Only textures the game can load again, and none which are being restored
+    if ( !IsReady || !EngineTexture || !GothicTexture || IsMovieSurface() || RestoreTexture )
+        return false;
+
+    return (OriginalSurfaceDesc.dwWidth >> (EvictedMips + 1)) >= MIN_EVICTED_TEXTURE_SIZE
+        && (OriginalSurfaceDesc.dwHeight >> (EvictedMips + 1)) >= MIN_EVICTED_TEXTURE_SIZE
+        && EngineTexture->CanDropTopMip();
+}
+
+/** Drops the top mip of the engine texture. Returns the freed video memory. */
+uint64_t MyDirectDrawSurface7::EvictMip() {
+    uint64_t sizeBefore = EngineTexture->GetVideoMemorySize();
+    if ( XR_SUCCESS != EngineTexture->DropTopMip() )
+        return 0;
+
+    EvictedMips++;
+    return sizeBefore - EngineTexture->GetVideoMemorySize();
+}
+
+/** Returns how much more video memory the texture needs once its evicted mips are restored */
+uint64_t MyDirectDrawSurface7::GetMemoryToRestore() {
+    if ( !EvictedMips || !EngineTexture )
+        return 0;
+
+    uint64_t fullSize = ResidencyManager::GetTextureSize( GetEngineTextureFormat(), OriginalSurfaceDesc.dwWidth, OriginalSurfaceDesc.dwHeight, GetOriginalMipMapCount() );
+    return fullSize > EngineTexture->GetVideoMemorySize() ? fullSize - EngineTexture->GetVideoMemorySize() : 0;
+}
+
+/** Creates the full size texture the evicted mips get loaded into. The current one stays in use until then. */
+bool MyDirectDrawSurface7::BeginRestore() {
+    if ( !EvictedMips || !EngineTexture || !GothicTexture || RestoreTexture ) {
+        RestoreRequested = false;
+        return false;
+    }
+
+    // Gothic writes every mip again, they need to be where it expects them
+    Engine::GraphicsEngine->CreateTexture( &RestoreTexture );
+    RestoreTexture->Init( INT2( OriginalSurfaceDesc.dwWidth, OriginalSurfaceDesc.dwHeight ),
+        static_cast<D3D11Texture::ETextureFormat>(GetEngineTextureFormat()), GetOriginalMipMapCount(), nullptr, "DirectDrawSurface7" );
+    RestoreIsImmutable = false;
+    RestoreSucceeded = false;
+    return true;
+}
+
+/** Lets the game load the texture again. Its locks end up in the restore texture and upload deferred, as on any other thread than the main one. */
+void MyDirectDrawSurface7::LoadRestoredMips() {
+    // Gothic's own loader thread calls this off the main thread too, one texture at a time
+    std::lock_guard<std::mutex> lock( zCResourceManager::GetResourceManagerMutex() );
+    RestoreSucceeded = GothicTexture->LoadResourceData() != 0;
+}
+
+/** Switches the restored texture in, or drops it if loading failed */
+void MyDirectDrawSurface7::FinishRestore() {
+    if ( !RestoreTexture )
+        return;
+
+    if ( RestoreSucceeded ) {
+        // Whatever still has the old one bound keeps it alive until it's replaced
+        std::swap( EngineTexture, RestoreTexture );
+        IsImmutable = RestoreIsImmutable;
+        EvictedMips = 0;
+    } else {
+        LogWarnCh( LC_TEXTURES ) << "Failed to restore evicted texture " << TextureName;
+    }
+
+    delete RestoreTexture;
+    RestoreTexture = nullptr;
+    RestoreRequested = false;
+}
+
+/** Returns the number of mips the game created this surface with */
+UINT MyDirectDrawSurface7::GetOriginalMipMapCount() {
+    if ( OriginalSurfaceDesc.ddsCaps.dwCaps & DDSCAPS_MIPMAP )
+        return OriginalSurfaceDesc.dwMipMapCount;
+
+    return 1;
+}
+
 HRESULT MyDirectDrawSurface7::ReleaseDC( HDC hDC ) {
     DebugWriteTex( "IDirectDrawSurface7(%p)::ReleaseDC()" );
     return S_OK;
@@ -526,11 +688,21 @@ HRESULT MyDirectDrawSurface7::SetSurfaceDesc( LPDDSURFACEDESC2 lpDDSurfaceDesc,
     // Create the texture object this is linked with
     Engine::GraphicsEngine->CreateTexture( &EngineTexture );
 
+    // Create the texture
+    EngineTexture->Init( INT2( lpDDSurfaceDesc->dwWidth, lpDDSurfaceDesc->dwHeight ), static_cast<D3D11Texture::ETextureFormat>(GetEngineTextureFormat()),
+        GetOriginalMipMapCount(), nullptr, "DirectDrawSurface7" );
+    IsImmutable = false;
+    EvictedMips = 0;
 
-    int redBits = Toolbox::GetNumberOfBits( lpDDSurfaceDesc->ddpfPixelFormat.dwRBitMask );
-    int greenBits = Toolbox::GetNumberOfBits( lpDDSurfaceDesc->ddpfPixelFormat.dwGBitMask );
-    int blueBits = Toolbox::GetNumberOfBits( lpDDSurfaceDesc->ddpfPixelFormat.dwBBitMask );
-    int alphaBits = Toolbox::GetNumberOfBits( lpDDSurfaceDesc->ddpfPixelFormat.dwRGBAlphaBitMask );
+    return S_OK;
+}
+
+/** Returns the format the engine texture is created with, before any conversion */
+DXGI_FORMAT MyDirectDrawSurface7::GetEngineTextureFormat() {
+    int redBits = Toolbox::GetNumberOfBits( OriginalSurfaceDesc.ddpfPixelFormat.dwRBitMask );
+    int greenBits = Toolbox::GetNumberOfBits( OriginalSurfaceDesc.ddpfPixelFormat.dwGBitMask );
+    int blueBits = Toolbox::GetNumberOfBits( OriginalSurfaceDesc.ddpfPixelFormat.dwBBitMask );
+    int alphaBits = Toolbox::GetNumberOfBits( OriginalSurfaceDesc.ddpfPixelFormat.dwRGBAlphaBitMask );
 
     int bpp = redBits + greenBits + blueBits + alphaBits;
 
@@ -549,8 +721,8 @@ HRESULT MyDirectDrawSurface7::SetSurfaceDesc( LPDDSURFACEDESC2 lpDDSurfaceDesc,
     case 0:
     {
         // DDS-Texture
-        if ( (lpDDSurfaceDesc->ddpfPixelFormat.dwFlags & DDPF_FOURCC) == DDPF_FOURCC ) {
-            switch ( lpDDSurfaceDesc->ddpfPixelFormat.dwFourCC ) {
+        if ( (OriginalSurfaceDesc.ddpfPixelFormat.dwFlags & DDPF_FOURCC) == DDPF_FOURCC ) {
+            switch ( OriginalSurfaceDesc.ddpfPixelFormat.dwFourCC ) {
             case FOURCC_DXT1:
                 format = D3D11Texture::ETextureFormat::TF_DXT1;
                 break;
@@ -570,16 +742,7 @@ HRESULT MyDirectDrawSurface7::SetSurfaceDesc( LPDDSURFACEDESC2 lpDDSurfaceDesc,
     break;
     }
 
-    // Find out mip-level count
-    unsigned int mipMapCount = 1;
-    if ( lpDDSurfaceDesc->ddsCaps.dwCaps & DDSCAPS_MIPMAP ) {
-        mipMapCount = lpDDSurfaceDesc->dwMipMapCount;
-    }
-
-    // Create the texture
-    EngineTexture->Init( INT2( lpDDSurfaceDesc->dwWidth, lpDDSurfaceDesc->dwHeight ), format, mipMapCount, nullptr, "DirectDrawSurface7" );
-
-    return S_OK;
+    return static_cast<DXGI_FORMAT>(format);
 }
 
 HRESULT MyDirectDrawSurface7::SetPrivateData( REFGUID guidTag, LPVOID lpData, DWORD cbSize, DWORD dwFlags ) {
@@ -6,6 +6,7 @@
 #pragma once
 #include "../pch.h"
 #include <ddraw.h>
+#include "../MipMapGenerator.h"
 
 enum ETextureType {
     TX_UNDEF,
@@ -105,8 +106,45 @@ public:
 
     /** Returns the type of this texture */
     ETextureType GetTextureType() { return TextureType; };
+
+    /** Returns the frame this surface was last bound in */
+    unsigned int GetLastBoundFrame() const { return LastBoundFrame; }
+
+    /** Returns true if the engine texture can give up its top mip to free video memory */
+    bool CanEvictMip();
+
+    /** Drops the top mip of the engine texture. Returns the freed video memory. */
+    uint64_t EvictMip();
+
+    /** Returns how much more video memory the texture needs once its evicted mips are restored */
+    uint64_t GetMemoryToRestore();
+
+    /** Creates the full size texture the evicted mips get loaded into. Returns false if there's nothing to restore. Main thread. */
+    bool BeginRestore();
+
+    /** Lets the game load the texture again, into the restore texture. Runs on a worker thread. */
+    void LoadRestoredMips();
+
+    /** Switches the restored texture in, or drops it if loading failed. Main thread, once its deferred uploads went through. */
+    void FinishRestore();
+
+    /** Returns the texture the game's data goes into. That's the one being restored while the game loads it again. */
+    D3D11Texture* GetLoadTarget();
 private:
 
+    /** Recreates the target texture with its mips generated on the CPU, block compressed if enabled.
+        Returns false if the GPU has to generate the mips instead. */
+    bool UploadWithMipChain( unsigned char* bgra, D3D11Texture* target, bool& immutable );
+
+    /** Recreates the target texture block compressed. Returns false if the texture can't be compressed. */
+    bool UploadCompressed( unsigned char* bgra, MipMapGenerator::EFilter mipFilter, D3D11Texture* target, bool& immutable );
+
+    /** Returns the number of mips the game created this surface with */
+    UINT GetOriginalMipMapCount();
+
+    /** Returns the format the engine texture is created with, before any conversion */
+    DXGI_FORMAT GetEngineTextureFormat();
+
     /** Faked attached surfaces for the mipmaps */
     std::vector<MyDirectDrawSurface7*> attachedSurfaces;
     int refCount;
@@ -121,6 +159,9 @@ private:
     /** Attached texture */
     D3D11Texture* EngineTexture;
 
+    /** True if the engine texture was recreated with its whole mip chain. It can't be updated anymore. */
+    bool IsImmutable;
+
     /** Associated Name */
     std::string TextureName;
     ETextureType TextureType;
@@ -134,4 +175,14 @@ private:
 
     /** zCTexture this is associated with */
     zCTexture* GothicTexture;
+
+    /** Residency state. Evicted mips come back when the surface is bound again. */
+    unsigned int LastBoundFrame;
+    UINT EvictedMips;
+    bool RestoreRequested;
+
+    /** Full size texture the game loads into while the evicted one stays in use */
+    D3D11Texture* RestoreTexture;
+    bool RestoreIsImmutable;
+    bool RestoreSucceeded;
 };
@@ -35,6 +35,7 @@ namespace Engine {
         // Create threadpool
         RenderingThreadPool = new ThreadPool;
         WorkerThreadPool = new ThreadPool;
+        RestoreThreadPool = new ThreadPool( 1 );
     }
 
     /** Creates the Global GAPI-Object */
@@ -64,6 +65,7 @@ namespace Engine {
         SAFE_DELETE( Engine::RenderingThreadPool );
         SAFE_DELETE( Engine::AntTweakBar );
         SAFE_DELETE( Engine::GAPI );
+        SAFE_DELETE( Engine::RestoreThreadPool );
         SAFE_DELETE( Engine::WorkerThreadPool );
         SAFE_DELETE( Engine::GraphicsEngine );
     }
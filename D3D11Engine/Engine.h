@@ -31,6 +31,10 @@ namespace Engine {
     /** Global worker threadpool */
     __declspec(selectany) ThreadPool* WorkerThreadPool;
 
+    /** Single thread restoring evicted textures. They hold the resource manager mutex while loading and
+        spread their mip generation over the worker threadpool, so they can't be worker jobs themselves. */
+    __declspec(selectany) ThreadPool* RestoreThreadPool;
+
     /** Refresh worker threadpool */
     void RefreshWorkerThreadpool();
 
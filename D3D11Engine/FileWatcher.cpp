@@ -0,0 +1,114 @@
+#include "pch.h"
+#include "FileWatcher.h"
+#include "Toolbox.h"
+#include <algorithm>
+
+/** Changes within this time are collected into one batch */
+const int FILE_WATCHER_SETTLE_MS = 200;
+
+/** Size of the buffer ReadDirectoryChangesW fills, enough for a few hundred notifications */
+const DWORD FILE_WATCHER_BUFFER_SIZE = 16 * 1024;
+
+FileWatcher::FileWatcher() {
+    Directory = INVALID_HANDLE_VALUE;
+    StopEvent = nullptr;
+}
+
+FileWatcher::~FileWatcher() {
+    Stop();
+}
+
+/** Starts watching the given directory. Returns false if it can't be opened. */
+bool FileWatcher::Start( const std::string& directory ) {
+    Stop();
+
+    Directory = CreateFileA( directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr );
+    if ( Directory == INVALID_HANDLE_VALUE ) {
+        LogWarn() << "Failed to watch directory " << directory << " for changes";
+        return false;
+    }
+
+    StopEvent = CreateEventA( nullptr, TRUE, FALSE, nullptr );
+    WatchThread = std::thread( &FileWatcher::WatchThreadFunc, this );
+    return true;
+}
+
+/** Stops the thread and closes the directory */
+void FileWatcher::Stop() {
+    if ( WatchThread.joinable() ) {
+        SetEvent( StopEvent );
+        WatchThread.join();
+    }
+
+    if ( StopEvent ) {
+        CloseHandle( StopEvent );
+        StopEvent = nullptr;
+    }
+
+    if ( Directory != INVALID_HANDLE_VALUE ) {
+        CloseHandle( Directory );
+        Directory = INVALID_HANDLE_VALUE;
+    }
+}
+
+/** Returns the files changed since the last call. Returns nothing while changes are still coming in,
+    since editors often write a file in several steps. */
+std::vector<std::string> FileWatcher::PopChangedFiles() {
+    std::unique_lock<std::mutex> lock( ChangedFilesMutex );
+    if ( ChangedFiles.empty() || std::chrono::steady_clock::now() - LastChange < std::chrono::milliseconds( FILE_WATCHER_SETTLE_MS ) )
+        return std::vector<std::string>();
+
+    std::vector<std::string> files( ChangedFiles.begin(), ChangedFiles.end() );
+    ChangedFiles.clear();
+    return files;
+}
+
+/** Waits for changes until the stop event is set */
+void FileWatcher::WatchThreadFunc() {
+    // Notifications are DWORD aligned
+    std::vector<DWORD> buffer( FILE_WATCHER_BUFFER_SIZE / sizeof( DWORD ) );
+
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = CreateEventA( nullptr, TRUE, FALSE, nullptr );
+    HANDLE events[] = { overlapped.hEvent, StopEvent };
+
+    while ( true ) {
+        ResetEvent( overlapped.hEvent );
+        if ( !ReadDirectoryChangesW( Directory, &buffer[0], FILE_WATCHER_BUFFER_SIZE, TRUE,
+            FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, nullptr, &overlapped, nullptr ) ) {
+            LogWarn() << "Failed to read directory changes, stopped watching";
+            break;
+        }
+
+        if ( WaitForMultipleObjects( 2, events, FALSE, INFINITE ) != WAIT_OBJECT_0 ) {
+            CancelIo( Directory );
+            WaitForSingleObject( overlapped.hEvent, INFINITE );
+            break;
+        }
+
+        DWORD bytes = 0;
+        if ( !GetOverlappedResult( Directory, &overlapped, &bytes, FALSE ) || bytes == 0 ) {
+            // The buffer overflowed. Nothing to tell which files changed, the next notification will.
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock( ChangedFilesMutex );
+        const unsigned char* entry = reinterpret_cast<const unsigned char*>(&buffer[0]);
+        while ( true ) {
+            const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(entry);
+            if ( info->Action != FILE_ACTION_REMOVED && info->Action != FILE_ACTION_RENAMED_OLD_NAME ) {
+                std::string file = Toolbox::ToMultiByte( std::wstring( info->FileName, info->FileNameLength / sizeof( WCHAR ) ) );
+                std::transform( file.begin(), file.end(), file.begin(), ::tolower );
+                ChangedFiles.insert( file );
+            }
+
+            if ( info->NextEntryOffset == 0 )
+                break;
+            entry += info->NextEntryOffset;
+        }
+        LastChange = std::chrono::steady_clock::now();
+    }
+
+    CloseHandle( overlapped.hEvent );
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "pch.h"
+
+/** Watches a directory and its subdirectories on a background thread. Collects the names of files written to,
+    relative to the directory and in lowercase, until someone picks them up. */
+class FileWatcher {
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    /** Starts watching the given directory. Returns false if it can't be opened. */
+    bool Start( const std::string& directory );
+
+    /** Stops the thread and closes the directory */
+    void Stop();
+
+    /** Returns the files changed since the last call. Returns nothing while changes are still coming in,
+        since editors often write a file in several steps. */
+    std::vector<std::string> PopChangedFiles();
+
+private:
+    /** Waits for changes until the stop event is set */
+    void WatchThreadFunc();
+
+    HANDLE Directory;
+    HANDLE StopEvent;
+    std::thread WatchThread;
+
+    std::mutex ChangedFilesMutex;
+    std::set<std::string> ChangedFiles;
+    std::chrono::steady_clock::time_point LastChange;
+};
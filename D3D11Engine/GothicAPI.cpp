@@ -30,6 +30,7 @@
 #include "BaseLineRenderer.h"
 #include "D3D11PShader.h"
 #include "D3D11VShader.h"
+#include "D3D11ShaderManager.h"
 #include "D3D7\MyDirect3DDevice7.h"
 #include "GVegetationBox.h"
 #include "oCNPC.h"
@@ -37,6 +38,11 @@
 #include "zCMeshSoftSkin.h"
 #include "GOcean.h"
 #include "zCVobLight.h"
+#include "TextureArchive.h"
+#include "TextureCompressor.h"
+#include "MipMapGenerator.h"
+#include "ResidencyManager.h"
+#include "WorldStreamer.h"
 #include "zCQuadMark.h"
 #include "zCOption.h"
 #include "zCRndD3D.h"
@@ -134,18 +140,24 @@ GothicAPI::GothicAPI() {
     ZeroMemory( BoundTextures, sizeof( BoundTextures ) );
 
     CameraReplacementPtr = nullptr;
+    ProjectionJitter = XMFLOAT2( 0, 0 );
     WrappedWorldMesh = nullptr;
+    FrameNumber = 0;
     Ocean = nullptr;
     CurrentCamera = nullptr;
 
     MainThreadID = GetCurrentThreadId();
 
+    TextureReplacementProbeCost = 0;
+    TextureReplacementCallsAvoided = 0;
+
     _canRain = false;
     _canClearVobsByVisual = false;
 }
 
 GothicAPI::~GothicAPI() {
     //ResetWorld(); // Just let it leak for now. // TODO: Do this properly
+    WorldStreamer::OnWorldUnloaded();
     SAFE_DELETE( WrappedWorldMesh );
 }
 
@@ -192,6 +204,14 @@ void GothicAPI::OnGameStart() {
 
     LoadMenuSettings( MENU_SETTINGS_FILE );
 
+    // Started with -GD3D11_PACKTEXTURES: turn the loose replacement textures into archives first
+    if ( HasCommandlineParameter( "GD3D11_PACKTEXTURES" ) ) {
+        PackTextureReplacementFolders();
+    }
+
+    // Needs the game name from the settings
+    BuildTextureReplacementIndex();
+
     LogInfo() << "Running with Commandline: " << zCOption::GetOptions()->GetCommandline();
 
     // Get forced resolution from commandline
@@ -286,6 +306,7 @@ void GothicAPI::OnWorldUpdate() {
 
     RendererState.RendererInfo.Reset();
     RendererState.RendererInfo.FPS = GetFramesPerSecond();
+    FrameNumber++;
     RendererState.GraphicsState.FF_Time = GetTimeSeconds();
 
     if ( zCCamera* camera = zCCamera::GetCamera() ) {
@@ -553,6 +574,7 @@ void GothicAPI::RemoveVegetationBox( GVegetationBox* box ) {
 
 /** Resets the object, like at level load */
 void GothicAPI::ResetWorld() {
+    WorldStreamer::OnWorldUnloaded();
     WorldSections.clear();
 
     ResetVobs();
@@ -646,6 +668,9 @@ void GothicAPI::OnGeometryLoaded( zCPolygon** polys, unsigned int numPolygons )
 
     bool indoorLocation = (LoadedWorldInfo->BspTree->GetBspTreeMode() == zBSP_MODE_INDOOR);
     std::string worldStr = "system\\GD3D11\\meshes\\WLD_" + LoadedWorldInfo->WorldName + ".obj";
+    std::string clusterCacheFile = WorldConverter::GetWorldMeshClusterCacheFile( LoadedWorldInfo->WorldName );
+    WorldConverter::LoadWorldMeshClusterCache( clusterCacheFile );
+
     // Convert world to our own format
 #ifdef BUILD_GOTHIC_2_6_fix
     WorldConverter::ConvertWorldMesh( polys, numPolygons, &WorldSections, LoadedWorldInfo.get(), &WrappedWorldMesh, indoorLocation );
@@ -657,6 +682,7 @@ void GothicAPI::OnGeometryLoaded( zCPolygon** polys, unsigned int numPolygons )
         WorldConverter::ConvertWorldMesh( polys, numPolygons, &WorldSections, LoadedWorldInfo.get(), &WrappedWorldMesh, indoorLocation );
     }
 #endif
+    WorldConverter::SaveWorldMeshClusterCache( clusterCacheFile );
     LogInfo() << "Done extracting world!";
 
 #if ENABLE_TESSELATION > 0
@@ -835,6 +861,11 @@ void GothicAPI::OnWorldLoaded() {
     // Reset wetness
     SceneWetness = GetRainFXWeight();
 
+    LogInfo() << "Texture replacement index avoided " << TextureReplacementCallsAvoided.load() << " filesystem calls so far";
+    TextureCompressor::LogStatistics();
+    MipMapGenerator::LogStatistics();
+    ResidencyManager::LogBreakdown();
+
 #ifndef PUBLIC_RELEASE
     // Enable input again, disabled it when loading started
     SetEnableGothicInput( true );
@@ -1069,6 +1100,9 @@ void GothicAPI::DrawWorldMeshNaive() {
         RendererState.RasterizerState.SetDirty();
         zCCamera::GetCamera()->Activate();
 
+        // Collect the bodies, so NPCs sharing a visual get drawn in one go
+        Engine::GraphicsEngine->BeginSkeletalMeshInstancing();
+
         for ( const auto& vobInfo : AnimatedSkeletalVobs ) {
             // Don't render if sleeping and has skeletal meshes available
             if ( !vobInfo->VisualInfo ) continue;
@@ -1097,6 +1131,26 @@ void GothicAPI::DrawWorldMeshNaive() {
             // This is important, because gothic only lerps between animation when this distance is set and below ~2000
             model->SetDistanceToCamera( dist );
 
+            // Pick the detail level by the fraction of the screen height the model covers
+            vobInfo->LODLevel = 0;
+            if ( RendererState.RendererSettings.EnableSkeletalLOD ) {
+                float radius;
+                XMStoreFloat( &radius, XMVector3Length( XMLoadFloat3( &bb.Max ) - XMLoadFloat3( &bb.Min ) ) * 0.5f );
+                float screenSize = radius * GetProjectionMatrix()._22 / std::max( dist, 1.0f );
+
+                if ( screenSize < RendererState.RendererSettings.SkeletalLOD2ScreenSize ) {
+                    vobInfo->LODLevel = 2;
+                } else if ( screenSize < RendererState.RendererSettings.SkeletalLOD1ScreenSize ) {
+                    vobInfo->LODLevel = 1;
+                }
+            }
+
+            switch ( vobInfo->LODLevel ) {
+            case 0: RendererState.RendererInfo.FrameSkeletalLOD0++; break;
+            case 1: RendererState.RendererInfo.FrameSkeletalLOD1++; break;
+            default: RendererState.RendererInfo.FrameSkeletalLOD2++; break;
+            }
+
             // Schedule for drawing in later stage if this vob is ghost
             if ( vobInfo->Vob->GetVisualAlpha() ) {
                 TransparencyVobs.emplace_back( dist, vobInfo->Vob->GetVobTransparency(), vobInfo, nullptr );
@@ -1108,6 +1162,8 @@ void GothicAPI::DrawWorldMeshNaive() {
             if( RendererState.RendererSettings.ShowSkeletalVertexNormals )
                 VNSkeletalVobs.emplace_back( vobInfo );
         }
+
+        Engine::GraphicsEngine->FlushSkeletalMeshInstances();
     }
     STOP_TIMING( GothicRendererTiming::TT_SkeletalMeshes );
 
@@ -1353,7 +1409,7 @@ void GothicAPI::OnVobMoved( zCVob* vob ) {
     auto it = VobMap.find( vob );
     if ( it != VobMap.end() ) {
         VobInfo* vi = it->second;
-        if ( checkMatrix( vob->GetWorldMatrixXM(), XMLoadFloat4x4( &vi->WorldMatrix ) ) ) {
+        if ( checkMatrix( vob->GetWorldMatrixXM(), XMLoadFloat4x4( &vi->GetWorldMatrix() ) ) ) {
             // No actual change
             return;
         }
@@ -1630,7 +1686,7 @@ void GothicAPI::OnRemovedVob( zCVob* vob, zCWorld* world ) {
             BspInfo* node = (*nodes)[i];
             if ( vi ) {
                 for ( auto bit = node->IndoorVobs.begin(); bit != node->IndoorVobs.end(); ++bit ) {
-                    if ( (*bit) == vi ) {
+                    if ( (*bit) == vi->Handle ) {
                         (*bit) = node->IndoorVobs.back();
                         node->IndoorVobs.pop_back();
                         break;
@@ -1638,7 +1694,7 @@ void GothicAPI::OnRemovedVob( zCVob* vob, zCWorld* world ) {
                 }
 
                 for ( auto bit = node->Vobs.begin(); bit != node->Vobs.end(); ++bit ) {
-                    if ( (*bit) == vi ) {
+                    if ( (*bit) == vi->Handle ) {
                         (*bit) = node->Vobs.back();
                         node->Vobs.pop_back();
                         break;
@@ -1646,7 +1702,7 @@ void GothicAPI::OnRemovedVob( zCVob* vob, zCWorld* world ) {
                 }
 
                 for ( auto bit = node->SmallVobs.begin(); bit != node->SmallVobs.end(); ++bit ) {
-                    if ( (*bit) == vi ) {
+                    if ( (*bit) == vi->Handle ) {
                         (*bit) = node->SmallVobs.back();
                         node->SmallVobs.pop_back();
                         break;
@@ -1803,6 +1859,9 @@ void GothicAPI::OnAddVob( zCVob* vob, zCWorld* world ) {
                 }
 
                 WorldConverter::Extract3DSMeshFromVisual2( pm, mi );
+                if ( RendererState.RendererSettings.EnableVertexCompression ) {
+                    WorldConverter::CompressStaticMeshVisual( mi );
+                }
                 StaticMeshVisuals[pm] = mi;
             }
 
@@ -2111,9 +2170,25 @@ void GothicAPI::DrawSkeletalMeshVob( SkeletalVobInfo* vi, float distance, bool u
 
     float fatness = model->GetModelFatness();
 
-    // Get the bone transforms
-    std::vector<XMFLOAT4X4> transforms;
-    model->GetBoneTransforms( &transforms );
+    // Get the bone transforms. They don't change within a frame, so the other passes reuse them.
+    // Models on a reduced detail level also keep their pose for a few frames.
+    const unsigned int frame = GetFrameNumber();
+    unsigned int poseInterval = 1;
+    if ( RendererState.RendererSettings.EnableSkeletalLOD && vi->LODLevel > 0 ) {
+        int interval = std::max( 1, RendererState.RendererSettings.SkeletalLODPoseInterval );
+        poseInterval = vi->LODLevel >= NUM_SKELETAL_MESH_LODS - 1 ? interval : std::max( 1, interval / 2 );
+    }
+
+    std::vector<XMFLOAT4X4>& transforms = vi->CachedBoneTransforms;
+    zCArray<zCModelNodeInst*>* nodeList = model->GetNodeList();
+    if ( transforms.empty() || !nodeList || transforms.size() != static_cast<size_t>(nodeList->NumInArray)
+        || frame - vi->BoneTransformsFrame >= poseInterval ) {
+        transforms.clear();
+        model->GetBoneTransforms( &transforms );
+        vi->BoneTransformsFrame = frame;
+    } else if ( frame != vi->BoneTransformsFrame && g->GetRenderingStage() == DES_MAIN ) {
+        RendererState.RendererInfo.FrameSkeletalPoseUpdatesSkipped++;
+    }
 
     if ( updateState ) {
         // Update attachments
@@ -2137,9 +2212,9 @@ void GothicAPI::DrawSkeletalMeshVob( SkeletalVobInfo* vi, float distance, bool u
     }
 
     if ( g->GetRenderingStage() == DES_SHADOWMAP_CUBE )
-        g->SetActiveVertexShader( "VS_ExNodeCube" );
+        g->SetActiveVertexShader( g->GetHotShaders().VS_ExNodeCube );
     else
-        g->SetActiveVertexShader( "VS_ExMode" );
+        g->SetActiveVertexShader( g->GetHotShaders().VS_ExMode );
 
     // Set up instance info
     VS_ExConstantBuffer_PerInstanceNode instanceInfo;
@@ -2208,7 +2283,7 @@ void GothicAPI::DrawSkeletalMeshVob( SkeletalVobInfo* vi, float distance, bool u
                 // Setup pixel shader here so that we get correct normals
                 // Somehow BindShaderForTexture make normals to be inversed
                 if ( g->GetRenderingStage() == DES_MAIN ) {
-                    g->SetActivePixelShader( "PS_DiffuseAlphaTest" );
+                    g->SetActivePixelShader( g->GetHotShaders().PS_DiffuseAlphaTest );
                     g->BindActivePixelShader();
                 }
 
@@ -2308,6 +2383,9 @@ void GothicAPI::DrawTransparencyVobs() {
             g->SetupVS_ExMeshDrawCall();
             TransVobInfo.normalVob->VobConstantBuffer->BindToVertexShader( 1 );
 
+            UINT vertexStride = g->ApplyStaticMeshVertexShader( static_cast<MeshVisualInfo*>(TransVobInfo.normalVob->VisualInfo),
+                g->GetActiveVS(), g->GetShaderManager().GetVShader( g->GetHotShaders().VS_ExCompressed ) );
+
             // Now actually draw mesh using transparency pixel shader
             g->SetActivePixelShader( "PS_Transparency" );
             g->BindActivePixelShader();
@@ -2330,7 +2408,7 @@ void GothicAPI::DrawTransparencyVobs() {
                     g->DrawVertexBufferIndexed(
                         meshInfo->MeshVertexBuffer,
                         meshInfo->MeshIndexBuffer,
-                        meshInfo->Indices.size() );
+                        meshInfo->Indices.size(), 0, vertexStride );
                 }
             }
         }
@@ -2642,6 +2720,12 @@ MeshInfo* GothicAPI::GetWrappedWorldMesh() {
     return WrappedWorldMesh;
 }
 
+/** Replaces the wrapped world mesh and deletes the old one */
+void GothicAPI::SetWrappedWorldMesh( MeshInfo* mesh ) {
+    delete WrappedWorldMesh;
+    WrappedWorldMesh = mesh;
+}
+
 /** Returns the loaded sections */
 std::map<int, std::map<int, WorldMeshSectionInfo>>& GothicAPI::GetWorldSections() {
     return WorldSections;
@@ -2924,6 +3008,10 @@ XMFLOAT4X4& GothicAPI::GetProjectionMatrix() {
     float zRange = FarZ / (FarZ - NearZ);
     RendererState.TransformState.TransformProj._33 = zRange;
     RendererState.TransformState.TransformProj._34 = -zRange * NearZ;
+
+    // Gothic's frustum is symmetric, so these are only ever the jitter
+    RendererState.TransformState.TransformProj._13 = ProjectionJitter.x;
+    RendererState.TransformState.TransformProj._23 = ProjectionJitter.y;
     return RendererState.TransformState.TransformProj;
 }
 
@@ -3218,7 +3306,7 @@ void GothicAPI::CollectVisibleVobs( std::vector<VobInfo*>& vobs, std::vector<Vob
             // Get distance to this vob
             XMStoreFloat( &dist, XMVector3Length( camPos - it->Vob->GetPositionWorldXM() ) );
             // Draw, if in range
-            if ( it->VisualInfo && ((dist < vobIndoorDist && it->IsIndoorVob) || (dist < vobOutdoorSmallDist && it->VisualInfo->MeshSize < vobSmallSize) || (dist < vobOutdoorDist)) ) {
+            if ( it->VisualInfo && ((dist < vobIndoorDist && it->IsIndoorVob()) || (dist < vobOutdoorSmallDist && it->VisualInfo->MeshSize < vobSmallSize) || (dist < vobOutdoorDist)) ) {
 #ifdef BUILD_GOTHIC_1_08k
                 // TODO: This is sometimes nullptr, suggesting that the Vob is invalid. Why does this happen?
                 if ( !it->VobConstantBuffer ) {
@@ -3237,13 +3325,13 @@ void GothicAPI::CollectVisibleVobs( std::vector<VobInfo*>& vobs, std::vector<Vob
                 }
 
                 VobInstanceInfo vii;
-                vii.world = it->WorldMatrix;
-                vii.color = it->GroundColor;
+                vii.world = it->GetWorldMatrix();
+                vii.color = it->GetGroundColor();
 
                 reinterpret_cast<MeshVisualInfo*>(it->VisualInfo)->Instances.push_back( vii );
 
                 vobs.push_back( it );
-                it->VisibleInRenderPass = true;
+                it->SetVisibleInRenderPass( true );
             }
         }
     }
@@ -3268,6 +3356,8 @@ void GothicAPI::CollectVisibleSections( std::vector<WorldMeshSectionInfo*>& sect
         for ( auto& itx : WorldSections ) {
             for ( auto& ity : itx.second ) {
                 WorldMeshSectionInfo& section = ity.second;
+                if ( section.StreamingState != WorldMeshSectionInfo::SS_RESIDENT )
+                    continue;
 
                 float dist = Toolbox::ComputePointAABBDistance( camPos, section.BoundingBox.Min, section.BoundingBox.Max );
                 if ( dist < sectionViewDist ) {
@@ -3289,6 +3379,8 @@ void GothicAPI::CollectVisibleSections( std::vector<WorldMeshSectionInfo*>& sect
 
             for ( auto& ity : itx.second ) {
                 WorldMeshSectionInfo& section = ity.second;
+                if ( section.StreamingState != WorldMeshSectionInfo::SS_RESIDENT )
+                    continue;
 
                 // Simple range-check
                 if ( abs( ity.first - camSection.y ) < sectionViewDist ) {
@@ -3329,24 +3421,24 @@ void GothicAPI::MoveVobFromBspToDynamic( VobInfo* vob ) {
         BspInfo* node = vob->ParentBSPNodes[i];
 
         // Remove from possible lists
-        for ( std::vector<VobInfo*>::iterator it = node->IndoorVobs.begin(); it != node->IndoorVobs.end(); ++it ) {
-            if ( (*it) == vob ) {
+        for ( std::vector<VobHandle>::iterator it = node->IndoorVobs.begin(); it != node->IndoorVobs.end(); ++it ) {
+            if ( (*it) == vob->Handle ) {
                 (*it) = node->IndoorVobs.back();
                 node->IndoorVobs.pop_back();
                 break;
             }
         }
 
-        for ( std::vector<VobInfo*>::iterator it = node->SmallVobs.begin(); it != node->SmallVobs.end(); ++it ) {
-            if ( (*it) == vob ) {
+        for ( std::vector<VobHandle>::iterator it = node->SmallVobs.begin(); it != node->SmallVobs.end(); ++it ) {
+            if ( (*it) == vob->Handle ) {
                 (*it) = node->SmallVobs.back();
                 node->SmallVobs.pop_back();
                 break;
             }
         }
 
-        for ( std::vector<VobInfo*>::iterator it = node->Vobs.begin(); it != node->Vobs.end(); ++it ) {
-            if ( (*it) == vob ) {
+        for ( std::vector<VobHandle>::iterator it = node->Vobs.begin(); it != node->Vobs.end(); ++it ) {
+            if ( (*it) == vob->Handle ) {
                 (*it) = node->Vobs.back();
                 node->Vobs.pop_back();
                 break;
@@ -3359,9 +3451,9 @@ void GothicAPI::MoveVobFromBspToDynamic( VobInfo* vob ) {
     DynamicallyAddedVobs.push_back( vob );
 }
 
-std::vector<VobInfo*>::iterator GothicAPI::MoveVobFromBspToDynamic( VobInfo* vob, std::vector<VobInfo*>* source ) {
-    std::vector<VobInfo*>::iterator itn = source->end();
-    std::vector<VobInfo*>::iterator itc;
+std::vector<VobHandle>::iterator GothicAPI::MoveVobFromBspToDynamic( VobInfo* vob, std::vector<VobHandle>* source ) {
+    std::vector<VobHandle>::iterator itn = source->end();
+    std::vector<VobHandle>::iterator itc;
 
     // Remove from all nodes
     for ( size_t i = 0; i < vob->ParentBSPNodes.size(); i++ ) {
@@ -3369,7 +3461,7 @@ std::vector<VobInfo*>::iterator GothicAPI::MoveVobFromBspToDynamic( VobInfo* vob
 
         // Remove from possible lists
         for ( auto it = node->IndoorVobs.begin(); it != node->IndoorVobs.end(); ++it ) {
-            if ( (*it) == vob ) {
+            if ( (*it) == vob->Handle ) {
                 itc = node->IndoorVobs.erase( it );
                 break;
             }
@@ -3379,7 +3471,7 @@ std::vector<VobInfo*>::iterator GothicAPI::MoveVobFromBspToDynamic( VobInfo* vob
             itn = itc;
 
         for ( auto it = node->SmallVobs.begin(); it != node->SmallVobs.end(); ++it ) {
-            if ( (*it) == vob ) {
+            if ( (*it) == vob->Handle ) {
                 itc = node->SmallVobs.erase( it );
                 break;
             }
@@ -3389,7 +3481,7 @@ std::vector<VobInfo*>::iterator GothicAPI::MoveVobFromBspToDynamic( VobInfo* vob
             itn = itc;
 
         for ( auto it = node->Vobs.begin(); it != node->Vobs.end(); ++it ) {
-            if ( (*it) == vob ) {
+            if ( (*it) == vob->Handle ) {
                 itc = node->Vobs.erase( it );
                 break;
             }
@@ -3405,14 +3497,19 @@ std::vector<VobInfo*>::iterator GothicAPI::MoveVobFromBspToDynamic( VobInfo* vob
     return itn;
 }
 
-static void CVVH_AddNotDrawnVobToList( std::vector<VobInfo*>& target, std::vector<VobInfo*>& source, float dist ) {
-    std::vector<VobInfo*> remVobs;
+static void CVVH_AddNotDrawnVobToList( std::vector<VobInfo*>& target, std::vector<VobHandle>& source, float dist ) {
+    FXMVECTOR camPos = Engine::GAPI->GetCameraPositionXM();
 
-    for ( auto const& it : source ) {
-        if ( !it->VisibleInRenderPass ) {
+    // Only the pool arrays are touched until a vob turns out to be in range
+    for ( VobHandle handle : source ) {
+        if ( !VobPool::HasFlag( handle, VobPool::F_VISIBLE_IN_RENDER_PASS ) ) {
             float vd;
-            XMStoreFloat( &vd, XMVector3Length( Engine::GAPI->GetCameraPositionXM() - XMLoadFloat3( &it->LastRenderPosition ) ) );
-            if ( vd < dist && it->Vob->GetShowVisual() ) {
+            XMStoreFloat( &vd, XMVector3Length( camPos - XMLoadFloat3( &VobPool::GetLastRenderPosition( handle ) ) ) );
+            if ( vd >= dist )
+                continue;
+
+            VobInfo* it = VobPool::GetInfo( handle );
+            if ( it->Vob->GetShowVisual() ) {
                 if ( it->Vob->GetVisualAlpha() ) {
                     Engine::GAPI->TransparencyVobs.emplace_back( vd, it->Vob->GetVobTransparency(), nullptr, it );
                     std::push_heap( Engine::GAPI->TransparencyVobs.begin(), Engine::GAPI->TransparencyVobs.end(), CompareGhostDistance );
@@ -3420,12 +3517,12 @@ static void CVVH_AddNotDrawnVobToList( std::vector<VobInfo*>& target, std::vecto
                 }
 
                 VobInstanceInfo vii;
-                vii.world = it->WorldMatrix;
-                vii.color = it->GroundColor;
+                vii.world = VobPool::GetWorldMatrix( handle );
+                vii.color = VobPool::GetGroundColor( handle );
 
                 reinterpret_cast<MeshVisualInfo*>(it->VisualInfo)->Instances.push_back( vii );
                 target.push_back( it );
-                it->VisibleInRenderPass = true;
+                VobPool::SetFlag( handle, VobPool::F_VISIBLE_IN_RENDER_PASS, true );
             }
         }
     }
@@ -3503,9 +3600,9 @@ void GothicAPI::CollectVisibleVobsHelper( BspInfo* base, zTBBox3D boxCell, int c
             bool insideFrustum = true;
 
             zCBspLeaf* leaf = static_cast<zCBspLeaf*>(base->OriginalNode);
-            std::vector<VobInfo*>& listA = base->IndoorVobs;
-            std::vector<VobInfo*>& listB = base->SmallVobs;
-            std::vector<VobInfo*>& listC = base->Vobs;
+            std::vector<VobHandle>& listA = base->IndoorVobs;
+            std::vector<VobHandle>& listB = base->SmallVobs;
+            std::vector<VobHandle>& listC = base->Vobs;
             std::vector<SkeletalVobInfo*>& listD = base->Mobs;
 
             // Concat the lists
@@ -3657,22 +3754,22 @@ void GothicAPI::BuildBspVobMapCacheHelper( zCBspBase* base ) {
                     // Treat indoor vobs as indoor vobs only in outdoor locations
                     if ( outdoorLocation && vob->IsIndoorVob() ) {
                         // Only add once
-                        if ( std::find( bvi.IndoorVobs.begin(), bvi.IndoorVobs.end(), v ) == bvi.IndoorVobs.end() ) {
+                        if ( std::find( bvi.IndoorVobs.begin(), bvi.IndoorVobs.end(), v->Handle ) == bvi.IndoorVobs.end() ) {
                             v->ParentBSPNodes.push_back( &bvi );
-                            bvi.IndoorVobs.push_back( v );
-                            v->IsIndoorVob = true;
+                            bvi.IndoorVobs.push_back( v->Handle );
+                            v->SetIndoorVob( true );
                         }
                     } else if ( v->VisualInfo->MeshSize < vobSmallSize ) {
                         // Only add once
-                        if ( std::find( bvi.SmallVobs.begin(), bvi.SmallVobs.end(), v ) == bvi.SmallVobs.end() ) {
+                        if ( std::find( bvi.SmallVobs.begin(), bvi.SmallVobs.end(), v->Handle ) == bvi.SmallVobs.end() ) {
                             v->ParentBSPNodes.push_back( &bvi );
-                            bvi.SmallVobs.push_back( v );
+                            bvi.SmallVobs.push_back( v->Handle );
                         }
                     } else {
                         // Only add once
-                        if ( std::find( bvi.Vobs.begin(), bvi.Vobs.end(), v ) == bvi.Vobs.end() ) {
+                        if ( std::find( bvi.Vobs.begin(), bvi.Vobs.end(), v->Handle ) == bvi.Vobs.end() ) {
                             v->ParentBSPNodes.push_back( &bvi );
-                            bvi.Vobs.push_back( v );
+                            bvi.Vobs.push_back( v->Handle );
                         }
                     }
                 }
@@ -3850,7 +3947,10 @@ MyDirectDrawSurface7* GothicAPI::GetSurface( const std::string& name ) {
 
 /** Removes a surface */
 void GothicAPI::RemoveSurface( MyDirectDrawSurface7* surface ) {
-    SurfacesByName.erase( surface->GetTextureName() );
+    // A reloaded texture may already have registered its new surface under the same name
+    auto it = SurfacesByName.find( surface->GetTextureName() );
+    if ( it != SurfacesByName.end() && it->second == surface )
+        SurfacesByName.erase( it );
 }
 
 /** Returns the loaded skeletal mesh vobs */
@@ -3877,7 +3977,7 @@ zCTexture* GothicAPI::GetTextureBySurface( MyDirectDrawSurface7* surface ) {
 /** Resets all vob-stats drawn this frame */
 void GothicAPI::ResetVobFrameStats( std::list<VobInfo*>& vobs ) {
     for ( auto&& it : vobs ) {
-        it->VisibleInRenderPass = false;
+        it->SetVisibleInRenderPass( false );
     }
 }
 
@@ -4182,6 +4282,9 @@ XRESULT GothicAPI::SaveMenuSettings( const std::string& file ) {
     WritePrivateProfileStringA( "General", "FogRange", std::to_string( s.FogRange ).c_str(), ini.c_str() );
     WritePrivateProfileStringA( "General", "EnableHDR", std::to_string( s.EnableHDR ? TRUE : FALSE ).c_str(), ini.c_str() );
     WritePrivateProfileStringA( "General", "HDRToneMap", std::to_string( s.HDRToneMap ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "General", "BloomQuality", std::to_string( s.BloomQuality ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "General", "PostFXFusion", std::to_string( s.PostFXFusion ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "General", "EnableColorGrading", std::to_string( s.EnableColorGrading ? TRUE : FALSE ).c_str(), ini.c_str() );
     WritePrivateProfileStringA( "General", "EnableDebugLog", std::to_string( s.EnableDebugLog ? TRUE : FALSE ).c_str(), ini.c_str() );
     WritePrivateProfileStringA( "General", "EnableAutoupdates", std::to_string( s.EnableAutoupdates ? TRUE : FALSE ).c_str(), ini.c_str() );
     WritePrivateProfileStringA( "General", "EnableGodRays", std::to_string( s.EnableGodRays ? TRUE : FALSE ).c_str(), ini.c_str() );
@@ -4201,6 +4304,21 @@ XRESULT GothicAPI::SaveMenuSettings( const std::string& file ) {
 
     WritePrivateProfileStringA( "General", "EnableOcclusionCulling", std::to_string( s.EnableOcclusionCulling ).c_str(), ini.c_str() );
     WritePrivateProfileStringA( "General", "FpsLimit", std::to_string( s.FpsLimit ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "General", "EnableSkeletalLOD", std::to_string( s.EnableSkeletalLOD ? TRUE : FALSE ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "General", "SkeletalLOD1ScreenSize", std::to_string( s.SkeletalLOD1ScreenSize ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "General", "SkeletalLOD2ScreenSize", std::to_string( s.SkeletalLOD2ScreenSize ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "General", "SkeletalLODPoseInterval", std::to_string( s.SkeletalLODPoseInterval ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "General", "EnableVertexCompression", std::to_string( s.EnableVertexCompression ? TRUE : FALSE ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "General", "EnableWorldMeshClusterCulling", std::to_string( s.EnableWorldMeshClusterCulling ? TRUE : FALSE ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "General", "EnableConstantBufferRing", std::to_string( s.EnableConstantBufferRing ? TRUE : FALSE ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "General", "EnableHUDBatching", std::to_string( s.EnableHUDBatching ? TRUE : FALSE ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "General", "EnableTextureCompression", std::to_string( s.EnableTextureCompression ? TRUE : FALSE ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "General", "EnableCPUMipMapGeneration", std::to_string( s.EnableCPUMipMapGeneration ? TRUE : FALSE ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "General", "MipMapFilter", std::to_string( s.MipMapFilter ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "General", "VideoMemoryBudgetMB", std::to_string( s.VideoMemoryBudgetMB ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "General", "EnableWorldSectionStreaming", std::to_string( s.EnableWorldSectionStreaming ? TRUE : FALSE ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "General", "SectionStreamingRadius", std::to_string( s.SectionStreamingRadius ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "General", "SectionStreamingHysteresis", std::to_string( s.SectionStreamingHysteresis ).c_str(), ini.c_str() );
     
     auto res = Engine::GraphicsEngine->GetResolution();
     WritePrivateProfileStringA( "Display", "TextureQuality", std::to_string( s.textureMaxSize ).c_str(), ini.c_str() );
@@ -4226,6 +4344,9 @@ XRESULT GothicAPI::SaveMenuSettings( const std::string& file ) {
     WritePrivateProfileStringA( "Shadows", "EnableSoftShadows", std::to_string( s.EnableSoftShadows ? TRUE : FALSE ).c_str(), ini.c_str() );
     WritePrivateProfileStringA( "Shadows", "ShadowMapSize", std::to_string( s.ShadowMapSize ).c_str(), ini.c_str() );
     WritePrivateProfileStringA( "Shadows", "WorldShadowRangeScale", std::to_string( s.WorldShadowRangeScale ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "Shadows", "NumShadowCascades", std::to_string( s.NumShadowCascades ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "Shadows", "ShadowCascadeSplitLambda", std::to_string( s.ShadowCascadeSplitLambda ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "Shadows", "ShadowCascadeAlternateUpdates", std::to_string( s.ShadowCascadeAlternateUpdates ? TRUE : FALSE ).c_str(), ini.c_str() );
     WritePrivateProfileStringA( "Shadows", "PointlightShadows", std::to_string( s.EnablePointlightShadows ).c_str(), ini.c_str() );
     WritePrivateProfileStringA( "Shadows", "EnableDynamicLighting", std::to_string( s.EnableDynamicLighting ? TRUE : FALSE ).c_str(), ini.c_str() );
     WritePrivateProfileStringA( "Shadows", "SmoothCameraUpdate", std::to_string( s.SmoothShadowCameraUpdate ? TRUE : FALSE ).c_str(), ini.c_str() );
@@ -4235,6 +4356,8 @@ XRESULT GothicAPI::SaveMenuSettings( const std::string& file ) {
 
     WritePrivateProfileStringA( "SMAA", "Enabled", std::to_string( s.EnableSMAA ? TRUE : FALSE ).c_str(), ini.c_str() );
     WritePrivateProfileStringA( "SMAA", "SharpenFactor", std::to_string( s.SharpenFactor ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "SMAA", "Predication", std::to_string( s.SMAAPredication ? TRUE : FALSE ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "SMAA", "T2x", std::to_string( s.EnableSMAAT2x ? TRUE : FALSE ).c_str(), ini.c_str() );
 
     WritePrivateProfileStringA( "HBAO", "Enabled", std::to_string( s.HbaoSettings.Enabled ? TRUE : FALSE ).c_str(), ini.c_str() );
     WritePrivateProfileStringA( "HBAO", "Bias", std::to_string( s.HbaoSettings.Bias ).c_str(), ini.c_str() );
@@ -4243,8 +4366,8 @@ XRESULT GothicAPI::SaveMenuSettings( const std::string& file ) {
     WritePrivateProfileStringA( "HBAO", "BlurSharpness", std::to_string( s.HbaoSettings.BlurSharpness ).c_str(), ini.c_str() );
     //WritePrivateProfileStringA( "HBAO", "EnableDualLayerAO", std::to_string( s.HbaoSettings.EnableDualLayerAO ).c_str(), ini.c_str() );
     WritePrivateProfileStringA( "HBAO", "EnableBlur", std::to_string( s.HbaoSettings.EnableBlur ).c_str(), ini.c_str() );
-    WritePrivateProfileStringA( "HBAO", "SsaoBlurRadius", std::to_string( s.HbaoSettings.SsaoBlurRadius ).c_str(), ini.c_str() );
-    WritePrivateProfileStringA( "HBAO", "SsaoStepCount", std::to_string( s.HbaoSettings.SsaoStepCount ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "HBAO", "EnableTemporal", std::to_string( s.HbaoSettings.EnableTemporal ? TRUE : FALSE ).c_str(), ini.c_str() );
+    WritePrivateProfileStringA( "HBAO", "QualityTier", std::to_string( s.HbaoSettings.QualityTier ).c_str(), ini.c_str() );
 
 #if ENABLE_TESSELATION > 0
     WritePrivateProfileStringA( "Tesselation", "EnableTesselation", std::to_string( s.EnableTesselation ? TRUE : FALSE ).c_str(), ini.c_str() );
@@ -4253,6 +4376,10 @@ XRESULT GothicAPI::SaveMenuSettings( const std::string& file ) {
 
     WritePrivateProfileStringA( "FontRendering", "Enable", std::to_string( s.EnableCustomFontRendering ? TRUE : FALSE ).c_str(), ini.c_str() );
 
+    for ( int i = 0; i < LC_NUM_CHANNELS; i++ ) {
+        WritePrivateProfileStringA( "Logging", LogChannelNames[i], std::to_string( LogChannelLevels[i] ).c_str(), ini.c_str() );
+    }
+
     return XR_SUCCESS;
 }
 
@@ -4277,6 +4404,9 @@ XRESULT GothicAPI::LoadMenuSettings( const std::string& file ) {
         s.AtmosphericScattering = GetPrivateProfileBoolA( "General", "AtmosphericScattering", true, ini );
         s.EnableHDR = GetPrivateProfileBoolA( "General", "EnableHDR", false, ini );
         s.HDRToneMap = GothicRendererSettings::E_HDRToneMap( GetPrivateProfileIntA( "General", "HDRToneMap", 4, ini.c_str() ) );
+        s.BloomQuality = GetPrivateProfileIntA( "General", "BloomQuality", defaultRendererSettings.BloomQuality, ini.c_str() );
+        s.PostFXFusion = GetPrivateProfileIntA( "General", "PostFXFusion", defaultRendererSettings.PostFXFusion, ini.c_str() );
+        s.EnableColorGrading = GetPrivateProfileBoolA( "General", "EnableColorGrading", defaultRendererSettings.EnableColorGrading, ini );
         s.EnableDebugLog = GetPrivateProfileBoolA( "General", "EnableDebugLog", defaultRendererSettings.EnableDebugLog, ini );
         s.EnableAutoupdates = GetPrivateProfileBoolA( "General", "EnableAutoupdates", defaultRendererSettings.EnableAutoupdates, ini );
         s.EnableGodRays = GetPrivateProfileBoolA( "General", "EnableGodRays", defaultRendererSettings.EnableGodRays, ini );
@@ -4296,6 +4426,21 @@ XRESULT GothicAPI::LoadMenuSettings( const std::string& file ) {
 
         s.EnableOcclusionCulling = GetPrivateProfileBoolA( "General", "EnableOcclusionCulling", defaultRendererSettings.EnableOcclusionCulling, ini );
         s.FpsLimit = GetPrivateProfileIntA( "General", "FpsLimit", 0, ini.c_str() );
+        s.EnableSkeletalLOD = GetPrivateProfileBoolA( "General", "EnableSkeletalLOD", defaultRendererSettings.EnableSkeletalLOD, ini );
+        s.SkeletalLOD1ScreenSize = GetPrivateProfileFloatA( "General", "SkeletalLOD1ScreenSize", defaultRendererSettings.SkeletalLOD1ScreenSize, ini );
+        s.SkeletalLOD2ScreenSize = GetPrivateProfileFloatA( "General", "SkeletalLOD2ScreenSize", defaultRendererSettings.SkeletalLOD2ScreenSize, ini );
+        s.SkeletalLODPoseInterval = GetPrivateProfileIntA( "General", "SkeletalLODPoseInterval", defaultRendererSettings.SkeletalLODPoseInterval, ini.c_str() );
+        s.EnableVertexCompression = GetPrivateProfileBoolA( "General", "EnableVertexCompression", defaultRendererSettings.EnableVertexCompression, ini );
+        s.EnableWorldMeshClusterCulling = GetPrivateProfileBoolA( "General", "EnableWorldMeshClusterCulling", defaultRendererSettings.EnableWorldMeshClusterCulling, ini );
+        s.EnableConstantBufferRing = GetPrivateProfileBoolA( "General", "EnableConstantBufferRing", defaultRendererSettings.EnableConstantBufferRing, ini );
+        s.EnableHUDBatching = GetPrivateProfileBoolA( "General", "EnableHUDBatching", defaultRendererSettings.EnableHUDBatching, ini );
+        s.EnableTextureCompression = GetPrivateProfileBoolA( "General", "EnableTextureCompression", defaultRendererSettings.EnableTextureCompression, ini );
+        s.EnableCPUMipMapGeneration = GetPrivateProfileBoolA( "General", "EnableCPUMipMapGeneration", defaultRendererSettings.EnableCPUMipMapGeneration, ini );
+        s.MipMapFilter = GetPrivateProfileIntA( "General", "MipMapFilter", defaultRendererSettings.MipMapFilter, ini.c_str() );
+        s.VideoMemoryBudgetMB = GetPrivateProfileIntA( "General", "VideoMemoryBudgetMB", defaultRendererSettings.VideoMemoryBudgetMB, ini.c_str() );
+        s.EnableWorldSectionStreaming = GetPrivateProfileBoolA( "General", "EnableWorldSectionStreaming", defaultRendererSettings.EnableWorldSectionStreaming, ini );
+        s.SectionStreamingRadius = GetPrivateProfileIntA( "General", "SectionStreamingRadius", defaultRendererSettings.SectionStreamingRadius, ini.c_str() );
+        s.SectionStreamingHysteresis = GetPrivateProfileIntA( "General", "SectionStreamingHysteresis", defaultRendererSettings.SectionStreamingHysteresis, ini.c_str() );
 
         // override INI settings with GMP minimum values.
         if ( GMPModeActive ) {
@@ -4312,6 +4457,9 @@ XRESULT GothicAPI::LoadMenuSettings( const std::string& file ) {
         s.ShadowMapSize = GetPrivateProfileIntA( "Shadows", "ShadowMapSize", defaultRendererSettings.ShadowMapSize, ini.c_str() );
         s.EnablePointlightShadows = GothicRendererSettings::EPointLightShadowMode( GetPrivateProfileIntA( "Shadows", "PointlightShadows", GothicRendererSettings::EPointLightShadowMode::PLS_STATIC_ONLY, ini.c_str() ) );
         s.WorldShadowRangeScale = GetPrivateProfileFloatA( "Shadows", "WorldShadowRangeScale", 1.0f, ini );
+        s.NumShadowCascades = GetPrivateProfileIntA( "Shadows", "NumShadowCascades", defaultRendererSettings.NumShadowCascades, ini.c_str() );
+        s.ShadowCascadeSplitLambda = GetPrivateProfileFloatA( "Shadows", "ShadowCascadeSplitLambda", defaultRendererSettings.ShadowCascadeSplitLambda, ini );
+        s.ShadowCascadeAlternateUpdates = GetPrivateProfileBoolA( "Shadows", "ShadowCascadeAlternateUpdates", defaultRendererSettings.ShadowCascadeAlternateUpdates, ini );
         s.EnableDynamicLighting = GetPrivateProfileBoolA( "Shadows", "EnableDynamicLighting", defaultRendererSettings.EnableDynamicLighting, ini );
         s.SmoothShadowCameraUpdate = GetPrivateProfileBoolA( "Shadows", "SmoothCameraUpdate", defaultRendererSettings.SmoothShadowCameraUpdate, ini );
         s.ShadowStrength = GetPrivateProfileFloatA( "Shadows", "ShadowStrength", defaultRendererSettings.ShadowStrength, ini );
@@ -4341,6 +4489,8 @@ XRESULT GothicAPI::LoadMenuSettings( const std::string& file ) {
 
         s.EnableSMAA = GetPrivateProfileBoolA( "SMAA", "Enabled", false, ini );
         s.SharpenFactor = GetPrivateProfileFloatA( "SMAA", "SharpenFactor", 0.30f, ini );
+        s.SMAAPredication = GetPrivateProfileBoolA( "SMAA", "Predication", true, ini );
+        s.EnableSMAAT2x = GetPrivateProfileBoolA( "SMAA", "T2x", false, ini );
 
     #if ENABLE_TESSELATION > 0
         s.AllowWorldMeshTesselation = GetPrivateProfileBoolA( "Tesselation", "AllowWorldMeshTesselation", false, ini );
@@ -4355,11 +4505,16 @@ XRESULT GothicAPI::LoadMenuSettings( const std::string& file ) {
         s.HbaoSettings.BlurSharpness = GetPrivateProfileFloatA( "HBAO", "BlurSharpness", defaultHBAOSettings.BlurSharpness, ini );
         //s.HbaoSettings.EnableDualLayerAO = GetPrivateProfileIntA( "HBAO", "EnableDualLayerAO", defaultHBAOSettings.EnableDualLayerAO, ini.c_str() );
         s.HbaoSettings.EnableBlur = GetPrivateProfileBoolA( "HBAO", "EnableBlur", defaultHBAOSettings.EnableBlur, ini );
-        s.HbaoSettings.SsaoBlurRadius = GetPrivateProfileIntA( "HBAO", "SsaoBlurRadius", defaultHBAOSettings.SsaoBlurRadius, ini.c_str() );
-        s.HbaoSettings.SsaoStepCount = GetPrivateProfileIntA( "HBAO", "SsaoStepCount", defaultHBAOSettings.SsaoStepCount, ini.c_str() );
+        s.HbaoSettings.EnableTemporal = GetPrivateProfileBoolA( "HBAO", "EnableTemporal", defaultHBAOSettings.EnableTemporal, ini );
+        s.HbaoSettings.QualityTier = GetPrivateProfileIntA( "HBAO", "QualityTier", defaultHBAOSettings.QualityTier, ini.c_str() );
 
         s.EnableCustomFontRendering = GetPrivateProfileBoolA( "FontRendering", "Enable", defaultRendererSettings.EnableCustomFontRendering, ini );
 
+        // 0 = Info, 1 = Warning, 2 = Error, 3 = Nothing
+        for ( int i = 0; i < LC_NUM_CHANNELS; i++ ) {
+            LogChannelLevels[i] = std::clamp<int>( GetPrivateProfileIntA( "Logging", LogChannelNames[i], LL_INFO, ini.c_str() ), LL_INFO, LL_NONE );
+        }
+
         // Fix the shadow range
         s.WorldShadowRangeScale = Toolbox::GetRecommendedWorldShadowRangeScaleForSize( s.ShadowMapSize );
 
@@ -4659,11 +4814,125 @@ void GothicAPI::ReloadTextures() {
 
     LogInfo() << "Reloading textures...";
 
+    // Pick up normalmaps which were added in the meantime
+    BuildTextureReplacementIndex();
+
     // This throws all texture out of the cache
     if ( resman )
         resman->PurgeCaches( 0 );
 }
 
+/** Returns the replacement folders in the order they are searched in */
+std::vector<std::string> GothicAPI::GetTextureReplacementFolders() {
+    const std::string replacementsFolder = "system\\GD3D11\\textures\\replacements\\Normalmaps_";
+
+    // Normalmaps_0, Normalmaps_1, ..., then the one of the game
+    std::vector<std::string> folders;
+    while ( Toolbox::FolderExists( replacementsFolder + std::to_string( folders.size() ) ) ) {
+        folders.push_back( replacementsFolder + std::to_string( folders.size() ) );
+    }
+    folders.push_back( replacementsFolder + GetGameName() );
+    return folders;
+}
+
+/** Packs every replacement folder into a texture archive next to it */
+void GothicAPI::PackTextureReplacementFolders() {
+    for ( const std::string& folder : GetTextureReplacementFolders() ) {
+        if ( Toolbox::FolderExists( folder ) ) {
+            TextureArchive::Pack( folder, folder + TextureArchive::GetFileExtension() );
+        }
+    }
+}
+
+/** Scans the replacement folders once, so textures don't have to probe the disk for their normal- and fx-maps */
+void GothicAPI::BuildTextureReplacementIndex() {
+    std::vector<std::string> folders = GetTextureReplacementFolders();
+    unsigned int numNumberedFolders = folders.size() - 1;
+
+    std::unordered_map<std::string, TextureReplacementInfo> replacements;
+    std::vector<std::shared_ptr<TextureArchive>> archives( folders.size() );
+    const std::string normalSuffix = "_NORMAL.DDS";
+    const std::string fxSuffix = "_FX.DDS";
+    unsigned int numNormalmaps = 0;
+    unsigned int numFxMaps = 0;
+    unsigned int numArchivedMaps = 0;
+    for ( size_t i = 0; i < folders.size(); i++ ) {
+        const std::string& folder = folders[i];
+
+        std::string archiveFile = folder + TextureArchive::GetFileExtension();
+        if ( Toolbox::FileExists( archiveFile ) ) {
+            auto archive = std::make_shared<TextureArchive>();
+            if ( XR_SUCCESS == archive->Open( archiveFile ) ) {
+                numArchivedMaps += archive->GetNumFiles();
+                archives[i] = std::move( archive );
+            }
+        }
+
+        std::error_code ec;
+        for ( auto it = std::filesystem::directory_iterator( folder, ec ); !ec && it != std::filesystem::directory_iterator(); it.increment( ec ) ) {
+            std::string file = it->path().filename().string();
+            std::string upper = file;
+            std::transform( upper.begin(), upper.end(), upper.begin(), ::toupper );
+
+            // Folders probed first take priority, so only fill what is still empty
+            if ( upper.size() > normalSuffix.size() && upper.compare( upper.size() - normalSuffix.size(), normalSuffix.size(), normalSuffix ) == 0 ) {
+                TextureReplacementSource& source = replacements[upper.substr( 0, upper.size() - normalSuffix.size() )].Normalmap;
+                if ( source.File.empty() ) {
+                    source.File = folder + "\\" + file;
+                    source.Folder = i;
+                    numNormalmaps++;
+                }
+            } else if ( upper.size() > fxSuffix.size() && upper.compare( upper.size() - fxSuffix.size(), fxSuffix.size(), fxSuffix ) == 0 ) {
+                TextureReplacementSource& source = replacements[upper.substr( 0, upper.size() - fxSuffix.size() )].FxMap;
+                if ( source.File.empty() ) {
+                    source.File = folder + "\\" + file;
+                    source.Folder = i;
+                    numFxMaps++;
+                }
+            }
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock( TextureReplacementMutex );
+        TextureReplacements = std::move( replacements );
+        TextureArchives = std::move( archives );
+
+        // Per map type: one FolderExists for every numbered folder plus the missing one, one FileExists per folder
+        TextureReplacementProbeCost = 2 * ((numNumberedFolders + 1) + (numNumberedFolders + 1));
+    }
+
+    LogInfo() << "Indexed " << numNormalmaps << " normalmaps, " << numFxMaps << " fx-maps and " << numArchivedMaps << " archived maps in " << folders.size() << " replacement folders";
+}
+
+/** Looks up the replacement maps of the given texture. Returns false if it has none. */
+bool GothicAPI::GetTextureReplacement( const std::string& textureName, TextureReplacementInfo& outInfo ) {
+    std::string key = textureName;
+    std::transform( key.begin(), key.end(), key.begin(), ::toupper );
+
+    std::unique_lock<std::mutex> lock( TextureReplacementMutex );
+    TextureReplacementCallsAvoided += TextureReplacementProbeCost;
+
+    auto it = TextureReplacements.find( key );
+    outInfo = it != TextureReplacements.end() ? it->second : TextureReplacementInfo();
+
+    // An archive wins over loose files of its own and all later folders
+    auto findArchived = [&]( TextureReplacementSource& source, const std::string& name ) {
+        for ( size_t i = 0; i < TextureArchives.size() && static_cast<int>(i) <= source.Folder; i++ ) {
+            if ( TextureArchives[i] && TextureArchives[i]->FindFile( name, &source.ArchiveEntry ) ) {
+                source.Archive = TextureArchives[i];
+                source.File = name;
+                source.Folder = i;
+                return;
+            }
+        }
+    };
+    findArchived( outInfo.Normalmap, key + "_NORMAL" );
+    findArchived( outInfo.FxMap, key + "_FX" );
+
+    return outInfo.Normalmap.IsValid() || outInfo.FxMap.IsValid();
+}
+
 /** Gets the int-param from the ini. String must be UPPERCASE. */
 int GothicAPI::GetIntParamFromConfig( const std::string& param ) {
     return ConfigIntValues[param];
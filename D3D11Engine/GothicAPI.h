@@ -5,6 +5,8 @@
 #include "zCTree.h"
 #include "zCPolyStrip.h"
 #include "zTypes.h"
+#include <atomic>
+#include <mutex>
 
 #define START_TIMING Engine::GAPI->GetRendererState().RendererInfo.Timing.Start
 #define STOP_TIMING Engine::GAPI->GetRendererState().RendererInfo.Timing.Stop
@@ -41,9 +43,9 @@ struct BspInfo {
         return Vobs.empty() && IndoorVobs.empty() && SmallVobs.empty() && Lights.empty() && IndoorLights.empty();
     }
 
-    std::vector<VobInfo*> Vobs;
-    std::vector<VobInfo*> IndoorVobs;
-    std::vector<VobInfo*> SmallVobs;
+    std::vector<VobHandle> Vobs;
+    std::vector<VobHandle> IndoorVobs;
+    std::vector<VobHandle> SmallVobs;
     std::vector<VobLightInfo*> Lights;
     std::vector<VobLightInfo*> IndoorLights;
     std::vector<SkeletalVobInfo*> Mobs;
@@ -179,8 +181,30 @@ struct TransparencyVobInfo {
     VobInfo* normalVob;
 };
 
+class TextureArchive;
+
+/** Where a replacement map comes from: a loose file or data inside a mapped texture archive */
+struct TextureReplacementSource {
+    bool IsValid() const { return Archive || !File.empty(); }
+
+    std::string File;
+
+    /** Set if the map is stored in an archive, which is kept open while this exists */
+    std::shared_ptr<TextureArchive> Archive;
+    unsigned int ArchiveEntry = 0;
+
+    /** Replacement folder the map was found in, lower ones take priority */
+    int Folder = INT_MAX;
+};
+
+/** Normal- and fx-map replacing a texture */
+struct TextureReplacementInfo {
+    TextureReplacementSource Normalmap;
+    TextureReplacementSource FxMap;
+};
+
 class GothicAPI {
-    friend void CVVH_AddNotDrawnVobToList( std::vector<VobInfo*>& target, std::vector<VobInfo*>& source, float dist );
+    friend void CVVH_AddNotDrawnVobToList( std::vector<VobInfo*>& target, std::vector<VobHandle>& source, float dist );
     friend void CVVH_AddNotDrawnVobToList( std::vector<VobLightInfo*>& target, std::vector<VobLightInfo*>& source, float dist );
     friend void CVVH_AddNotDrawnVobToList( std::vector<SkeletalVobInfo*>& target, std::vector<SkeletalVobInfo*>& source, float dist );
 
@@ -375,6 +399,9 @@ public:
     /** Returns the wrapped world mesh */
     MeshInfo* GetWrappedWorldMesh();
 
+    /** Replaces the wrapped world mesh and deletes the old one */
+    void SetWrappedWorldMesh( MeshInfo* mesh );
+
     /** Returns the loaded skeletal mesh vobs */
     std::list<SkeletalVobInfo*>& GetSkeletalMeshVobs();
     std::list<SkeletalVobInfo*>& GetAnimatedSkeletalMeshVobs();
@@ -393,6 +420,10 @@ public:
     /** Returns the projection-matrix */
     XMFLOAT4X4& GetProjectionMatrix();
 
+    /** Offsets the projection of the main camera by the given amount in NDC, for temporal antialiasing */
+    void SetProjectionJitter( const XMFLOAT2& jitter ) { ProjectionJitter = jitter; }
+    const XMFLOAT2& GetProjectionJitter() const { return ProjectionJitter; }
+
     /** Unprojects a pixel-position on the screen */
     void XM_CALLCONV UnprojectXM( FXMVECTOR p, XMVECTOR& worldPos, XMVECTOR& worldDir );
 
@@ -450,6 +481,9 @@ public:
     /** Returns the current frame time */
     float GetFrameTimeSec();
 
+    /** Returns the number of frames rendered so far */
+    unsigned int GetFrameNumber() const { return FrameNumber; }
+
     /** Returns global time */
     float GetTimeSeconds();
 
@@ -472,7 +506,7 @@ public:
     void MoveVobFromBspToDynamic( VobInfo* vob );
     void MoveVobFromBspToDynamic( SkeletalVobInfo* vob );
 
-    std::vector<VobInfo*>::iterator MoveVobFromBspToDynamic( VobInfo* vob, std::vector<VobInfo*>* source );
+    std::vector<VobHandle>::iterator MoveVobFromBspToDynamic( VobInfo* vob, std::vector<VobHandle>* source );
 
     /** Collects vobs using gothics BSP-Tree */
     void CollectVisibleVobs( std::vector<VobInfo*>& vobs, std::vector<VobLightInfo*>& lights, std::vector<SkeletalVobInfo*>& mobs );
@@ -500,6 +534,15 @@ public:
     /** Reloads all textures */
     void ReloadTextures();
 
+    /** Scans the replacement folders once, so textures don't have to probe the disk for their normal- and fx-maps */
+    void BuildTextureReplacementIndex();
+
+    /** Packs every replacement folder into a texture archive next to it */
+    void PackTextureReplacementFolders();
+
+    /** Looks up the replacement maps of the given texture. Returns false if it has none. */
+    bool GetTextureReplacement( const std::string& textureName, TextureReplacementInfo& outInfo );
+
     /** Returns true if the given string can be found in the commandline */
     bool HasCommandlineParameter( const std::string& param );
 
@@ -696,6 +739,9 @@ public:
     float GetSkyTimeScale();
 
 private:
+    /** Returns the replacement folders in the order they are searched in */
+    std::vector<std::string> GetTextureReplacementFolders();
+
     /** Collects polygons in the given AABB */
     void CollectPolygonsInAABBRec( BspInfo* base, const zTBBox3D& bbox, std::vector<zCPolygon*>& list );
 
@@ -796,6 +842,17 @@ private:
     /** Map of textures */
     std::unordered_map<std::string, MyDirectDrawSurface7*> SurfacesByName;
 
+    /** Replacement maps by uppercase texture name. Looked up from the loading threads, too. */
+    std::unordered_map<std::string, TextureReplacementInfo> TextureReplacements;
+    std::mutex TextureReplacementMutex;
+
+    /** Archives of the replacement folders, by folder. Preferred over loose files. */
+    std::vector<std::shared_ptr<TextureArchive>> TextureArchives;
+
+    /** Filesystem calls a lookup would have needed without the index */
+    unsigned int TextureReplacementProbeCost;
+    std::atomic<unsigned int> TextureReplacementCallsAvoided;
+
     /** Directory we started in */
     std::string StartDirectory;
 
@@ -818,6 +875,9 @@ private:
     /** Replacement values for the camera */
     CameraReplacement* CameraReplacementPtr;
 
+    /** Subpixel offset of the main camera, in NDC */
+    XMFLOAT2 ProjectionJitter;
+
     /** List of available GVegetationBoxes */
     std::list<GVegetationBox*> VegetationBoxes;
 
@@ -850,6 +910,9 @@ private:
     /** The overall wetness of the current scene */
     float SceneWetness;
 
+    /** Number of frames rendered so far */
+    unsigned int FrameNumber;
+
     /** Internal list of futures, so they can run until they are finished */
     std::vector<std::future<void>> FutureList;
 
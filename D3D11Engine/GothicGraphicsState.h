@@ -479,8 +479,8 @@ struct HBAOSettings {
         Enabled = true;
         EnableDualLayerAO = false;
         EnableBlur = true;
-        SsaoBlurRadius = 1; // GFSDK_SSAO_BlurRadius::GFSDK_SSAO_BLUR_RADIUS_4;
-        SsaoStepCount = 0; // GFSDK_SSAO_StepCount::GFSDK_SSAO_STEP_COUNT_4;
+        EnableTemporal = true;
+        QualityTier = 1; // HBAOKernel::QT_MEDIUM
     }
 
     float Bias;
@@ -491,9 +491,15 @@ struct HBAOSettings {
     int BlendMode;
     bool Enabled;
     bool EnableDualLayerAO;
+
+    /** Widens the upsampling filter over the whole interleaved pattern */
     bool EnableBlur;
-    int SsaoBlurRadius;
-    int SsaoStepCount;
+
+    /** Accumulates the AO over the last frames, so fewer samples per frame are needed */
+    bool EnableTemporal;
+
+    /** HBAOKernel::EQualityTier, resolution and sample count */
+    int QualityTier;
 };
 
 struct GothicRendererSettings {
@@ -522,6 +528,7 @@ struct GothicRendererSettings {
         DrawVOBs = true;
         DrawWorldMesh = 3;
         DrawSkeletalMeshes = true;
+        EnableSkeletalMeshInstancing = true;
         DrawMobs = true;
         DrawDynamicVOBs = true;
 
@@ -545,6 +552,21 @@ struct GothicRendererSettings {
         IndoorVobDrawRadius = 5000.0f;
         OutdoorVobDrawRadius = 30000.0f;
         SkeletalMeshDrawRadius = 6000.0f;
+        EnableSkeletalLOD = true;
+        SkeletalLOD1ScreenSize = 0.2f;
+        SkeletalLOD2ScreenSize = 0.08f;
+        SkeletalLODPoseInterval = 4;
+        EnableVertexCompression = true;
+        EnableWorldMeshClusterCulling = true;
+        EnableConstantBufferRing = true;
+        EnableHUDBatching = true;
+        EnableTextureCompression = false;
+        EnableCPUMipMapGeneration = true;
+        MipMapFilter = 1;
+        VideoMemoryBudgetMB = 0;
+        EnableWorldSectionStreaming = false;
+        SectionStreamingRadius = 6;
+        SectionStreamingHysteresis = 1;
         VisualFXDrawRadius = 10000.0f;
 
 #if BUILD_SPACER_NET
@@ -573,6 +595,8 @@ struct GothicRendererSettings {
 
         HDRLumWhite = 11.2f;
         HDRMiddleGray = 0.8f;
+        HDRLumLowPercentile = 0.1f;
+        HDRLumHighPercentile = 0.95f;
         BloomThreshold = 0.9f;
 
         WireframeVobs = false;
@@ -589,6 +613,9 @@ struct GothicRendererSettings {
         EnableEditorPanel = false;
 #endif
         EnableSMAA = true;
+        SMAAPredication = true;
+        EnableSMAAT2x = false;
+        LogSMAAStats = false;
 
         TesselationFactor = 20.0f;
         TesselationRange = 8.0f;
@@ -596,12 +623,18 @@ struct GothicRendererSettings {
         textureMaxSize = 16384;
         ShadowMapSize = 2048;
         WorldShadowRangeScale = 8.0f;
+        NumShadowCascades = 4;
+        ShadowCascadeSplitLambda = 0.75f;
+        ShadowCascadeAlternateUpdates = true;
 
         ShadowStrength = 0.40f;
         ShadowAOStrength = 0.50f;
         WorldAOStrength = 0.50f;
 
         BloomStrength = 1.0f;
+        BloomQuality = 2;
+        PostFXFusion = 0;
+        EnableColorGrading = false;
         GlobalWindStrength = 1.0f;
         VegetationAlphaToCoverage = true;
 
@@ -763,6 +796,7 @@ struct GothicRendererSettings {
     bool DrawDynamicVOBs;
     int DrawWorldMesh;
     bool DrawSkeletalMeshes;
+    bool EnableSkeletalMeshInstancing;
     bool DrawMobs;
     bool DrawParticleEffects;
     bool DrawSky;
@@ -773,6 +807,15 @@ struct GothicRendererSettings {
     E_HDRToneMap HDRToneMap;
     bool EnableVSync;
     bool EnableSMAA;
+
+    /** Lowers the SMAA threshold on depth edges and raises it elsewhere */
+    bool SMAAPredication;
+
+    /** SMAA T2x, jitters the camera and blends with the reprojected last frame */
+    bool EnableSMAAT2x;
+
+    /** Times the SMAA passes with GPU queries and writes the averages to the PostFX log channel */
+    bool LogSMAAStats;
 #if ENABLE_TESSELATION > 0
     bool EnableTesselation;
     bool AllowWorldMeshTesselation;
@@ -811,6 +854,47 @@ struct GothicRendererSettings {
     float IndoorVobDrawRadius;
     float OutdoorVobDrawRadius;
     float SkeletalMeshDrawRadius;
+
+    /** Skeletal LOD. The screensizes are the fraction of the screen height a model
+        has to cover to stay on the finer level. The interval is the number of frames
+        between pose updates on the coarsest level. */
+    bool EnableSkeletalLOD;
+    float SkeletalLOD1ScreenSize;
+    float SkeletalLOD2ScreenSize;
+    int SkeletalLODPoseInterval;
+
+    /** Stores static vob meshes as ExVertexStructCompressed. Only applies to visuals loaded afterwards. */
+    bool EnableVertexCompression;
+
+    /** Culls the triangle clusters of world meshes by frustum, normal cone and distance */
+    bool EnableWorldMeshClusterCulling;
+
+    /** Suballocates constantbuffer updates from a per-frame ring instead of mapping every buffer */
+    bool EnableConstantBufferRing;
+
+    /** Merges consecutive HUD draws with the same texture and states into one drawcall */
+    bool EnableHUDBatching;
+
+    /** Block compresses 16-bit game textures on load. Saves video memory at a small loss of quality. */
+    bool EnableTextureCompression;
+
+    /** Generates the mips of 16-bit game textures on the loading threads instead of the GPU */
+    bool EnableCPUMipMapGeneration;
+
+    /** Filter for CPU generated mips. 0 = Box, 1 = Kaiser */
+    int MipMapFilter;
+
+    /** Textures lose their top mips when the renderer uses more video memory than this. 0 = most of the adapter memory */
+    int VideoMemoryBudgetMB;
+
+    /** Only keeps the world sections around the camera in video memory. The others are uploaded again when needed. */
+    bool EnableWorldSectionStreaming;
+
+    /** Sections closer than this are uploaded. Never smaller than the SectionDrawRadius. */
+    int SectionStreamingRadius;
+
+    /** Sections are only evicted once they are this many sections further away than the streaming radius */
+    int SectionStreamingHysteresis;
     float OutdoorSmallVobDrawRadius;
     float VisualFXDrawRadius;
     float SmallVobSize;
@@ -818,6 +902,9 @@ struct GothicRendererSettings {
     float GammaValue;
     float BrightnessValue;
     int ShadowMapSize;
+    int NumShadowCascades;
+    float ShadowCascadeSplitLambda;
+    bool ShadowCascadeAlternateUpdates;
     int textureMaxSize;
 
     float GlobalWindStrength;
@@ -833,8 +920,22 @@ struct GothicRendererSettings {
     float TesselationRange;
     float HDRLumWhite;
     float HDRMiddleGray;
+
+    /** Share of the darkest and brightest pixels left out of the average luminance (0..1) */
+    float HDRLumLowPercentile;
+    float HDRLumHighPercentile;
     float BloomThreshold;
     float BloomStrength;
+
+    /** 0-2, lower tiers skip the smallest levels of the bloom chain */
+    int BloomQuality;
+
+    /** With HDR: 0 runs the post effects on their own, 1 applies the godrays in the final composite, 2 the heightfog too.
+        Fused effects end up over the particles and polystrips drawn after them, so anything but 0 changes the look. */
+    int PostFXFusion;
+
+    /** Grades the final composite through the LUT in system/GD3D11/Textures/ColorGrading.dds */
+    bool EnableColorGrading;
     float GothicUIScale;
     float FOVHoriz;
     float FOVVert;
@@ -948,6 +1049,26 @@ struct GothicRendererInfo {
     GothicRendererInfo() {
         VOBVerticesDataSize = 0;
         SkeletalVerticesDataSize = 0;
+        VideoMemoryTotalMB = 0;
+        VideoMemoryBudgetMB = 0;
+        VideoMemoryWorldMB = 0;
+        VideoMemoryVobsMB = 0;
+        VideoMemoryTexturesMB = 0;
+        VideoMemoryShadowMapsMB = 0;
+        VideoMemoryRenderTargetsMB = 0;
+        VideoMemoryMipsEvicted = 0;
+        VideoMemoryTexturesRestored = 0;
+        WorldSectionsResident = 0;
+        WorldSectionsUploaded = 0;
+        WorldSectionsEvicted = 0;
+        VideoMemoryWorldPeakMB = 0;
+        VideoMemoryTotalPeakMB = 0;
+        FrameTimeP50MS = 0;
+        FrameTimeP95MS = 0;
+        FrameTimeP99MS = 0;
+        FrameJitterMS = 0;
+        FramePacingErrorMS = 0;
+        FrameLimiterSpinPercent = 0;
         Reset();
     }
 
@@ -963,6 +1084,22 @@ struct GothicRendererInfo {
         FrameDrawnLights = 0;
         WorldMeshDrawCalls = 0;
         FramePipelineStates = 0;
+        FrameShadowCascadesRendered = 0;
+        FrameShadowCastersCulled = 0;
+        FrameSkeletalInstanceBatches = 0;
+        FrameSkeletalDrawCallsSaved = 0;
+        FrameSkeletalLOD0 = 0;
+        FrameSkeletalLOD1 = 0;
+        FrameSkeletalLOD2 = 0;
+        FrameSkeletalPoseUpdatesSkipped = 0;
+        FrameWorldClustersDrawn = 0;
+        FrameWorldClustersCulled = 0;
+        FrameWorldTrianglesCulled = 0;
+        FrameConstantBufferMaps = 0;
+        FrameConstantBufferBytes = 0;
+        FrameConstantBufferUpdatesSkipped = 0;
+        FrameHUDDrawCalls = 0;
+        FrameHUDBatches = 0;
 
         StateChanges = 0;
         memset( StateChangesByState, 0, sizeof( StateChangesByState ) );
@@ -1000,11 +1137,53 @@ struct GothicRendererInfo {
     float NearPlane;
     int FrameDrawnLights;
     int WorldMeshDrawCalls;
+    int FrameShadowCascadesRendered;
+    int FrameShadowCastersCulled;
+    int FrameSkeletalInstanceBatches;
+    int FrameSkeletalDrawCallsSaved;
+    int FrameSkeletalLOD0;
+    int FrameSkeletalLOD1;
+    int FrameSkeletalLOD2;
+    int FrameSkeletalPoseUpdatesSkipped;
+    int FrameWorldClustersDrawn;
+    int FrameWorldClustersCulled;
+    int FrameWorldTrianglesCulled;
+    int FrameConstantBufferMaps;
+    int FrameConstantBufferBytes;
+    int FrameConstantBufferUpdatesSkipped;
+    int FrameHUDDrawCalls;
+    int FrameHUDBatches;
 
     GothicRendererTiming Timing;
 
     unsigned int VOBVerticesDataSize;
     unsigned int SkeletalVerticesDataSize;
+
+    /** Video memory usage, updated every frame by the residency manager */
+    int VideoMemoryTotalMB;
+    int VideoMemoryBudgetMB;
+    int VideoMemoryWorldMB;
+    int VideoMemoryVobsMB;
+    int VideoMemoryTexturesMB;
+    int VideoMemoryShadowMapsMB;
+    int VideoMemoryRenderTargetsMB;
+    int VideoMemoryMipsEvicted;
+    int VideoMemoryTexturesRestored;
+
+    /** World section streaming, updated every frame by the world streamer. Peaks are since the world was loaded. */
+    int WorldSectionsResident;
+    int WorldSectionsUploaded;
+    int WorldSectionsEvicted;
+    int VideoMemoryWorldPeakMB;
+    int VideoMemoryTotalPeakMB;
+
+    /** Frame pacing over the last 256 frames, updated by the frame limiter */
+    float FrameTimeP50MS;
+    float FrameTimeP95MS;
+    float FrameTimeP99MS;
+    float FrameJitterMS;
+    float FramePacingErrorMS;
+    float FrameLimiterSpinPercent;
 };
 
 /** This handles more device specific settings */
@@ -0,0 +1,76 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+/** Quality tiers, interleaved pattern and constants of the horizon based ambient occlusion. The tiers and the pattern
+    are passed to PS_PFX_HBAO, PS_PFX_HBAOTemporal and PS_PFX_HBAOUpsample, the constants are mirrored in Shaders/HBAO.h. */
+namespace HBAOKernel {
+    /** Side of the interleaved pattern. The pixels of a 4x4 block all sample different directions, which the
+        upsampling filter then averages. */
+    const int PATTERN_SIZE = 4;
+    const int PATTERN_LENGTH = PATTERN_SIZE * PATTERN_SIZE;
+
+    /** The radius is clamped to this many pixels of the AO buffer, to keep the texture cache happy on close-ups */
+    const float MAX_RADIUS_PIXELS = 64.0f;
+
+    /** Weight of the current frame in the temporal accumulation */
+    const float TEMPORAL_BLEND = 0.15f;
+
+    /** History is dropped where its depth differs more than this from the reprojected one, relative */
+    const float TEMPORAL_DEPTH_TOLERANCE = 0.05f;
+
+    /** Scales BlurSharpness for the relative depth difference in the bilateral upsampling */
+    const float BILATERAL_DEPTH_SCALE = 16.0f;
+
+    enum EQualityTier {
+        QT_LOW,
+        QT_MEDIUM,
+        QT_HIGH,
+        QT_ULTRA,
+
+        QT_NUM_TIERS
+    };
+
+    struct QualityTier {
+        /** Factor the AO buffer is smaller than the screen */
+        int Downsample;
+        int NumDirections;
+        int NumSteps;
+    };
+
+    inline QualityTier GetQualityTier( int tier ) {
+        static const QualityTier tiers[QT_NUM_TIERS] = {
+            { 4, 4, 3 },
+            { 2, 4, 4 },
+            { 2, 6, 6 },
+            { 2, 8, 8 },
+        };
+        return tiers[std::min( std::max( tier, 0 ), QT_NUM_TIERS - 1 )];
+    }
+
+    /** Rotation of the sample directions and offset of the first step, both per pattern slot */
+    struct Jitter {
+        float CosAngle;
+        float SinAngle;
+        float StepOffset;
+    };
+
+    /** Returns the jitter of a slot of the pattern, slot = x % 4 + (y % 4) * 4. The frame moves the values around the
+        slots, so every pixel sees all of them over the temporal accumulation. */
+    inline Jitter GetInterleavedJitter( int slot, int numDirections, unsigned int frame ) {
+        // Bayer order, so neighbouring slots get rotations far apart
+        static const int BAYER[PATTERN_LENGTH] = { 0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5 };
+        const float PI = 3.14159265f;
+
+        int rotation = BAYER[(slot + frame * 7) % PATTERN_LENGTH];
+        int offset = BAYER[(slot * 5 + frame * 3) % PATTERN_LENGTH];
+
+        float angle = 2.0f * PI / numDirections * (rotation + 0.5f) / PATTERN_LENGTH;
+
+        Jitter jitter;
+        jitter.CosAngle = std::cos( angle );
+        jitter.SinAngle = std::sin( angle );
+        jitter.StepOffset = (offset + 0.5f) / PATTERN_LENGTH;
+        return jitter;
+    }
+}
@@ -0,0 +1,313 @@
+#include "pch.h"
+#include "Logger.h"
+#include <atomic>
+#include <thread>
+
+/** Number of lines which can be queued before producers have to write themselves. Must be a power of two. */
+const size_t LOG_RING_SIZE = 8192;
+
+/** How often the writer thread wakes up to write and flush the queued lines */
+const DWORD LOG_WRITER_FLUSH_INTERVAL_MS = 100;
+
+/** Identical lines are written this often per window, further copies are only counted */
+const unsigned int LOG_MAX_REPEATS_PER_WINDOW = 5;
+const DWORD LOG_REPEAT_WINDOW_MS = 5000;
+const size_t LOG_MAX_TRACKED_LINES = 4096;
+
+/** How long a synchronous flush waits for the writer thread to finish its current batch */
+const DWORD LOG_SYNC_FLUSH_TIMEOUT_MS = 200;
+
+const size_t LOG_FILE_BUFFER_SIZE = 64 * 1024;
+
+/** One queued line. The sequence tells producers and consumers whose turn it is, see Vyukov's bounded queue. */
+struct LogRecordSlot {
+    std::atomic<size_t> Sequence;
+    std::string Text;
+};
+
+struct LogWriterState {
+    LogWriterState() {
+        Ring.reset( new LogRecordSlot[LOG_RING_SIZE] );
+        for ( size_t i = 0; i < LOG_RING_SIZE; i++ ) {
+            Ring[i].Sequence.store( i, std::memory_order_relaxed );
+        }
+
+        EnqueuePosition = 0;
+        DequeuePosition = 0;
+        Draining = false;
+        Synchronous = false;
+        WriterStarted = false;
+        WakeEvent = CreateEventA( nullptr, FALSE, FALSE, nullptr );
+        File = nullptr;
+        RepeatWindowStart = GetTickCount();
+    }
+
+    std::unique_ptr<LogRecordSlot[]> Ring;
+    alignas(64) std::atomic<size_t> EnqueuePosition;
+    alignas(64) std::atomic<size_t> DequeuePosition;
+
+    /** Set by whoever currently writes to the file, the writer thread or a synchronous flush */
+    alignas(64) std::atomic<bool> Draining;
+
+    /** Set once the program shuts down. Every line is written immediately from then on. */
+    std::atomic<bool> Synchronous;
+    std::atomic<bool> WriterStarted;
+    HANDLE WakeEvent;
+
+    /** Only touched while holding Draining */
+    FILE* File;
+    std::unordered_map<std::string, unsigned int> RepeatCounts;
+    DWORD RepeatWindowStart;
+};
+
+/** The state is never deleted, so lines logged from static destructors still find it */
+static LogWriterState& GetState() {
+    static LogWriterState* state = new LogWriterState();
+    return *state;
+}
+
+static bool TryEnqueue( LogWriterState& s, std::string& line ) {
+    size_t pos = s.EnqueuePosition.load( std::memory_order_relaxed );
+    for ( ;; ) {
+        LogRecordSlot& slot = s.Ring[pos & (LOG_RING_SIZE - 1)];
+        const size_t seq = slot.Sequence.load( std::memory_order_acquire );
+        const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if ( diff == 0 ) {
+            if ( s.EnqueuePosition.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ) {
+                slot.Text = std::move( line );
+                slot.Sequence.store( pos + 1, std::memory_order_release );
+
+                // Don't wait for the timeout if the ring is filling up
+                if ( pos + 1 - s.DequeuePosition.load( std::memory_order_relaxed ) == LOG_RING_SIZE / 2 ) {
+                    SetEvent( s.WakeEvent );
+                }
+                return true;
+            }
+        } else if ( diff < 0 ) {
+            return false; // Full
+        } else {
+            pos = s.EnqueuePosition.load( std::memory_order_relaxed );
+        }
+    }
+}
+
+static bool TryDequeue( LogWriterState& s, std::string& line ) {
+    size_t pos = s.DequeuePosition.load( std::memory_order_relaxed );
+    for ( ;; ) {
+        LogRecordSlot& slot = s.Ring[pos & (LOG_RING_SIZE - 1)];
+        const size_t seq = slot.Sequence.load( std::memory_order_acquire );
+        const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+        if ( diff == 0 ) {
+            if ( s.DequeuePosition.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ) {
+                line = std::move( slot.Text );
+                slot.Sequence.store( pos + LOG_RING_SIZE, std::memory_order_release );
+                return true;
+            }
+        } else if ( diff < 0 ) {
+            return false; // Empty
+        } else {
+            pos = s.DequeuePosition.load( std::memory_order_relaxed );
+        }
+    }
+}
+
+static bool AcquireDraining( LogWriterState& s, DWORD timeoutMs ) {
+    const DWORD start = GetTickCount();
+    while ( s.Draining.exchange( true, std::memory_order_acquire ) ) {
+        if ( GetTickCount() - start > timeoutMs )
+            return false;
+
+        Sleep( 1 );
+    }
+    return true;
+}
+
+static void ReleaseDraining( LogWriterState& s ) {
+    s.Draining.store( false, std::memory_order_release );
+}
+
+static FILE* GetFile( LogWriterState& s ) {
+    if ( !s.File && !LOGFILE.empty() ) {
+        s.File = fopen( LOGFILE.c_str(), "a" );
+        if ( s.File ) {
+            setvbuf( s.File, nullptr, _IOFBF, LOG_FILE_BUFFER_SIZE );
+        }
+    }
+    return s.File;
+}
+
+/** Writes how many copies of each line were dropped during the last window */
+static void WriteRepeatSummary( LogWriterState& s, FILE* f ) {
+    for ( auto const& it : s.RepeatCounts ) {
+        if ( it.second > LOG_MAX_REPEATS_PER_WINDOW ) {
+            fprintf( f, "Info: Suppressed %u more copies of: %s", it.second - LOG_MAX_REPEATS_PER_WINDOW, it.first.c_str() );
+        }
+    }
+    s.RepeatCounts.clear();
+}
+
+/** Returns false if the line was already written too often during the current window */
+static bool PassRepeatFilter( LogWriterState& s, FILE* f, const std::string& line ) {
+    const DWORD now = GetTickCount();
+    if ( now - s.RepeatWindowStart > LOG_REPEAT_WINDOW_MS || s.RepeatCounts.size() >= LOG_MAX_TRACKED_LINES ) {
+        WriteRepeatSummary( s, f );
+        s.RepeatWindowStart = now;
+    }
+
+    return ++s.RepeatCounts[line] <= LOG_MAX_REPEATS_PER_WINDOW;
+}
+
+/** Writes everything queued. Must hold Draining if filterRepeats is set. */
+static void DrainRing( LogWriterState& s, bool filterRepeats ) {
+    FILE* f = GetFile( s );
+    std::string line;
+    while ( TryDequeue( s, line ) ) {
+        if ( !f )
+            continue;
+
+        if ( !filterRepeats || PassRepeatFilter( s, f, line ) ) {
+            fputs( line.c_str(), f );
+        }
+    }
+
+    if ( f ) {
+        fflush( f );
+    }
+}
+
+static void WriterThreadFunc() {
+    LogWriterState& s = GetState();
+    for ( ;; ) {
+        WaitForSingleObject( s.WakeEvent, LOG_WRITER_FLUSH_INTERVAL_MS );
+
+        if ( AcquireDraining( s, INFINITE ) ) {
+            DrainRing( s, true );
+            ReleaseDraining( s );
+        }
+    }
+}
+
+/** Starts the writer thread. Called by Log::Clear once the path of the logfile is known. */
+void LogWriter::Start() {
+    LogWriterState& s = GetState();
+    if ( s.WriterStarted.exchange( true ) )
+        return;
+
+    // The thread is killed with the process, everything left is written by the synchronous flush on exit
+    std::thread( WriterThreadFunc ).detach();
+}
+
+/** Queues a finished line. Only writes to the file itself if the queue is full. */
+void LogWriter::Push( std::string&& line ) {
+    LogWriterState& s = GetState();
+    while ( !TryEnqueue( s, line ) ) {
+        FlushSynchronous();
+    }
+
+    if ( s.Synchronous.load( std::memory_order_relaxed ) || !s.WriterStarted.load( std::memory_order_relaxed ) ) {
+        FlushSynchronous();
+    }
+}
+
+/** Writes everything queued so far from the calling thread */
+void LogWriter::FlushSynchronous() {
+    LogWriterState& s = GetState();
+
+    // The writer thread may have died with the lock held when crashing, so don't wait forever.
+    // Without the lock the queue is still safe to drain, the repeat filter is skipped then.
+    if ( AcquireDraining( s, LOG_SYNC_FLUSH_TIMEOUT_MS ) ) {
+        DrainRing( s, true );
+        ReleaseDraining( s );
+    } else {
+        DrainRing( s, false );
+    }
+}
+
+/** Writes everything and makes all further lines synchronous. Called when the program terminates. */
+void LogWriter::Shutdown() {
+    LogWriterState& s = GetState();
+    s.Synchronous = true;
+    FlushSynchronous();
+
+    if ( AcquireDraining( s, LOG_SYNC_FLUSH_TIMEOUT_MS ) ) {
+        if ( s.File ) {
+            WriteRepeatSummary( s, s.File );
+            fflush( s.File );
+        }
+        ReleaseDraining( s );
+    }
+}
+
+/** Times the cost of a log call for the calling thread, from one and from several threads at once, and compares it
+    to opening, appending and closing a file for every line and to a disabled line. Writes the results to the log. */
+void LogWriter::RunProducerBenchmark() {
+    const unsigned int callsPerRound = LOG_RING_SIZE / 2;
+    const unsigned int rounds = 4;
+    const unsigned int numThreads = 4;
+
+    // Measure the producer only, the queue is emptied between the rounds
+    FlushSynchronous();
+
+    long long singleThreadNs = 0;
+    for ( unsigned int r = 0; r < rounds; r++ ) {
+        auto start = std::chrono::high_resolution_clock::now();
+        for ( unsigned int i = 0; i < callsPerRound; i++ ) {
+            LogInfo() << "Log benchmark, single thread, message " << (i & 3);
+        }
+        singleThreadNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+        FlushSynchronous();
+    }
+
+    std::atomic<long long> multiThreadNs( 0 );
+    for ( unsigned int r = 0; r < rounds; r++ ) {
+        std::vector<std::thread> threads;
+        for ( unsigned int t = 0; t < numThreads; t++ ) {
+            threads.emplace_back( [&multiThreadNs, callsPerRound, numThreads, t]() {
+                auto start = std::chrono::high_resolution_clock::now();
+                for ( unsigned int i = 0; i < callsPerRound / numThreads; i++ ) {
+                    LogInfo() << "Log benchmark, thread " << t << ", message " << (i & 3);
+                }
+                multiThreadNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+                } );
+        }
+
+        for ( std::thread& thread : threads ) {
+            thread.join();
+        }
+        FlushSynchronous();
+    }
+
+    // Disabled lines, with arguments which would allocate if they were evaluated
+    const unsigned int disabledCalls = 1000000;
+    const int previousLevel = LogChannelLevels[LC_GENERAL];
+    LogChannelLevels[LC_GENERAL] = LL_WARNING;
+    auto disabledStart = std::chrono::high_resolution_clock::now();
+    for ( unsigned int i = 0; i < disabledCalls; i++ ) {
+        LogInfo() << "Log benchmark, disabled, message " << std::to_string( i );
+    }
+    const long long disabledNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - disabledStart).count();
+    LogChannelLevels[LC_GENERAL] = previousLevel;
+
+    // The old way, into a scratch file next to the log
+    const unsigned int syncCalls = 1000;
+    const std::string scratchFile = LOGFILE + ".benchmark";
+    auto start = std::chrono::high_resolution_clock::now();
+    for ( unsigned int i = 0; i < syncCalls; i++ ) {
+        std::stringstream ss;
+        ss << "Info: " << "Log benchmark, synchronous, message " << (i & 3) << "\n";
+
+        FILE* f = fopen( scratchFile.c_str(), "a" );
+        if ( f ) {
+            fputs( ss.str().c_str(), f );
+            fclose( f );
+        }
+    }
+    const long long syncNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+    DeleteFileA( scratchFile.c_str() );
+
+    LogInfo() << "Log benchmark, producer cost per call: "
+        << singleThreadNs / (rounds * callsPerRound) << " ns from one thread, "
+        << multiThreadNs / (rounds * callsPerRound) << " ns from " << numThreads << " threads at once, "
+        << syncNs / syncCalls << " ns when opening, appending and closing the file per line, "
+        << static_cast<double>(disabledNs) / disabledCalls << " ns for a disabled line";
+}
@@ -6,12 +6,13 @@
 #include <string>
 #include "Toolbox.h"
 #include <mutex>
+#include <charconv>
+#include <algorithm>
 
 //#include <DxErr.h>
 //#pragma comment(lib, "Dxerr.lib")
 #define USE_LOG
 
-const int MAX_LOG_MESSAGES_TO_CACHE = 200;
 __declspec(selectany) std::string LOGFILE;
 
 //#ifdef BUILD_DESKTOP
@@ -63,14 +64,55 @@ __declspec(selectany) std::string LOGFILE;
 #endif
 */
 
+/** Severity of a log line */
+enum ELogLevel {
+    LL_INFO = 0,
+    LL_WARNING = 1,
+    LL_ERROR = 2,
+    LL_NONE = 3
+};
+
+/** Subsystems which can be made quieter or louder separately */
+enum ELogChannel {
+    LC_GENERAL = 0,
+    LC_TEXTURES,
+    LC_SHADERS,
+    LC_WORLD,
+    LC_HOOKS,
+    LC_POSTFX,
+    LC_NUM_CHANNELS
+};
+
+/** Lines below this level are compiled out, including the evaluation of their arguments */
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LL_INFO
+#endif
+
+/** Lowest level written per channel, set from the [Logging] section of the settings */
+__declspec(selectany) int LogChannelLevels[LC_NUM_CHANNELS] = {};
+
+__declspec(selectany) const char* LogChannelNames[LC_NUM_CHANNELS] = { "General", "Textures", "Shaders", "World", "Hooks", "PostFX" };
+
+inline bool LogIsEnabled( int level, int channel ) {
+    return level >= LOG_COMPILE_LEVEL && level >= LogChannelLevels[channel];
+}
+
+/** Skips the whole statement following it if the level is disabled. The else keeps the macros safe inside unbraced if/else. */
+#define LOG_IF_ENABLED(level, channel) if ( !LogIsEnabled( level, channel ) ) {} else
+
 /** Logging macros
     Usage: LogInfo() << L"Loaded Texture: " << TextureName;
+           LogInfoCh( LC_TEXTURES ) << "Loaded Texture: " << TextureName;
     */
 
 
-#define LogInfo() Log("Info",__FILE__, __LINE__, __FUNCSIG__)
-#define LogWarn() Log("Warning",__FILE__, __LINE__, __FUNCSIG__, true)
-#define LogError() Log("Error",__FILE__, __LINE__, __FUNCSIG__, true)
+#define LogInfoCh(channel) LOG_IF_ENABLED(LL_INFO, channel) Log("Info",__FILE__, __LINE__, __FUNCSIG__)
+#define LogWarnCh(channel) LOG_IF_ENABLED(LL_WARNING, channel) Log("Warning",__FILE__, __LINE__, __FUNCSIG__, true)
+#define LogErrorCh(channel) LOG_IF_ENABLED(LL_ERROR, channel) Log("Error",__FILE__, __LINE__, __FUNCSIG__, true)
+
+#define LogInfo() LogInfoCh(LC_GENERAL)
+#define LogWarn() LogWarnCh(LC_GENERAL)
+#define LogError() LogErrorCh(LC_GENERAL)
 
 
     /** Displays a messagebox and loggs its content */
@@ -81,50 +123,51 @@ __declspec(selectany) std::string LOGFILE;
 /** Stream logger */
 #ifdef USE_LOG
 
-namespace LogCache {
-    __declspec(selectany) std::vector<std::string> Cache;
-    __declspec(selectany) std::mutex LogMutex;
-    struct LogFlush {
-        ~LogFlush() {
-            LogMutex.lock();
-            Cache.push_back( "Flushed " + std::to_string( Cache.size() ) + " log messages at program termination!\n" );
-            FlushData();
-            LogMutex.unlock();
-        }
-
-        static void FlushData() {
-            FILE* f;
-            f = fopen( LOGFILE.c_str(), "a" );
+/** Keeps file I/O off the threads which log. Finished lines go into a lock-free ring, which a background thread
+    writes into the logfile every few milliseconds. Identical lines are only written a few times per window. */
+class LogWriter {
+public:
+    /** Starts the writer thread. Called by Log::Clear once the path of the logfile is known. */
+    static void Start();
 
-            //if (MAX_LOG_MESSAGES_TO_CACHE > 5)
-            //	fputs(" --- Log-Cache flush! --- \n", f);
+    /** Queues a finished line. Only writes to the file itself if the queue is full. */
+    static void Push( std::string&& line );
 
-            // Write down all the data we have
-            for ( UINT i = 0; i < Cache.size(); i++ ) {
-                fputs( Cache[i].c_str(), f );
+    /** Writes everything queued so far from the calling thread. Used on crashes and before message boxes. */
+    static void FlushSynchronous();
 
-                //OutputDebugStringA(Cache[i].c_str());
-            }
+    /** Writes everything and makes all further lines synchronous. Called when the program terminates. */
+    static void Shutdown();
 
-            fclose( f );
+    /** Times the cost of a log call for the calling thread, from one and from several threads at once, and compares it
+        to opening, appending and closing a file for every line and to a disabled line. Writes the results to the log. */
+    static void RunProducerBenchmark();
+};
 
-            // Clear the cache
-            Cache.clear();
+namespace LogCache {
+    struct LogFlush {
+        ~LogFlush() {
+            LogWriter::Shutdown();
         }
     };
 
-    __declspec(selectany) LogFlush fls; // This will be deleted by the CRT when the program ends, thus, calling the destructor, which flushes the remaining cache
+    __declspec(selectany) LogFlush fls; // This will be deleted by the CRT when the program ends, thus, calling the destructor, which flushes the remaining lines
 }
 
+/** Lines up to this length are formatted without touching the heap */
+const size_t LOG_LINE_BUFFER_SIZE = 512;
+
 class Log {
 public:
     Log( const char* Type, const  char* File, int Line, const  char* Function, bool bIncludeInfo = false, UINT MessageBox = 0 ) {
+        Length = 0;
         if ( bIncludeInfo ) {
-            Info << Type << ": [" << File << "(" << Line << "), " << Function << "]: ";
+            *this << Type << ": [" << File << "(" << Line << "), " << Function << "]: ";
         } else {
-            Info << Type << ": ";
+            *this << Type << ": ";
         }
 
+        MessageStart = Length;
         MessageBoxStyle = MessageBox;
     }
 
@@ -142,36 +185,75 @@ public:
 
         FILE* f;
         f = fopen( LOGFILE.c_str(), "w" );
-        fclose( f );
+        if ( f ) {
+            fclose( f );
+        }
+
+        LogWriter::Start();
     }
 
-    /** STL stringstream feature */
+    /** Common types are formatted into the line buffer directly */
+    inline Log& operator << ( const char* str ) {
+        if ( str ) {
+            Append( str, strlen( str ) );
+        }
+        return *this;
+    }
+
+    inline Log& operator << ( char* str ) { return *this << static_cast<const char*>(str); }
+    inline Log& operator << ( const std::string& str ) { Append( str.c_str(), str.size() ); return *this; }
+    inline Log& operator << ( char c ) { Append( &c, 1 ); return *this; }
+
+    inline Log& operator << ( bool value ) { return AppendInteger( value ? 1 : 0 ); }
+    inline Log& operator << ( short value ) { return AppendInteger( value ); }
+    inline Log& operator << ( unsigned short value ) { return AppendInteger( value ); }
+    inline Log& operator << ( int value ) { return AppendInteger( value ); }
+    inline Log& operator << ( unsigned int value ) { return AppendInteger( value ); }
+    inline Log& operator << ( long value ) { return AppendInteger( value ); }
+    inline Log& operator << ( unsigned long value ) { return AppendInteger( value ); }
+    inline Log& operator << ( long long value ) { return AppendInteger( value ); }
+    inline Log& operator << ( unsigned long long value ) { return AppendInteger( value ); }
+
+    inline Log& operator << ( float value ) { return *this << static_cast<double>(value); }
+    inline Log& operator << ( double value ) {
+        char buffer[32];
+        int len = snprintf( buffer, sizeof( buffer ), "%g", value );
+        if ( len > 0 ) {
+            Append( buffer, std::min( static_cast<size_t>(len), sizeof( buffer ) - 1 ) );
+        }
+        return *this;
+    }
+
+    inline Log& operator << ( const void* ptr ) {
+        char buffer[32];
+        int len = snprintf( buffer, sizeof( buffer ), "%p", ptr );
+        if ( len > 0 ) {
+            Append( buffer, std::min( static_cast<size_t>(len), sizeof( buffer ) - 1 ) );
+        }
+        return *this;
+    }
+
+    /** Everything else goes through its stream operator, as before */
     template< typename T >
     inline Log& operator << ( const T& obj ) {
-        Message << obj;
-        return *this;
+        std::stringstream ss;
+        ss << obj;
+        return *this << ss.str();
     }
 
     inline Log& operator << ( std::wostream& (*fn)(std::wostream&) ) {
-        Message << fn;
         return *this;
     }
 
     /** Called when the object is getting destroyed, which happens immediately if simply calling the constructor of this class */
     inline void Flush() {
-        FILE* f;
-        std::unique_lock<std::mutex> lock( LogCache::LogMutex );
-
-        f = fopen( LOGFILE.c_str(), "a" );
-
-        if ( f ) {
-
-            fputs( Info.str().c_str(), f );
+        std::string line = GetText( 0 );
+        line += '\n';
+        LogWriter::Push( std::move( line ) );
 
-            fputs( Message.str().c_str(), f );
-            fputs( "\n", f );
-
-            fclose( f );
+        // Make sure the log is complete while the box blocks, the user might kill the game from there
+        if ( MessageBoxStyle ) {
+            LogWriter::FlushSynchronous();
         }
 
         /*if (strnicmp(Info.str().c_str(), "Error", sizeof("Error")) == 0)
@@ -179,32 +261,55 @@ public:
             LastErrorMessage = Info.str() + Message.str();
         }*/
 
-        /*// Place the message into the cache
-        LogCache::Cache.push_back(Info.str() + Message.str() + "\n");
-
-        // Flush data if the cache is full
-        if (LogCache::Cache.size() >= MAX_LOG_MESSAGES_TO_CACHE)
-            LogCache::LogFlush::FlushData();*/
-
         switch ( MessageBoxStyle ) {
         case 1:
-            InfoBox( Message.str().c_str() );
+            InfoBox( GetText( MessageStart ).c_str() );
             break;
 
         case 2:
-            WarnBox( Message.str().c_str() );
+            WarnBox( GetText( MessageStart ).c_str() );
             break;
 
         case 3:
-            ErrorBox( Message.str().c_str() );
+            ErrorBox( GetText( MessageStart ).c_str() );
             break;
         }
     }
 
 private:
+    /** Adds to the line buffer, lines which don't fit continue on the heap */
+    inline void Append( const char* str, size_t len ) {
+        if ( Overflow.empty() && Length + len <= LOG_LINE_BUFFER_SIZE ) {
+            memcpy( Buffer + Length, str, len );
+            Length += len;
+        } else {
+            if ( Overflow.empty() ) {
+                Overflow.assign( Buffer, Length );
+            }
+            Overflow.append( str, len );
+        }
+    }
+
+    template< typename T >
+    inline Log& AppendInteger( T value ) {
+        char buffer[24];
+        auto result = std::to_chars( buffer, buffer + sizeof( buffer ), value );
+        Append( buffer, static_cast<size_t>(result.ptr - buffer) );
+        return *this;
+    }
+
+    /** Returns the line starting at the given offset */
+    inline std::string GetText( size_t start ) const {
+        if ( !Overflow.empty() ) {
+            return Overflow.substr( start );
+        }
+        return std::string( Buffer + start, Length - start );
+    }
 
-    std::stringstream Info; // Contains an information like "Info", "Warning" or "Error"
-    std::stringstream Message; // Text to write into the logfile
+    char Buffer[LOG_LINE_BUFFER_SIZE]; // Formatted line, starting with an information like "Info", "Warning" or "Error"
+    size_t Length; // Used part of the buffer
+    std::string Overflow; // Whole line, once it got too long for the buffer
+    size_t MessageStart; // Where the text after the information starts
     UINT MessageBoxStyle; // Style of the messagebox if needed
 
     //static std::string LastErrorMessage; // The last errormessage
@@ -0,0 +1,20 @@
+#pragma once
+
+/** Range and adaption constants of the luminance histogram built by CS_PFX_LumHistogram and evaluated by
+    CS_PFX_LumExposure. They are passed to the shaders through the constant buffer, NUM_BINS is mirrored in Shaders/LumHistogram.h. */
+namespace LuminanceHistogram {
+    const unsigned int NUM_BINS = 64;
+
+    /** Range of the histogram in log2 luminance. Everything outside goes into the first or last bin. */
+    const float MIN_LOG2_LUMINANCE = -5.0f;
+    const float MAX_LOG2_LUMINANCE = 5.0f;
+
+    /** Pixels darker than this don't count, same as the minimum of the old luminance buffer */
+    const float MIN_LUMINANCE = 0.05f;
+
+    /** Adapted luminance is kept in this range */
+    const float MAX_ADAPTED_LUMINANCE = 32.0f;
+
+    /** Speed of the eye adaption, in 1/s */
+    const float ADAPTION_RATE = 0.5f;
+}
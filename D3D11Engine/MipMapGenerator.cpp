@@ -0,0 +1,186 @@
+#include "pch.h"
+#include "MipMapGenerator.h"
+#include "Engine.h"
+#include "ThreadPool.h"
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#include <atomic>
+#include <mutex>
+
+/** Mips with at least this many rows are split into jobs of half as many rows */
+const int PARALLEL_MIN_ROWS = 64;
+
+/** Kaiser window parameters, in output pixels */
+const float KAISER_ALPHA = 4.0f;
+const float KAISER_RADIUS = 1.5f;
+
+/** Separable filter taking an even number of source texels around each destination texel */
+struct DownsampleKernel {
+    int NumTaps;
+    float Weights[6];
+};
+
+static std::once_flag TablesInitialized;
+static float SRGBToLinear[256];
+static unsigned char LinearToSRGB[4096];
+static DownsampleKernel Kernels[2];
+
+/** Statistics since startup */
+static std::atomic<unsigned int> NumGenerated = 0;
+static std::atomic<long long> GenerationMicroseconds = 0;
+
+/** Modified bessel function of the first kind, used by the kaiser window */
+static double BesselI0( double x ) {
+    double sum = 1.0;
+    double term = 1.0;
+    for ( int k = 1; k < 32 && term > sum * 1e-12; k++ ) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+static void InitTables() {
+    for ( int i = 0; i < 256; i++ ) {
+        float c = i / 255.0f;
+        SRGBToLinear[i] = c <= 0.04045f ? c / 12.92f : powf( (c + 0.055f) / 1.055f, 2.4f );
+    }
+
+    for ( int i = 0; i < 4096; i++ ) {
+        float l = i / 4095.0f;
+        float c = l <= 0.0031308f ? l * 12.92f : 1.055f * powf( l, 1.0f / 2.4f ) - 0.055f;
+        LinearToSRGB[i] = static_cast<unsigned char>(std::min( 255.0f, c * 255.0f + 0.5f ));
+    }
+
+    Kernels[MipMapGenerator::F_BOX].NumTaps = 2;
+    Kernels[MipMapGenerator::F_BOX].Weights[0] = 0.5f;
+    Kernels[MipMapGenerator::F_BOX].Weights[1] = 0.5f;
+
+    // Windowed sinc over 6 source texels. Distances are in destination texels, which are twice as large.
+    DownsampleKernel& kaiser = Kernels[MipMapGenerator::F_KAISER];
+    kaiser.NumTaps = 6;
+
+    double sum = 0.0;
+    double weights[6];
+    for ( int t = 0; t < 6; t++ ) {
+        double x = (t - 2.5) / 2.0;
+        double sinc = sin( XM_PI * x ) / (XM_PI * x);
+        double r = x / KAISER_RADIUS;
+        weights[t] = sinc * BesselI0( KAISER_ALPHA * sqrt( 1.0 - r * r ) ) / BesselI0( KAISER_ALPHA );
+        sum += weights[t];
+    }
+
+    for ( int t = 0; t < 6; t++ ) {
+        kaiser.Weights[t] = static_cast<float>(weights[t] / sum);
+    }
+}
+
+/** Filters the given rows of a mip from the mip above */
+static void DownsampleRows( const unsigned char* src, INT2 srcSize, unsigned char* dst, INT2 dstSize,
+    const DownsampleKernel& kernel, int firstRow, int lastRow ) {
+    const int firstTap = kernel.NumTaps / 2 - 1;
+    const __m128 scale = _mm_setr_ps( 4095.0f, 4095.0f, 4095.0f, 255.0f );
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps( 1.0f );
+    const __m128 half = _mm_set1_ps( 0.5f );
+
+    std::vector<float> row( srcSize.x * 4 );
+    for ( int y = firstRow; y < lastRow; y++ ) {
+        // Filter vertically into one linear row
+        std::fill( row.begin(), row.end(), 0.0f );
+        for ( int t = 0; t < kernel.NumTaps; t++ ) {
+            int sy = std::clamp( y * 2 - firstTap + t, 0, srcSize.y - 1 );
+            const unsigned char* srcRow = &src[sy * srcSize.x * 4];
+            __m128 weight = _mm_set1_ps( kernel.Weights[t] );
+
+            for ( int x = 0; x < srcSize.x; x++ ) {
+                const unsigned char* px = &srcRow[x * 4];
+                __m128 linear = _mm_setr_ps( SRGBToLinear[px[0]], SRGBToLinear[px[1]], SRGBToLinear[px[2]], px[3] * (1.0f / 255.0f) );
+                _mm_storeu_ps( &row[x * 4], _mm_add_ps( _mm_loadu_ps( &row[x * 4] ), _mm_mul_ps( linear, weight ) ) );
+            }
+        }
+
+        // Then horizontally into the destination
+        unsigned char* dstRow = &dst[y * dstSize.x * 4];
+        for ( int x = 0; x < dstSize.x; x++ ) {
+            __m128 sum = zero;
+            for ( int t = 0; t < kernel.NumTaps; t++ ) {
+                int sx = std::clamp( x * 2 - firstTap + t, 0, srcSize.x - 1 );
+                sum = _mm_add_ps( sum, _mm_mul_ps( _mm_loadu_ps( &row[sx * 4] ), _mm_set1_ps( kernel.Weights[t] ) ) );
+            }
+
+            // Kaiser has negative lobes, clamp the overshoot
+            sum = _mm_min_ps( _mm_max_ps( sum, zero ), one );
+
+            alignas(16) int quantized[4];
+            _mm_store_si128( reinterpret_cast<__m128i*>(quantized), _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( sum, scale ), half ) ) );
+
+            dstRow[x * 4 + 0] = LinearToSRGB[quantized[0]];
+            dstRow[x * 4 + 1] = LinearToSRGB[quantized[1]];
+            dstRow[x * 4 + 2] = LinearToSRGB[quantized[2]];
+            dstRow[x * 4 + 3] = static_cast<unsigned char>(quantized[3]);
+        }
+    }
+}
+
+/** Returns the size of the given mip, the way D3D computes it */
+INT2 MipMapGenerator::GetMipSize( INT2 size, UINT mip ) {
+    return INT2( std::max( 1, size.x >> mip ), std::max( 1, size.y >> mip ) );
+}
+
+/** Generates the mips below the given image */
+void MipMapGenerator::Generate( const unsigned char* bgra, INT2 size, UINT mipLevels, EFilter filter, MipChain& out ) {
+    std::call_once( TablesInitialized, InitTables );
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Allocate everything at once, so the pointers stay valid
+    size_t dataSize = 0;
+    for ( UINT mip = 1; mip < mipLevels; mip++ ) {
+        INT2 mipSize = GetMipSize( size, mip );
+        dataSize += mipSize.x * mipSize.y * 4;
+    }
+    out.Data.resize( dataSize );
+    out.Mips.resize( mipLevels );
+    out.Mips[0] = bgra;
+
+    const DownsampleKernel& kernel = Kernels[filter == F_KAISER ? F_KAISER : F_BOX];
+
+    size_t offset = 0;
+    for ( UINT mip = 1; mip < mipLevels; mip++ ) {
+        INT2 srcSize = GetMipSize( size, mip - 1 );
+        INT2 dstSize = GetMipSize( size, mip );
+        const unsigned char* src = out.Mips[mip - 1];
+        unsigned char* dst = &out.Data[offset];
+        out.Mips[mip] = dst;
+        offset += dstSize.x * dstSize.y * 4;
+
+        // From a worker job, waiting on more jobs could block every worker
+        if ( dstSize.y >= PARALLEL_MIN_ROWS && Engine::WorkerThreadPool && !Engine::WorkerThreadPool->isWorkerThread() ) {
+            // Every mip depends on the previous one, so only rows of the same mip run in parallel
+            std::vector<std::future<void>> jobs;
+            for ( int row = 0; row < dstSize.y; row += PARALLEL_MIN_ROWS / 2 ) {
+                int lastRow = std::min( row + PARALLEL_MIN_ROWS / 2, dstSize.y );
+                jobs.push_back( Engine::WorkerThreadPool->enqueue( [=, &kernel]() {
+                    DownsampleRows( src, srcSize, dst, dstSize, kernel, row, lastRow );
+                } ) );
+            }
+
+            for ( auto& job : jobs ) {
+                job.get();
+            }
+        } else {
+            DownsampleRows( src, srcSize, dst, dstSize, kernel, 0, dstSize.y );
+        }
+    }
+
+    NumGenerated++;
+    GenerationMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+/** Writes the number of generated chains and the time spent to the log */
+void MipMapGenerator::LogStatistics() {
+    if ( !NumGenerated )
+        return;
+
+    LogInfoCh( LC_TEXTURES ) << "Generated " << NumGenerated.load() << " mip chains on the CPU in " << GenerationMicroseconds.load() / 1000 << " ms";
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "pch.h"
+
+/** Generates mip chains of B8G8R8A8 images on the CPU, so textures can be created with all their mips at once
+    instead of rendering them on the immediate context. Colors are filtered in linear space, alpha as is. */
+class MipMapGenerator {
+public:
+    enum EFilter {
+        F_BOX = 0,
+        F_KAISER = 1
+    };
+
+    /** Mip chain of one image */
+    struct MipChain {
+        /** Pointer to each mip. Mip 0 is the source image. */
+        std::vector<const unsigned char*> Mips;
+
+        /** Storage of all mips but the first */
+        std::vector<unsigned char> Data;
+    };
+
+    /** Returns the size of the given mip, the way D3D computes it */
+    static INT2 GetMipSize( INT2 size, UINT mip );
+
+    /** Generates the mips below the given image */
+    static void Generate( const unsigned char* bgra, INT2 size, UINT mipLevels, EFilter filter, MipChain& out );
+
+    /** Writes the number of generated chains and the time spent to the log */
+    static void LogStatistics();
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include "pch.h"
+#include "ResidencyManager.h"
 
 /** Helper structs for quickly creating render-to-texture buffers */
 
@@ -20,6 +21,7 @@ struct RenderToTextureBuffer {
 
         this->SizeX = SizeX;
         this->SizeY = SizeY;
+        this->ArraySize = arraySize;
 
         if ( Format == 0 ) {
             LogError() << L"DXGI_FORMAT_UNKNOWN (0) isn't a valid texture format";
@@ -34,7 +36,7 @@ struct RenderToTextureBuffer {
             MipLevels,
             D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE );
 
-        if ( arraySize > 1 )
+        if ( cubemap )
             Desc.MiscFlags |= D3D11_RESOURCE_MISC_TEXTURECUBE;
 
         if ( MipLevels != 1 )
@@ -45,6 +47,8 @@ struct RenderToTextureBuffer {
         // Can't do further work if texture is null.
         if ( !Texture.Get() ) return;
 
+        MemoryAllocation.Set( ResidencyManager::C_RENDER_TARGETS, ResidencyManager::GetTextureSize( Format, SizeX, SizeY, Desc.MipLevels, arraySize ) );
+
         //Create a render target view
         D3D11_RENDER_TARGET_VIEW_DESC DescRT = CD3D11_RENDER_TARGET_VIEW_DESC();
         DescRT.Format = (RTVFormat != DXGI_FORMAT_UNKNOWN ? RTVFormat : Desc.Format);
@@ -111,6 +115,9 @@ struct RenderToTextureBuffer {
 
     UINT GetSizeX() { return SizeX; }
     UINT GetSizeY() { return SizeY; }
+
+    /** Moves this buffer to another category of the video memory statistics */
+    void SetMemoryCategory( ResidencyManager::ECategory category ) { MemoryAllocation.SetCategory( category ); }
 private:
 
     /** The Texture object */
@@ -126,10 +133,14 @@ private:
     UINT SizeX;
     UINT SizeY;
 
+    /** Registers the size of the texture with the residency manager */
+    ResidencyManager::Allocation MemoryAllocation;
+
     void ReleaseAll() {
         Texture.Reset();
         ShaderResView.Reset();
         RenderTargetView.Reset();
+        MemoryAllocation.Release();
     }
 };
 
@@ -139,14 +150,18 @@ struct RenderToDepthStencilBuffer {
     }
 
     /** Creates the render-to-texture buffers */
-    RenderToDepthStencilBuffer( const Microsoft::WRL::ComPtr<ID3D11Device1>& device, UINT SizeX, UINT SizeY, DXGI_FORMAT Format, HRESULT* Result = nullptr, DXGI_FORMAT DSVFormat = DXGI_FORMAT_UNKNOWN, DXGI_FORMAT SRVFormat = DXGI_FORMAT_UNKNOWN, UINT arraySize = 1 ) {
+    RenderToDepthStencilBuffer( const Microsoft::WRL::ComPtr<ID3D11Device1>& device, UINT SizeX, UINT SizeY, DXGI_FORMAT Format, HRESULT* Result = nullptr, DXGI_FORMAT DSVFormat = DXGI_FORMAT_UNKNOWN, DXGI_FORMAT SRVFormat = DXGI_FORMAT_UNKNOWN, UINT arraySize = 1, bool textureArray = false ) {
         HRESULT hr = S_OK;
 
-        if ( arraySize != 1 && arraySize != 6 ) {
-            LogError() << "Only supporting single render targets and cubemaps ATM. Unsupported Arraysize: " << arraySize;
+        // Without textureArray, an arraysize of 6 creates a cubemap
+        if ( arraySize == 0 || arraySize > 6 || (!textureArray && arraySize != 1 && arraySize != 6) ) {
+            LogError() << "Only supporting single render targets, texture arrays up to 6 slices and cubemaps ATM. Unsupported Arraysize: " << arraySize;
             return;
         }
 
+        const bool cubemap = !textureArray && arraySize == 6;
+        const bool sliced = textureArray || cubemap;
+
         if ( SizeX == 0 || SizeY == 0 ) {
             LogError() << L"SizeX or SizeY can't be 0";
         }
@@ -167,7 +182,7 @@ struct RenderToDepthStencilBuffer {
             1,
             D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE );
 
-        if ( arraySize > 1 )
+        if ( cubemap )
             Desc.MiscFlags |= D3D11_RESOURCE_MISC_TEXTURECUBE;
 
         LE( device->CreateTexture2D( &Desc, nullptr, Texture.GetAddressOf() ) );
@@ -177,12 +192,14 @@ struct RenderToDepthStencilBuffer {
             return;
         }
 
+        MemoryAllocation.Set( ResidencyManager::C_RENDER_TARGETS, ResidencyManager::GetTextureSize( Format, SizeX, SizeY, 1, arraySize ) );
+
         //Create a render target view
         D3D11_DEPTH_STENCIL_VIEW_DESC DescDSV = CD3D11_DEPTH_STENCIL_VIEW_DESC();
         ZeroMemory( &DescDSV, sizeof( DescDSV ) );
         DescDSV.Format = (DSVFormat != DXGI_FORMAT_UNKNOWN ? DSVFormat : Desc.Format);
 
-        if ( arraySize == 1 )
+        if ( !sliced )
             DescDSV.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
         else {
             DescDSV.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
@@ -195,10 +212,10 @@ struct RenderToDepthStencilBuffer {
 
         LE( device->CreateDepthStencilView( Texture.Get(), &DescDSV, DepthStencilView.GetAddressOf() ) );
 
-        if ( arraySize > 1 ) {
-            // Create the one-face render target views
+        if ( sliced ) {
+            // Create the one-face/one-slice render target views
             DescDSV.Texture2DArray.ArraySize = 1;
-            for ( int i = 0; i < 6; ++i ) {
+            for ( UINT i = 0; i < arraySize; ++i ) {
                 DescDSV.Texture2DArray.FirstArraySlice = i;
                 LE( device->CreateDepthStencilView( Texture.Get(), &DescDSV, CubeMapDSVs[i].GetAddressOf() ) );
             }
@@ -207,13 +224,21 @@ struct RenderToDepthStencilBuffer {
         // Create the resource view
         D3D11_SHADER_RESOURCE_VIEW_DESC DescRV = CD3D11_SHADER_RESOURCE_VIEW_DESC();
         DescRV.Format = (SRVFormat != DXGI_FORMAT_UNKNOWN ? SRVFormat : Desc.Format);
-        if ( arraySize > 1 )
+        if ( cubemap ) {
             DescRV.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
-        else
+            DescRV.TextureCube.MipLevels = 1;
+            DescRV.TextureCube.MostDetailedMip = 0;
+        } else if ( textureArray ) {
+            DescRV.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+            DescRV.Texture2DArray.MipLevels = 1;
+            DescRV.Texture2DArray.MostDetailedMip = 0;
+            DescRV.Texture2DArray.FirstArraySlice = 0;
+            DescRV.Texture2DArray.ArraySize = arraySize;
+        } else {
             DescRV.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-
-        DescRV.Texture2D.MipLevels = 1;
-        DescRV.Texture2D.MostDetailedMip = 0;
+            DescRV.Texture2D.MipLevels = 1;
+            DescRV.Texture2D.MostDetailedMip = 0;
+        }
 
         LE( device->CreateShaderResourceView( Texture.Get(), &DescRV, ShaderResView.GetAddressOf() ) );
 
@@ -241,9 +266,16 @@ struct RenderToDepthStencilBuffer {
     const Microsoft::WRL::ComPtr<ID3D11DepthStencilView>& GetDepthStencilView() const { return DepthStencilView; }
     UINT GetSizeX() const { return SizeX; }
     UINT GetSizeY() const { return SizeY; }
+    UINT GetArraySize() const { return ArraySize; }
 
     Microsoft::WRL::ComPtr<ID3D11DepthStencilView> GetDSVCubemapFace( UINT i ) { return CubeMapDSVs[i].Get(); }
 
+    /** Moves this buffer to another category of the video memory statistics */
+    void SetMemoryCategory( ResidencyManager::ECategory category ) { MemoryAllocation.SetCategory( category ); }
+
+    /** Returns the depth-stencil view of a single slice, if this is a texture array */
+    Microsoft::WRL::ComPtr<ID3D11DepthStencilView> GetDSVArraySlice( UINT i ) { return CubeMapDSVs[i].Get(); }
+
     //void SetTexture( Microsoft::WRL::ComPtr<ID3D11Texture2D> tx ) { Texture = tx.Get(); }
     //void SetShaderResView( Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv ) { ShaderResView = srv.Get(); }
     //void SetDepthStencilView( Microsoft::WRL::ComPtr<ID3D11DepthStencilView> dsv ) { DepthStencilView = dsv.Get(); }
@@ -255,11 +287,15 @@ private:
 
     UINT SizeX;
     UINT SizeY;
+    UINT ArraySize;
 
     // Shader and rendertarget resource views
     Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ShaderResView;
     Microsoft::WRL::ComPtr<ID3D11DepthStencilView> DepthStencilView;
 
-    // Rendertargets for the cubemap-faces, if this is a cubemap
+    // Rendertargets for the cubemap-faces or array slices, if this is a cubemap or texture array
     Microsoft::WRL::ComPtr<ID3D11DepthStencilView> CubeMapDSVs[6];
+
+    /** Registers the size of the texture with the residency manager */
+    ResidencyManager::Allocation MemoryAllocation;
 };
@@ -0,0 +1,344 @@
+#include "pch.h"
+#include "ResidencyManager.h"
+#include "Engine.h"
+#include "GothicAPI.h"
+#include "D3D7/MyDirectDrawSurface7.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+/** Eviction stops once usage is back below this part of the budget. Restoring needs to stay below the lower one,
+    so a restored texture doesn't get evicted again right away. */
+const double EVICTION_TARGET = 0.95;
+const double RESTORE_LIMIT = 0.9;
+
+/** Used when no budget is configured and the adapter memory is unknown */
+const uint64_t DEFAULT_BUDGET = 1536ull * 1024 * 1024;
+
+/** Keeps this part of the adapter memory for the driver and other applications */
+const double ADAPTER_MEMORY_USABLE = 0.8;
+
+/** Limits the work done per frame. Evictions need the immediate context, restores load in the background. */
+const unsigned int MAX_EVICTIONS_PER_FRAME = 32;
+const unsigned int MAX_RESTORES_PER_FRAME = 4;
+const unsigned int MAX_RESTORES_IN_FLIGHT = 16;
+
+static std::atomic<int64_t> UsageByCategory[ResidencyManager::C_NUM_CATEGORIES];
+static std::atomic<int> AllocationsByCategory[ResidencyManager::C_NUM_CATEGORIES];
+static std::atomic<uint64_t> AdapterMemory = 0;
+
+static thread_local ResidencyManager::ECategory BufferCategoryOverride = ResidencyManager::C_NUM_CATEGORIES;
+
+/** Surfaces are created and destroyed by the loader thread as well */
+static std::mutex SurfaceMutex;
+static std::unordered_set<MyDirectDrawSurface7*> Surfaces;
+static std::vector<MyDirectDrawSurface7*> RestoreQueue;
+
+/** Restores the worker finished loading. They are switched in one frame later, after the frame start
+    uploaded what they queued. Each holds a reference until then. */
+static std::vector<MyDirectDrawSurface7*> LoadedRestores;
+static std::vector<MyDirectDrawSurface7*> RestoresToSwap;
+static unsigned int NumRestoresInFlight = 0;
+
+/** Statistics since startup */
+static unsigned int NumEvictions = 0;
+static unsigned int NumRestores = 0;
+
+static const char* CATEGORY_NAMES[] = {
+    "World geometry",
+    "Vobs",
+    "Textures",
+    "Shadow maps",
+    "Render targets",
+    "Other"
+};
+
+ResidencyManager::Allocation::Allocation() {
+    Category = C_OTHER;
+    SizeInBytes = 0;
+}
+
+ResidencyManager::Allocation::~Allocation() {
+    Release();
+}
+
+/** Replaces the registered size, e.g. after the resource was recreated */
+void ResidencyManager::Allocation::Set( ECategory category, uint64_t sizeInBytes ) {
+    Release();
+
+    Category = category;
+    SizeInBytes = sizeInBytes;
+    UsageByCategory[Category] += static_cast<int64_t>(SizeInBytes);
+    AllocationsByCategory[Category]++;
+}
+
+/** Moves the allocation to another category */
+void ResidencyManager::Allocation::SetCategory( ECategory category ) {
+    if ( !SizeInBytes || category == Category ) {
+        Category = category;
+        return;
+    }
+
+    Set( category, SizeInBytes );
+}
+
+/** Removes the allocation from the statistics */
+void ResidencyManager::Allocation::Release() {
+    if ( !SizeInBytes )
+        return;
+
+    UsageByCategory[Category] -= static_cast<int64_t>(SizeInBytes);
+    AllocationsByCategory[Category]--;
+    SizeInBytes = 0;
+}
+
+ResidencyManager::ScopedBufferCategory::ScopedBufferCategory( ECategory category ) {
+    Previous = BufferCategoryOverride;
+    BufferCategoryOverride = category;
+}
+
+ResidencyManager::ScopedBufferCategory::~ScopedBufferCategory() {
+    BufferCategoryOverride = Previous;
+}
+
+/** Returns the category buffers of the given default category should be registered with on this thread */
+ResidencyManager::ECategory ResidencyManager::GetBufferCategory( ECategory defaultCategory ) {
+    return BufferCategoryOverride != C_NUM_CATEGORIES ? BufferCategoryOverride : defaultCategory;
+}
+
+/** Returns the size of a texture with the given layout, the way the driver is likely to store it */
+uint64_t ResidencyManager::GetTextureSize( DXGI_FORMAT format, UINT width, UINT height, UINT mipLevels, UINT arraySize ) {
+    UINT blockBytes = 0; // Only set for block compressed formats
+    UINT pixelBytes = 4;
+    switch ( format ) {
+    case DXGI_FORMAT_BC1_TYPELESS: case DXGI_FORMAT_BC1_UNORM: case DXGI_FORMAT_BC1_UNORM_SRGB:
+    case DXGI_FORMAT_BC4_TYPELESS: case DXGI_FORMAT_BC4_UNORM: case DXGI_FORMAT_BC4_SNORM:
+        blockBytes = 8;
+        break;
+
+    case DXGI_FORMAT_BC2_TYPELESS: case DXGI_FORMAT_BC2_UNORM: case DXGI_FORMAT_BC2_UNORM_SRGB:
+    case DXGI_FORMAT_BC3_TYPELESS: case DXGI_FORMAT_BC3_UNORM: case DXGI_FORMAT_BC3_UNORM_SRGB:
+    case DXGI_FORMAT_BC5_TYPELESS: case DXGI_FORMAT_BC5_UNORM: case DXGI_FORMAT_BC5_SNORM:
+    case DXGI_FORMAT_BC6H_TYPELESS: case DXGI_FORMAT_BC6H_UF16: case DXGI_FORMAT_BC6H_SF16:
+    case DXGI_FORMAT_BC7_TYPELESS: case DXGI_FORMAT_BC7_UNORM: case DXGI_FORMAT_BC7_UNORM_SRGB:
+        blockBytes = 16;
+        break;
+
+    case DXGI_FORMAT_R8_TYPELESS: case DXGI_FORMAT_R8_UNORM: case DXGI_FORMAT_R8_UINT: case DXGI_FORMAT_A8_UNORM:
+        pixelBytes = 1;
+        break;
+
+    case DXGI_FORMAT_R16_TYPELESS: case DXGI_FORMAT_R16_UNORM: case DXGI_FORMAT_R16_FLOAT: case DXGI_FORMAT_D16_UNORM:
+    case DXGI_FORMAT_R8G8_TYPELESS: case DXGI_FORMAT_R8G8_UNORM: case DXGI_FORMAT_B5G6R5_UNORM:
+        pixelBytes = 2;
+        break;
+
+    case DXGI_FORMAT_R16G16B16A16_TYPELESS: case DXGI_FORMAT_R16G16B16A16_FLOAT: case DXGI_FORMAT_R16G16B16A16_UNORM:
+    case DXGI_FORMAT_R32G32_TYPELESS: case DXGI_FORMAT_R32G32_FLOAT: case DXGI_FORMAT_R32G8X24_TYPELESS:
+        pixelBytes = 8;
+        break;
+
+    case DXGI_FORMAT_R32G32B32A32_TYPELESS: case DXGI_FORMAT_R32G32B32A32_FLOAT:
+        pixelBytes = 16;
+        break;
+
+    default:
+        break;
+    }
+
+    uint64_t size = 0;
+    for ( UINT mip = 0; mip < std::max( 1u, mipLevels ); mip++ ) {
+        uint64_t w = std::max( 1u, width >> mip );
+        uint64_t h = std::max( 1u, height >> mip );
+
+        if ( blockBytes )
+            size += ((w + 3) / 4) * ((h + 3) / 4) * blockBytes;
+        else
+            size += w * h * pixelBytes;
+    }
+    return size * std::max( 1u, arraySize );
+}
+
+/** Sets the dedicated memory of the adapter, used when no budget is configured */
+void ResidencyManager::SetAdapterMemory( uint64_t dedicatedVideoMemory ) {
+    AdapterMemory = dedicatedVideoMemory;
+    LogInfo() << "Video memory budget: " << GetBudget() / (1024 * 1024) << " MB (adapter has " << dedicatedVideoMemory / (1024 * 1024) << " MB)";
+}
+
+/** Returns the video memory allocated for the given category */
+uint64_t ResidencyManager::GetUsage( ECategory category ) {
+    return static_cast<uint64_t>(std::max<int64_t>( 0, UsageByCategory[category].load() ));
+}
+
+/** Returns the number of live allocations of the given category */
+unsigned int ResidencyManager::GetNumAllocations( ECategory category ) {
+    return static_cast<unsigned int>(std::max( 0, AllocationsByCategory[category].load() ));
+}
+
+/** Returns the video memory allocated in total */
+uint64_t ResidencyManager::GetTotalUsage() {
+    uint64_t total = 0;
+    for ( int i = 0; i < C_NUM_CATEGORIES; i++ ) {
+        total += GetUsage( static_cast<ECategory>(i) );
+    }
+    return total;
+}
+
+/** Returns the budget in bytes. Either the configured one or most of the adapter memory. */
+uint64_t ResidencyManager::GetBudget() {
+    int budgetMB = Engine::GAPI ? Engine::GAPI->GetRendererState().RendererSettings.VideoMemoryBudgetMB : 0;
+    if ( budgetMB > 0 )
+        return static_cast<uint64_t>(budgetMB) * 1024 * 1024;
+
+    if ( AdapterMemory )
+        return static_cast<uint64_t>(AdapterMemory * ADAPTER_MEMORY_USABLE);
+
+    return DEFAULT_BUDGET;
+}
+
+/** Returns the name of the given category */
+const char* ResidencyManager::GetCategoryName( ECategory category ) {
+    return category < C_NUM_CATEGORIES ? CATEGORY_NAMES[category] : "Unknown";
+}
+
+/** Surfaces register themselves, so their textures can be evicted */
+void ResidencyManager::RegisterSurface( MyDirectDrawSurface7* surface ) {
+    std::lock_guard<std::mutex> lock( SurfaceMutex );
+    Surfaces.insert( surface );
+}
+
+void ResidencyManager::UnregisterSurface( MyDirectDrawSurface7* surface ) {
+    std::lock_guard<std::mutex> lock( SurfaceMutex );
+    Surfaces.erase( surface );
+    RestoreQueue.erase( std::remove( RestoreQueue.begin(), RestoreQueue.end(), surface ), RestoreQueue.end() );
+}
+
+/** Called when an evicted surface is used again. It gets its mips back once there is room. */
+void ResidencyManager::RequestRestore( MyDirectDrawSurface7* surface ) {
+    std::lock_guard<std::mutex> lock( SurfaceMutex );
+    RestoreQueue.push_back( surface );
+}
+
+/** Restores and evicts textures. Called once per frame on the main thread. */
+void ResidencyManager::Update() {
+    FinishRestores();
+
+    uint64_t budget = GetBudget();
+    uint64_t usage = GetTotalUsage();
+
+    if ( usage > budget ) {
+        EvictTextures( usage - static_cast<uint64_t>(budget * EVICTION_TARGET) );
+    } else {
+        RestoreTextures();
+    }
+
+    UpdateRendererInfo();
+}
+
+/** Drops mips of the least recently bound surfaces until the given amount of memory is free */
+void ResidencyManager::EvictTextures( uint64_t bytesToFree ) {
+    std::lock_guard<std::mutex> lock( SurfaceMutex );
+    const unsigned int frame = Engine::GAPI->GetFrameNumber();
+
+    // Anything drawn this frame stays, it would only come back next frame
+    std::vector<MyDirectDrawSurface7*> candidates;
+    for ( MyDirectDrawSurface7* surface : Surfaces ) {
+        if ( surface->GetLastBoundFrame() < frame && surface->CanEvictMip() )
+            candidates.push_back( surface );
+    }
+
+    std::sort( candidates.begin(), candidates.end(), []( MyDirectDrawSurface7* a, MyDirectDrawSurface7* b ) {
+        return a->GetLastBoundFrame() < b->GetLastBoundFrame();
+    } );
+
+    uint64_t freed = 0;
+    unsigned int numEvicted = 0;
+    for ( MyDirectDrawSurface7* surface : candidates ) {
+        if ( freed >= bytesToFree || numEvicted >= MAX_EVICTIONS_PER_FRAME )
+            break;
+
+        freed += surface->EvictMip();
+        numEvicted++;
+    }
+
+    NumEvictions += numEvicted;
+}
+
+/** Starts reloading the full mip chain of queued surfaces while they fit into the budget */
+void ResidencyManager::RestoreTextures() {
+    uint64_t limit = static_cast<uint64_t>(GetBudget() * RESTORE_LIMIT);
+
+    for ( unsigned int i = 0; i < MAX_RESTORES_PER_FRAME && NumRestoresInFlight < MAX_RESTORES_IN_FLIGHT; i++ ) {
+        MyDirectDrawSurface7* surface;
+        {
+            std::lock_guard<std::mutex> lock( SurfaceMutex );
+            if ( RestoreQueue.empty() )
+                return;
+
+            surface = RestoreQueue.front();
+            if ( GetTotalUsage() + surface->GetMemoryToRestore() > limit )
+                return;
+
+            RestoreQueue.erase( RestoreQueue.begin() );
+
+            // Keep it alive until the restored texture is switched in
+            surface->AddRef();
+        }
+
+        if ( !surface->BeginRestore() ) {
+            surface->Release();
+            continue;
+        }
+
+        // Reading and converting the texture takes too long for the render thread, the old mips are drawn meanwhile.
+        // The loads serialize on the resource manager anyway, one thread keeps them from blocking the workers.
+        NumRestoresInFlight++;
+        Engine::RestoreThreadPool->enqueue( [surface]() {
+            surface->LoadRestoredMips();
+
+            std::lock_guard<std::mutex> lock( SurfaceMutex );
+            LoadedRestores.push_back( surface );
+        } );
+    }
+}
+
+/** Switches in the textures which finished loading before the last frame start */
+void ResidencyManager::FinishRestores() {
+    for ( MyDirectDrawSurface7* surface : RestoresToSwap ) {
+        surface->FinishRestore();
+        surface->Release();
+        NumRestoresInFlight--;
+        NumRestores++;
+    }
+    RestoresToSwap.clear();
+
+    std::lock_guard<std::mutex> lock( SurfaceMutex );
+    RestoresToSwap.swap( LoadedRestores );
+}
+
+/** Copies the usage into the renderer info, for the frame stats */
+void ResidencyManager::UpdateRendererInfo() {
+    GothicRendererInfo& info = Engine::GAPI->GetRendererState().RendererInfo;
+    info.VideoMemoryTotalMB = static_cast<int>(GetTotalUsage() / (1024 * 1024));
+    info.VideoMemoryBudgetMB = static_cast<int>(GetBudget() / (1024 * 1024));
+    info.VideoMemoryWorldMB = static_cast<int>(GetUsage( C_WORLD_GEOMETRY ) / (1024 * 1024));
+    info.VideoMemoryVobsMB = static_cast<int>(GetUsage( C_VOBS ) / (1024 * 1024));
+    info.VideoMemoryTexturesMB = static_cast<int>(GetUsage( C_TEXTURES ) / (1024 * 1024));
+    info.VideoMemoryShadowMapsMB = static_cast<int>(GetUsage( C_SHADOW_MAPS ) / (1024 * 1024));
+    info.VideoMemoryRenderTargetsMB = static_cast<int>(GetUsage( C_RENDER_TARGETS ) / (1024 * 1024));
+    info.VideoMemoryMipsEvicted = static_cast<int>(NumEvictions);
+    info.VideoMemoryTexturesRestored = static_cast<int>(NumRestores);
+}
+
+/** Writes the usage of each category to the log */
+void ResidencyManager::LogBreakdown() {
+    LogInfo() << "Video memory: " << GetTotalUsage() / (1024 * 1024) << " of " << GetBudget() / (1024 * 1024) << " MB used, "
+        << NumEvictions << " mips evicted and " << NumRestores << " textures restored so far";
+
+    for ( int i = 0; i < C_NUM_CATEGORIES; i++ ) {
+        ECategory category = static_cast<ECategory>(i);
+        LogInfo() << "  " << GetCategoryName( category ) << ": " << GetUsage( category ) / (1024 * 1024) << " MB in "
+            << GetNumAllocations( category ) << " allocations";
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "pch.h"
+
+class MyDirectDrawSurface7;
+
+/** Keeps track of the video memory allocated by the renderer and keeps it inside a budget. When over budget,
+    the least recently bound game textures lose their top mips until they are used again. */
+class ResidencyManager {
+public:
+    enum ECategory {
+        C_WORLD_GEOMETRY,
+        C_VOBS,
+        C_TEXTURES,
+        C_SHADOW_MAPS,
+        C_RENDER_TARGETS,
+        C_OTHER,
+        C_NUM_CATEGORIES
+    };
+
+    /** One GPU resource. Registers its size on creation and removes it again when destroyed. */
+    class Allocation {
+    public:
+        Allocation();
+        ~Allocation();
+
+        Allocation( const Allocation& ) = delete;
+        Allocation& operator=( const Allocation& ) = delete;
+
+        /** Replaces the registered size, e.g. after the resource was recreated */
+        void Set( ECategory category, uint64_t sizeInBytes );
+
+        /** Moves the allocation to another category */
+        void SetCategory( ECategory category );
+
+        /** Removes the allocation from the statistics */
+        void Release();
+
+        ECategory GetCategory() const { return Category; }
+        uint64_t GetSize() const { return SizeInBytes; }
+
+    private:
+        ECategory Category;
+        uint64_t SizeInBytes;
+    };
+
+    /** Overrides the category of all buffers created by this thread while it exists, e.g. for the world converter */
+    class ScopedBufferCategory {
+    public:
+        ScopedBufferCategory( ECategory category );
+        ~ScopedBufferCategory();
+
+    private:
+        ECategory Previous;
+    };
+
+    /** Returns the category buffers of the given default category should be registered with on this thread */
+    static ECategory GetBufferCategory( ECategory defaultCategory );
+
+    /** Returns the size of a texture with the given layout, the way the driver is likely to store it */
+    static uint64_t GetTextureSize( DXGI_FORMAT format, UINT width, UINT height, UINT mipLevels, UINT arraySize = 1 );
+
+    /** Sets the dedicated memory of the adapter, used when no budget is configured */
+    static void SetAdapterMemory( uint64_t dedicatedVideoMemory );
+
+    /** Returns the video memory allocated for the given category */
+    static uint64_t GetUsage( ECategory category );
+
+    /** Returns the number of live allocations of the given category */
+    static unsigned int GetNumAllocations( ECategory category );
+
+    /** Returns the video memory allocated in total */
+    static uint64_t GetTotalUsage();
+
+    /** Returns the budget in bytes. Either the configured one or most of the adapter memory. */
+    static uint64_t GetBudget();
+
+    /** Returns the name of the given category */
+    static const char* GetCategoryName( ECategory category );
+
+    /** Surfaces register themselves, so their textures can be evicted */
+    static void RegisterSurface( MyDirectDrawSurface7* surface );
+    static void UnregisterSurface( MyDirectDrawSurface7* surface );
+
+    /** Called when an evicted surface is used again. It gets its mips back once there is room. */
+    static void RequestRestore( MyDirectDrawSurface7* surface );
+
+    /** Restores and evicts textures. Called once per frame on the main thread. */
+    static void Update();
+
+    /** Writes the usage of each category to the log */
+    static void LogBreakdown();
+
+private:
+    /** Drops mips of the least recently bound surfaces until the given amount of memory is free */
+    static void EvictTextures( uint64_t bytesToFree );
+
+    /** Starts reloading the full mip chain of queued surfaces while they fit into the budget */
+    static void RestoreTextures();
+
+    /** Switches in the textures which finished loading before the last frame start */
+    static void FinishRestores();
+
+    /** Copies the usage into the renderer info, for the frame stats */
+    static void UpdateRendererInfo();
+};
@@ -2,6 +2,7 @@
 
 #include "D2DView.h"
 #include "D3D11GraphicsEngine.h"
+#include "D3D11ShaderManager.h"
 #include "RenderToTextureBuffer.h"
 #include "SV_Panel.h"
 #include "zCTexture.h"
@@ -175,6 +176,9 @@ void SV_GMeshInfoView::DrawMeshes() {
 	g->SetupVS_ExConstantBuffer();
 	g->SetupVS_ExPerInstanceConstantBuffer();
 
+	// Static mesh visuals may hold compressed vertices
+	MeshVisualInfo* meshVisual = dynamic_cast<MeshVisualInfo*>(VisualInfo);
+
 #if ENABLE_TESSELATION > 0
 	VisualTesselationSettings* ts = nullptr;
 	if ( VisualInfo )
@@ -204,10 +208,15 @@ void SV_GMeshInfoView::DrawMeshes() {
 			g->SetActiveHDShader( "" );
 			g->SetActiveVertexShader( "VS_Ex" );
 
+			UINT vertexStride = sizeof( ExVertexStruct );
+			if ( meshVisual ) {
+				vertexStride = g->ApplyStaticMeshVertexShader( meshVisual, g->GetActiveVS(), g->GetShaderManager().GetVShader( g->GetHotShaders().VS_ExCompressed ) );
+			}
+
 			if ( it->first && it->first->CacheIn( -1 ) == zRES_CACHED_IN ) {
 				// Draw
 				it->first->Bind( 0 );
-				g->DrawVertexBufferIndexed( it->second->MeshVertexBuffer, it->second->MeshIndexBuffer, it->second->Indices.size() );
+				g->DrawVertexBufferIndexed( it->second->MeshVertexBuffer, it->second->MeshIndexBuffer, it->second->Indices.size(), 0, vertexStride );
 			}
 		}
 	}
@@ -0,0 +1,78 @@
+#ifndef _BLOOM_FILTER_H
+#define _BLOOM_FILTER_H
+
+float2 GetTexelSize(Texture2D tx)
+{
+	float2 size;
+	tx.GetDimensions(size.x, size.y);
+	return 1.0f / size;
+}
+
+// 4x4 texel box from 4 bilinear taps, for a quarter resolution target. Each tap is weighted by its
+// inverse luminance (Karis average), so single very bright pixels don't flicker through the bloom.
+float3 BloomPrefilterBox4(Texture2D tx, SamplerState ss, float2 uv, float3 lumConvert)
+{
+	float2 texel = GetTexelSize(tx);
+	
+	float3 a = tx.SampleLevel(ss, uv + texel * float2(-1, -1), 0).rgb;
+	float3 b = tx.SampleLevel(ss, uv + texel * float2( 1, -1), 0).rgb;
+	float3 c = tx.SampleLevel(ss, uv + texel * float2(-1,  1), 0).rgb;
+	float3 d = tx.SampleLevel(ss, uv + texel * float2( 1,  1), 0).rgb;
+	
+	float wa = 1.0f / (1.0f + dot(a, lumConvert));
+	float wb = 1.0f / (1.0f + dot(b, lumConvert));
+	float wc = 1.0f / (1.0f + dot(c, lumConvert));
+	float wd = 1.0f / (1.0f + dot(d, lumConvert));
+	
+	return (a * wa + b * wb + c * wc + d * wd) / (wa + wb + wc + wd);
+}
+
+// 13 bilinear taps over 6x6 texels of the source, as five overlapping 4x4 boxes. The center box
+// counts half, the corner boxes an eighth each (Jimenez, "Next Generation Post Processing in Call of Duty: AW").
+float3 BloomDownsample13(Texture2D tx, SamplerState ss, float2 uv)
+{
+	float2 texel = GetTexelSize(tx);
+	
+	float3 a = tx.SampleLevel(ss, uv + texel * float2(-2, -2), 0).rgb;
+	float3 b = tx.SampleLevel(ss, uv + texel * float2( 0, -2), 0).rgb;
+	float3 c = tx.SampleLevel(ss, uv + texel * float2( 2, -2), 0).rgb;
+	float3 d = tx.SampleLevel(ss, uv + texel * float2(-1, -1), 0).rgb;
+	float3 e = tx.SampleLevel(ss, uv + texel * float2( 1, -1), 0).rgb;
+	float3 f = tx.SampleLevel(ss, uv + texel * float2(-2,  0), 0).rgb;
+	float3 g = tx.SampleLevel(ss, uv, 0).rgb;
+	float3 h = tx.SampleLevel(ss, uv + texel * float2( 2,  0), 0).rgb;
+	float3 i = tx.SampleLevel(ss, uv + texel * float2(-1,  1), 0).rgb;
+	float3 j = tx.SampleLevel(ss, uv + texel * float2( 1,  1), 0).rgb;
+	float3 k = tx.SampleLevel(ss, uv + texel * float2(-2,  2), 0).rgb;
+	float3 l = tx.SampleLevel(ss, uv + texel * float2( 0,  2), 0).rgb;
+	float3 m = tx.SampleLevel(ss, uv + texel * float2( 2,  2), 0).rgb;
+	
+	float3 result = (d + e + i + j) * (0.5f / 4.0f);
+	result += (a + b + f + g) * (0.125f / 4.0f);
+	result += (b + c + g + h) * (0.125f / 4.0f);
+	result += (f + g + k + l) * (0.125f / 4.0f);
+	result += (g + h + l + m) * (0.125f / 4.0f);
+	return result;
+}
+
+// 3x3 tent filter with 9 taps, radius in texels of the (smaller) source
+float3 BloomUpsampleTent(Texture2D tx, SamplerState ss, float2 uv, float radius)
+{
+	float4 d = GetTexelSize(tx).xyxy * float4(1, 1, -1, 0) * radius;
+	
+	float3 s = tx.SampleLevel(ss, uv - d.xy, 0).rgb;
+	s += tx.SampleLevel(ss, uv - d.wy, 0).rgb * 2.0f;
+	s += tx.SampleLevel(ss, uv - d.zy, 0).rgb;
+	
+	s += tx.SampleLevel(ss, uv + d.zw, 0).rgb * 2.0f;
+	s += tx.SampleLevel(ss, uv, 0).rgb * 4.0f;
+	s += tx.SampleLevel(ss, uv + d.xw, 0).rgb * 2.0f;
+	
+	s += tx.SampleLevel(ss, uv + d.zy, 0).rgb;
+	s += tx.SampleLevel(ss, uv + d.wy, 0).rgb * 2.0f;
+	s += tx.SampleLevel(ss, uv + d.xy, 0).rgb;
+	
+	return s * (1.0f / 16.0f);
+}
+
+#endif
@@ -0,0 +1,62 @@
+//--------------------------------------------------------------------------------------
+// Average luminance from the histogram and eye adaption, in a single group
+//--------------------------------------------------------------------------------------
+
+#include <LumHistogram.h>
+
+RWByteAddressBuffer RW_Histogram : register( u0 );
+RWBuffer<float> RW_AdaptedLum : register( u1 );
+
+groupshared float g_Counts[LUM_HISTOGRAM_NUM_BINS];
+
+//--------------------------------------------------------------------------------------
+// Compute Shader
+//--------------------------------------------------------------------------------------
+[numthreads(LUM_HISTOGRAM_NUM_BINS, 1, 1)]
+void CSMain( uint GroupIndex : SV_GroupIndex )
+{
+	// Take the bins and clear them for the next frame
+	g_Counts[GroupIndex] = (float)RW_Histogram.Load(GroupIndex * 4);
+	RW_Histogram.Store(GroupIndex * 4, 0);
+	
+	GroupMemoryBarrierWithGroupSync();
+	
+	if (GroupIndex != 0)
+		return;
+	
+	// Geometric mean of the pixels between the low and high percentile. Clipping both ends keeps a few
+	// bright lights or a dark corner from pulling the exposure around.
+	float total = 0;
+	for (uint i = 0; i < LUM_HISTOGRAM_NUM_BINS; i++)
+	{
+		total += g_Counts[i];
+	}
+	
+	float low = total * LH_LowPercentile;
+	float high = total * max(LH_HighPercentile, LH_LowPercentile);
+	
+	// Only take the part of each bin which lies inside the window
+	float below = 0;
+	float sumLog2 = 0;
+	float weight = 0;
+	for (uint b = 0; b < LUM_HISTOGRAM_NUM_BINS; b++)
+	{
+		float count = g_Counts[b];
+		float inside = max(0, min(below + count, high) - max(below, low));
+		float binLog2 = LH_MinLog2Luminance + (b + 0.5f) * LH_Log2LuminanceRange / LUM_HISTOGRAM_NUM_BINS;
+		
+		sumLog2 += inside * binLog2;
+		weight += inside;
+		below += count;
+	}
+	
+	float currentLum = weight > 0 ? exp2(sumLog2 / weight) : LH_MinLuminance;
+	
+	// Adapt the luminance using Pattanaik's technique, start at the target if nothing was adapted yet
+	float lastLum = RW_AdaptedLum[0];
+	if (!(lastLum > 0))
+		lastLum = currentLum;
+	
+	float adaptedLum = lastLum + (currentLum - lastLum) * (1 - exp(-LH_DeltaTime * LH_AdaptionRate));
+	RW_AdaptedLum[0] = clamp(adaptedLum, 0, LH_MaxAdaptedLuminance);
+}
@@ -0,0 +1,67 @@
+//--------------------------------------------------------------------------------------
+// Luminance histogram of the HDR-Backbuffer, one pixel per thread. Since every pixel is
+// read here anyways, this also writes the 4x4 box filtered input of the bloom chain.
+//--------------------------------------------------------------------------------------
+
+#include <LumHistogram.h>
+
+#define GROUP_SIZE 16
+
+Texture2D	TX_Scene : register( t0 );
+RWByteAddressBuffer RW_Histogram : register( u0 );
+RWTexture2D<float4> RW_BloomPrefilter : register( u1 );
+
+groupshared uint g_Bins[LUM_HISTOGRAM_NUM_BINS];
+groupshared float4 g_BloomTaps[GROUP_SIZE * GROUP_SIZE];
+
+//--------------------------------------------------------------------------------------
+// Compute Shader
+//--------------------------------------------------------------------------------------
+[numthreads(GROUP_SIZE, GROUP_SIZE, 1)]
+void CSMain( uint3 DispatchThreadID : SV_DispatchThreadID, uint3 GroupThreadID : SV_GroupThreadID, uint GroupIndex : SV_GroupIndex )
+{
+	if (GroupIndex < LUM_HISTOGRAM_NUM_BINS)
+		g_Bins[GroupIndex] = 0;
+	
+	GroupMemoryBarrierWithGroupSync();
+	
+	// Count into the group first, so only one atomic per bin and group goes to memory
+	float4 bloomTap = 0;
+	if (DispatchThreadID.x < LH_Width && DispatchThreadID.y < LH_Height)
+	{
+		float3 color = TX_Scene.Load(int3(DispatchThreadID.xy, 0)).rgb;
+		float pixelLum = dot(color, LUM_CONVERT_HISTOGRAM);
+		float lum = max(LH_MinLuminance, pixelLum);
+		
+		float t = saturate((log2(lum) - LH_MinLog2Luminance) / LH_Log2LuminanceRange);
+		uint bin = min((uint)(t * LUM_HISTOGRAM_NUM_BINS), LUM_HISTOGRAM_NUM_BINS - 1);
+		
+		InterlockedAdd(g_Bins[bin], 1);
+		
+		// Weighted by inverse luminance (Karis average), so single very bright pixels don't flicker through the bloom
+		float weight = 1.0f / (1.0f + max(0, pixelLum));
+		bloomTap = float4(color * weight, weight);
+	}
+	g_BloomTaps[GroupIndex] = bloomTap;
+	
+	GroupMemoryBarrierWithGroupSync();
+	
+	if (GroupIndex < LUM_HISTOGRAM_NUM_BINS && g_Bins[GroupIndex] > 0)
+		RW_Histogram.InterlockedAdd(GroupIndex * 4, g_Bins[GroupIndex]);
+	
+	// One thread per 4x4 block writes its average
+	if ((GroupThreadID.x & 3) == 0 && (GroupThreadID.y & 3) == 0)
+	{
+		float4 sum = 0;
+		for (uint y = 0; y < 4; y++)
+		{
+			for (uint x = 0; x < 4; x++)
+			{
+				sum += g_BloomTaps[(GroupThreadID.y + y) * GROUP_SIZE + GroupThreadID.x + x];
+			}
+		}
+		
+		if (sum.w > 0)
+			RW_BloomPrefilter[DispatchThreadID.xy / 4] = float4(sum.rgb / sum.w, 1);
+	}
+}
@@ -134,15 +134,16 @@ float4 GetColorFromStates(float4 diffuse, float2 uv, float2 uv2, SamplerState sa
 {		
 	float4 color = __runStage(FF_Stages[0].colorop, FF_Stages[0].colorarg1, FF_Stages[0].colorarg2, diffuse, diffuse, texture0, uv, samplerState);
 	
-	if(FF_Stages[1].colorop != D3DTOP_DISABLE)
-	{
-		color = __runStage(FF_Stages[1].colorop, FF_Stages[1].colorarg1, FF_Stages[1].colorarg2, color, diffuse, texture1, uv2, samplerState);
-	}
+	// The variants of PS_FixedFunctionPipe decide these on the CPU, so the shader doesn't branch on the states
+#if FF_SECOND_STAGE
+	color = __runStage(FF_Stages[1].colorop, FF_Stages[1].colorarg1, FF_Stages[1].colorarg2, color, diffuse, texture1, uv2, samplerState);
+#endif
 	
 	float4 alpha = color;//__runStage(FF_Stages[0].alphaop, FF_Stages[0].alphaarg1, FF_Stages[0].alphaarg2, diffuse, diffuse, texture0, uv, samplerState);
 
-	if(FF_AlphaTestEnabled())
-		DoAlphaTest(alpha.a);
+#if FF_ALPHATEST
+	DoAlphaTest(alpha.a);
+#endif
 	
 	//return textureFactor;
 	return float4(color.rgb, alpha.a);
@@ -0,0 +1,74 @@
+#ifndef _HBAO_H
+#define _HBAO_H
+
+// Constants shared with HBAOKernel
+
+// Must match HBAOKernel::PATTERN_SIZE
+#define HBAO_PATTERN_SIZE 4
+
+// Must match HBAOKernel::MAX_RADIUS_PIXELS
+static const float HBAO_MAX_RADIUS_PIXELS = 64.0f;
+
+// Must match HBAOKernel::TEMPORAL_BLEND and TEMPORAL_DEPTH_TOLERANCE
+static const float HBAO_TEMPORAL_BLEND = 0.15f;
+static const float HBAO_TEMPORAL_DEPTH_TOLERANCE = 0.05f;
+
+// Must match HBAOKernel::BILATERAL_DEPTH_SCALE
+static const float HBAO_BILATERAL_DEPTH_SCALE = 16.0f;
+
+static const float HBAO_PI = 3.14159265f;
+
+cbuffer HBAOConstantBuffer : register( b0 )
+{
+	float4 AO_Jitter[HBAO_PATTERN_SIZE * HBAO_PATTERN_SIZE];
+	
+	matrix AO_ViewToPrevClip;
+	
+	float4 AO_ProjParams;
+	
+	float2 AO_InvSize;
+	float2 AO_Size;
+	
+	float2 AO_FullSize;
+	float AO_RadiusToScreen;
+	float AO_NegInvRadius2;
+	
+	float AO_Bias;
+	float AO_PowerExponent;
+	int AO_NumDirections;
+	int AO_NumSteps;
+	
+	float AO_BlurSharpness;
+	float AO_UpsampleRadius;
+	float AO_HistoryValid;
+	float AO_Pad;
+};
+
+Texture2D	TX_Depth : register( t0 );
+
+//--------------------------------------------------------------------------------------
+// Returns the view-space depth of a value of the (reversed) depthbuffer
+//--------------------------------------------------------------------------------------
+float GetViewDepth(float depth)
+{
+	return AO_ProjParams.w / (depth - AO_ProjParams.z);
+}
+
+//--------------------------------------------------------------------------------------
+// Returns the view-space position of a texcoord at the given view-space depth
+//--------------------------------------------------------------------------------------
+float3 GetViewPosition(float2 uv, float viewZ)
+{
+	return float3((uv * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f)) * viewZ / AO_ProjParams.xy, viewZ);
+}
+
+//--------------------------------------------------------------------------------------
+// Returns the view-space position of the full resolution pixel under a texcoord
+//--------------------------------------------------------------------------------------
+float3 FetchViewPosition(float2 uv)
+{
+	int2 pixel = clamp(int2(uv * AO_FullSize), 0, int2(AO_FullSize) - 1);
+	return GetViewPosition(uv, GetViewDepth(TX_Depth.Load(int3(pixel, 0)).r));
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef _HEIGHTFOG_H
+#define _HEIGHTFOG_H
+
+#include <AtmosphericScattering.h>
+
+// The heightfog pass has this at b0, the fused HDR composite moves it behind its own buffers
+#ifndef HEIGHTFOG_CB_REGISTER
+#define HEIGHTFOG_CB_REGISTER b0
+#endif
+
+cbuffer PFXBuffer : register( HEIGHTFOG_CB_REGISTER )
+{
+	matrix HF_InvProj;
+	matrix HF_InvView;
+	float3 HF_CameraPosition;
+	float HF_FogHeight;
+
+	float HF_HeightFalloff;
+	float HF_GlobalDensity;
+	float HF_WeightZNear;
+	float HF_WeightZFar;
+
+	float3 HF_FogColorMod;
+	float HF_pad2;
+
+	float2 HF_ProjAB;
+	float2 HF_Pad3;
+};
+
+float3 VSPositionFromDepth(float depth, float2 vTexCoord)
+{
+	// Get NDC clip-space position
+	float4 vProjectedPos = float4(vTexCoord * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), depth, 1.0f);
+
+	// Transform by the inverse projection matrix
+	float4 vPositionVS = mul(vProjectedPos, HF_InvProj); //invViewProj == invProjection here
+
+	// Divide by w to get the view-space position
+	return vPositionVS.xyz / vPositionVS.www;
+}
+
+float ComputeVolumetricFog(float3 cameraToWorldPos, float3 posOriginal)
+{	
+	float cVolFogHeightDensityAtViewer = exp( -HF_HeightFalloff );
+	
+	float lenOrig = length(posOriginal - HF_CameraPosition);
+	float len = length(cameraToWorldPos);
+	float fogInt = len * cVolFogHeightDensityAtViewer;
+	const float	cSlopeThreshold = 0.01;
+	
+	float w = saturate((lenOrig-HF_WeightZNear)/(HF_WeightZFar-HF_WeightZNear));
+
+	if(abs( cameraToWorldPos.y ) > cSlopeThreshold )
+	{
+		float t = HF_HeightFalloff * cameraToWorldPos.y * w;
+		fogInt *= (	1.0	- exp( -t ) ) / t;
+		
+	}
+	
+	
+	
+	return	exp( -HF_GlobalDensity * w * fogInt);
+}
+
+// Fog color in rgb and its opacity in alpha, for the given depthbuffer value
+float4 ComputeHeightfog(float expDepth, float2 vTexCoord)
+{
+	float3 position = VSPositionFromDepth(expDepth, vTexCoord);
+	
+	
+	position = mul(float4(position, 1), HF_InvView).xyz;
+	float3 posOriginal = position;
+	
+	position -= HF_CameraPosition;
+	
+	position.y -= HF_FogHeight;
+	
+	float fog = 1.0f - ComputeVolumetricFog(position, posOriginal);
+		
+	float3 color = ApplyAtmosphericScatteringGround(position, HF_FogColorMod, true);
+
+	//darken / lighten fog based on the day / night cycle
+	float darknessFactor = 2.0f;
+	if (AC_LightPos.y < 0.0f) { darknessFactor -= AC_LightPos.y * 3.0f; }
+	else if (AC_LightPos.y > 0.0f) { darknessFactor -= AC_LightPos.y; }
+
+	return float4(saturate(color / darknessFactor), saturate(fog));
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef _LUM_HISTOGRAM_H
+#define _LUM_HISTOGRAM_H
+
+// Must match LuminanceHistogram::NUM_BINS
+#define LUM_HISTOGRAM_NUM_BINS 64
+
+static const float3 LUM_CONVERT_HISTOGRAM = float3(0.333f, 0.333f, 0.333f);
+
+cbuffer LumHistogramCB : register( b0 )
+{
+	float LH_MinLog2Luminance;
+	float LH_Log2LuminanceRange;
+	float LH_MinLuminance;
+	float LH_MaxAdaptedLuminance;
+	
+	float LH_LowPercentile;
+	float LH_HighPercentile;
+	float LH_DeltaTime;
+	float LH_AdaptionRate;
+	
+	uint LH_Width;
+	uint LH_Height;
+	float2 LH_Pad;
+};
+
+#endif
@@ -5,6 +5,8 @@
 
 #include <AtmosphericScattering.h>
 
+#define MAX_SHADOW_CASCADES 4
+
 cbuffer DS_ScreenQuadConstantBuffer : register( b0 )
 {
 	matrix SQ_InvProj; // Optimize out!
@@ -27,6 +29,11 @@ cbuffer DS_ScreenQuadConstantBuffer : register( b0 )
 	float SQ_ShadowAOStrength;
 	float SQ_WorldAOStrength;
 	float SQ_Pad;
+	
+	matrix SQ_CascadeViewProj[MAX_SHADOW_CASCADES];
+	float4 SQ_CascadeBias;
+	float SQ_NumShadowCascades;
+	float3 SQ_CascadePad;
 };
 
 //--------------------------------------------------------------------------------------
@@ -38,7 +45,7 @@ SamplerComparisonState SS_Comp : register( s2 );
 Texture2D	TX_Diffuse : register( t0 );
 Texture2D	TX_Nrm : register( t1 );
 Texture2D	TX_Depth : register( t2 );
-Texture2D	TX_Shadowmap : register( t3 );
+Texture2DArray	TX_Shadowmap : register( t3 );
 Texture2D	TX_RainShadowmap : register( t4 );
 TextureCube	TX_ReflectionCube : register( t5 );
 Texture2D	TX_Distortion : register( t6 );
@@ -79,15 +86,6 @@ float2 TexOffset( int u, int v )
     return float2( u * 1.0f/SQ_ShadowmapSize, v * 1.0f/SQ_ShadowmapSize );
 }
 
-float IsInShadow(float3 wsPosition, Texture2D shadowmap, SamplerComparisonState samplerState)
-{
-	float4 vShadowSamplingPos = mul(float4(wsPosition, 1), mul(SQ_ShadowView, SQ_ShadowProj));
-	vShadowSamplingPos.xyz /= vShadowSamplingPos.www;
-	
-	float2 projectedTexCoords = vShadowSamplingPos.xy * float2(0.5f, -0.5f) + float2(0.5f, 0.5f);
-	return shadowmap.SampleCmpLevelZero(samplerState, projectedTexCoords.xy, vShadowSamplingPos.z);
-}
-
 float IsWet(float3 wsPosition, Texture2D shadowmap, SamplerComparisonState samplerState, matrix viewProj)
 {
 	float4 vShadowSamplingPos = mul(float4(wsPosition, 1), mul(SQ_RainView, SQ_RainProj));
@@ -164,6 +162,62 @@ float ComputeShadowValue(float2 uv, float3 wsPosition, Texture2D shadowmap, Samp
 	return saturate(shadow);
 }
 
+/** Samples one cascade of the sun shadowmap */
+float SampleShadowCascade(float2 uv, float depth, int cascade)
+{
+#if SHD_FILTER_16TAP_PCF
+	//perform PCF filtering on a 4 x 4 texel neighborhood
+	float sum = 0;
+	[unroll] for (float y = -1.5; y <= 1.5; y += 1.0)
+	{
+		[unroll] for (float x = -1.5; x <= 1.5; x += 1.0)
+		{
+			sum += TX_Shadowmap.SampleCmpLevelZero( SS_Comp, float3(uv + TexOffset(x,y), cascade), depth);
+		}
+	}
+	
+	return sum / 16.0;
+#else
+	return TX_Shadowmap.SampleCmpLevelZero( SS_Comp, float3(uv, cascade), depth);
+#endif
+}
+
+/** Picks the first cascade containing the position and returns its shadow value */
+float ComputeCascadedShadowValue(float3 wsPosition, float vertLighting)
+{
+	// Stay away from the border by the size of the filter
+	const float margin = 2.0f / SQ_ShadowmapSize;
+	
+	[unroll] for (int i = 0; i < MAX_SHADOW_CASCADES; i++)
+	{
+		if(i >= (int)SQ_NumShadowCascades)
+			break;
+		
+		float4 vShadowSamplingPos = mul(float4(wsPosition, 1), SQ_CascadeViewProj[i]);
+		float2 projectedTexCoords = vShadowSamplingPos.xy * float2(0.5f, -0.5f) + float2(0.5f, 0.5f);
+		
+		if(all(projectedTexCoords > margin) && all(projectedTexCoords < 1.0f - margin) && vShadowSamplingPos.z < 1.0f)
+		{
+			float shadow = SampleShadowCascade(projectedTexCoords, vShadowSamplingPos.z - SQ_CascadeBias[i], i);
+			
+			// Fade out to the vertex lighting at the end of the last cascade
+			if(i == (int)SQ_NumShadowCascades - 1)
+			{
+				float border;
+				border = pow(abs(projectedTexCoords.x), 16.0f);
+				border += pow(abs(projectedTexCoords.y), 16.0f);
+				border += pow(abs(1.0f-projectedTexCoords.x), 16.0f);
+				border += pow(abs(1.0f-projectedTexCoords.y), 16.0f);
+				shadow = lerp(shadow, vertLighting, saturate(border));
+			}
+			
+			return saturate(shadow);
+		}
+	}
+	
+	return vertLighting;
+}
+
 static const float WEIGHT_BIAS = -0.55;
 static const float WEIGHT_MUL = 0.7;
 
@@ -327,9 +381,12 @@ float4 PSMain( PS_INPUT Input ) : SV_TARGET
 	//return float4(mul(float4(wsPosition, 1), mul(SQ_ShadowView, SQ_ShadowProj)).xyz, 1);
 	
 	// Get shadowing
+#if SUN_BELOW_HORIZON
+	// Night-time, the whole scene is in shadow
 	float shadow = 0.0f;
-	if(AC_LightPos.y > 0) // only get shadow value if it isn't night-time otherwise report that the whole scene is in shadow
-		shadow = ComputeShadowValue(uv, wsPosition, TX_Shadowmap, SS_Comp, vsPosition.z, vertLighting, mul(SQ_ShadowView, SQ_ShadowProj), lerp(0.00005f, 0.0001f, vsPosition.z / 1000));
+#else
+	float shadow = ComputeCascadedShadowValue(wsPosition, vertLighting);
+#endif
 #else
 	float shadow = vertLighting;
 #endif
@@ -355,7 +412,7 @@ float4 PSMain( PS_INPUT Input ) : SV_TARGET
 	// Compute wettness
 	float specWet = 0.0f;
 	
-#ifdef APPLY_RAIN_EFFECTS
+#if APPLY_RAIN_EFFECTS
 	ApplySceneWettness(wsPosition, vsPosition, V, normal, diffuse.rgb, specIntensity, specPower, specWet);
 	
 	// Boost specWet when not in shadow
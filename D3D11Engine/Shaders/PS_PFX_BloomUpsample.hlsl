@@ -0,0 +1,30 @@
+//--------------------------------------------------------------------------------------
+// One step up the bloom chain
+//--------------------------------------------------------------------------------------
+#include <BloomFilter.h>
+
+//--------------------------------------------------------------------------------------
+// Textures and Samplers
+//--------------------------------------------------------------------------------------
+SamplerState SS_Linear : register( s0 );
+SamplerState SS_Mirror : register( s1 );
+Texture2D	TX_Texture0 : register( t0 );
+
+//--------------------------------------------------------------------------------------
+// Input / Output structures
+//--------------------------------------------------------------------------------------
+struct PS_INPUT
+{
+	float2 vTexcoord		: TEXCOORD0;
+	float3 vEyeRay			: TEXCOORD1;
+	float4 vPosition		: SV_POSITION;
+};
+
+//--------------------------------------------------------------------------------------
+// Pixel Shader
+//--------------------------------------------------------------------------------------
+float4 PSMain( PS_INPUT Input ) : SV_TARGET
+{
+	// Added onto the next larger level by the blendstate
+	return float4(BloomUpsampleTent(TX_Texture0, SS_Linear, Input.vTexcoord, 1.0f), 1);
+}
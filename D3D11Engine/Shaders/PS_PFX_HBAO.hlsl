@@ -0,0 +1,79 @@
+//--------------------------------------------------------------------------------------
+// Horizon based ambient occlusion, rendered at a fraction of the resolution
+//--------------------------------------------------------------------------------------
+#include <HBAO.h>
+
+//--------------------------------------------------------------------------------------
+// Textures and Samplers
+//--------------------------------------------------------------------------------------
+Texture2D	TX_Nrm : register( t1 );
+
+//--------------------------------------------------------------------------------------
+// Input / Output structures
+//--------------------------------------------------------------------------------------
+struct PS_INPUT
+{
+	float2 vTexcoord		: TEXCOORD0;
+	float3 vEyeRay			: TEXCOORD1;
+	float4 vPosition		: SV_POSITION;
+};
+
+//--------------------------------------------------------------------------------------
+// Occlusion of a single sample at view-space offset v from a pixel with normal n
+//--------------------------------------------------------------------------------------
+float GetSampleOcclusion(float3 v, float3 n)
+{
+	float vv = dot(v, v);
+	float nv = dot(n, v) * rsqrt(max(vv, 1e-12f));
+	
+	return saturate(nv - AO_Bias) * saturate(vv * AO_NegInvRadius2 + 1.0f);
+}
+
+//--------------------------------------------------------------------------------------
+// Pixel Shader, returns the visibility and the view-space depth
+//--------------------------------------------------------------------------------------
+float2 PSMain( PS_INPUT Input ) : SV_TARGET
+{
+	float2 uv = Input.vPosition.xy * AO_InvSize;
+	int2 fullPixel = min(int2(uv * AO_FullSize), int2(AO_FullSize) - 1);
+	
+	float3 p = FetchViewPosition(uv);
+	float3 n = normalize(TX_Nrm.Load(int3(fullPixel, 0)).xyz);
+	
+	float radiusPixels = min(AO_RadiusToScreen / p.z, HBAO_MAX_RADIUS_PIXELS);
+	if(radiusPixels < 1.0f)
+		return float2(1.0f, p.z); // Less than a pixel, nothing to find
+	
+	int2 slot = int2(Input.vPosition.xy) % HBAO_PATTERN_SIZE;
+	float3 jitter = AO_Jitter[slot.x + slot.y * HBAO_PATTERN_SIZE].xyz;
+	
+	float stepSize = radiusPixels / (AO_NumSteps + 1);
+	float occlusion = 0.0f;
+	
+	[loop]
+	for(int d = 0; d < AO_NumDirections; d++)
+	{
+		float angle = 2.0f * HBAO_PI / AO_NumDirections * d;
+		float2 cs;
+		sincos(angle, cs.y, cs.x);
+		
+		float2 dir = float2(cs.x * jitter.x - cs.y * jitter.y, cs.x * jitter.y + cs.y * jitter.x);
+		
+		float rayPixels = jitter.z * stepSize + 1.0f;
+		
+		[loop]
+		for(int s = 0; s < AO_NumSteps; s++)
+		{
+			// Snap to pixel centers of the AO buffer
+			float2 sampleUV = uv + round(rayPixels * dir) * AO_InvSize;
+			
+			occlusion += GetSampleOcclusion(FetchViewPosition(sampleUV) - p, n);
+			
+			rayPixels += stepSize;
+		}
+	}
+	
+	// Scale back up what the bias took away
+	occlusion *= 1.0f / (1.0f - AO_Bias) / (AO_NumDirections * AO_NumSteps);
+	return float2(pow(saturate(1.0f - occlusion), AO_PowerExponent), p.z);
+}
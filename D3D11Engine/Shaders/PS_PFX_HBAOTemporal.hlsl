@@ -0,0 +1,45 @@
+//--------------------------------------------------------------------------------------
+// Accumulates the AO over the last frames, reprojected through the depthbuffer
+//--------------------------------------------------------------------------------------
+#include <HBAO.h>
+
+//--------------------------------------------------------------------------------------
+// Textures and Samplers
+//--------------------------------------------------------------------------------------
+Texture2D	TX_AO : register( t2 );
+Texture2D	TX_History : register( t3 );
+
+//--------------------------------------------------------------------------------------
+// Input / Output structures
+//--------------------------------------------------------------------------------------
+struct PS_INPUT
+{
+	float2 vTexcoord		: TEXCOORD0;
+	float3 vEyeRay			: TEXCOORD1;
+	float4 vPosition		: SV_POSITION;
+};
+
+//--------------------------------------------------------------------------------------
+// Pixel Shader
+//--------------------------------------------------------------------------------------
+float2 PSMain( PS_INPUT Input ) : SV_TARGET
+{
+	float2 current = TX_AO.Load(int3(Input.vPosition.xy, 0)).xy;
+	float2 uv = Input.vPosition.xy * AO_InvSize;
+	
+	float4 prevClip = mul(float4(GetViewPosition(uv, current.y), 1.0f), AO_ViewToPrevClip);
+	float2 prevUV = (prevClip.xy / prevClip.w) * float2(0.5f, -0.5f) + 0.5f;
+	
+	// Nothing to blend with where the pixel wasn't on screen
+	if(AO_HistoryValid == 0.0f || any(prevUV != saturate(prevUV)))
+		return current;
+	
+	// Nearest, filtering would mix the depth of both sides of an edge
+	float2 history = TX_History.Load(int3(min(int2(prevUV * AO_Size), int2(AO_Size) - 1), 0)).xy;
+	
+	// Disoccluded, the history belongs to something else
+	if(abs(prevClip.w - history.y) > HBAO_TEMPORAL_DEPTH_TOLERANCE * prevClip.w)
+		return current;
+	
+	return float2(lerp(history.x, current.x, HBAO_TEMPORAL_BLEND), current.y);
+}
@@ -0,0 +1,61 @@
+//--------------------------------------------------------------------------------------
+// Depth-aware upsampling of the AO to full resolution
+//--------------------------------------------------------------------------------------
+#include <HBAO.h>
+
+//--------------------------------------------------------------------------------------
+// Textures and Samplers
+//--------------------------------------------------------------------------------------
+Texture2D	TX_AO : register( t2 );
+
+//--------------------------------------------------------------------------------------
+// Input / Output structures
+//--------------------------------------------------------------------------------------
+struct PS_INPUT
+{
+	float2 vTexcoord		: TEXCOORD0;
+	float3 vEyeRay			: TEXCOORD1;
+	float4 vPosition		: SV_POSITION;
+};
+
+//--------------------------------------------------------------------------------------
+// Pixel Shader
+//--------------------------------------------------------------------------------------
+float4 PSMain( PS_INPUT Input ) : SV_TARGET
+{
+	float z = GetViewDepth(TX_Depth.Load(int3(Input.vPosition.xy, 0)).r);
+	
+	// Position in AO pixels, relative to the centers
+	float2 center = Input.vPosition.xy / AO_FullSize * AO_Size - 0.5f;
+	int2 base = int2(floor(center)) - 1;
+	
+	// 4x4 footprint, enough for a tent of radius 2. Radius 1 is a plain bilinear footprint.
+	float ao = 0.0f;
+	float weightSum = 0.0f;
+	
+	[unroll]
+	for(int y = 0; y < 4; y++)
+	{
+		[unroll]
+		for(int x = 0; x < 4; x++)
+		{
+			int2 t = clamp(base + int2(x, y), 0, int2(AO_Size) - 1);
+			float2 s = TX_AO.Load(int3(t, 0)).xy;
+			float2 dist = abs(float2(base + int2(x, y)) - center);
+			
+			float2 tent = max(AO_UpsampleRadius - dist, 0.0f);
+			float w = tent.x * tent.y * exp2(-AO_BlurSharpness * HBAO_BILATERAL_DEPTH_SCALE * abs(s.y - z) / z);
+			
+			ao += s.x * w;
+			weightSum += w;
+		}
+	}
+	
+	// Nothing at that depth around, a thin feature. Take the closest sample.
+	if(weightSum < 1e-4f)
+		ao = TX_AO.Load(int3(clamp(int2(round(center)), 0, int2(AO_Size) - 1), 0)).x;
+	else
+		ao /= weightSum;
+	
+	return float4(ao, ao, ao, 1.0f);
+}
@@ -3,6 +3,23 @@
 //--------------------------------------------------------------------------------------
 
 #include <hdr.h>
+#include <BloomFilter.h>
+
+// Passes the composite applies itself, instead of running them on their own
+#ifndef FUSE_HEIGHTFOG
+#define FUSE_HEIGHTFOG 0
+#endif
+#ifndef FUSE_GODRAYS
+#define FUSE_GODRAYS 0
+#endif
+#ifndef COLOR_GRADING
+#define COLOR_GRADING 0
+#endif
+
+#if FUSE_HEIGHTFOG
+#define HEIGHTFOG_CB_REGISTER b2
+#include <Heightfog.h>
+#endif
 
 //--------------------------------------------------------------------------------------
 // Textures and Samplers
@@ -10,8 +27,28 @@
 SamplerState SS_Linear : register( s0 );
 SamplerState SS_samMirror : register( s1 );
 Texture2D	TX_Scene : register( t0 );
-Texture2D	TX_Lum : register( t1 );
 Texture2D	TX_Bloom : register( t2 );
+Texture2D	TX_Depth : register( t3 );
+Texture2D	TX_GodRays : register( t4 );
+Texture2D	TX_GradingLUT : register( t5 );
+
+#define GRADING_LUT_SIZE 16
+
+// The LUT is a strip of 16 slices of 16x16, one for each step of blue
+float3 ApplyColorGrading(float3 color)
+{
+	color = saturate(color);
+	
+	float slice = color.b * (GRADING_LUT_SIZE - 1);
+	float sliceLow = floor(slice);
+	
+	float2 uv = float2((color.r * (GRADING_LUT_SIZE - 1) + 0.5f) / (GRADING_LUT_SIZE * GRADING_LUT_SIZE),
+		(color.g * (GRADING_LUT_SIZE - 1) + 0.5f) / GRADING_LUT_SIZE);
+	float2 uv0 = uv + float2(sliceLow / GRADING_LUT_SIZE, 0);
+	float2 uv1 = uv0 + float2(1.0f / GRADING_LUT_SIZE, 0);
+	
+	return lerp(TX_GradingLUT.SampleLevel(SS_Linear, uv0, 0).rgb, TX_GradingLUT.SampleLevel(SS_Linear, uv1, 0).rgb, slice - sliceLow);
+}
 
 
 
@@ -33,25 +70,43 @@ float4 PSMain( PS_INPUT Input ) : SV_TARGET
 {
 	float4 sample = TX_Scene.Sample(SS_Linear, Input.vTexcoord);
 	float3 HDRColor = sample.rgb;
+	
+#if FUSE_HEIGHTFOG
+	// Same as blending the fog over the scene
+	float4 fog = ComputeHeightfog(TX_Depth.SampleLevel(SS_Linear, Input.vTexcoord, 0).r, Input.vTexcoord);
+	HDRColor = lerp(HDRColor, fog.rgb, fog.a);
+#endif
+
+#if FUSE_GODRAYS
+	// Same as the additive upscale of the quarter resolution rays
+	HDRColor += TX_GodRays.SampleLevel(SS_Linear, Input.vTexcoord, 0).rgb;
+#endif
 	//HDRColor = float3(Input.vTexcoord.r, 0, 0);
 #if USE_TONEMAP == 0
-		float3 toneMapped = saturate(ToneMap_jafEq4(HDRColor, TX_Lum, SS_Linear));
+		float3 toneMapped = saturate(ToneMap_jafEq4(HDRColor, GetAverageLuminance(SS_Linear)));
 #elif USE_TONEMAP == 1
-		float3 toneMapped = saturate(Uncharted2Tonemap(HDRColor, TX_Lum, SS_Linear));
+		float3 toneMapped = saturate(Uncharted2Tonemap(HDRColor, GetAverageLuminance(SS_Linear)));
 #elif USE_TONEMAP == 2
-		float3 toneMapped = saturate(ACESFilmTonemap(HDRColor, TX_Lum, SS_Linear));
+		float3 toneMapped = saturate(ACESFilmTonemap(HDRColor, GetAverageLuminance(SS_Linear)));
 #elif USE_TONEMAP == 3
-		float3 toneMapped = saturate(PerceptualQuantizerTonemap(HDRColor, TX_Lum, SS_Linear));
+		float3 toneMapped = saturate(PerceptualQuantizerTonemap(HDRColor, GetAverageLuminance(SS_Linear)));
 #elif USE_TONEMAP == 4
-		float3 toneMapped = saturate(ToneMap_Simple(HDRColor, TX_Lum, SS_Linear));
+		float3 toneMapped = saturate(ToneMap_Simple(HDRColor, GetAverageLuminance(SS_Linear)));
 #elif USE_TONEMAP == 5
-		float3 toneMapped = saturate(ACESFittedTonemap(HDRColor, TX_Lum, SS_Linear));
+		float3 toneMapped = saturate(ACESFittedTonemap(HDRColor, GetAverageLuminance(SS_Linear)));
 #endif
 	
-	float3 bloom = TX_Bloom.Sample(SS_Linear, Input.vTexcoord).rgb * HDR_BloomStrength;
+	// Last upsample of the bloom chain
+	float3 bloom = BloomUpsampleTent(TX_Bloom, SS_Linear, Input.vTexcoord, 1.0f) * HDR_BloomStrength;
 
 	//return float4(sample.rgb, 1);
 	//return float4(TX_Lum.SampleLevel(SS_Linear, float2(0.5f, 0.5f), 10).rrr,1);
-	return float4(pow(toneMapped * (1 - bloom) + bloom, 2.2f), 1); 
+	float3 color = toneMapped * (1 - bloom) + bloom;
+	
+#if COLOR_GRADING
+	color = ApplyColorGrading(color);
+#endif
+
+	return float4(pow(color, 2.2f), 1); 
 }
 
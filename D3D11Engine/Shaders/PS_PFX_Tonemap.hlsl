@@ -3,6 +3,7 @@
 //--------------------------------------------------------------------------------------
 
 #include <hdr.h>
+#include <BloomFilter.h>
 
 static const float BRIGHT_PASS_OFFSET = 10.0f;
 
@@ -13,7 +14,6 @@ static const float BRIGHT_PASS_OFFSET = 10.0f;
 SamplerState SS_Linear : register( s0 );
 SamplerState SS_samMirror : register( s1 );
 Texture2D	TX_Scene : register( t0 );
-Texture2D	TX_Lum : register( t1 );
 
 
 //--------------------------------------------------------------------------------------
@@ -32,25 +32,30 @@ struct PS_INPUT
 //--------------------------------------------------------------------------------------
 float4 PSMain( PS_INPUT Input ) : SV_TARGET
 {
-	float4 sample = TX_Scene.Sample(SS_Linear, Input.vTexcoord);
-	float3 HDRColor = sample.rgb;
+	// Renders into the first level of the bloom chain, at a quarter of the resolution
+#if USE_LUM_HISTOGRAM
+	// Already box filtered by CS_PFX_LumHistogram
+	float3 HDRColor = TX_Scene.SampleLevel(SS_Linear, Input.vTexcoord, 0).rgb;
+#else
+	float3 HDRColor = BloomPrefilterBox4(TX_Scene, SS_Linear, Input.vTexcoord, LUM_CONVERT);
+#endif
 	
 	// Determine what the pixel's value will be after tone-mapping occurs
 	//float fLumAvg = TX_Lum.SampleLevel(SS_Linear, float2(0.5f, 0.5f), 9).r;
 	//HDRColor *= HDR_MiddleGray/(fLumAvg + 0.001f);
 	
 #if USE_TONEMAP == 0
-		float3 toneMapped = ToneMap_jafEq4(HDRColor, TX_Lum, SS_Linear);
+		float3 toneMapped = ToneMap_jafEq4(HDRColor, GetAverageLuminance(SS_Linear));
 #elif USE_TONEMAP == 1
-		float3 toneMapped = Uncharted2Tonemap(HDRColor, TX_Lum, SS_Linear);
+		float3 toneMapped = Uncharted2Tonemap(HDRColor, GetAverageLuminance(SS_Linear));
 #elif USE_TONEMAP == 2
-		float3 toneMapped = ACESFilmTonemap(HDRColor, TX_Lum, SS_Linear);
+		float3 toneMapped = ACESFilmTonemap(HDRColor, GetAverageLuminance(SS_Linear));
 #elif USE_TONEMAP == 3
-		float3 toneMapped = PerceptualQuantizerTonemap(HDRColor, TX_Lum, SS_Linear);
+		float3 toneMapped = PerceptualQuantizerTonemap(HDRColor, GetAverageLuminance(SS_Linear));
 #elif USE_TONEMAP == 4
-		float3 toneMapped = ToneMap_Simple(HDRColor, TX_Lum, SS_Linear);
+		float3 toneMapped = ToneMap_Simple(HDRColor, GetAverageLuminance(SS_Linear));
 #elif USE_TONEMAP == 5
-		float3 toneMapped = ACESFittedTonemap(HDRColor, TX_Lum, SS_Linear);
+		float3 toneMapped = ACESFittedTonemap(HDRColor, GetAverageLuminance(SS_Linear));
 #endif
 	
 	toneMapped -= HDR_Threshold;
@@ -47,7 +47,17 @@
 /**
  * This is only required for temporal modes (SMAA T2x).
  */
-static const int4 subsampleIndices = 0;
+// Zero for SMAA 1x, alternates with the camera jitter for T2x
+int4 subsampleIndices = 0;
+
+// Z-row of the projection, to linearize the depthbuffer
+float2 depthProjAB;
+
+// Maps a pixel of this frame to where it was last frame, in clip space
+float4x4 reprojection;
+
+// Zero while there is no usable last frame
+float historyWeight;
 
 /**
  * This is required for blending the results of previous subsample with the
@@ -66,6 +76,10 @@ float maxSearchStepsDiag;
 float cornerRounding;
 
 //#define SMAA_PRESET_HIGH 1
+
+// Predicate on the log of the view distance, so the threshold is a ratio and works at any distance
+#define SMAA_PREDICATION_TRANSFORM(depth) log2(max(depthProjAB.y / ((depth) - depthProjAB.x), 1.0))
+#define SMAA_PREDICATION_THRESHOLD 0.02
 #ifdef SMAA_PRESET_CUSTOM
 #define SMAA_THRESHOLD threshld
 #define SMAA_MAX_SEARCH_STEPS maxSearchSteps
@@ -249,6 +263,42 @@ float4 DX10_SMAAResolvePS(float4 position : SV_POSITION,
     #endif
 }
 
+/**
+ * T2x resolve. Reprojects the last frame through the depthbuffer, which covers camera movement. Whatever else
+ * moved is caught by clamping the history to the neighborhood of the current pixel.
+ */
+float4 DX10_SMAATemporalResolvePS(float4 position : SV_POSITION,
+                                  float2 texcoord : TEXCOORD0,
+                                  uniform SMAATexture2D colorTex,
+                                  uniform SMAATexture2D colorTexPrev,
+                                  uniform SMAATexture2D depthTex) : SV_TARGET {
+    float4 current = SMAASampleLevelZero(colorTex, texcoord);
+
+    float depth = SMAASampleLevelZero(depthTex, texcoord).r;
+    float4 clipPos = float4(texcoord * float2(2.0, -2.0) + float2(-1.0, 1.0), depth, 1.0);
+    float4 prevClipPos = mul(clipPos, reprojection);
+    float2 prevTexcoord = (prevClipPos.xy / prevClipPos.w) * float2(0.5, -0.5) + 0.5;
+
+    // Nothing to blend with where the pixel wasn't on screen
+    if (any(prevTexcoord != saturate(prevTexcoord)))
+        return current;
+
+    float4 minColor = current;
+    float4 maxColor = current;
+    [unroll]
+    for (int y = -1; y <= 1; y++) {
+        [unroll]
+        for (int x = -1; x <= 1; x++) {
+            float4 c = SMAASampleLevelZeroOffset(colorTex, texcoord, int2(x, y));
+            minColor = min(minColor, c);
+            maxColor = max(maxColor, c);
+        }
+    }
+
+    float4 previous = clamp(SMAASampleLevelZero(colorTexPrev, prevTexcoord), minColor, maxColor);
+    return SMAALerp(current, previous, 0.5 * historyWeight);
+}
+
 void DX10_SMAASeparatePS(float4 position : SV_POSITION,
                          float2 texcoord : TEXCOORD0,
                          out float4 target0 : SV_TARGET0,
@@ -338,6 +388,20 @@ technique10 Resolve {
     }
 }
 
+/**
+ * T2x resolve, with reprojection through the depthbuffer
+ */
+technique10 TemporalResolve {
+    pass TemporalResolve {
+        SetVertexShader(CompileShader(vs_5_0, DX10_SMAAResolveVS()));
+        SetGeometryShader(NULL);
+        SetPixelShader(CompileShader(PS_VERSION, DX10_SMAATemporalResolvePS(colorTex, colorTexPrev, depthTex)));
+
+        SetDepthStencilState(DisableDepthStencil, 0);
+        SetBlendState(NoBlending, float4(0.0f, 0.0f, 0.0f, 0.0f), 0xFFFFFFFF);
+    }
+}
+
 /**
  * 2x multisampled buffer conversion into two regular buffers
  */
@@ -2,6 +2,8 @@
 // Simple vertex shader
 //--------------------------------------------------------------------------------------
 
+#include <VertexCompression.h>
+
 cbuffer Matrices_PerFrame : register( b0 )
 {
 	matrix M_View;
@@ -20,10 +22,16 @@ cbuffer Matrices_PerInstances : register( b1 )
 //--------------------------------------------------------------------------------------
 struct VS_INPUT
 {
+#if COMPRESSED_VERTICES
+	float4 vPosition	: POSITION;
+	float2 vNormal		: NORMAL;
+	float2 vTex1		: TEXCOORD0;
+#else
 	float3 vPosition	: POSITION;
 	float3 vNormal		: NORMAL;
 	float2 vTex1		: TEXCOORD0;
 	float2 vTex2		: TEXCOORD1;
+#endif
 	float4 vDiffuse		: DIFFUSE;
 };
 
@@ -43,13 +51,24 @@ VS_OUTPUT VSMain( VS_INPUT Input )
 {
 	VS_OUTPUT Output;
 	
-	float3 positionWorld = mul(float4(Input.vPosition,1), M_World).xyz;
+#if COMPRESSED_VERTICES
+	float3 vPosition = DecodeVertexPosition(Input.vPosition);
+	float3 vNormal = DecodeOctahedralNormal(Input.vNormal);
+	float2 vTex1 = DecodeVertexTexCoord(Input.vTex1);
+	float2 vTex2 = vTex1;
+#else
+	float3 vPosition = Input.vPosition;
+	float3 vNormal = Input.vNormal;
+	float2 vTex1 = Input.vTex1;
+	float2 vTex2 = Input.vTex2;
+#endif
+	float3 positionWorld = mul(float4(vPosition,1), M_World).xyz;
 	
 	//Output.vPosition = float4(Input.vPosition, 1);
-	Output.vTexcoord2 = Input.vTex2;
-	Output.vTexcoord = Input.vTex1;
+	Output.vTexcoord2 = vTex2;
+	Output.vTexcoord = vTex1;
 	Output.vDiffuse  = Input.vDiffuse;
-	Output.vNormalWS = mul(Input.vNormal, (float3x3)M_World);
+	Output.vNormalWS = mul(vNormal, (float3x3)M_World);
 	Output.vWorldPosition = positionWorld;
 
 	return Output;
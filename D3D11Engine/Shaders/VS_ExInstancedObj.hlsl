@@ -2,6 +2,8 @@
 // Simple vertex shader
 //--------------------------------------------------------------------------------------
 
+#include <VertexCompression.h>
+
 cbuffer Matrices_PerFrame : register( b0 )
 {
 	matrix M_View;
@@ -15,10 +17,16 @@ cbuffer Matrices_PerFrame : register( b0 )
 //--------------------------------------------------------------------------------------
 struct VS_INPUT
 {
+#if COMPRESSED_VERTICES
+	float4 vPosition	: POSITION;
+	float2 vNormal		: NORMAL;
+	float2 vTex1		: TEXCOORD0;
+#else
 	float3 vPosition	: POSITION;
 	float3 vNormal		: NORMAL;
 	float2 vTex1		: TEXCOORD0;
 	float2 vTex2		: TEXCOORD1;
+#endif
 	float4 vDiffuse		: DIFFUSE;
 	float4x4 InstanceWorldMatrix : INSTANCE_WORLD_MATRIX;
 	float4 InstanceColor : INSTANCE_COLOR;
@@ -42,13 +50,24 @@ VS_OUTPUT VSMain( VS_INPUT Input )
 {
 	VS_OUTPUT Output;
 	
-	float3 wpos = mul(float4(Input.vPosition,1), Input.InstanceWorldMatrix).xyz;
+#if COMPRESSED_VERTICES
+	float3 vPosition = DecodeVertexPosition(Input.vPosition);
+	float3 vNormal = DecodeOctahedralNormal(Input.vNormal);
+	float2 vTex1 = DecodeVertexTexCoord(Input.vTex1);
+	float2 vTex2 = vTex1;
+#else
+	float3 vPosition = Input.vPosition;
+	float3 vNormal = Input.vNormal;
+	float2 vTex1 = Input.vTex1;
+	float2 vTex2 = Input.vTex2;
+#endif
+	float3 wpos = mul(float4(vPosition,1), Input.InstanceWorldMatrix).xyz;
 	Output.vPosition = mul( float4(wpos,1), M_ViewProj);
 	
-	Output.vTexcoord2 = Input.vTex2;
-	Output.vTexcoord = Input.vTex1;
+	Output.vTexcoord2 = vTex2;
+	Output.vTexcoord = vTex1;
 	Output.vDiffuse  = Input.InstanceColor;
-	Output.vNormalVS = mul(Input.vNormal, mul((float3x3)Input.InstanceWorldMatrix, (float3x3)M_View));
+	Output.vNormalVS = mul(vNormal, mul((float3x3)Input.InstanceWorldMatrix, (float3x3)M_View));
 	Output.vViewPosition = mul(float4(wpos,1), M_View);
 	//Output.vWorldPosition = positionWorld;
 	
@@ -0,0 +1,87 @@
+//--------------------------------------------------------------------------------------
+// Instanced skeletal vertex shader. Bones of all instances live in one buffer.
+//--------------------------------------------------------------------------------------
+
+cbuffer Matrices_PerFrame : register( b0 )
+{
+	matrix M_View;
+	matrix M_Proj;
+	matrix M_ViewProj;
+};
+
+cbuffer SkeletalInstancing : register( b1 )
+{
+	uint SI_InstanceOffset;
+	uint3 SI_Pad;
+};
+
+struct InstanceData
+{
+	matrix World;
+	float4 ModelColor;
+	float ModelFatness;
+	uint BoneOffset;
+	float2 Pad;
+};
+
+/** Per-instance data and the concatenated bone palettes of all instances */
+StructuredBuffer<InstanceData> InstanceSB : register( t0 );
+StructuredBuffer<float4x4> BoneSB : register( t1 );
+
+//--------------------------------------------------------------------------------------
+// Input / Output structures
+//--------------------------------------------------------------------------------------
+struct VS_INPUT
+{
+	float4 vPosition[4]	: POSITION;
+	float3 vNormal		: NORMAL;
+	float3 vBindPoseNormal		: TEXCOORD0;
+	float2 vTex1		: TEXCOORD1;
+	uint4 BoneIndices : BONEIDS;
+	float4 Weights 	: WEIGHTS;
+	uint InstanceID : SV_InstanceID;
+};
+
+struct VS_OUTPUT
+{
+	float2 vTexcoord		: TEXCOORD0;
+	float2 vTexcoord2		: TEXCOORD1;
+	float4 vDiffuse			: TEXCOORD2;
+	float3 vNormalVS		: TEXCOORD4;
+	float3 vViewPosition	: TEXCOORD5;
+	float4 vPosition		: SV_POSITION;
+};
+
+//--------------------------------------------------------------------------------------
+// Vertex Shader
+//--------------------------------------------------------------------------------------
+VS_OUTPUT VSMain( VS_INPUT Input )
+{
+	VS_OUTPUT Output;
+
+	InstanceData inst = InstanceSB[SI_InstanceOffset + Input.InstanceID];
+	uint4 bones = Input.BoneIndices + inst.BoneOffset;
+
+	float3 position = float3(0, 0, 0);
+	position += Input.Weights.x * mul(float4(Input.vPosition[0].xyz, 1), BoneSB[bones.x]).xyz;
+	position += Input.Weights.y * mul(float4(Input.vPosition[1].xyz, 1), BoneSB[bones.y]).xyz;
+	position += Input.Weights.z * mul(float4(Input.vPosition[2].xyz, 1), BoneSB[bones.z]).xyz;
+	position += Input.Weights.w * mul(float4(Input.vPosition[3].xyz, 1), BoneSB[bones.w]).xyz;
+
+	float3 normal = float3(0, 0, 0);
+	normal += Input.Weights.x * mul(Input.vNormal, (float3x3)BoneSB[bones.x]);
+	normal += Input.Weights.y * mul(Input.vNormal, (float3x3)BoneSB[bones.y]);
+	normal += Input.Weights.z * mul(Input.vNormal, (float3x3)BoneSB[bones.z]);
+	normal += Input.Weights.w * mul(Input.vNormal, (float3x3)BoneSB[bones.w]);
+
+	float3 positionWorld = mul(float4(position + inst.ModelFatness * normal,1), inst.World).xyz;
+
+	Output.vPosition = mul(float4(positionWorld,1), M_ViewProj);
+	Output.vTexcoord2 = Input.vTex1;
+	Output.vTexcoord = Input.vTex1;
+	Output.vDiffuse  = inst.ModelColor;
+	Output.vNormalVS = mul(Input.vBindPoseNormal, (float3x3)mul(inst.World, M_View));
+	Output.vViewPosition = mul(float4(positionWorld,1),M_View).xyz;
+
+	return Output;
+}
@@ -0,0 +1,33 @@
+//--------------------------------------------------------------------------------------
+// Decoding of compressed static mesh vertices (ExVertexStructCompressed)
+//--------------------------------------------------------------------------------------
+
+#if COMPRESSED_VERTICES
+cbuffer VertexDecode : register( b2 )
+{
+	float4 VD_PositionScale;
+	float4 VD_PositionOffset;
+	float4 VD_TexCoordScaleOffset;
+};
+
+/** Position is stored as UNORM16 inside the bounding box of the visual */
+float3 DecodeVertexPosition(float4 p)
+{
+	return p.xyz * VD_PositionScale.xyz + VD_PositionOffset.xyz;
+}
+
+/** Texcoords are stored as UNORM16 inside the texcoord-range of the visual */
+float2 DecodeVertexTexCoord(float2 t)
+{
+	return t * VD_TexCoordScaleOffset.xy + VD_TexCoordScaleOffset.zw;
+}
+
+/** Normals are octahedral encoded into two SNORM16 values */
+float3 DecodeOctahedralNormal(float2 e)
+{
+	float3 n = float3(e.xy, 1.0f - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.xy += n.xy >= 0.0f ? -t : t;
+	return normalize(n);
+}
+#endif
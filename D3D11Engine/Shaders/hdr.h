@@ -13,11 +13,26 @@ cbuffer HDR_Settings : register(b0)
 	float HDR_BloomStrength;
 };
 
-float3 ToneMap_Reinhard(float3 vColor, Texture2D lumTex, SamplerState samplerState)
+// The adapted average luminance comes from the histogram if compute shaders are available,
+// otherwise from the last mip of the luminance buffer
+#if USE_LUM_HISTOGRAM
+Buffer<float> TX_AdaptedLum : register( t1 );
+
+float GetAverageLuminance(SamplerState samplerState)
+{
+	return TX_AdaptedLum[0];
+}
+#else
+Texture2D TX_Lum : register( t1 );
+
+float GetAverageLuminance(SamplerState samplerState)
 {
-	// Get the calculated average luminance
-	float fLumAvg = lumTex.SampleLevel(samplerState, float2(0.5f, 0.5f), 9).r;
+	return TX_Lum.SampleLevel(samplerState, float2(0.5f, 0.5f), 9).r;
+}
+#endif
 
+float3 ToneMap_Reinhard(float3 vColor, float fLumAvg)
+{
 	// Calculate the luminance of the current pixel
 	float fLumPixel = dot(vColor, LUM_CONVERT); //?.
 	
@@ -30,11 +45,8 @@ float3 ToneMap_Reinhard(float3 vColor, Texture2D lumTex, SamplerState samplerSta
 	return pow( vColor, 2.2f );
 } 
 
-float3 ToneMap_jafEq4(float3 vColor, Texture2D lumTex, SamplerState samplerState)
+float3 ToneMap_jafEq4(float3 vColor, float fLumAvg)
 {
-	// Get the calculated average luminance
-	float fLumAvg = lumTex.SampleLevel(samplerState, float2(0.5f, 0.5f), 9).r;
-
 	// Calculate the luminance of the current pixel
 	float fLumPixel = dot(vColor, LUM_CONVERT);
 	
@@ -58,10 +70,8 @@ float3 Uncharted2TonemapOperator(float3 x)
 	return ((x*(A*x+C*B)+D*E)/(x*(A*x+B)+D*F))-E/F;
 }
 
-float3 Uncharted2Tonemap(float3 vColor, Texture2D lumTex, SamplerState samplerState) : COLOR
+float3 Uncharted2Tonemap(float3 vColor, float fLumAvg) : COLOR
 {
-	float fLumAvg = lumTex.SampleLevel(samplerState, float2(0.5f, 0.5f), 9).r;
-	
 	vColor *= (HDR_MiddleGray / fLumAvg);  // Exposure Adjustment
 
 	float ExposureBias = 2.0f;
@@ -86,12 +96,10 @@ float3 ACESFilmTonemapOperator(float3 x)
 	return saturate( ( x * ( a * x + b ) ) / ( x * ( c * x + d ) + e ) );
 }
 
-float3 ACESFilmTonemap(float3 vColor, Texture2D lumTex, SamplerState samplerState) : COLOR // needs adaptation
+float3 ACESFilmTonemap(float3 vColor, float fLumAvg) : COLOR // needs adaptation
 {
 	float3 LUM_CONVERT  = float3(0.2125f, 0.7154f, 0.0721f);
 	
-	float fLumAvg = lumTex.SampleLevel(samplerState, float2(0.5f, 0.5f), 9).r;
-	
 	// Calculate the luminance of the current pixel
 	float fLumPixel = dot(vColor, LUM_CONVERT);
 	
@@ -121,10 +129,8 @@ float3 PerceptualQuantizerTonemapOperator(float3 x) //broken with gray color
 	return pow((c1 + c2 * p) / (1.0 + c3 * p), m2);
 }
 
-float3 PerceptualQuantizerTonemap(float3 vColor, Texture2D lumTex, SamplerState samplerState) : COLOR //broken with gray color
+float3 PerceptualQuantizerTonemap(float3 vColor, float fLumAvg) : COLOR //broken with gray color
 {
-	float fLumAvg = lumTex.SampleLevel(samplerState, float2(0.5f, 0.5f), 9).r;
-	
 	vColor *= (HDR_MiddleGray / fLumAvg);  // Exposure Adjustment
 
 	float3 curr = PerceptualQuantizerTonemapOperator(vColor);	
@@ -136,11 +142,8 @@ float3 PerceptualQuantizerTonemap(float3 vColor, Texture2D lumTex, SamplerState
 	return retColor;
 }
 
-float3 ToneMap_Simple(float3 vColor, Texture2D lumTex, SamplerState samplerState)
+float3 ToneMap_Simple(float3 vColor, float fLumAvg)
 {
-	// Get the calculated average luminance
-	float fLumAvg = lumTex.SampleLevel(samplerState, float2(0.5f, 0.5f), 9).r;
-	
 	vColor *= HDR_MiddleGray/(fLumAvg + 0.001f);
 	vColor /= (1.0f + vColor);
 	
@@ -188,10 +191,8 @@ float3 ACESFittedTonemapOperator(float3 color)
     return color;
 }
 
-float3 ACESFittedTonemap(float3 vColor, Texture2D lumTex, SamplerState samplerState) : COLOR
+float3 ACESFittedTonemap(float3 vColor, float fLumAvg) : COLOR
 {	
-	float fLumAvg = lumTex.SampleLevel(samplerState, float2(0.5f, 0.5f), 9).r;
-	
 	vColor *= (HDR_MiddleGray / fLumAvg);  // Exposure Adjustment
 
 	float3 curr = ACESFittedTonemapOperator(vColor);	
@@ -0,0 +1,283 @@
+#include "pch.h"
+#include "TextureArchive.h"
+#include <algorithm>
+
+const uint32_t TEXTURE_ARCHIVE_MAGIC = MAKEFOURCC( 'G', 'D', 'T', 'A' );
+const uint32_t TEXTURE_ARCHIVE_VERSION = 2;
+const uint32_t TEXTURE_ARCHIVE_ALIGNMENT = 16;
+
+/** Offsets into a DDS file */
+const size_t DDS_PIXELFORMAT_FLAGS_OFFSET = 80;
+const size_t DDS_PIXELFORMAT_FOURCC_OFFSET = 84;
+const size_t DDS_DX10_FORMAT_OFFSET = 128;
+const uint32_t DDS_PF_FOURCC = 0x4;
+
+TextureArchive::TextureArchive() {
+    FileHandle = INVALID_HANDLE_VALUE;
+    MappingHandle = nullptr;
+    FileSize = 0;
+}
+
+TextureArchive::~TextureArchive() {
+    Close();
+}
+
+TextureArchive::FileView::~FileView() {
+    if ( Base ) {
+        UnmapViewOfFile( Base );
+    }
+}
+
+/** Closes the archive */
+void TextureArchive::Close() {
+    if ( MappingHandle ) {
+        CloseHandle( MappingHandle );
+        MappingHandle = nullptr;
+    }
+
+    if ( FileHandle != INVALID_HANDLE_VALUE ) {
+        CloseHandle( FileHandle );
+        FileHandle = INVALID_HANDLE_VALUE;
+    }
+
+    FileSize = 0;
+    Entries.clear();
+    Names.clear();
+}
+
+/** FNV-1a over the uppercase name without extension */
+uint64_t TextureArchive::HashName( const std::string& name ) {
+    uint64_t hash = 14695981039346656037ull;
+    for ( char c : name ) {
+        hash ^= static_cast<unsigned char>(toupper( c ));
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/** Opens the given archive and reads its table */
+XRESULT TextureArchive::Open( const std::string& file ) {
+    Close();
+
+    FileHandle = CreateFileA( file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr );
+    if ( FileHandle == INVALID_HANDLE_VALUE )
+        return XR_FAILED;
+
+    // Offsets are 32 bits, so a valid archive is never larger than 4 GB
+    LARGE_INTEGER fileSize;
+    if ( !GetFileSizeEx( FileHandle, &fileSize ) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof( Header )) || fileSize.QuadPart > UINT_MAX ) {
+        LogWarnCh( LC_TEXTURES ) << "Texture archive " << file << " is too small or too large";
+        Close();
+        return XR_FAILED;
+    }
+    FileSize = static_cast<uint64_t>(fileSize.QuadPart);
+
+    auto readBlock = [&]( void* data, uint64_t size ) {
+        DWORD read = 0;
+        return size == 0 || (ReadFile( FileHandle, data, static_cast<DWORD>(size), &read, nullptr ) && read == size);
+    };
+
+    // Validate everything once in 64 bits, lookups can trust the table afterwards
+    Header header;
+    if ( !readBlock( &header, sizeof( header ) )
+        || header.Magic != TEXTURE_ARCHIVE_MAGIC || header.Version != TEXTURE_ARCHIVE_VERSION
+        || sizeof( Header ) + static_cast<uint64_t>(header.NumEntries) * sizeof( Entry ) + header.NamesSize > FileSize ) {
+        LogWarnCh( LC_TEXTURES ) << "Texture archive " << file << " is invalid or was built by another version";
+        Close();
+        return XR_FAILED;
+    }
+
+    std::vector<Entry> entries( header.NumEntries );
+    std::string names( header.NamesSize, '\0' );
+    bool ok = readBlock( entries.data(), static_cast<uint64_t>(entries.size()) * sizeof( Entry ) )
+        && readBlock( &names[0], names.size() );
+
+    const uint64_t tableSize = sizeof( Header ) + static_cast<uint64_t>(entries.size()) * sizeof( Entry ) + names.size();
+    for ( size_t i = 0; ok && i < entries.size(); i++ ) {
+        const Entry& entry = entries[i];
+        ok = entry.Size > 0 && entry.Offset >= tableSize
+            && static_cast<uint64_t>(entry.Offset) + entry.Size <= FileSize
+            && static_cast<uint64_t>(entry.NameOffset) + entry.NameLength <= names.size()
+            && (i == 0 || entries[i - 1].NameHash <= entry.NameHash);
+    }
+
+    if ( !ok ) {
+        LogWarnCh( LC_TEXTURES ) << "Texture archive " << file << " is corrupt";
+        Close();
+        return XR_FAILED;
+    }
+
+    // Creating the mapping doesn't reserve any address space yet, only MapFile does
+    MappingHandle = CreateFileMappingA( FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    if ( !MappingHandle ) {
+        LogWarnCh( LC_TEXTURES ) << "Failed to map texture archive " << file;
+        Close();
+        return XR_FAILED;
+    }
+
+    Entries = std::move( entries );
+    Names = std::move( names );
+
+    LogInfoCh( LC_TEXTURES ) << "Opened texture archive " << file << " with " << Entries.size() << " textures";
+    return XR_SUCCESS;
+}
+
+/** Looks up the entry of the given file */
+bool TextureArchive::FindFile( const std::string& name, unsigned int* outEntry ) const {
+    if ( Entries.empty() )
+        return false;
+
+    std::string upper = name;
+    std::transform( upper.begin(), upper.end(), upper.begin(), ::toupper );
+
+    // Names sharing a hash are next to each other, the stored name decides
+    uint64_t hash = HashName( upper );
+    auto it = std::lower_bound( Entries.begin(), Entries.end(), hash, []( const Entry& e, uint64_t h ) { return e.NameHash < h; } );
+    for ( ; it != Entries.end() && it->NameHash == hash; ++it ) {
+        if ( Names.compare( it->NameOffset, it->NameLength, upper ) == 0 ) {
+            *outEntry = static_cast<unsigned int>(it - Entries.begin());
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Maps the DDS data of the given entry. Returns nullptr on failure. */
+std::unique_ptr<TextureArchive::FileView> TextureArchive::MapFile( unsigned int entry ) const {
+    if ( entry >= Entries.size() || !MappingHandle )
+        return nullptr;
+
+    // Views have to start at a multiple of the allocation granularity
+    static const DWORD granularity = []() {
+        SYSTEM_INFO info;
+        GetSystemInfo( &info );
+        return info.dwAllocationGranularity;
+    }();
+
+    const Entry& e = Entries[entry];
+    const uint64_t start = e.Offset - e.Offset % granularity;
+    const size_t padding = static_cast<size_t>(e.Offset - start);
+    const char* base = reinterpret_cast<const char*>(MapViewOfFile( MappingHandle, FILE_MAP_READ,
+        static_cast<DWORD>(start >> 32), static_cast<DWORD>(start), padding + e.Size ));
+    if ( !base ) {
+        LogWarnCh( LC_TEXTURES ) << "Failed to map " << Names.substr( e.NameOffset, e.NameLength ) << " from its texture archive";
+        return nullptr;
+    }
+
+    auto view = std::make_unique<FileView>();
+    view->Base = base;
+    view->Data = base + padding;
+    view->Size = e.Size;
+    return view;
+}
+
+/** Packs all DDS files of the given folder into an archive */
+XRESULT TextureArchive::Pack( const std::string& folder, const std::string& archiveFile ) {
+    std::vector<std::pair<Entry, std::string>> files;
+    std::vector<std::string> names;
+
+    std::error_code ec;
+    for ( auto it = std::filesystem::directory_iterator( folder, ec ); !ec && it != std::filesystem::directory_iterator(); it.increment( ec ) ) {
+        std::string ext = it->path().extension().string();
+        std::transform( ext.begin(), ext.end(), ext.begin(), ::toupper );
+        if ( ext != ".DDS" )
+            continue;
+
+        std::error_code sizeEc;
+        uintmax_t size = std::filesystem::file_size( it->path(), sizeEc );
+        if ( sizeEc || size < DDS_DX10_FORMAT_OFFSET || size > UINT_MAX )
+            continue;
+
+        Entry entry = {};
+        entry.NameHash = HashName( it->path().stem().string() );
+        entry.Size = static_cast<uint32_t>(size);
+        files.emplace_back( entry, it->path().string() );
+        names.push_back( it->path().stem().string() );
+    }
+
+    if ( files.empty() ) {
+        LogWarnCh( LC_TEXTURES ) << "No DDS files found in " << folder;
+        return XR_FAILED;
+    }
+
+    // Names with the same hash end up next to each other, lookups compare the stored names
+    std::string nameBlock;
+    for ( size_t i = 0; i < files.size(); i++ ) {
+        std::transform( names[i].begin(), names[i].end(), names[i].begin(), ::toupper );
+        files[i].first.NameOffset = static_cast<uint32_t>(nameBlock.size());
+        files[i].first.NameLength = static_cast<uint32_t>(names[i].size());
+        nameBlock += names[i];
+    }
+
+    std::sort( files.begin(), files.end(), []( const std::pair<Entry, std::string>& a, const std::pair<Entry, std::string>& b ) {
+        return a.first.NameHash < b.first.NameHash;
+    } );
+
+    const uint64_t tableSize = sizeof( Header ) + static_cast<uint64_t>(files.size()) * sizeof( Entry ) + nameBlock.size();
+    uint64_t offset = tableSize;
+    for ( auto& file : files ) {
+        offset = (offset + TEXTURE_ARCHIVE_ALIGNMENT - 1) & ~static_cast<uint64_t>(TEXTURE_ARCHIVE_ALIGNMENT - 1);
+        file.first.Offset = static_cast<uint32_t>(offset);
+        offset += file.first.Size;
+    }
+
+    if ( offset > UINT_MAX ) {
+        LogErrorCh( LC_TEXTURES ) << "Texture archive for " << folder << " would be larger than 4 GB";
+        return XR_FAILED;
+    }
+
+    FILE* f = fopen( archiveFile.c_str(), "wb" );
+    if ( !f ) {
+        LogErrorCh( LC_TEXTURES ) << "Failed to create texture archive " << archiveFile;
+        return XR_FAILED;
+    }
+
+    // Entries are written last, once the formats are known
+    std::vector<char> zeros( sizeof( Header ) + files.size() * sizeof( Entry ) + TEXTURE_ARCHIVE_ALIGNMENT, 0 );
+    fwrite( &zeros[0], sizeof( Header ) + files.size() * sizeof( Entry ), 1, f );
+    fwrite( nameBlock.data(), nameBlock.size(), 1, f );
+
+    std::vector<char> data;
+    uint64_t position = tableSize;
+    for ( auto& file : files ) {
+        data.resize( file.first.Size );
+
+        FILE* in = fopen( file.second.c_str(), "rb" );
+        bool ok = in && fread( &data[0], file.first.Size, 1, in ) == 1;
+        if ( in )
+            fclose( in );
+
+        if ( !ok || memcmp( &data[0], "DDS ", 4 ) != 0 ) {
+            LogErrorCh( LC_TEXTURES ) << "Failed to read " << file.second;
+            fclose( f );
+            return XR_FAILED;
+        }
+
+        uint32_t flags = *reinterpret_cast<uint32_t*>(&data[DDS_PIXELFORMAT_FLAGS_OFFSET]);
+        uint32_t fourCC = *reinterpret_cast<uint32_t*>(&data[DDS_PIXELFORMAT_FOURCC_OFFSET]);
+        if ( (flags & DDS_PF_FOURCC) && fourCC == MAKEFOURCC( 'D', 'X', '1', '0' ) && file.first.Size >= DDS_DX10_FORMAT_OFFSET + 4 )
+            file.first.Format = *reinterpret_cast<uint32_t*>(&data[DDS_DX10_FORMAT_OFFSET]);
+        else if ( flags & DDS_PF_FOURCC )
+            file.first.Format = fourCC;
+
+        fwrite( &zeros[0], static_cast<size_t>(file.first.Offset - position), 1, f );
+        fwrite( &data[0], file.first.Size, 1, f );
+        position = static_cast<uint64_t>(file.first.Offset) + file.first.Size;
+    }
+
+    Header header = {};
+    header.Magic = TEXTURE_ARCHIVE_MAGIC;
+    header.Version = TEXTURE_ARCHIVE_VERSION;
+    header.NumEntries = static_cast<uint32_t>(files.size());
+    header.NamesSize = static_cast<uint32_t>(nameBlock.size());
+
+    fseek( f, 0, SEEK_SET );
+    fwrite( &header, sizeof( header ), 1, f );
+    for ( const auto& file : files ) {
+        fwrite( &file.first, sizeof( Entry ), 1, f );
+    }
+    fclose( f );
+
+    LogInfoCh( LC_TEXTURES ) << "Packed " << files.size() << " textures from " << folder << " into " << archiveFile << " (" << position / (1024 * 1024) << " MB)";
+    return XR_SUCCESS;
+}
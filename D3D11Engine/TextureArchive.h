@@ -0,0 +1,85 @@
+#pragma once
+#include "pch.h"
+
+/** Archive of DDS files, replacing a folder of loose textures.
+    Layout: header, entries sorted by name hash, the uppercase names, then the 16-byte aligned DDS payloads.
+    Names are stored uppercase and without extension. Only the table is kept in memory, the payloads are mapped one at a time. */
+class TextureArchive {
+public:
+    /** A single file mapped out of the archive, unmapped again when destroyed */
+    class FileView {
+    public:
+        FileView() = default;
+        FileView( const FileView& ) = delete;
+        FileView& operator=( const FileView& ) = delete;
+        ~FileView();
+
+        const void* GetData() const { return Data; }
+        UINT GetSize() const { return Size; }
+
+    private:
+        friend class TextureArchive;
+
+        const char* Base = nullptr;
+        const void* Data = nullptr;
+        UINT Size = 0;
+    };
+
+    TextureArchive();
+    ~TextureArchive();
+
+    /** Opens the given archive and reads its table */
+    XRESULT Open( const std::string& file );
+
+    /** Looks up the entry of the given file */
+    bool FindFile( const std::string& name, unsigned int* outEntry ) const;
+
+    /** Maps the DDS data of the given entry. Returns nullptr on failure. */
+    std::unique_ptr<FileView> MapFile( unsigned int entry ) const;
+
+    /** Returns the number of files in the archive */
+    unsigned int GetNumFiles() const { return static_cast<unsigned int>(Entries.size()); }
+
+    /** Packs all DDS files of the given folder into an archive */
+    static XRESULT Pack( const std::string& folder, const std::string& archiveFile );
+
+    /** Returns the extension archives are stored with, next to the folder they were built from */
+    static const char* GetFileExtension() { return ".gdta"; }
+
+private:
+    struct Header {
+        uint32_t Magic;
+        uint32_t Version;
+        uint32_t NumEntries;
+
+        /** Size of the name block following the entries */
+        uint32_t NamesSize;
+    };
+
+    struct Entry {
+        uint64_t NameHash;
+        uint32_t Offset;
+        uint32_t Size;
+
+        /** DXGI_FORMAT for DX10-headers, FourCC otherwise */
+        uint32_t Format;
+
+        /** Position of the name inside the name block */
+        uint32_t NameOffset;
+        uint32_t NameLength;
+        uint32_t Reserved;
+    };
+
+    /** FNV-1a over the uppercase name without extension */
+    static uint64_t HashName( const std::string& name );
+
+    /** Closes the archive */
+    void Close();
+
+    HANDLE FileHandle;
+    HANDLE MappingHandle;
+    uint64_t FileSize;
+
+    std::vector<Entry> Entries;
+    std::string Names;
+};
@@ -0,0 +1,430 @@
+#include "pch.h"
+#include "TextureCompressor.h"
+#include "Engine.h"
+#include "ThreadPool.h"
+#include <emmintrin.h>
+#include <mutex>
+
+const uint32_t TEXTURE_CACHE_MAGIC = MAKEFOURCC( 'G', 'D', 'T', 'C' );
+const uint32_t TEXTURE_CACHE_VERSION = 2;
+const char* TEXTURE_CACHE_FOLDER = "system\\GD3D11\\textures\\cache\\";
+
+/** Top mips with at least this many block rows are split into jobs of half as many rows */
+const int PARALLEL_MIN_BLOCK_ROWS = 32;
+
+/** Returned when the compressed image is identical to the source */
+const float MAX_PSNR = 99.0f;
+
+struct TextureCacheHeader {
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t Format;
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t MipLevels;
+    uint64_t ContentHash;
+    uint32_t DataSize;
+    float PSNR;
+    uint32_t MipFilter;
+    uint32_t Reserved;
+};
+
+/** Squared error of the encoded channels against the source */
+struct BlockError {
+    uint64_t Error;
+    uint64_t Samples;
+};
+
+/** Statistics since startup */
+static std::mutex StatisticsMutex;
+static unsigned int NumCompressed = 0;
+static unsigned int NumCacheHits = 0;
+static double PSNRSum = 0.0;
+static float WorstPSNR = MAX_PSNR;
+static std::string WorstPSNRTexture;
+static uint64_t BytesSaved = 0;
+
+static inline uint16_t ToRGB565( int r, int g, int b ) {
+    return static_cast<uint16_t>(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+/** Expands a 565 color to 8 bits per channel, like the GPU does when decoding */
+static inline void FromRGB565( uint16_t c, int* rgb ) {
+    int r = (c >> 11) & 31;
+    int g = (c >> 5) & 63;
+    int b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+/** Per channel minimum and maximum of 16 B8G8R8A8 pixels */
+static inline void GetBlockBounds( const unsigned char* block, unsigned char* outMin, unsigned char* outMax ) {
+    const __m128i* rows = reinterpret_cast<const __m128i*>(block);
+    __m128i r0 = _mm_load_si128( rows + 0 );
+    __m128i r1 = _mm_load_si128( rows + 1 );
+    __m128i r2 = _mm_load_si128( rows + 2 );
+    __m128i r3 = _mm_load_si128( rows + 3 );
+
+    __m128i mn = _mm_min_epu8( _mm_min_epu8( r0, r1 ), _mm_min_epu8( r2, r3 ) );
+    __m128i mx = _mm_max_epu8( _mm_max_epu8( r0, r1 ), _mm_max_epu8( r2, r3 ) );
+
+    // Fold the 4 pixels of each register into one
+    mn = _mm_min_epu8( mn, _mm_shuffle_epi32( mn, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+    mn = _mm_min_epu8( mn, _mm_shuffle_epi32( mn, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+    mx = _mm_max_epu8( mx, _mm_shuffle_epi32( mx, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+    mx = _mm_max_epu8( mx, _mm_shuffle_epi32( mx, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+
+    int packedMin = _mm_cvtsi128_si32( mn );
+    int packedMax = _mm_cvtsi128_si32( mx );
+    memcpy( outMin, &packedMin, 4 );
+    memcpy( outMax, &packedMax, 4 );
+}
+
+/** Encodes the colors of a block using the inset bounding box of the colors as endpoints.
+    With punch-through alpha, pixels below half alpha are stored as transparent (BC1 only). */
+static void EncodeColorBlock( const unsigned char* block, const unsigned char* bmin, const unsigned char* bmax,
+    bool punchThrough, unsigned char* out, BlockError& error ) {
+    unsigned char lo[4];
+    unsigned char hi[4];
+    memcpy( lo, bmin, 4 );
+    memcpy( hi, bmax, 4 );
+
+    bool hasTransparent = punchThrough && bmin[3] < 128;
+    if ( hasTransparent ) {
+        // Only visible pixels may influence the endpoints
+        memset( lo, 255, 4 );
+        memset( hi, 0, 4 );
+        for ( int i = 0; i < 16; i++ ) {
+            const unsigned char* px = &block[i * 4];
+            if ( px[3] < 128 )
+                continue;
+
+            for ( int c = 0; c < 3; c++ ) {
+                lo[c] = std::min( lo[c], px[c] );
+                hi[c] = std::max( hi[c], px[c] );
+            }
+        }
+
+        if ( bmax[3] < 128 ) {
+            memset( lo, 0, 4 );
+            memset( hi, 0, 4 );
+        }
+    }
+
+    // Pull the endpoints in a bit, the extremes are usually outliers
+    for ( int c = 0; c < 3; c++ ) {
+        int inset = (hi[c] - lo[c]) >> 4;
+        lo[c] += inset;
+        hi[c] -= inset;
+    }
+
+    uint16_t c0 = ToRGB565( hi[2], hi[1], hi[0] );
+    uint16_t c1 = ToRGB565( lo[2], lo[1], lo[0] );
+
+    // c0 > c1 selects 4 colors, otherwise 3 colors and transparent
+    if ( hasTransparent ? c0 > c1 : c0 < c1 )
+        std::swap( c0, c1 );
+
+    int palette[4][3];
+    FromRGB565( c0, palette[0] );
+    FromRGB565( c1, palette[1] );
+
+    bool fourColors = c0 > c1;
+    for ( int c = 0; c < 3; c++ ) {
+        if ( fourColors ) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+
+    int numColors = fourColors ? 4 : 3;
+    uint32_t indices = 0;
+    for ( int i = 0; i < 16; i++ ) {
+        const unsigned char* px = &block[i * 4];
+
+        int best = 3;
+        if ( !hasTransparent || px[3] >= 128 ) {
+            int bestDistance = INT_MAX;
+            for ( int p = 0; p < numColors; p++ ) {
+                int dr = palette[p][0] - px[2];
+                int dg = palette[p][1] - px[1];
+                int db = palette[p][2] - px[0];
+                int distance = dr * dr + dg * dg + db * db;
+                if ( distance < bestDistance ) {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+
+            error.Error += bestDistance;
+            error.Samples += 3;
+        }
+
+        indices |= static_cast<uint32_t>(best) << (i * 2);
+    }
+
+    memcpy( out + 0, &c0, 2 );
+    memcpy( out + 2, &c1, 2 );
+    memcpy( out + 4, &indices, 4 );
+}
+
+/** Encodes the alpha channel of a block with 8 interpolated values between its extremes */
+static void EncodeAlphaBlock( const unsigned char* block, const unsigned char* bmin, const unsigned char* bmax,
+    unsigned char* out, BlockError& error ) {
+    int a0 = bmax[3];
+    int a1 = bmin[3];
+
+    int palette[8];
+    palette[0] = a0;
+    palette[1] = a1;
+    for ( int k = 1; k < 7; k++ ) {
+        palette[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+    }
+
+    uint64_t indices = 0;
+    for ( int i = 0; i < 16; i++ ) {
+        int a = block[i * 4 + 3];
+
+        int best = 0;
+        int bestDistance = INT_MAX;
+        for ( int p = 0; p < (a0 > a1 ? 8 : 1); p++ ) {
+            int distance = (palette[p] - a) * (palette[p] - a);
+            if ( distance < bestDistance ) {
+                bestDistance = distance;
+                best = p;
+            }
+        }
+
+        error.Error += bestDistance;
+        error.Samples++;
+        indices |= static_cast<uint64_t>(best) << (i * 3);
+    }
+
+    out[0] = static_cast<unsigned char>(a0);
+    out[1] = static_cast<unsigned char>(a1);
+    for ( int k = 0; k < 6; k++ ) {
+        out[2 + k] = static_cast<unsigned char>(indices >> (k * 8));
+    }
+}
+
+/** Encodes the given block rows of an image. Jobs for different rows write to different parts of out. */
+static BlockError EncodeBlockRows( const unsigned char* bgra, int width, TextureCompressor::EBlockFormat format,
+    int firstRow, int lastRow, unsigned char* out ) {
+    BlockError error = {};
+
+    int blocksX = width / 4;
+    int blockSize = format == TextureCompressor::BF_BC1 ? 8 : 16;
+
+    alignas(16) unsigned char block[64];
+    for ( int by = firstRow; by < lastRow; by++ ) {
+        for ( int bx = 0; bx < blocksX; bx++ ) {
+            for ( int y = 0; y < 4; y++ ) {
+                memcpy( &block[y * 16], &bgra[((by * 4 + y) * width + bx * 4) * 4], 16 );
+            }
+
+            unsigned char bmin[4];
+            unsigned char bmax[4];
+            GetBlockBounds( block, bmin, bmax );
+
+            unsigned char* dst = out + (by * blocksX + bx) * blockSize;
+            if ( format == TextureCompressor::BF_BC1 ) {
+                EncodeColorBlock( block, bmin, bmax, true, dst, error );
+            } else {
+                EncodeAlphaBlock( block, bmin, bmax, dst, error );
+                EncodeColorBlock( block, bmin, bmax, false, dst + 8, error );
+            }
+        }
+    }
+
+    return error;
+}
+
+/** Returns how many mips of the given size can be block compressed. All of them need to be multiples of 4. */
+UINT TextureCompressor::GetNumCompressibleMips( INT2 size, UINT maxMipLevels ) {
+    UINT mips = 0;
+    while ( mips < maxMipLevels ) {
+        int width = size.x >> mips;
+        int height = size.y >> mips;
+        if ( width < 4 || height < 4 || (width % 4) != 0 || (height % 4) != 0 )
+            break;
+
+        mips++;
+    }
+    return mips;
+}
+
+/** Sizes the data and computes the mip offsets */
+void TextureCompressor::InitLayout( EBlockFormat format, INT2 size, UINT mipLevels, MipMapGenerator::EFilter mipFilter, CompressedTexture& out ) {
+    out.Format = format;
+    out.MipFilter = mipFilter;
+    out.Size = size;
+    out.MipLevels = mipLevels;
+    out.MipOffsets.resize( mipLevels );
+    out.PSNR = MAX_PSNR;
+
+    UINT offset = 0;
+    for ( UINT mip = 0; mip < mipLevels; mip++ ) {
+        out.MipOffsets[mip] = offset;
+        offset += Toolbox::GetDDSStorageRequirements( size.x >> mip, size.y >> mip, format == BF_BC1 );
+    }
+    out.Data.resize( offset );
+}
+
+/** Compresses the given B8G8R8A8 image and the mips generated from it. Returns the PSNR of the top mip in dB. */
+float TextureCompressor::Compress( const std::string& name, const unsigned char* bgra, INT2 size, UINT mipLevels, EBlockFormat format,
+    MipMapGenerator::EFilter mipFilter, CompressedTexture& out ) {
+    InitLayout( format, size, mipLevels, mipFilter, out );
+
+    MipMapGenerator::MipChain chain;
+    MipMapGenerator::Generate( bgra, size, mipLevels, mipFilter, chain );
+
+    BlockError topError = {};
+    for ( UINT mip = 0; mip < mipLevels; mip++ ) {
+        int width = size.x >> mip;
+        int height = size.y >> mip;
+        const unsigned char* src = chain.Mips[mip];
+
+        unsigned char* blocks = &out.Data[out.MipOffsets[mip]];
+        int blockRows = height / 4;
+
+        if ( mip == 0 && blockRows >= PARALLEL_MIN_BLOCK_ROWS && Engine::WorkerThreadPool && !Engine::WorkerThreadPool->isWorkerThread() ) {
+            // The top mip is three quarters of the work, spread it over the worker threads
+            std::vector<std::future<BlockError>> jobs;
+            for ( int row = 0; row < blockRows; row += PARALLEL_MIN_BLOCK_ROWS / 2 ) {
+                int lastRow = std::min( row + PARALLEL_MIN_BLOCK_ROWS / 2, blockRows );
+                jobs.push_back( Engine::WorkerThreadPool->enqueue( [=]() {
+                    return EncodeBlockRows( src, width, format, row, lastRow, blocks );
+                } ) );
+            }
+
+            for ( auto& job : jobs ) {
+                BlockError e = job.get();
+                topError.Error += e.Error;
+                topError.Samples += e.Samples;
+            }
+        } else {
+            BlockError e = EncodeBlockRows( src, width, format, 0, blockRows, blocks );
+            if ( mip == 0 )
+                topError = e;
+        }
+    }
+
+    if ( topError.Error > 0 && topError.Samples > 0 ) {
+        double mse = static_cast<double>(topError.Error) / topError.Samples;
+        out.PSNR = std::min( MAX_PSNR, static_cast<float>(10.0 * log10( 255.0 * 255.0 / mse )) );
+    }
+
+    RecordStatistics( name, out, false );
+    return out.PSNR;
+}
+
+/** Returns the file the given texture is cached in */
+std::string TextureCompressor::GetCacheFile( const std::string& name, INT2 size ) {
+    // Mip-surfaces share the name of their texture
+    return TEXTURE_CACHE_FOLDER + name + "_" + std::to_string( size.x ) + "x" + std::to_string( size.y ) + ".gdtc";
+}
+
+/** Loads a texture compressed before, if it was built from the same content and with the same settings */
+bool TextureCompressor::LoadFromCache( const std::string& name, uint64_t contentHash, EBlockFormat format, INT2 size, UINT mipLevels,
+    MipMapGenerator::EFilter mipFilter, CompressedTexture& out ) {
+    FILE* f = fopen( GetCacheFile( name, size ).c_str(), "rb" );
+    if ( !f )
+        return false;
+
+    TextureCacheHeader header;
+    bool ok = fread( &header, sizeof( header ), 1, f ) == 1
+        && header.Magic == TEXTURE_CACHE_MAGIC && header.Version == TEXTURE_CACHE_VERSION
+        && header.ContentHash == contentHash && header.Format == static_cast<uint32_t>(format)
+        && header.Width == static_cast<uint32_t>(size.x) && header.Height == static_cast<uint32_t>(size.y)
+        && header.MipLevels == mipLevels && header.MipFilter == static_cast<uint32_t>(mipFilter);
+
+    if ( ok ) {
+        InitLayout( format, size, mipLevels, mipFilter, out );
+        ok = header.DataSize == out.Data.size() && fread( &out.Data[0], out.Data.size(), 1, f ) == 1;
+        out.PSNR = header.PSNR;
+    }
+    fclose( f );
+
+    if ( ok )
+        RecordStatistics( name, out, true );
+
+    return ok;
+}
+
+/** Stores the compressed texture so the next start can skip compressing it */
+void TextureCompressor::SaveToCache( const std::string& name, uint64_t contentHash, const CompressedTexture& texture ) {
+    std::error_code ec;
+    std::filesystem::create_directories( TEXTURE_CACHE_FOLDER, ec );
+
+    std::string file = GetCacheFile( name, texture.Size );
+    FILE* f = fopen( file.c_str(), "wb" );
+    if ( !f ) {
+        LogWarnCh( LC_TEXTURES ) << "Failed to open texture cache file " << file << " for writing";
+        return;
+    }
+
+    TextureCacheHeader header = {};
+    header.Magic = TEXTURE_CACHE_MAGIC;
+    header.Version = TEXTURE_CACHE_VERSION;
+    header.Format = texture.Format;
+    header.Width = texture.Size.x;
+    header.Height = texture.Size.y;
+    header.MipLevels = texture.MipLevels;
+    header.ContentHash = contentHash;
+    header.DataSize = static_cast<uint32_t>(texture.Data.size());
+    header.PSNR = texture.PSNR;
+    header.MipFilter = texture.MipFilter;
+
+    fwrite( &header, sizeof( header ), 1, f );
+    fwrite( &texture.Data[0], texture.Data.size(), 1, f );
+    fclose( f );
+}
+
+/** FNV-1a over the given data */
+uint64_t TextureCompressor::HashData( const void* data, size_t size ) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    uint64_t hash = 14695981039346656037ull;
+    for ( size_t i = 0; i < size; i++ ) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/** Adds the texture to the statistics */
+void TextureCompressor::RecordStatistics( const std::string& name, const CompressedTexture& texture, bool fromCache ) {
+    uint64_t uncompressedSize = 0;
+    for ( UINT mip = 0; mip < texture.MipLevels; mip++ ) {
+        uncompressedSize += static_cast<uint64_t>(texture.Size.x >> mip) * (texture.Size.y >> mip) * 4;
+    }
+
+    std::lock_guard<std::mutex> lock( StatisticsMutex );
+    if ( fromCache )
+        NumCacheHits++;
+    else
+        NumCompressed++;
+
+    BytesSaved += uncompressedSize - texture.Data.size();
+    PSNRSum += texture.PSNR;
+    if ( texture.PSNR < WorstPSNR ) {
+        WorstPSNR = texture.PSNR;
+        WorstPSNRTexture = name;
+    }
+}
+
+/** Writes the number of compressed textures, cache hits and the quality so far to the log */
+void TextureCompressor::LogStatistics() {
+    std::lock_guard<std::mutex> lock( StatisticsMutex );
+
+    unsigned int numTextures = NumCompressed + NumCacheHits;
+    if ( !numTextures )
+        return;
+
+    LogInfoCh( LC_TEXTURES ) << "Block compressed " << numTextures << " textures (" << NumCacheHits << " from cache), saving "
+        << BytesSaved / (1024 * 1024) << " MB. Average PSNR: " << PSNRSum / numTextures << " dB, worst: "
+        << WorstPSNR << " dB (" << WorstPSNRTexture << ")";
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "pch.h"
+#include "MipMapGenerator.h"
+
+/** Block compresses converted game textures on the CPU, so they only need an eighth (BC1) or a quarter (BC3)
+    of the memory of their B8G8R8A8 versions. Results are cached on disk by texture name and content. */
+class TextureCompressor {
+public:
+    enum EBlockFormat {
+        BF_BC1 = DXGI_FORMAT_BC1_UNORM, // Opaque or 1-bit alpha
+        BF_BC3 = DXGI_FORMAT_BC3_UNORM
+    };
+
+    /** Block compressed mip chain of one texture */
+    struct CompressedTexture {
+        EBlockFormat Format;
+        INT2 Size;
+        UINT MipLevels;
+        std::vector<unsigned char> Data;
+
+        /** Offset of each mip inside Data */
+        std::vector<UINT> MipOffsets;
+
+        /** Filter the mips were generated with */
+        MipMapGenerator::EFilter MipFilter;
+
+        /** Peak signal-to-noise ratio of the top mip against its source, in dB */
+        float PSNR;
+    };
+
+    /** Returns how many mips of the given size can be block compressed. All of them need to be multiples of 4. */
+    static UINT GetNumCompressibleMips( INT2 size, UINT maxMipLevels );
+
+    /** Compresses the given B8G8R8A8 image and the mips generated from it. Returns the PSNR of the top mip in dB. */
+    static float Compress( const std::string& name, const unsigned char* bgra, INT2 size, UINT mipLevels, EBlockFormat format,
+        MipMapGenerator::EFilter mipFilter, CompressedTexture& out );
+
+    /** Loads a texture compressed before, if it was built from the same content and with the same settings */
+    static bool LoadFromCache( const std::string& name, uint64_t contentHash, EBlockFormat format, INT2 size, UINT mipLevels,
+        MipMapGenerator::EFilter mipFilter, CompressedTexture& out );
+
+    /** Stores the compressed texture so the next start can skip compressing it */
+    static void SaveToCache( const std::string& name, uint64_t contentHash, const CompressedTexture& texture );
+
+    /** FNV-1a over the given data */
+    static uint64_t HashData( const void* data, size_t size );
+
+    /** Writes the number of compressed textures, cache hits and the quality so far to the log */
+    static void LogStatistics();
+
+private:
+    /** Sizes the data and computes the mip offsets */
+    static void InitLayout( EBlockFormat format, INT2 size, UINT mipLevels, MipMapGenerator::EFilter mipFilter, CompressedTexture& out );
+
+    /** Returns the file the given texture is cached in */
+    static std::string GetCacheFile( const std::string& name, INT2 size );
+
+    /** Adds the texture to the statistics */
+    static void RecordStatistics( const std::string& name, const CompressedTexture& texture, bool fromCache );
+};
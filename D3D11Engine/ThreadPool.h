@@ -26,7 +26,16 @@ public:
 	~ThreadPool();
 
 	size_t getNumThreads() { return numThreads; }
+
+	// true if called from one of this pool's workers. Jobs which would wait on other jobs
+	// of the same pool must run inline then, or every worker can end up waiting.
+	bool isWorkerThread() const { return currentPool() == this; }
 private:
+	static const ThreadPool*& currentPool() {
+		static thread_local const ThreadPool* pool = nullptr;
+		return pool;
+	}
+
 	// need to keep track of threads so we can join them
 	std::vector< std::thread > workers;
 	// the task queue
@@ -47,6 +56,7 @@ inline ThreadPool::ThreadPool( size_t threads )
 	for ( size_t i = 0; i < threads; ++i )
 		workers.emplace_back(
 			[this] {
+				currentPool() = this;
 				for ( ;;) {
 					std::function<void()> task;
 
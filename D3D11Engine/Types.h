@@ -16,6 +16,14 @@ enum XRESULT {
     XR_INVALID_ARG,
 };
 
+/** Dense index of a shader inside the D3D11ShaderManager. Resolve it once by name,
+    it stays valid when the shader gets reloaded. */
+typedef unsigned int ShaderHandle;
+const ShaderHandle INVALID_SHADER_HANDLE = UINT_MAX;
+
+/** Index of a shader declared with feature permutations inside the D3D11ShaderManager */
+typedef unsigned int PermutationHandle;
+
 struct INT2 {
     INT2( int x, int y ) {
         this->x = x;
@@ -13,6 +13,16 @@ struct ExVertexStruct {
     DWORD Color;
 };
 
+/** Quantized version of ExVertexStruct for static vob meshes. Position and texcoord are stored
+    relative to the bounds of their visual, the normal is octahedral encoded. TexCoord2 is dropped,
+    since vobs don't use lightmaps. */
+struct ExVertexStructCompressed {
+    unsigned short Position[4];
+    short Normal[2];
+    unsigned short TexCoord[2];
+    DWORD Color;
+};
+
 struct SimpleObjectVertexStruct {
     float3 Position;
     float2 TexCoord;
@@ -0,0 +1,187 @@
+#include "pch.h"
+#include "VobPool.h"
+#include <algorithm>
+#include <random>
+
+/** Size of the synthetic scene of the benchmark */
+const unsigned int BENCHMARK_NUM_VOBS = 50000;
+const unsigned int BENCHMARK_VOBS_PER_LEAF = 64;
+const unsigned int BENCHMARK_RUNS = 5;
+
+/** Everything above this is evicted from the CPU caches before each run */
+const size_t BENCHMARK_CACHE_FLUSH_SIZE = 32 * 1024 * 1024;
+
+std::vector<VobInfo*> VobPool::Infos;
+std::vector<XMFLOAT4X4> VobPool::WorldMatrices;
+std::vector<XMFLOAT3> VobPool::LastRenderPositions;
+std::vector<DWORD> VobPool::GroundColors;
+std::vector<uint8_t> VobPool::Flags;
+std::vector<VobHandle> VobPool::FreeHandles;
+
+/** Returns a free slot for the given vob */
+VobHandle VobPool::Allocate( VobInfo* info ) {
+    VobHandle handle;
+    if ( !FreeHandles.empty() ) {
+        handle = FreeHandles.back();
+        FreeHandles.pop_back();
+    } else {
+        handle = static_cast<VobHandle>(Infos.size());
+        Infos.emplace_back();
+        WorldMatrices.emplace_back();
+        LastRenderPositions.emplace_back();
+        GroundColors.emplace_back();
+        Flags.emplace_back();
+    }
+
+    Infos[handle] = info;
+    XMStoreFloat4x4( &WorldMatrices[handle], XMMatrixIdentity() );
+    LastRenderPositions[handle] = XMFLOAT3( 0, 0, 0 );
+    GroundColors[handle] = 0xFFFFFFFF;
+    Flags[handle] = 0;
+    return handle;
+}
+
+/** Gives the slot back, after the vob was deleted */
+void VobPool::Free( VobHandle handle ) {
+    Infos[handle] = nullptr;
+    Flags[handle] = 0;
+    FreeHandles.push_back( handle );
+}
+
+/** Returns the number of live vobs */
+unsigned int VobPool::GetNumVobs() {
+    return static_cast<unsigned int>(Infos.size() - FreeHandles.size());
+}
+
+/** Layout of the hot fields when they were part of VobInfo, including the cold data around them */
+struct BenchmarkHeapVob {
+    void* VTable;
+    void* VisualInfo;
+    void* Vob;
+    void* VobConstantBuffer;
+    XMFLOAT3 LastRenderPosition;
+    bool IsIndoorVob;
+    bool VisibleInRenderPass;
+    void* VobSection;
+    XMFLOAT4X4 WorldMatrix;
+    std::vector<void*> ParentBSPNodes;
+    DWORD GroundColor;
+};
+
+/** Instance data gathered for the vobs in range */
+struct BenchmarkInstance {
+    XMFLOAT4X4 World;
+    DWORD Color;
+};
+
+/** Touches enough memory to push the scene out of the caches */
+static void FlushCaches( std::vector<unsigned char>& flushBuffer ) {
+    for ( size_t i = 0; i < flushBuffer.size(); i += 64 ) {
+        flushBuffer[i]++;
+    }
+}
+
+/** Times collecting the vobs in range from synthetic leafs of 50k vobs, once through heap objects the way
+    VobInfo used to store the fields and once through the pool arrays. Writes the results to the log. */
+void VobPool::RunCollectionBenchmark() {
+    std::mt19937 random( 1337 );
+    std::uniform_real_distribution<float> position( -50000.0f, 50000.0f );
+
+    // Allocate the heap objects in between unrelated allocations, like vobs loaded with their visuals
+    std::vector<BenchmarkHeapVob*> heapVobs( BENCHMARK_NUM_VOBS );
+    std::vector<std::unique_ptr<char[]>> fillers( BENCHMARK_NUM_VOBS );
+    for ( unsigned int i = 0; i < BENCHMARK_NUM_VOBS; i++ ) {
+        heapVobs[i] = new BenchmarkHeapVob();
+        heapVobs[i]->LastRenderPosition = XMFLOAT3( position( random ), 0.0f, position( random ) );
+        heapVobs[i]->VisibleInRenderPass = false;
+        XMStoreFloat4x4( &heapVobs[i]->WorldMatrix, XMMatrixIdentity() );
+        heapVobs[i]->GroundColor = 0xFFFFFFFF;
+        fillers[i].reset( new char[64 + random() % 512] );
+    }
+
+    // The same scene in separate arrays
+    std::vector<XMFLOAT4X4> worldMatrices( BENCHMARK_NUM_VOBS );
+    std::vector<XMFLOAT3> positions( BENCHMARK_NUM_VOBS );
+    std::vector<DWORD> groundColors( BENCHMARK_NUM_VOBS, 0xFFFFFFFF );
+    std::vector<uint8_t> flags( BENCHMARK_NUM_VOBS, 0 );
+    for ( unsigned int i = 0; i < BENCHMARK_NUM_VOBS; i++ ) {
+        positions[i] = heapVobs[i]->LastRenderPosition;
+        worldMatrices[i] = heapVobs[i]->WorldMatrix;
+    }
+
+    // Leafs reference their vobs in no particular order
+    std::vector<unsigned int> order( BENCHMARK_NUM_VOBS );
+    for ( unsigned int i = 0; i < BENCHMARK_NUM_VOBS; i++ ) {
+        order[i] = i;
+    }
+    std::shuffle( order.begin(), order.end(), random );
+
+    std::vector<std::vector<BenchmarkHeapVob*>> heapLeafs( BENCHMARK_NUM_VOBS / BENCHMARK_VOBS_PER_LEAF + 1 );
+    std::vector<std::vector<VobHandle>> handleLeafs( heapLeafs.size() );
+    for ( unsigned int i = 0; i < BENCHMARK_NUM_VOBS; i++ ) {
+        heapLeafs[i / BENCHMARK_VOBS_PER_LEAF].push_back( heapVobs[order[i]] );
+        handleLeafs[i / BENCHMARK_VOBS_PER_LEAF].push_back( order[i] );
+    }
+
+    const XMVECTOR camPos = XMVectorZero();
+    const float range = 10000.0f;
+
+    std::vector<BenchmarkInstance> instances;
+    instances.reserve( BENCHMARK_NUM_VOBS );
+    std::vector<unsigned char> flushBuffer( BENCHMARK_CACHE_FLUSH_SIZE );
+
+    long long bestHeap = LLONG_MAX;
+    long long bestPool = LLONG_MAX;
+    size_t numCollected = 0;
+    for ( unsigned int run = 0; run < BENCHMARK_RUNS; run++ ) {
+        for ( BenchmarkHeapVob* vob : heapVobs ) {
+            vob->VisibleInRenderPass = false;
+        }
+        instances.clear();
+        FlushCaches( flushBuffer );
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for ( auto const& leaf : heapLeafs ) {
+            for ( BenchmarkHeapVob* vob : leaf ) {
+                if ( vob->VisibleInRenderPass )
+                    continue;
+
+                float dist;
+                XMStoreFloat( &dist, XMVector3Length( camPos - XMLoadFloat3( &vob->LastRenderPosition ) ) );
+                if ( dist < range ) {
+                    instances.push_back( { vob->WorldMatrix, vob->GroundColor } );
+                    vob->VisibleInRenderPass = true;
+                }
+            }
+        }
+        bestHeap = std::min( bestHeap, static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count()) );
+
+        std::fill( flags.begin(), flags.end(), static_cast<uint8_t>(0) );
+        instances.clear();
+        FlushCaches( flushBuffer );
+
+        start = std::chrono::high_resolution_clock::now();
+        for ( auto const& leaf : handleLeafs ) {
+            for ( VobHandle handle : leaf ) {
+                if ( flags[handle] & F_VISIBLE_IN_RENDER_PASS )
+                    continue;
+
+                float dist;
+                XMStoreFloat( &dist, XMVector3Length( camPos - XMLoadFloat3( &positions[handle] ) ) );
+                if ( dist < range ) {
+                    instances.push_back( { worldMatrices[handle], groundColors[handle] } );
+                    flags[handle] |= F_VISIBLE_IN_RENDER_PASS;
+                }
+            }
+        }
+        bestPool = std::min( bestPool, static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count()) );
+        numCollected = instances.size();
+    }
+
+    for ( BenchmarkHeapVob* vob : heapVobs ) {
+        delete vob;
+    }
+
+    LogInfo() << "Vob collection benchmark, " << BENCHMARK_NUM_VOBS << " vobs, " << numCollected << " in range, cold caches: "
+        << bestHeap << " us through heap objects, " << bestPool << " us through the vob pool";
+}
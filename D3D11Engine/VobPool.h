@@ -0,0 +1,52 @@
+#pragma once
+#include "pch.h"
+
+struct VobInfo;
+
+/** Stable index of a static vob inside the VobPool */
+typedef unsigned int VobHandle;
+const VobHandle INVALID_VOB_HANDLE = UINT_MAX;
+
+/** Holds the fields of all static vobs which are touched every frame, as structure of arrays. Visibility collection
+    walks the handles of a BSP leaf and only reaches the VobInfo once a vob is in range. Slots of deleted vobs are
+    reused, so a handle stays the same for the lifetime of its vob. Only used from the main thread. */
+class VobPool {
+public:
+    enum EFlags : uint8_t {
+        F_VISIBLE_IN_RENDER_PASS = 1,
+        F_INDOOR = 2
+    };
+
+    /** Returns a free slot for the given vob */
+    static VobHandle Allocate( VobInfo* info );
+
+    /** Gives the slot back, after the vob was deleted */
+    static void Free( VobHandle handle );
+
+    static VobInfo* GetInfo( VobHandle handle ) { return Infos[handle]; }
+    static XMFLOAT4X4& GetWorldMatrix( VobHandle handle ) { return WorldMatrices[handle]; }
+    static XMFLOAT3& GetLastRenderPosition( VobHandle handle ) { return LastRenderPositions[handle]; }
+    static DWORD& GetGroundColor( VobHandle handle ) { return GroundColors[handle]; }
+
+    static bool HasFlag( VobHandle handle, EFlags flag ) { return (Flags[handle] & flag) != 0; }
+    static void SetFlag( VobHandle handle, EFlags flag, bool set ) {
+        Flags[handle] = set ? (Flags[handle] | flag) : (Flags[handle] & ~flag);
+    }
+
+    /** Returns the number of live vobs */
+    static unsigned int GetNumVobs();
+
+    /** Times collecting the vobs in range from synthetic leafs of 50k vobs, once through heap objects the way
+        VobInfo used to store the fields and once through the pool arrays. Writes the results to the log. */
+    static void RunCollectionBenchmark();
+
+private:
+    static std::vector<VobInfo*> Infos;
+    static std::vector<XMFLOAT4X4> WorldMatrices;
+    static std::vector<XMFLOAT3> LastRenderPositions;
+    static std::vector<DWORD> GroundColors;
+    static std::vector<uint8_t> Flags;
+
+    /** Slots of deleted vobs */
+    static std::vector<VobHandle> FreeHandles;
+};
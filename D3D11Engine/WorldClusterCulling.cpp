@@ -0,0 +1,199 @@
+#include "pch.h"
+#include "WorldClusterCulling.h"
+#include "Engine.h"
+#include "GothicAPI.h"
+#include "WorldConverter.h"
+#include "zCMaterial.h"
+
+/** Bump when the layout of a sample changes */
+const uint32_t CAMERA_PATH_VERSION = 1;
+
+/** One recorded frame */
+struct CameraPathSample {
+    XMFLOAT3 CameraPosition;
+    float MaxDistance;
+    XMFLOAT4X4 ViewProj;
+    int SectionDrawRadius;
+};
+
+static std::vector<CameraPathSample> RecordedPath;
+static bool Recording = false;
+static unsigned int LastRecordedFrame = 0;
+
+/** Extracts the 4 side planes of the view frustum from the given view-projection matrix */
+void WorldClusterCulling::GetFrustumSidePlanes( const XMFLOAT4X4& viewProj, XMFLOAT4* planes ) {
+    // Taken from the transposed viewproj-matrix, so the rows are the columns of the clip transform
+    XMMATRIX clip = XMLoadFloat4x4( &viewProj );
+    XMStoreFloat4( &planes[0], XMPlaneNormalize( clip.r[3] + clip.r[0] ) );
+    XMStoreFloat4( &planes[1], XMPlaneNormalize( clip.r[3] - clip.r[0] ) );
+    XMStoreFloat4( &planes[2], XMPlaneNormalize( clip.r[3] + clip.r[1] ) );
+    XMStoreFloat4( &planes[3], XMPlaneNormalize( clip.r[3] - clip.r[1] ) );
+}
+
+/** Tests the cluster against the distance, its normal cone and the side planes, in that order */
+WorldClusterCulling::ECullResult WorldClusterCulling::TestCluster( const WorldMeshCluster& cluster, const XMFLOAT4* frustumPlanes, const XMFLOAT3& cameraPosition, float maxDistance ) {
+    XMVECTOR center = XMLoadFloat3( &cluster.Center );
+    XMVECTOR toCluster = center - XMLoadFloat3( &cameraPosition );
+    float distance = XMVectorGetX( XMVector3Length( toCluster ) );
+
+    if ( distance - cluster.Radius > maxDistance )
+        return CR_DISTANCE;
+
+    // All triangles facing away from the camera
+    if ( XMVectorGetX( XMVector3Dot( toCluster, XMLoadFloat3( &cluster.ConeAxis ) ) ) >= cluster.ConeCutoff * distance + cluster.Radius )
+        return CR_BACKFACING;
+
+    for ( int p = 0; p < 4; p++ ) {
+        if ( XMVectorGetX( XMPlaneDotCoord( XMLoadFloat4( &frustumPlanes[p] ), center ) ) < -cluster.Radius )
+            return CR_FRUSTUM;
+    }
+
+    return CR_VISIBLE;
+}
+
+/** Starts recording the camera of every frame, or stops and writes the path to the file of the current world */
+void WorldClusterCulling::SetRecording( bool recording ) {
+    if ( recording == Recording )
+        return;
+
+    Recording = recording;
+    if ( Recording ) {
+        RecordedPath.clear();
+        LogInfoCh( LC_WORLD ) << "Recording camera path";
+        return;
+    }
+
+    std::string file = GetPathFile();
+    FILE* f = fopen( file.c_str(), "wb" );
+    if ( !f ) {
+        LogWarnCh( LC_WORLD ) << "Could not write camera path " << file;
+        return;
+    }
+
+    uint32_t version = CAMERA_PATH_VERSION;
+    uint32_t numSamples = RecordedPath.size();
+    fwrite( &version, sizeof( version ), 1, f );
+    fwrite( &numSamples, sizeof( numSamples ), 1, f );
+    if ( numSamples )
+        fwrite( &RecordedPath[0], sizeof( CameraPathSample ) * numSamples, 1, f );
+    fclose( f );
+
+    LogInfoCh( LC_WORLD ) << "Saved " << numSamples << " frames of camera path to " << file;
+    RecordedPath.clear();
+    RecordedPath.shrink_to_fit();
+}
+
+bool WorldClusterCulling::IsRecording() {
+    return Recording;
+}
+
+/** Called by the world mesh rendering. Only stores something while recording, once per frame. */
+void WorldClusterCulling::RecordFrame( const XMFLOAT3& cameraPosition, const XMFLOAT4X4& viewProj, float maxDistance ) {
+    const unsigned int frame = Engine::GAPI->GetFrameNumber();
+    if ( !Recording || (frame == LastRecordedFrame && !RecordedPath.empty()) )
+        return;
+
+    LastRecordedFrame = frame;
+
+    CameraPathSample sample;
+    sample.CameraPosition = cameraPosition;
+    sample.MaxDistance = maxDistance;
+    sample.ViewProj = viewProj;
+    sample.SectionDrawRadius = Engine::GAPI->GetRendererState().RendererSettings.SectionDrawRadius;
+    RecordedPath.push_back( sample );
+}
+
+/** Culls the loaded world mesh from every camera of the recorded path of the current world and logs
+    how many clusters and triangles were culled, split by reason */
+void WorldClusterCulling::ReplayPath() {
+    std::string file = GetPathFile();
+    std::vector<CameraPathSample> path;
+
+    FILE* f = fopen( file.c_str(), "rb" );
+    if ( f ) {
+        uint32_t version = 0;
+        uint32_t numSamples = 0;
+        if ( fread( &version, sizeof( version ), 1, f ) == 1 && version == CAMERA_PATH_VERSION
+            && fread( &numSamples, sizeof( numSamples ), 1, f ) == 1 && numSamples > 0 ) {
+            path.resize( numSamples );
+            if ( fread( &path[0], sizeof( CameraPathSample ) * numSamples, 1, f ) != 1 )
+                path.clear();
+        }
+        fclose( f );
+    }
+
+    if ( path.empty() ) {
+        LogWarnCh( LC_WORLD ) << "No camera path recorded for this world (" << file << ")";
+        return;
+    }
+
+    uint64_t clusters[CR_NUM_RESULTS] = {};
+    uint64_t triangles[CR_NUM_RESULTS] = {};
+    uint64_t unclusteredTriangles = 0;
+    for ( const CameraPathSample& sample : path ) {
+        XMFLOAT4 planes[4];
+        GetFrustumSidePlanes( sample.ViewProj, planes );
+        const INT2 camSection = WorldConverter::GetSectionOfPos( sample.CameraPosition );
+
+        // Same section selection as the renderer
+        for ( auto const& itx : Engine::GAPI->GetWorldSections() ) {
+            if ( abs( itx.first - camSection.x ) >= sample.SectionDrawRadius )
+                continue;
+
+            for ( auto const& ity : itx.second ) {
+                const WorldMeshSectionInfo& section = ity.second;
+                if ( abs( ity.first - camSection.y ) >= sample.SectionDrawRadius )
+                    continue;
+
+                // Only opaque meshes get their clusters culled
+                for ( auto const& worldMesh : section.WorldMeshes ) {
+                    const MeshKey& key = worldMesh.first;
+                    if ( !key.Material || !key.Material->GetTexture() || !key.Info
+                        || key.Info->MaterialType == MaterialInfo::MT_Water
+                        || key.Info->MaterialType == MaterialInfo::MT_Portal
+                        || key.Info->MaterialType == MaterialInfo::MT_WaterfallFoam
+                        || (key.Material->GetAlphaFunc() > zMAT_ALPHA_FUNC_NONE && key.Material->GetAlphaFunc() != zMAT_ALPHA_FUNC_TEST) )
+                        continue;
+
+                    if ( worldMesh.second->Clusters.empty() ) {
+                        unclusteredTriangles += worldMesh.second->Indices.size() / 3;
+                        continue;
+                    }
+
+                    for ( const WorldMeshCluster& cluster : worldMesh.second->Clusters ) {
+                        ECullResult result = TestCluster( cluster, planes, sample.CameraPosition, sample.MaxDistance );
+                        clusters[result]++;
+                        triangles[result] += cluster.NumIndices / 3;
+                    }
+                }
+            }
+        }
+    }
+
+    uint64_t totalClusters = 0;
+    uint64_t totalTriangles = unclusteredTriangles;
+    for ( int r = 0; r < CR_NUM_RESULTS; r++ ) {
+        totalClusters += clusters[r];
+        totalTriangles += triangles[r];
+    }
+
+    const double frames = static_cast<double>(path.size());
+    auto percent = []( uint64_t part, uint64_t total ) { return total ? 100.0 * part / total : 0.0; };
+    uint64_t culledClusters = totalClusters - clusters[CR_VISIBLE];
+    uint64_t culledTriangles = triangles[CR_DISTANCE] + triangles[CR_BACKFACING] + triangles[CR_FRUSTUM];
+
+    LogInfoCh( LC_WORLD ) << "Replayed " << path.size() << " frames of " << file << ", per frame:";
+    LogInfoCh( LC_WORLD ) << "  Clusters: " << static_cast<uint64_t>(totalClusters / frames) << " tested, "
+        << static_cast<uint64_t>(culledClusters / frames) << " culled (" << percent( culledClusters, totalClusters ) << "%)";
+    LogInfoCh( LC_WORLD ) << "  Triangles: " << static_cast<uint64_t>(totalTriangles / frames) << " in visible sections, "
+        << static_cast<uint64_t>(culledTriangles / frames) << " culled (" << percent( culledTriangles, totalTriangles ) << "%), "
+        << static_cast<uint64_t>(unclusteredTriangles / frames) << " in meshes without clusters";
+    LogInfoCh( LC_WORLD ) << "  Culled triangles by reason: distance " << percent( triangles[CR_DISTANCE], totalTriangles )
+        << "%, facing away " << percent( triangles[CR_BACKFACING], totalTriangles )
+        << "%, outside the view " << percent( triangles[CR_FRUSTUM], totalTriangles ) << "%";
+}
+
+/** Returns the file the camera path of the current world is stored in */
+std::string WorldClusterCulling::GetPathFile() {
+    return "system\\GD3D11\\meshes\\WLD_" + Engine::GAPI->GetLoadedWorldInfo()->WorldName + ".campath";
+}
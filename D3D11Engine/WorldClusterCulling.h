@@ -0,0 +1,38 @@
+#pragma once
+#include "pch.h"
+
+struct WorldMeshCluster;
+
+/** Decides which clusters of the world mesh are drawn. Can also record the camera while playing and replay
+    that path later against the loaded world, to measure how much the culling saves without rendering anything. */
+class WorldClusterCulling {
+public:
+    enum ECullResult {
+        CR_VISIBLE,
+        CR_DISTANCE,
+        CR_BACKFACING,
+        CR_FRUSTUM,
+        CR_NUM_RESULTS
+    };
+
+    /** Extracts the 4 side planes of the view frustum from the given view-projection matrix */
+    static void GetFrustumSidePlanes( const XMFLOAT4X4& viewProj, XMFLOAT4* planes );
+
+    /** Tests the cluster against the distance, its normal cone and the side planes, in that order */
+    static ECullResult TestCluster( const WorldMeshCluster& cluster, const XMFLOAT4* frustumPlanes, const XMFLOAT3& cameraPosition, float maxDistance );
+
+    /** Starts recording the camera of every frame, or stops and writes the path to the file of the current world */
+    static void SetRecording( bool recording );
+    static bool IsRecording();
+
+    /** Called by the world mesh rendering. Only stores something while recording, once per frame. */
+    static void RecordFrame( const XMFLOAT3& cameraPosition, const XMFLOAT4X4& viewProj, float maxDistance );
+
+    /** Culls the loaded world mesh from every camera of the recorded path of the current world and logs
+        how many clusters and triangles were culled, split by reason */
+    static void ReplayPath();
+
+private:
+    /** Returns the file the camera path of the current world is stored in */
+    static std::string GetPathFile();
+};
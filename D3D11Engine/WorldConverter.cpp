@@ -3,6 +3,8 @@
 #include "Engine.h"
 #include "BaseGraphicsEngine.h"
 #include "D3D11VertexBuffer.h"
+#include "ResidencyManager.h"
+#include "WorldStreamer.h"
 #include "zCPolygon.h"
 #include "zCMaterial.h"
 #include "zCTexture.h"
@@ -13,6 +15,7 @@
 #include "zCModel.h"
 #include "zCMorphMesh.h"
 #include <set>
+#include <algorithm>
 #include "ConstantBufferStructs.h"
 #include "D3D11ConstantBuffer.h"
 #include "zCMesh.h"
@@ -29,6 +32,7 @@ WorldConverter::~WorldConverter() {}
 
 /** Collects all world-polys in the specific range. Drops all materials that have no alphablending */
 void WorldConverter::WorldMeshCollectPolyRange( const float3& position, float range, std::map<int, std::map<int, WorldMeshSectionInfo>>& inSections, std::map<MeshKey, WorldMeshInfo*, cmpMeshKey>& outMeshes ) {
+    ResidencyManager::ScopedBufferCategory bufferCategory( ResidencyManager::C_WORLD_GEOMETRY );
     INT2 s = GetSectionOfPos( position );
     MeshKey opaqueKey;
     opaqueKey.Material = nullptr;
@@ -104,6 +108,8 @@ void WorldConverter::WorldMeshCollectPolyRange( const float3& position, float ra
 
 /** Converts a loaded custommesh to be the worldmesh */
 XRESULT WorldConverter::LoadWorldMeshFromFile( const std::string& file, std::map<int, std::map<int, WorldMeshSectionInfo>>* outSections, WorldInfo* info, MeshInfo** outWrappedMesh ) {
+    ResidencyManager::ScopedBufferCategory bufferCategory( ResidencyManager::C_WORLD_GEOMETRY );
+    const bool streamSections = WorldStreamer::IsEnabled();
     GMesh* mesh = new GMesh();
 
     const float worldScale = 100.0f;
@@ -222,7 +228,7 @@ XRESULT WorldConverter::LoadWorldMeshFromFile( const std::string& file, std::map
             ms += "\t" + (*it) + "\n";
         }
 
-        LogWarn() << ms;
+        LogWarnCh( LC_WORLD ) << ms;
     }
 
     // Dont need that anymore
@@ -266,9 +272,17 @@ XRESULT WorldConverter::LoadWorldMeshFromFile( const std::string& file, std::map
                     it.second->Vertices.size(),
                     sizeof( ExVertexStruct ) );
 
-                // Init and fill them
-                it.second->MeshVertexBuffer->Init( &it.second->Vertices[0], it.second->Vertices.size() * sizeof( ExVertexStruct ), D3D11VertexBuffer::B_VERTEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
-                it.second->MeshIndexBuffer->Init( &it.second->Indices[0], it.second->Indices.size() * sizeof( VERTEX_INDEX ), D3D11VertexBuffer::B_INDEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
+                // Group the triangles into cullable clusters
+                BuildWorldMeshClusters( it.second );
+
+                // Init and fill them. When streaming, only the sections around the camera get them later.
+                if ( !streamSections ) {
+                    it.second->MeshVertexBuffer->Init( &it.second->Vertices[0], it.second->Vertices.size() * sizeof( ExVertexStruct ), D3D11VertexBuffer::B_VERTEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
+                    it.second->MeshIndexBuffer->Init( &it.second->Indices[0], it.second->Indices.size() * sizeof( VERTEX_INDEX ), D3D11VertexBuffer::B_INDEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
+                } else {
+                    SAFE_DELETE( it.second->MeshVertexBuffer );
+                    SAFE_DELETE( it.second->MeshIndexBuffer );
+                }
 
                 // Remember them, to wrap then up later
                 vertexBuffers.emplace_back( &it.second->Vertices );
@@ -305,12 +319,21 @@ XRESULT WorldConverter::LoadWorldMeshFromFile( const std::string& file, std::map
 
     // Create the buffers for wrapped mesh
     MeshInfo* wmi = new MeshInfo;
-    Engine::GraphicsEngine->CreateVertexBuffer( &wmi->MeshVertexBuffer );
-    Engine::GraphicsEngine->CreateVertexBuffer( &wmi->MeshIndexBuffer );
+    if ( !streamSections ) {
+        Engine::GraphicsEngine->CreateVertexBuffer( &wmi->MeshVertexBuffer );
+        Engine::GraphicsEngine->CreateVertexBuffer( &wmi->MeshIndexBuffer );
 
-    // Init and fill them
-    wmi->MeshVertexBuffer->Init( &wrappedVertices[0], wrappedVertices.size() * sizeof( ExVertexStruct ), D3D11VertexBuffer::B_VERTEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
-    wmi->MeshIndexBuffer->Init( &wrappedIndices[0], wrappedIndices.size() * sizeof( unsigned int ), D3D11VertexBuffer::B_INDEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
+        // Init and fill them
+        wmi->MeshVertexBuffer->Init( &wrappedVertices[0], wrappedVertices.size() * sizeof( ExVertexStruct ), D3D11VertexBuffer::B_VERTEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
+        wmi->MeshIndexBuffer->Init( &wrappedIndices[0], wrappedIndices.size() * sizeof( unsigned int ), D3D11VertexBuffer::B_INDEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
+    } else {
+        // The world streamer uploads and wraps the sections around the camera
+        for ( auto& itx : *outSections ) {
+            for ( auto& ity : itx.second ) {
+                ity.second.StreamingState = WorldMeshSectionInfo::SS_EVICTED;
+            }
+        }
+    }
 
     *outWrappedMesh = wmi;
 
@@ -343,6 +366,8 @@ bool AdditionalCheckWaterFall(zCTexture* texture)
 
 /** Converts the worldmesh into a more usable format */
 HRESULT WorldConverter::ConvertWorldMesh( zCPolygon** polys, unsigned int numPolygons, std::map<int, std::map<int, WorldMeshSectionInfo>>* outSections, WorldInfo* info, MeshInfo** outWrappedMesh, bool indoorLocation ) {
+    ResidencyManager::ScopedBufferCategory bufferCategory( ResidencyManager::C_WORLD_GEOMETRY );
+    const bool streamSections = WorldStreamer::IsEnabled();
     // Go through every polygon and put it into its section
     for ( unsigned int i = 0; i < numPolygons; i++ ) {
         zCPolygon* poly = polys[i];
@@ -388,7 +413,7 @@ HRESULT WorldConverter::ConvertWorldMesh( zCPolygon** polys, unsigned int numPol
 
         zCMaterial* mat = poly->GetMaterial();
         if ( poly->GetNumPolyVertices() < 3 ) {
-            LogWarn() << "Poly with less than 3 vertices!";
+            LogWarnCh( LC_WORLD ) << "Poly with less than 3 vertices!";
         }
 
         // Extract poly vertices
@@ -523,9 +548,17 @@ HRESULT WorldConverter::ConvertWorldMesh( zCPolygon** polys, unsigned int numPol
                     it.second->Vertices.size(),
                     sizeof( ExVertexStruct ) );
 
-                // Init and fill them
-                it.second->MeshVertexBuffer->Init( &it.second->Vertices[0], it.second->Vertices.size() * sizeof( ExVertexStruct ), D3D11VertexBuffer::B_VERTEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
-                it.second->MeshIndexBuffer->Init( &it.second->Indices[0], it.second->Indices.size() * sizeof( VERTEX_INDEX ), D3D11VertexBuffer::B_INDEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
+                // Group the triangles into cullable clusters
+                BuildWorldMeshClusters( it.second );
+
+                // Init and fill them. When streaming, only the sections around the camera get them later.
+                if ( !streamSections ) {
+                    it.second->MeshVertexBuffer->Init( &it.second->Vertices[0], it.second->Vertices.size() * sizeof( ExVertexStruct ), D3D11VertexBuffer::B_VERTEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
+                    it.second->MeshIndexBuffer->Init( &it.second->Indices[0], it.second->Indices.size() * sizeof( VERTEX_INDEX ), D3D11VertexBuffer::B_INDEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
+                } else {
+                    SAFE_DELETE( it.second->MeshVertexBuffer );
+                    SAFE_DELETE( it.second->MeshIndexBuffer );
+                }
 
 
                 // Remember them, to wrap then up later
@@ -556,12 +589,21 @@ HRESULT WorldConverter::ConvertWorldMesh( zCPolygon** polys, unsigned int numPol
 
     // Create the buffers for wrapped mesh
     MeshInfo* wmi = new MeshInfo();
-    Engine::GraphicsEngine->CreateVertexBuffer( &wmi->MeshVertexBuffer );
-    Engine::GraphicsEngine->CreateVertexBuffer( &wmi->MeshIndexBuffer );
+    if ( !streamSections ) {
+        Engine::GraphicsEngine->CreateVertexBuffer( &wmi->MeshVertexBuffer );
+        Engine::GraphicsEngine->CreateVertexBuffer( &wmi->MeshIndexBuffer );
 
-    // Init and fill them
-    wmi->MeshVertexBuffer->Init( &wrappedVertices[0], wrappedVertices.size() * sizeof( ExVertexStruct ), D3D11VertexBuffer::B_VERTEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
-    wmi->MeshIndexBuffer->Init( &wrappedIndices[0], wrappedIndices.size() * sizeof( unsigned int ), D3D11VertexBuffer::B_INDEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
+        // Init and fill them
+        wmi->MeshVertexBuffer->Init( &wrappedVertices[0], wrappedVertices.size() * sizeof( ExVertexStruct ), D3D11VertexBuffer::B_VERTEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
+        wmi->MeshIndexBuffer->Init( &wrappedIndices[0], wrappedIndices.size() * sizeof( unsigned int ), D3D11VertexBuffer::B_INDEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
+    } else {
+        // The world streamer uploads and wraps the sections around the camera
+        for ( auto& itx : *outSections ) {
+            for ( auto& ity : itx.second ) {
+                ity.second.StreamingState = WorldMeshSectionInfo::SS_EVICTED;
+            }
+        }
+    }
 
     *outWrappedMesh = wmi;
 
@@ -587,6 +629,7 @@ HRESULT WorldConverter::ConvertWorldMesh( zCPolygon** polys, unsigned int numPol
 
 /** Creates the FullSectionMesh for the given section */
 void WorldConverter::GenerateFullSectionMesh( WorldMeshSectionInfo& section ) {
+    ResidencyManager::ScopedBufferCategory bufferCategory( ResidencyManager::C_WORLD_GEOMETRY );
     std::vector<ExVertexStruct> vx;
     for ( auto const& it : section.WorldMeshes ) {
         if ( !it.first.Material ||
@@ -603,7 +646,7 @@ void WorldConverter::GenerateFullSectionMesh( WorldMeshSectionInfo& section ) {
 
     // Get VOBs
     for ( auto const& it : section.Vobs ) {
-        if ( it->IsIndoorVob )
+        if ( it->IsIndoorVob() )
             continue;
 
         XMFLOAT4X4 world;
@@ -682,7 +725,7 @@ void WorldConverter::SaveSectionsToObjUnindexed( const char* file, const std::ma
     FILE* f = fopen( file, "w" );
 
     if ( !f ) {
-        LogError() << "Failed to open file " << file << " for writing!";
+        LogErrorCh( LC_WORLD ) << "Failed to open file " << file << " for writing!";
         return;
     }
 
@@ -704,6 +747,7 @@ void WorldConverter::SaveSectionsToObjUnindexed( const char* file, const std::ma
 
 /** Extracts a 3DS-Mesh from a zCVisual */
 void WorldConverter::Extract3DSMeshFromVisual( zCProgMeshProto* visual, MeshVisualInfo* meshInfo ) {
+    ResidencyManager::ScopedBufferCategory bufferCategory( ResidencyManager::C_VOBS );
     std::vector<ExVertexStruct> vertices;
 
     // Get the data out for all submeshes
@@ -755,6 +799,7 @@ void WorldConverter::Extract3DSMeshFromVisual( zCProgMeshProto* visual, MeshVisu
 
 /** Extracts a skeletal mesh from a zCMeshSoftSkin */
 void WorldConverter::ExtractSkeletalMeshFromVob( zCModel* model, SkeletalMeshVisualInfo* skeletalMeshInfo ) {
+    ResidencyManager::ScopedBufferCategory bufferCategory( ResidencyManager::C_VOBS );
     // This type has multiple skinned meshes inside
     for ( int i = 0; i < model->GetMeshSoftSkinList()->NumInArray; i++ ) {
         zCMeshSoftSkin* s = model->GetMeshSoftSkinList()->Array[i];
@@ -877,6 +922,8 @@ void WorldConverter::ExtractSkeletalMeshFromVob( zCModel* model, SkeletalMeshVis
             Engine::GAPI->GetRendererState().RendererInfo.SkeletalVerticesDataSize += mi->Vertices.size() * sizeof( ExVertexStruct );
             Engine::GAPI->GetRendererState().RendererInfo.SkeletalVerticesDataSize += mi->Indices.size() * sizeof( VERTEX_INDEX );
 
+            CreateSkeletalMeshLODs( mi, bindPoseVertices );
+
             skeletalMeshInfo->SkeletalMeshes[mat].emplace_back( mi );
             skeletalMeshInfo->Meshes[mat].emplace_back( bmi );
         }
@@ -896,8 +943,93 @@ void WorldConverter::ExtractSkeletalMeshFromVob( zCModel* model, SkeletalMeshVis
 #endif
 }
 
+/** Creates the reduced detail levels of a skeletal mesh by clustering its bind-pose vertices */
+void WorldConverter::CreateSkeletalMeshLODs( SkeletalMeshInfo* mesh, const std::vector<ExVertexStruct>& bindPoseVertices ) {
+    ResidencyManager::ScopedBufferCategory bufferCategory( ResidencyManager::C_VOBS );
+    // Grid resolution over the longest side of the mesh for LOD 1, halved for every further level
+    const int LOD_GRID_RESOLUTION = 24;
+    // Meshes this small are cheap enough already
+    const size_t LOD_MIN_TRIANGLES = 64;
+
+    if ( bindPoseVertices.size() != mesh->Vertices.size() || mesh->Indices.size() < LOD_MIN_TRIANGLES * 3 )
+        return;
+
+    XMVECTOR bbMin = XMVectorReplicate( FLT_MAX );
+    XMVECTOR bbMax = XMVectorReplicate( -FLT_MAX );
+    for ( const ExVertexStruct& v : bindPoseVertices ) {
+        XMVECTOR p = XMLoadFloat3( v.Position.toXMFLOAT3() );
+        bbMin = XMVectorMin( bbMin, p );
+        bbMax = XMVectorMax( bbMax, p );
+    }
+
+    XMFLOAT3 extent;
+    XMStoreFloat3( &extent, bbMax - bbMin );
+    float longestSide = std::max( extent.x, std::max( extent.y, extent.z ) );
+    if ( longestSide <= 0.0f )
+        return;
+
+    std::vector<VERTEX_INDEX> remap( mesh->Vertices.size() );
+    std::unordered_map<unsigned long long, VERTEX_INDEX> cells;
+    size_t previousNumIndices = mesh->Indices.size();
+
+    for ( int lod = 0; lod < NUM_SKELETAL_MESH_LODS - 1; lod++ ) {
+        const int resolution = std::max( 2, LOD_GRID_RESOLUTION >> lod );
+        const XMVECTOR invCellSize = XMVectorReplicate( static_cast<float>(resolution) / longestSide );
+
+        // Every vertex collapses into the first vertex found in its cell. The dominant bone is part of the
+        // cell, so limbs which are close in bind-pose (fingers, legs) don't get welded together.
+        cells.clear();
+        for ( size_t i = 0; i < mesh->Vertices.size(); i++ ) {
+            const ExSkelVertexStruct& vx = mesh->Vertices[i];
+            int dominant = 0;
+            for ( int n = 1; n < 4; n++ ) {
+                if ( vx.weights[n] > vx.weights[dominant] )
+                    dominant = n;
+            }
+
+            XMFLOAT3 cell;
+            XMStoreFloat3( &cell, (XMLoadFloat3( bindPoseVertices[i].Position.toXMFLOAT3() ) - bbMin) * invCellSize );
+
+            unsigned long long key = static_cast<unsigned long long>(static_cast<unsigned short>(cell.x))
+                | (static_cast<unsigned long long>(static_cast<unsigned short>(cell.y)) << 16)
+                | (static_cast<unsigned long long>(static_cast<unsigned short>(cell.z)) << 32)
+                | (static_cast<unsigned long long>(vx.boneIndices[dominant]) << 48);
+
+            remap[i] = cells.emplace( key, static_cast<VERTEX_INDEX>(i) ).first->second;
+        }
+
+        std::vector<VERTEX_INDEX> indices;
+        indices.reserve( mesh->Indices.size() );
+        for ( size_t t = 0; t + 2 < mesh->Indices.size(); t += 3 ) {
+            VERTEX_INDEX a = remap[mesh->Indices[t]];
+            VERTEX_INDEX b = remap[mesh->Indices[t + 1]];
+            VERTEX_INDEX c = remap[mesh->Indices[t + 2]];
+
+            // Drop triangles which collapsed
+            if ( a == b || b == c || a == c )
+                continue;
+
+            indices.push_back( a );
+            indices.push_back( b );
+            indices.push_back( c );
+        }
+
+        // Not worth an extra level if it doesn't remove at least a quarter of what's left
+        if ( indices.empty() || indices.size() > (previousNumIndices * 3) / 4 )
+            continue;
+
+        Engine::GraphicsEngine->CreateVertexBuffer( &mesh->MeshIndexBufferLOD[lod] );
+        mesh->MeshIndexBufferLOD[lod]->Init( &indices[0], indices.size() * sizeof( VERTEX_INDEX ), D3D11VertexBuffer::B_INDEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
+        Engine::GAPI->GetRendererState().RendererInfo.SkeletalVerticesDataSize += indices.size() * sizeof( VERTEX_INDEX );
+
+        previousNumIndices = indices.size();
+        mesh->IndicesLOD[lod] = std::move( indices );
+    }
+}
+
 /** Extracts a zCProgMeshProto from a zCModel */
 void WorldConverter::ExtractProgMeshProtoFromModel( zCModel* model, MeshVisualInfo* meshInfo ) {
+    ResidencyManager::ScopedBufferCategory bufferCategory( ResidencyManager::C_VOBS );
     XMFLOAT3 bbmin = XMFLOAT3( FLT_MAX, FLT_MAX, FLT_MAX );
     XMFLOAT3 bbmax = XMFLOAT3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
 
@@ -970,7 +1102,7 @@ void WorldConverter::ExtractProgMeshProtoFromModel( zCModel* model, MeshVisualIn
 
             // Create the indexed mesh
             if ( vertices.empty() ) {
-                LogWarn() << "Empty submesh (#" << i << ") on Visual " << visualName;
+                LogWarnCh( LC_WORLD ) << "Empty submesh (#" << i << ") on Visual " << visualName;
                 continue;
             }
 
@@ -1064,6 +1196,7 @@ void WorldConverter::ExtractProgMeshProtoFromModel( zCModel* model, MeshVisualIn
 
 /** Extracts a zCProgMeshProto from a zCMesh */
 void WorldConverter::ExtractProgMeshProtoFromMesh( zCMesh* mesh, MeshVisualInfo* meshInfo ) {
+    ResidencyManager::ScopedBufferCategory bufferCategory( ResidencyManager::C_VOBS );
     zCPolygon** polys = mesh->GetPolygons();
     int numPolys = mesh->GetNumPolygons();
     zCMaterial* mat = (numPolys > 0 ? polys[0]->GetMaterial() : nullptr);
@@ -1156,6 +1289,7 @@ void WorldConverter::ExtractNodeVisual( int index, zCModelNodeInst* node, std::m
 
 /** Updates a Morph-Mesh visual */
 void WorldConverter::UpdateMorphMeshVisual( void* v, MeshVisualInfo* meshInfo ) {
+    ResidencyManager::ScopedBufferCategory bufferCategory( ResidencyManager::C_VOBS );
     zCMorphMesh* visual = reinterpret_cast<zCMorphMesh*>(v);
     visual->GetTexAniState()->UpdateTexList();
     visual->AdvanceAnis();
@@ -1195,6 +1329,7 @@ void WorldConverter::UpdateMorphMeshVisual( void* v, MeshVisualInfo* meshInfo )
 
 /** Extracts a 3DS-Mesh from a zCVisual */
 void WorldConverter::Extract3DSMeshFromVisual2( zCProgMeshProto* visual, MeshVisualInfo* meshInfo ) {
+    ResidencyManager::ScopedBufferCategory bufferCategory( ResidencyManager::C_VOBS );
     XMFLOAT3 bbmin = XMFLOAT3( FLT_MAX, FLT_MAX, FLT_MAX );
     XMFLOAT3 bbmax = XMFLOAT3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
 
@@ -1246,7 +1381,7 @@ void WorldConverter::Extract3DSMeshFromVisual2( zCProgMeshProto* visual, MeshVis
 
         // Create the indexed mesh
         if ( vertices.empty() ) {
-            LogWarn() << "Empty submesh (#" << i << ") on Visual " << visual->GetObjectName();
+            LogWarnCh( LC_WORLD ) << "Empty submesh (#" << i << ") on Visual " << visual->GetObjectName();
             continue;
         }
 
@@ -1347,6 +1482,587 @@ void WorldConverter::Extract3DSMeshFromVisual2( zCProgMeshProto* visual, MeshVis
 #endif
 }
 
+static unsigned short QuantizeUNorm16( float v ) {
+    return static_cast<unsigned short>(std::min( std::max( v, 0.0f ), 1.0f ) * 65535.0f + 0.5f);
+}
+
+static short QuantizeSNorm16( float v ) {
+    return static_cast<short>(roundf( std::min( std::max( v, -1.0f ), 1.0f ) * 32767.0f ));
+}
+
+/** Maps a unit vector onto the octahedron, unfolded into [-1, 1]^2 */
+static XMFLOAT2 EncodeOctahedral( const float3& n ) {
+    float l1 = fabs( n.x ) + fabs( n.y ) + fabs( n.z );
+    if ( l1 <= 0.0f )
+        return XMFLOAT2( 0.0f, 0.0f );
+
+    float x = n.x / l1;
+    float y = n.y / l1;
+    if ( n.z < 0.0f ) {
+        float ox = (1.0f - fabs( y )) * (x >= 0.0f ? 1.0f : -1.0f);
+        float oy = (1.0f - fabs( x )) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = ox;
+        y = oy;
+    }
+    return XMFLOAT2( x, y );
+}
+
+/** Same as DecodeOctahedralNormal in VertexCompression.h */
+static XMFLOAT3 DecodeOctahedral( float ex, float ey ) {
+    XMFLOAT3 n = XMFLOAT3( ex, ey, 1.0f - fabs( ex ) - fabs( ey ) );
+    float t = std::min( std::max( -n.z, 0.0f ), 1.0f );
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+
+    XMStoreFloat3( &n, XMVector3Normalize( XMLoadFloat3( &n ) ) );
+    return n;
+}
+
+/** Quantizes a vertex into the ranges given by the decode parameters */
+static ExVertexStructCompressed EncodeCompressedVertex( const ExVertexStruct& v, const VS_ExConstantBuffer_VertexDecode& decode ) {
+    ExVertexStructCompressed c;
+    c.Position[0] = QuantizeUNorm16( (v.Position.x - decode.VD_PositionOffset.x) / decode.VD_PositionScale.x );
+    c.Position[1] = QuantizeUNorm16( (v.Position.y - decode.VD_PositionOffset.y) / decode.VD_PositionScale.y );
+    c.Position[2] = QuantizeUNorm16( (v.Position.z - decode.VD_PositionOffset.z) / decode.VD_PositionScale.z );
+    c.Position[3] = 0;
+
+    XMFLOAT2 oct = EncodeOctahedral( v.Normal );
+    c.Normal[0] = QuantizeSNorm16( oct.x );
+    c.Normal[1] = QuantizeSNorm16( oct.y );
+
+    c.TexCoord[0] = QuantizeUNorm16( (v.TexCoord.x - decode.VD_TexCoordScaleOffset.z) / decode.VD_TexCoordScaleOffset.x );
+    c.TexCoord[1] = QuantizeUNorm16( (v.TexCoord.y - decode.VD_TexCoordScaleOffset.w) / decode.VD_TexCoordScaleOffset.y );
+    c.Color = v.Color;
+    return c;
+}
+
+/** Expands a vertex again, the same way the vertexshaders do it */
+static ExVertexStruct DecodeCompressedVertex( const ExVertexStructCompressed& c, const VS_ExConstantBuffer_VertexDecode& decode ) {
+    ExVertexStruct v = {};
+    v.Position.x = (c.Position[0] / 65535.0f) * decode.VD_PositionScale.x + decode.VD_PositionOffset.x;
+    v.Position.y = (c.Position[1] / 65535.0f) * decode.VD_PositionScale.y + decode.VD_PositionOffset.y;
+    v.Position.z = (c.Position[2] / 65535.0f) * decode.VD_PositionScale.z + decode.VD_PositionOffset.z;
+
+    XMFLOAT3 n = DecodeOctahedral( std::max( c.Normal[0] / 32767.0f, -1.0f ), std::max( c.Normal[1] / 32767.0f, -1.0f ) );
+    v.Normal = float3( n.x, n.y, n.z );
+
+    v.TexCoord.x = (c.TexCoord[0] / 65535.0f) * decode.VD_TexCoordScaleOffset.x + decode.VD_TexCoordScaleOffset.z;
+    v.TexCoord.y = (c.TexCoord[1] / 65535.0f) * decode.VD_TexCoordScaleOffset.y + decode.VD_TexCoordScaleOffset.w;
+    v.Color = c.Color;
+    return v;
+}
+
+/** Largest differences found between the vertices and their round trip */
+struct VertexRoundTripError {
+    float Position = 0.0f;
+    float TexCoord = 0.0f;
+    double MinNormalDot = 1.0;
+};
+
+/** Octahedral SNORM16 normals are off by less than 0.004 degrees, allow some float slack */
+const double MAX_NORMAL_ERROR_DEGREES = 0.05;
+
+/** Encodes and decodes the vertex and checks the result is within half a quantization step of the original.
+    The slack covers the float math of applying scale and offset. */
+static bool CheckVertexRoundTrip( const ExVertexStruct& v, const VS_ExConstantBuffer_VertexDecode& decode, VertexRoundTripError& error ) {
+    ExVertexStruct d = DecodeCompressedVertex( EncodeCompressedVertex( v, decode ), decode );
+    bool ok = true;
+
+    for ( int a = 0; a < 3; a++ ) {
+        float scale = (&decode.VD_PositionScale.x)[a];
+        float offset = (&decode.VD_PositionOffset.x)[a];
+        float bound = 0.5f * scale / 65535.0f + 8.0f * FLT_EPSILON * (fabs( offset ) + scale);
+        float e = fabs( (&d.Position.x)[a] - (&v.Position.x)[a] );
+        error.Position = std::max( error.Position, e );
+        ok &= e <= bound;
+    }
+
+    for ( int a = 0; a < 2; a++ ) {
+        float scale = (&decode.VD_TexCoordScaleOffset.x)[a];
+        float offset = (&decode.VD_TexCoordScaleOffset.z)[a];
+        float bound = 0.5f * scale / 65535.0f + 8.0f * FLT_EPSILON * (fabs( offset ) + scale);
+        float e = fabs( (&d.TexCoord.x)[a] - (&v.TexCoord.x)[a] );
+        error.TexCoord = std::max( error.TexCoord, e );
+        ok &= e <= bound;
+    }
+
+    // Degenerated normals have no direction to keep
+    double nLen = sqrt( static_cast<double>(v.Normal.x) * v.Normal.x + static_cast<double>(v.Normal.y) * v.Normal.y + static_cast<double>(v.Normal.z) * v.Normal.z );
+    if ( nLen > 1e-6 ) {
+        double dot = (static_cast<double>(d.Normal.x) * v.Normal.x + static_cast<double>(d.Normal.y) * v.Normal.y + static_cast<double>(d.Normal.z) * v.Normal.z) / nLen;
+        error.MinNormalDot = std::min( error.MinNormalDot, dot );
+        ok &= dot >= cos( XMConvertToRadians( static_cast<float>(MAX_NORMAL_ERROR_DEGREES) ) );
+    }
+
+    return ok;
+}
+
+/** Runs the round trip once on synthetic vertices covering the corners of the ranges, both octahedron
+    hemispheres and its folds. If this fails, the encoding is broken and nothing gets compressed. */
+static bool VerifyVertexCompression() {
+    VS_ExConstantBuffer_VertexDecode decode;
+    decode.VD_PositionScale = float4( 2500.0f, 0.25f, 731.5f, 0.0f );
+    decode.VD_PositionOffset = float4( -1250.0f, 40000.0f, -0.125f, 0.0f );
+    decode.VD_TexCoordScaleOffset = float4( 64.0f, 1.0f, -32.0f, 0.0f );
+
+    std::vector<float3> normals = {
+        float3( 1, 0, 0 ), float3( -1, 0, 0 ), float3( 0, 1, 0 ), float3( 0, -1, 0 ), float3( 0, 0, 1 ), float3( 0, 0, -1 ),
+    };
+    for ( int i = 0; i < 26; i++ ) {
+        float x = static_cast<float>(i % 3) - 1.0f;
+        float y = static_cast<float>((i / 3) % 3) - 1.0f;
+        float z = static_cast<float>(i / 9) - 1.0f;
+        normals.push_back( float3( x, y, z == 0.0f && x == 0.0f && y == 0.0f ? 1.0f : z ) );
+    }
+
+    // Directions on a spiral over the whole sphere
+    for ( int i = 0; i < 1024; i++ ) {
+        float z = 1.0f - 2.0f * (i + 0.5f) / 1024.0f;
+        float r = sqrtf( std::max( 1.0f - z * z, 0.0f ) );
+        float phi = i * 2.39996323f;
+        normals.push_back( float3( r * cosf( phi ), r * sinf( phi ), z ) );
+    }
+
+    VertexRoundTripError error;
+    bool ok = true;
+    for ( size_t i = 0; i < normals.size(); i++ ) {
+        float fx = (i % 5) / 4.0f;
+        float fy = ((i / 5) % 7) / 6.0f;
+        float fz = ((i / 35) % 3) / 2.0f;
+
+        ExVertexStruct v = {};
+        v.Position = float3( decode.VD_PositionOffset.x + fx * decode.VD_PositionScale.x,
+            decode.VD_PositionOffset.y + fy * decode.VD_PositionScale.y,
+            decode.VD_PositionOffset.z + fz * decode.VD_PositionScale.z );
+        v.Normal = normals[i];
+        v.TexCoord = float2( decode.VD_TexCoordScaleOffset.z + fy * decode.VD_TexCoordScaleOffset.x,
+            decode.VD_TexCoordScaleOffset.w + fx * decode.VD_TexCoordScaleOffset.y );
+        ok &= CheckVertexRoundTrip( v, decode, error );
+    }
+
+    if ( !ok ) {
+        LogError() << "Vertex compression self test failed: max position error " << error.Position
+            << ", max texcoord error " << error.TexCoord
+            << ", max normal error " << XMConvertToDegrees( static_cast<float>(acos( std::min( error.MinNormalDot, 1.0 ) )) ) << " deg"
+            << ". Static meshes stay uncompressed.";
+    }
+    return ok;
+}
+
+/** Replaces the vertexbuffers of a static mesh visual with quantized ExVertexStructCompressed-buffers */
+void WorldConverter::CompressStaticMeshVisual( MeshVisualInfo* meshInfo ) {
+    static const bool compressionWorks = VerifyVertexCompression();
+    if ( !compressionWorks )
+        return;
+
+    ResidencyManager::ScopedBufferCategory bufferCategory( ResidencyManager::C_VOBS );
+    // Morph-meshes get their full vertices re-uploaded every frame
+    if ( meshInfo->MorphMeshVisual || meshInfo->VertexDecodeBuffer )
+        return;
+
+#if ENABLE_TESSELATION > 0
+    // PNAEN-tesselation works on the full vertex format
+    if ( meshInfo->TesselationInfo.buffer.VT_TesselationFactor > 0.0f )
+        return;
+#endif
+
+    // Get the ranges to quantize into
+    XMFLOAT3 posMin = XMFLOAT3( FLT_MAX, FLT_MAX, FLT_MAX );
+    XMFLOAT3 posMax = XMFLOAT3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+    XMFLOAT2 uvMin = XMFLOAT2( FLT_MAX, FLT_MAX );
+    XMFLOAT2 uvMax = XMFLOAT2( -FLT_MAX, -FLT_MAX );
+    for ( auto const& [material, meshes] : meshInfo->Meshes ) {
+        for ( MeshInfo* mi : meshes ) {
+            for ( const ExVertexStruct& v : mi->Vertices ) {
+                posMin.x = std::min( posMin.x, v.Position.x );
+                posMin.y = std::min( posMin.y, v.Position.y );
+                posMin.z = std::min( posMin.z, v.Position.z );
+                posMax.x = std::max( posMax.x, v.Position.x );
+                posMax.y = std::max( posMax.y, v.Position.y );
+                posMax.z = std::max( posMax.z, v.Position.z );
+
+                uvMin.x = std::min( uvMin.x, v.TexCoord.x );
+                uvMin.y = std::min( uvMin.y, v.TexCoord.y );
+                uvMax.x = std::max( uvMax.x, v.TexCoord.x );
+                uvMax.y = std::max( uvMax.y, v.TexCoord.y );
+            }
+        }
+    }
+
+    if ( posMin.x > posMax.x )
+        return; // No vertices at all
+
+    VS_ExConstantBuffer_VertexDecode decode;
+    decode.VD_PositionScale = float4( std::max( posMax.x - posMin.x, FLT_EPSILON ), std::max( posMax.y - posMin.y, FLT_EPSILON ), std::max( posMax.z - posMin.z, FLT_EPSILON ), 0.0f );
+    decode.VD_PositionOffset = float4( posMin.x, posMin.y, posMin.z, 0.0f );
+    decode.VD_TexCoordScaleOffset = float4( std::max( uvMax.x - uvMin.x, FLT_EPSILON ), std::max( uvMax.y - uvMin.y, FLT_EPSILON ), uvMin.x, uvMin.y );
+
+    // Heavily tiled textures would lose too much precision in 16 bit. Keep those uncompressed.
+    const float maxTexCoordRange = 64.0f;
+    if ( decode.VD_TexCoordScaleOffset.x > maxTexCoordRange || decode.VD_TexCoordScaleOffset.y > maxTexCoordRange )
+        return;
+
+    // Quantize all submeshes and check every vertex survives the round trip before touching any buffer
+    VertexRoundTripError error;
+    std::vector<std::vector<ExVertexStructCompressed>> compressed;
+    for ( auto const& [material, meshes] : meshInfo->Meshes ) {
+        for ( MeshInfo* mi : meshes ) {
+            compressed.emplace_back();
+            compressed.back().reserve( mi->Vertices.size() );
+            for ( const ExVertexStruct& v : mi->Vertices ) {
+                if ( !CheckVertexRoundTrip( v, decode, error ) ) {
+                    LogWarnCh( LC_WORLD ) << "Vertices of " << meshInfo->VisualName << " don't survive compression, keeping them uncompressed";
+                    return;
+                }
+                compressed.back().push_back( EncodeCompressedVertex( v, decode ) );
+            }
+        }
+    }
+
+    // Swap the buffers. The full vertices stay in mi->Vertices for picking and the editor.
+    size_t meshIndex = 0;
+    for ( auto const& [material, meshes] : meshInfo->Meshes ) {
+        for ( MeshInfo* mi : meshes ) {
+            std::vector<ExVertexStructCompressed>& vertices = compressed[meshIndex++];
+            if ( vertices.empty() )
+                continue;
+
+            delete mi->MeshVertexBuffer;
+            Engine::GraphicsEngine->CreateVertexBuffer( &mi->MeshVertexBuffer );
+            mi->MeshVertexBuffer->Init( &vertices[0], vertices.size() * sizeof( ExVertexStructCompressed ), D3D11VertexBuffer::B_VERTEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
+
+            Engine::GAPI->GetRendererState().RendererInfo.VOBVerticesDataSize -= mi->Vertices.size() * (sizeof( ExVertexStruct ) - sizeof( ExVertexStructCompressed ));
+        }
+    }
+
+    meshInfo->VertexDecodeBuffer = new D3D11ConstantBuffer( sizeof( VS_ExConstantBuffer_VertexDecode ), &decode );
+
+    if ( Engine::GAPI->GetRendererState().RendererSettings.EnableDebugLog ) {
+        LogInfoCh( LC_WORLD ) << "Compressed vertices of " << meshInfo->VisualName
+            << ": max position error " << error.Position
+            << ", max normal error " << XMConvertToDegrees( static_cast<float>(acos( std::min( error.MinNormalDot, 1.0 ) )) ) << " deg"
+            << ", max texcoord error " << error.TexCoord;
+    }
+}
+
+/** Spreads the lower 10 bits of v so there are two zero-bits between each of them */
+static unsigned int SpreadMortonBits( unsigned int v ) {
+    v &= 0x3FF;
+    v = (v | (v << 16)) & 0x030000FF;
+    v = (v | (v << 8)) & 0x0300F00F;
+    v = (v | (v << 4)) & 0x030C30C3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+/** Bump when the clustering changes, so older cluster caches get rebuilt */
+const uint32_t CLUSTER_CACHE_VERSION = 1;
+
+/** Result of clustering one world mesh, reused as long as its vertices and indices stay the same */
+struct CachedWorldMeshClusters {
+    uint32_t NumVertices;
+    std::vector<VERTEX_INDEX> Indices;
+    std::vector<WorldMeshCluster> Clusters;
+
+    /** Taken or built during this conversion, everything else is left out of the next save */
+    bool Used = false;
+};
+
+/** Only filled while a world is converted */
+static std::unordered_map<uint64_t, CachedWorldMeshClusters> ClusterCache;
+static bool ClusterCacheDirty = false;
+
+/** FNV-1a over the vertices and indices of the mesh, as they are before clustering */
+static uint64_t HashWorldMesh( const WorldMeshInfo* mesh ) {
+    uint64_t hash = 14695981039346656037ull;
+    auto hashBytes = [&hash]( const void* data, size_t size ) {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+        for ( size_t i = 0; i < size; i++ ) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+
+    if ( !mesh->Vertices.empty() )
+        hashBytes( &mesh->Vertices[0], mesh->Vertices.size() * sizeof( ExVertexStruct ) );
+    if ( !mesh->Indices.empty() )
+        hashBytes( &mesh->Indices[0], mesh->Indices.size() * sizeof( VERTEX_INDEX ) );
+    return hash;
+}
+
+/** Applies the cached clusters of this mesh, if there are any which fit it */
+static bool TakeCachedWorldMeshClusters( WorldMeshInfo* mesh ) {
+    if ( ClusterCache.empty() )
+        return false;
+
+    auto it = ClusterCache.find( HashWorldMesh( mesh ) );
+    if ( it == ClusterCache.end() )
+        return false;
+
+    // A hash collision or a broken file must not end up as out of range draws
+    const CachedWorldMeshClusters& cached = it->second;
+    if ( cached.NumVertices != mesh->Vertices.size() || cached.Indices.size() != mesh->Indices.size() )
+        return false;
+
+    for ( VERTEX_INDEX idx : cached.Indices ) {
+        if ( idx >= mesh->Vertices.size() )
+            return false;
+    }
+
+    unsigned int nextOffset = 0;
+    for ( const WorldMeshCluster& cluster : cached.Clusters ) {
+        if ( cluster.IndexOffset != nextOffset || cluster.NumIndices == 0 || cluster.NumIndices % 3 != 0 )
+            return false;
+        nextOffset += cluster.NumIndices;
+    }
+    if ( nextOffset != cached.Indices.size() )
+        return false;
+
+    mesh->Indices = cached.Indices;
+    mesh->Clusters = cached.Clusters;
+    it->second.Used = true;
+    return true;
+}
+
+/** Splits a world mesh into small clusters of triangles and reorders its indices to match.
+    Takes the result from the cluster cache if the same mesh was clustered before. */
+void WorldConverter::BuildWorldMeshClusters( WorldMeshInfo* mesh ) {
+    if ( TakeCachedWorldMeshClusters( mesh ) )
+        return;
+
+    const unsigned int MIN_CLUSTER_TRIANGLES = 64;
+    const unsigned int MAX_CLUSTER_TRIANGLES = 128;
+    const float CLUSTER_NORMAL_SPLIT_DOT = 0.7f;
+
+    mesh->Clusters.clear();
+
+    unsigned int numTriangles = mesh->Indices.size() / 3;
+    if ( numTriangles == 0 )
+        return;
+
+    // Get centroids and facenormals of all triangles
+    std::vector<XMFLOAT3> centroids( numTriangles );
+    std::vector<XMFLOAT3> normals( numTriangles );
+    XMVECTOR bbmin = XMVectorReplicate( FLT_MAX );
+    XMVECTOR bbmax = XMVectorReplicate( -FLT_MAX );
+    for ( unsigned int t = 0; t < numTriangles; t++ ) {
+        XMVECTOR v0 = XMLoadFloat3( mesh->Vertices[mesh->Indices[t * 3 + 0]].Position.toXMFLOAT3() );
+        XMVECTOR v1 = XMLoadFloat3( mesh->Vertices[mesh->Indices[t * 3 + 1]].Position.toXMFLOAT3() );
+        XMVECTOR v2 = XMLoadFloat3( mesh->Vertices[mesh->Indices[t * 3 + 2]].Position.toXMFLOAT3() );
+
+        XMVECTOR c = (v0 + v1 + v2) / 3.0f;
+        XMStoreFloat3( &centroids[t], c );
+        bbmin = XMVectorMin( bbmin, c );
+        bbmax = XMVectorMax( bbmax, c );
+
+        // Degenerated triangles get a zero normal and are ignored by the cone
+        XMVECTOR n = XMVector3Cross( v1 - v0, v2 - v0 );
+        float len = XMVectorGetX( XMVector3Length( n ) );
+        XMStoreFloat3( &normals[t], len > 0.0f ? n / len : XMVectorZero() );
+    }
+
+    // Sort the triangles along a morton-curve, so neighbouring triangles end up next to each other
+    XMVECTOR extent = XMVectorMax( bbmax - bbmin, XMVectorReplicate( 0.0001f ) );
+    std::vector<std::pair<unsigned int, unsigned int>> order( numTriangles );
+    for ( unsigned int t = 0; t < numTriangles; t++ ) {
+        XMFLOAT3 q;
+        XMStoreFloat3( &q, (XMLoadFloat3( &centroids[t] ) - bbmin) / extent * 1023.0f );
+        order[t].first = SpreadMortonBits( static_cast<unsigned int>(q.x) )
+            | (SpreadMortonBits( static_cast<unsigned int>(q.y) ) << 1)
+            | (SpreadMortonBits( static_cast<unsigned int>(q.z) ) << 2);
+        order[t].second = t;
+    }
+    std::sort( order.begin(), order.end() );
+
+    // Greedily cut the curve into clusters. Split early on sharp changes of the surface so the normal cones stay tight.
+    std::vector<std::vector<unsigned int>> clusterTriangles;
+    XMVECTOR clusterNormal = XMVectorZero();
+    for ( unsigned int i = 0; i < numTriangles; i++ ) {
+        unsigned int t = order[i].second;
+        XMVECTOR n = XMLoadFloat3( &normals[t] );
+
+        bool split = clusterTriangles.empty() || clusterTriangles.back().size() >= MAX_CLUSTER_TRIANGLES;
+        if ( !split && clusterTriangles.back().size() >= MIN_CLUSTER_TRIANGLES ) {
+            split = XMVectorGetX( XMVector3Dot( XMVector3Normalize( clusterNormal ), n ) ) < CLUSTER_NORMAL_SPLIT_DOT;
+        }
+
+        if ( split ) {
+            clusterTriangles.emplace_back();
+            clusterTriangles.back().reserve( MAX_CLUSTER_TRIANGLES );
+            clusterNormal = XMVectorZero();
+        }
+
+        clusterTriangles.back().push_back( t );
+        clusterNormal += n;
+    }
+
+    // Write the clusters back into the indexbuffer. Keep the original order inside of a cluster,
+    // since that was already optimized for the vertex cache.
+    std::vector<VERTEX_INDEX> indices;
+    indices.reserve( mesh->Indices.size() );
+    mesh->Clusters.reserve( clusterTriangles.size() );
+    for ( auto& tris : clusterTriangles ) {
+        std::sort( tris.begin(), tris.end() );
+
+        WorldMeshCluster cluster;
+        cluster.IndexOffset = indices.size();
+        cluster.NumIndices = tris.size() * 3;
+
+        XMVECTOR cmin = XMVectorReplicate( FLT_MAX );
+        XMVECTOR cmax = XMVectorReplicate( -FLT_MAX );
+        XMVECTOR axis = XMVectorZero();
+        for ( unsigned int t : tris ) {
+            for ( unsigned int v = 0; v < 3; v++ ) {
+                VERTEX_INDEX idx = mesh->Indices[t * 3 + v];
+                XMVECTOR p = XMLoadFloat3( mesh->Vertices[idx].Position.toXMFLOAT3() );
+                cmin = XMVectorMin( cmin, p );
+                cmax = XMVectorMax( cmax, p );
+                indices.push_back( idx );
+            }
+            axis += XMLoadFloat3( &normals[t] );
+        }
+
+        // Bounding sphere around the center of the box
+        XMVECTOR center = 0.5f * (cmin + cmax);
+        float radius = 0.0f;
+        for ( unsigned int i = cluster.IndexOffset; i < cluster.IndexOffset + cluster.NumIndices; i++ ) {
+            XMVECTOR p = XMLoadFloat3( mesh->Vertices[indices[i]].Position.toXMFLOAT3() );
+            radius = std::max( radius, XMVectorGetX( XMVector3Length( p - center ) ) );
+        }
+        XMStoreFloat3( &cluster.Center, center );
+        cluster.Radius = radius;
+
+        // Normal cone. A cutoff of 1 never culls, which is what we want for clusters facing all over the place.
+        cluster.ConeCutoff = 1.0f;
+        cluster.ConeAxis = XMFLOAT3( 0.0f, 0.0f, 0.0f );
+        float axisLength = XMVectorGetX( XMVector3Length( axis ) );
+        if ( axisLength > 0.0f ) {
+            axis /= axisLength;
+
+            float minDot = 1.0f;
+            for ( unsigned int t : tris ) {
+                XMVECTOR n = XMLoadFloat3( &normals[t] );
+                if ( XMVector3Equal( n, XMVectorZero() ) )
+                    continue;
+
+                minDot = std::min( minDot, XMVectorGetX( XMVector3Dot( axis, n ) ) );
+            }
+
+            if ( minDot > 0.1f ) {
+                XMStoreFloat3( &cluster.ConeAxis, axis );
+                cluster.ConeCutoff = sqrtf( 1.0f - minDot * minDot );
+            }
+        }
+
+        mesh->Clusters.push_back( cluster );
+    }
+
+    // Keyed by the indices before reordering, that's what the next load will look up
+    CachedWorldMeshClusters& cached = ClusterCache[HashWorldMesh( mesh )];
+    cached.NumVertices = mesh->Vertices.size();
+    cached.Indices = indices;
+    cached.Clusters = mesh->Clusters;
+    cached.Used = true;
+    ClusterCacheDirty = true;
+
+    mesh->Indices = indices;
+}
+
+/** Returns the file the clusters of the given world are cached in */
+std::string WorldConverter::GetWorldMeshClusterCacheFile( const std::string& worldName ) {
+    return "system\\GD3D11\\meshes\\WLD_" + worldName + ".clusters";
+}
+
+/** Reads the clusters of an earlier load of the world, used by BuildWorldMeshClusters */
+void WorldConverter::LoadWorldMeshClusterCache( const std::string& file ) {
+    ClusterCache.clear();
+    ClusterCacheDirty = false;
+
+    FILE* f = fopen( file.c_str(), "rb" );
+    if ( !f )
+        return;
+
+    uint32_t version = 0;
+    uint32_t numMeshes = 0;
+    bool ok = fread( &version, sizeof( version ), 1, f ) == 1 && version == CLUSTER_CACHE_VERSION
+        && fread( &numMeshes, sizeof( numMeshes ), 1, f ) == 1;
+
+    for ( uint32_t m = 0; ok && m < numMeshes; m++ ) {
+        uint64_t hash;
+        uint32_t numVertices, numIndices, numClusters;
+        ok = fread( &hash, sizeof( hash ), 1, f ) == 1
+            && fread( &numVertices, sizeof( numVertices ), 1, f ) == 1
+            && fread( &numIndices, sizeof( numIndices ), 1, f ) == 1
+            && fread( &numClusters, sizeof( numClusters ), 1, f ) == 1
+            && numIndices % 3 == 0 && numClusters <= numIndices / 3;
+        if ( !ok )
+            break;
+
+        CachedWorldMeshClusters& cached = ClusterCache[hash];
+        cached.NumVertices = numVertices;
+        cached.Indices.resize( numIndices );
+        cached.Clusters.resize( numClusters );
+        ok = (numIndices == 0 || fread( &cached.Indices[0], sizeof( VERTEX_INDEX ) * numIndices, 1, f ) == 1)
+            && (numClusters == 0 || fread( &cached.Clusters[0], sizeof( WorldMeshCluster ) * numClusters, 1, f ) == 1);
+    }
+    fclose( f );
+
+    if ( !ok ) {
+        LogWarnCh( LC_WORLD ) << "Ignoring outdated or broken world mesh cluster cache " << file;
+        ClusterCache.clear();
+        return;
+    }
+
+    LogInfoCh( LC_WORLD ) << "Loaded world mesh clusters of " << ClusterCache.size() << " meshes from " << file;
+}
+
+/** Writes the cache back if clusters were built, then frees it */
+void WorldConverter::SaveWorldMeshClusterCache( const std::string& file ) {
+    // Drop what belongs to meshes which changed since the cache was written
+    for ( auto it = ClusterCache.begin(); it != ClusterCache.end(); ) {
+        if ( !it->second.Used ) {
+            it = ClusterCache.erase( it );
+            ClusterCacheDirty = true;
+        } else {
+            ++it;
+        }
+    }
+
+    if ( ClusterCacheDirty ) {
+        std::string folder = file.substr( 0, file.find_last_of( '\\' ) + 1 );
+        if ( !Toolbox::FolderExists( folder ) ) {
+            Toolbox::CreateDirectoryRecursive( folder );
+        }
+
+        FILE* f = fopen( file.c_str(), "wb" );
+        if ( f ) {
+            uint32_t version = CLUSTER_CACHE_VERSION;
+            uint32_t numMeshes = ClusterCache.size();
+            fwrite( &version, sizeof( version ), 1, f );
+            fwrite( &numMeshes, sizeof( numMeshes ), 1, f );
+
+            for ( auto const& [hash, cached] : ClusterCache ) {
+                uint32_t numIndices = cached.Indices.size();
+                uint32_t numClusters = cached.Clusters.size();
+                fwrite( &hash, sizeof( hash ), 1, f );
+                fwrite( &cached.NumVertices, sizeof( cached.NumVertices ), 1, f );
+                fwrite( &numIndices, sizeof( numIndices ), 1, f );
+                fwrite( &numClusters, sizeof( numClusters ), 1, f );
+                if ( numIndices )
+                    fwrite( &cached.Indices[0], sizeof( VERTEX_INDEX ) * numIndices, 1, f );
+                if ( numClusters )
+                    fwrite( &cached.Clusters[0], sizeof( WorldMeshCluster ) * numClusters, 1, f );
+            }
+            fclose( f );
+        } else {
+            LogWarnCh( LC_WORLD ) << "Could not write world mesh cluster cache " << file;
+        }
+    }
+
+    ClusterCache.clear();
+    ClusterCacheDirty = false;
+}
+
 const float eps = 0.001f;
 
 struct CmpClass // class comparing vertices in the set
@@ -1652,6 +2368,7 @@ void WorldConverter::UpdateQuadMarkInfo( QuadMarkInfo* info, zCQuadMark* mark, c
 #if ENABLE_TESSELATION > 0
 /** Turns a MeshInfo into PNAEN */
 void WorldConverter::CreatePNAENInfoFor( MeshInfo* mesh, bool softNormals ) {
+    ResidencyManager::ScopedBufferCategory bufferCategory( ResidencyManager::C_VOBS );
     delete mesh->MeshIndexBufferPNAEN;
     Engine::GraphicsEngine->CreateVertexBuffer( &mesh->MeshIndexBufferPNAEN );
 
@@ -1666,6 +2383,7 @@ void WorldConverter::CreatePNAENInfoFor( MeshInfo* mesh, bool softNormals ) {
 }
 
 void WorldConverter::CreatePNAENInfoFor( WorldMeshInfo* mesh, bool softNormals ) {
+    ResidencyManager::ScopedBufferCategory bufferCategory( ResidencyManager::C_WORLD_GEOMETRY );
     delete mesh->MeshIndexBufferPNAEN;
     Engine::GraphicsEngine->CreateVertexBuffer( &mesh->MeshIndexBufferPNAEN );
 
@@ -1681,6 +2399,7 @@ void WorldConverter::CreatePNAENInfoFor( WorldMeshInfo* mesh, bool softNormals )
 
 /** Turns a MeshInfo into PNAEN */
 void WorldConverter::CreatePNAENInfoFor( SkeletalMeshInfo* mesh, MeshInfo* bindPoseMesh, bool softNormals ) {
+    ResidencyManager::ScopedBufferCategory bufferCategory( ResidencyManager::C_VOBS );
     delete mesh->MeshIndexBufferPNAEN;
     Engine::GraphicsEngine->CreateVertexBuffer( &mesh->MeshIndexBufferPNAEN );
 
@@ -1754,6 +2473,7 @@ void WorldConverter::ConvertExVerticesTozCPolygons( const std::vector<ExVertexSt
 #if ENABLE_TESSELATION > 0
 /** Tesselates the given mesh the given amount of times */
 void WorldConverter::TesselateMesh( WorldMeshInfo* mesh, int amount ) {
+    ResidencyManager::ScopedBufferCategory bufferCategory( ResidencyManager::C_WORLD_GEOMETRY );
     // Copy old vertices so we can directly write to the vectors again
     std::vector<ExVertexStruct> vxOld = mesh->Vertices;
     std::vector<unsigned short> ixOld = mesh->Indices;
@@ -1805,6 +2525,9 @@ void WorldConverter::TesselateMesh( WorldMeshInfo* mesh, int amount ) {
     mesh->MeshIndexBufferPNAEN->Init( &mesh->IndicesPNAEN[0], mesh->IndicesPNAEN.size() * sizeof( VERTEX_INDEX ), D3D11VertexBuffer::B_INDEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
     mesh->MeshIndexBuffer->Init( &mesh->Indices[0], mesh->Indices.size() * sizeof( VERTEX_INDEX ), D3D11VertexBuffer::B_INDEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
 
+    // Tesselated indices don't match the clusters anymore
+    mesh->Clusters.clear();
+
     mesh->TesselationSettings.buffer.VT_TesselationFactor = 1.0f;
     mesh->TesselationSettings.buffer.VT_DisplacementStrength = 0.5f;
     mesh->TesselationSettings.UpdateConstantbuffer();
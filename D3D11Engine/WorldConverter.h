@@ -54,12 +54,31 @@ public:
     /** Extracts a 3DS-Mesh from a zCVisual */
     static void Extract3DSMeshFromVisual2( zCProgMeshProto* visual, MeshVisualInfo* meshInfo );
 
+    /** Replaces the vertexbuffers of a static mesh visual with quantized ExVertexStructCompressed-buffers */
+    static void CompressStaticMeshVisual( MeshVisualInfo* meshInfo );
+
+    /** Splits a world mesh into small clusters of triangles and reorders its indices to match.
+        Takes the result from the cluster cache if the same mesh was clustered before. */
+    static void BuildWorldMeshClusters( WorldMeshInfo* mesh );
+
+    /** Returns the file the clusters of the given world are cached in */
+    static std::string GetWorldMeshClusterCacheFile( const std::string& worldName );
+
+    /** Reads the clusters of an earlier load of the world, used by BuildWorldMeshClusters */
+    static void LoadWorldMeshClusterCache( const std::string& file );
+
+    /** Writes the cache back if clusters were built, then frees it */
+    static void SaveWorldMeshClusterCache( const std::string& file );
+
     /** Updates a Morph-Mesh visual */
     static void UpdateMorphMeshVisual( void* visual, MeshVisualInfo* meshInfo );
 
     /** Extracts a skeletal mesh from a zCModel */
     static void ExtractSkeletalMeshFromVob( zCModel* model, SkeletalMeshVisualInfo* skeletalMeshInfo );
 
+    /** Creates the reduced detail levels of a skeletal mesh by clustering its bind-pose vertices */
+    static void CreateSkeletalMeshLODs( SkeletalMeshInfo* mesh, const std::vector<ExVertexStruct>& bindPoseVertices );
+
     /** Extracts a zCProgMeshProto from a zCModel */
     static void ExtractProgMeshProtoFromModel( zCModel* model, MeshVisualInfo* meshInfo );
 
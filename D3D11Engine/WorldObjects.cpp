@@ -69,16 +69,16 @@ void VobInfo::UpdateVobConstantBuffer() {
 
     VobConstantBuffer->UpdateBuffer( &cb );
 
-    XMStoreFloat3( &LastRenderPosition, Vob->GetPositionWorldXM() );
-    WorldMatrix = cb.World;
+    XMStoreFloat3( &GetLastRenderPosition(), Vob->GetPositionWorldXM() );
+    GetWorldMatrix() = cb.World;
 
     // Colorize the vob according to the underlaying polygon
-    if ( IsIndoorVob ) {
+    if ( IsIndoorVob() ) {
         // All lightmapped polys have this color, so just use it
-        GroundColor = DEFAULT_LIGHTMAP_POLY_COLOR;
+        GetGroundColor() = DEFAULT_LIGHTMAP_POLY_COLOR;
     } else {
         // Get the color of the first found feature of the ground poly
-        GroundColor = Vob->GetGroundPoly() ? Vob->GetGroundPoly()->getFeatures()[0]->lightStatic : 0xFFFFFFFF;
+        GetGroundColor() = Vob->GetGroundPoly() ? Vob->GetGroundPoly()->getFeatures()[0]->lightStatic : 0xFFFFFFFF;
     }
 
     //&WorldMatrix = XMMatrixTranspose(XMLoadFloat4x4(&cb.World));
@@ -221,10 +221,28 @@ MeshInfo::~MeshInfo() {
 #endif
 }
 
+/** Returns the indexbuffer for the given detail level */
+D3D11VertexBuffer* SkeletalMeshInfo::GetIndexBufferForLOD( int lod, unsigned int& numIndices ) {
+    for ( int i = std::min( lod, NUM_SKELETAL_MESH_LODS - 1 ); i > 0; i-- ) {
+        if ( MeshIndexBufferLOD[i - 1] ) {
+            numIndices = IndicesLOD[i - 1].size();
+            return MeshIndexBufferLOD[i - 1];
+        }
+    }
+
+    numIndices = Indices.size();
+    return MeshIndexBuffer;
+}
+
 SkeletalMeshInfo::~SkeletalMeshInfo() {
     Engine::GAPI->GetRendererState().RendererInfo.SkeletalVerticesDataSize -= Indices.size() * sizeof( VERTEX_INDEX );
     Engine::GAPI->GetRendererState().RendererInfo.SkeletalVerticesDataSize -= Vertices.size() * sizeof( ExSkelVertexStruct );
 
+    for ( int i = 0; i < NUM_SKELETAL_MESH_LODS - 1; i++ ) {
+        Engine::GAPI->GetRendererState().RendererInfo.SkeletalVerticesDataSize -= IndicesLOD[i].size() * sizeof( VERTEX_INDEX );
+        delete MeshIndexBufferLOD[i];
+    }
+
     delete MeshVertexBuffer;
     delete MeshIndexBuffer;
 #if ENABLE_TESSELATION > 0
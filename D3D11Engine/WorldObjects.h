@@ -11,6 +11,7 @@
 #include "zCPolygon.h"
 #include "BaseShadowedPointLight.h"
 #include "D3D11VertexBuffer.h"
+#include "VobPool.h"
 
 class zCMaterial;
 class zCPolygon;
@@ -130,6 +131,22 @@ struct MeshInfo {
     unsigned int MeshIndex;
 };
 
+/** A small group of triangles of a world mesh, which can be culled on its own */
+struct WorldMeshCluster {
+    /** Bounding sphere */
+    XMFLOAT3 Center;
+    float Radius;
+
+    /** Normal cone. All triangles face away from the camera if
+        dot(Center - cam, ConeAxis) >= ConeCutoff * length(Center - cam) + Radius */
+    XMFLOAT3 ConeAxis;
+    float ConeCutoff;
+
+    /** Range of the cluster inside the Indices of its mesh */
+    unsigned int IndexOffset;
+    unsigned int NumIndices;
+};
+
 struct WorldMeshInfo : public MeshInfo {
     WorldMeshInfo() {
         SaveInfo = false;
@@ -147,6 +164,12 @@ struct WorldMeshInfo : public MeshInfo {
 
     /** If true we will save an info-file on next zen-resource-save */
     bool SaveInfo;
+
+    /** Clusters of this mesh, sorted by IndexOffset. Empty if the mesh wasn't clustered. */
+    std::vector<WorldMeshCluster> Clusters;
+
+    /** (IndexOffset, NumIndices) of the runs of clusters that survived culling this frame */
+    std::vector<std::pair<unsigned int, unsigned int>> VisibleClusterRanges;
 };
 
 struct QuadMarkInfo {
@@ -166,6 +189,9 @@ struct QuadMarkInfo {
     float3 Position;
 };
 
+/** Number of detail levels of skeletal meshes, including the full one */
+const int NUM_SKELETAL_MESH_LODS = 3;
+
 /** Holds information about a skeletal mesh */
 class zCMeshSoftSkin;
 struct SkeletalMeshInfo {
@@ -173,6 +199,9 @@ struct SkeletalMeshInfo {
         MeshVertexBuffer = nullptr;
         MeshIndexBuffer = nullptr;
         visual = nullptr;
+        for ( D3D11VertexBuffer*& ib : MeshIndexBufferLOD ) {
+            ib = nullptr;
+        }
 #if ENABLE_TESSELATION > 0
         MeshIndexBufferPNAEN = nullptr;
 #endif
@@ -185,6 +214,14 @@ struct SkeletalMeshInfo {
     std::vector<ExSkelVertexStruct> Vertices;
     std::vector<VERTEX_INDEX> Indices;
 
+    /** Returns the indexbuffer for the given detail level. Falls back to
+        the next finer level if a level wasn't worth generating. */
+    D3D11VertexBuffer* GetIndexBufferForLOD( int lod, unsigned int& numIndices );
+
+    /** Reduced indexbuffers into the same vertices, for LOD 1 and up */
+    D3D11VertexBuffer* MeshIndexBufferLOD[NUM_SKELETAL_MESH_LODS - 1];
+    std::vector<VERTEX_INDEX> IndicesLOD[NUM_SKELETAL_MESH_LODS - 1];
+
 #if ENABLE_TESSELATION > 0
     D3D11VertexBuffer* MeshIndexBufferPNAEN;
     std::vector<VERTEX_INDEX> IndicesPNAEN;
@@ -255,6 +292,7 @@ struct MeshVisualInfo : public BaseVisualInfo {
         UnloadedSomething = false;
         StartInstanceNum = 0;
         FullMesh = nullptr;
+        VertexDecodeBuffer = nullptr;
     }
 
     ~MeshVisualInfo() {
@@ -262,6 +300,7 @@ struct MeshVisualInfo : public BaseVisualInfo {
             zCObject_Release( MorphMeshVisual );
         }
         delete FullMesh;
+        delete VertexDecodeBuffer;
     }
 
     /** Starts a new frame for this mesh */
@@ -289,6 +328,9 @@ struct MeshVisualInfo : public BaseVisualInfo {
     /** This is true if we can't actually render something on this. TODO: Try to fix this! */
     bool UnloadedSomething;
     void* MorphMeshVisual;
+
+    /** Dequantization parameters if the vertexbuffers of this visual hold ExVertexStructCompressed, nullptr otherwise */
+    D3D11ConstantBuffer* VertexDecodeBuffer;
 };
 
 /** Holds the converted mesh of a VOB */
@@ -346,42 +388,50 @@ struct VobInfo : public BaseVobInfo {
     VobInfo() {
         //Vob = nullptr;
         VobConstantBuffer = nullptr;
-        IsIndoorVob = false;
-        VisibleInRenderPass = false;
         VobSection = nullptr;
+        Handle = VobPool::Allocate( this );
     }
 
     ~VobInfo() {
         //delete VisualInfo;
         delete VobConstantBuffer;
+        VobPool::Free( Handle );
     }
 
+    VobInfo( const VobInfo& ) = delete;
+    VobInfo& operator=( const VobInfo& ) = delete;
+
     /** Updates the vobs constantbuffer */
     void UpdateVobConstantBuffer();
 
-    /** Constantbuffer which holds this vobs world matrix */
-    D3D11ConstantBuffer* VobConstantBuffer;
-
     /** Position the vob was at while being rendered last time */
-    XMFLOAT3 LastRenderPosition;
+    XMFLOAT3& GetLastRenderPosition() { return VobPool::GetLastRenderPosition( Handle ); }
 
     /** True if this is an indoor-vob */
-    bool IsIndoorVob;
+    bool IsIndoorVob() const { return VobPool::HasFlag( Handle, VobPool::F_INDOOR ); }
+    void SetIndoorVob( bool indoor ) { VobPool::SetFlag( Handle, VobPool::F_INDOOR, indoor ); }
 
     /** Flag to see if this vob was drawn in the current render pass. Used to collect the same vob only once. */
-    bool VisibleInRenderPass;
+    bool IsVisibleInRenderPass() const { return VobPool::HasFlag( Handle, VobPool::F_VISIBLE_IN_RENDER_PASS ); }
+    void SetVisibleInRenderPass( bool visible ) { VobPool::SetFlag( Handle, VobPool::F_VISIBLE_IN_RENDER_PASS, visible ); }
+
+    /** Current world transform */
+    XMFLOAT4X4& GetWorldMatrix() { return VobPool::GetWorldMatrix( Handle ); }
+
+    /** Color the underlaying polygon has */
+    DWORD& GetGroundColor() { return VobPool::GetGroundColor( Handle ); }
+
+    /** Slot of the per-frame fields inside the vob pool */
+    VobHandle Handle;
+
+    /** Constantbuffer which holds this vobs world matrix */
+    D3D11ConstantBuffer* VobConstantBuffer;
 
     /** Section this vob is in */
     WorldMeshSectionInfo* VobSection;
 
-    /** Current world transform */
-    XMFLOAT4X4 WorldMatrix;
-
     /** BSP-Node this is stored in */
     std::vector<BspInfo*> ParentBSPNodes;
-
-    /** Color the underlaying polygon has */
-    DWORD GroundColor;
 };
 
 class zCVobLight;
@@ -432,6 +482,8 @@ struct SkeletalVobInfo : public BaseVobInfo {
         IndoorVob = false;
         VisibleInRenderPass = false;
         VobConstantBuffer = nullptr;
+        LODLevel = 0;
+        BoneTransformsFrame = 0;
     }
 
     ~SkeletalVobInfo() {
@@ -466,6 +518,13 @@ struct SkeletalVobInfo : public BaseVobInfo {
 
     /** BSP-Node this is stored in */
     std::vector<BspInfo*> ParentBSPNodes;
+
+    /** Detail level picked by the main view. Other passes reuse it. */
+    int LODLevel;
+
+    /** Bone transforms of the last pose update and the frame they were taken in */
+    std::vector<XMFLOAT4X4> CachedBoneTransforms;
+    unsigned int BoneTransformsFrame;
 };
 
 struct SectionInstanceCache {
@@ -486,10 +545,18 @@ class D3D11Texture;
 
 /** Describes a world-section for the renderer */
 struct WorldMeshSectionInfo {
+    /** Whether the buffers of this section are in video memory, see WorldStreamer */
+    enum EStreamingState {
+        SS_RESIDENT,
+        SS_EVICTED,
+        SS_UPLOADING
+    };
+
     WorldMeshSectionInfo() {
         BoundingBox.Min = XMFLOAT3( FLT_MAX, FLT_MAX, FLT_MAX );
         BoundingBox.Max = XMFLOAT3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
         FullStaticMesh = nullptr;
+        StreamingState = SS_RESIDENT;
     }
 
     ~WorldMeshSectionInfo() {
@@ -552,6 +619,9 @@ struct WorldMeshSectionInfo {
 
     unsigned int BaseIndexLocation;
     unsigned int NumIndices;
+
+    /** Only resident sections may be drawn. Their meshes have buffers and are part of the wrapped world mesh. */
+    EStreamingState StreamingState;
 };
 
 class zCBspTree;
@@ -0,0 +1,299 @@
+#include "pch.h"
+#include "WorldStreamer.h"
+#include "Engine.h"
+#include "GothicAPI.h"
+#include "BaseGraphicsEngine.h"
+#include "D3D11VertexBuffer.h"
+#include "ResidencyManager.h"
+#include "ThreadPool.h"
+#include "WorldConverter.h"
+
+/** Buffers created for one world mesh by an upload job */
+struct UploadedMeshBuffers {
+    WorldMeshInfo* Mesh;
+    D3D11VertexBuffer* VertexBuffer;
+    D3D11VertexBuffer* IndexBuffer;
+#if ENABLE_TESSELATION > 0
+    D3D11VertexBuffer* IndexBufferPNAEN;
+#endif
+};
+
+/** Everything an upload job creates. Handed over to the sections on the main thread once it is done. */
+struct UploadJob {
+    /** Sections drawable once the job is done, in the order they were put into the wrapped mesh */
+    std::vector<WorldMeshSectionInfo*> ResidentSections;
+    std::vector<WorldMeshSectionInfo*> UploadedSections;
+    std::vector<UploadedMeshBuffers> Buffers;
+
+    MeshInfo* WrappedMesh;
+
+    /** Start index of each mesh of the resident sections inside the wrapped mesh */
+    std::vector<unsigned int> Offsets;
+};
+
+static std::unique_ptr<UploadJob> PendingUpload;
+static std::future<void> PendingUploadDone;
+
+/** Set when sections were evicted, but the wrapped mesh still holds their geometry */
+static bool WrappedMeshOutdated = false;
+
+/** Set once every section is resident while streaming is disabled, so there is nothing left to do */
+static bool AllSectionsResident = false;
+
+/** Statistics since the world was loaded */
+static unsigned int NumResidentSections = 0;
+static unsigned int NumSectionsUploaded = 0;
+static unsigned int NumSectionsEvicted = 0;
+static uint64_t PeakWorldUsage = 0;
+static uint64_t PeakTotalUsage = 0;
+
+/** Creates the buffers of the sections to upload and wraps all resident sections. Runs on a worker thread. */
+static void CreateBuffers( UploadJob& job ) {
+    ResidencyManager::ScopedBufferCategory bufferCategory( ResidencyManager::C_WORLD_GEOMETRY );
+
+    for ( WorldMeshSectionInfo* section : job.UploadedSections ) {
+        for ( auto const& it : section->WorldMeshes ) {
+            WorldMeshInfo* mesh = it.second;
+
+            UploadedMeshBuffers buffers = {};
+            buffers.Mesh = mesh;
+            Engine::GraphicsEngine->CreateVertexBuffer( &buffers.VertexBuffer );
+            Engine::GraphicsEngine->CreateVertexBuffer( &buffers.IndexBuffer );
+            buffers.VertexBuffer->Init( &mesh->Vertices[0], mesh->Vertices.size() * sizeof( ExVertexStruct ), D3D11VertexBuffer::B_VERTEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
+            buffers.IndexBuffer->Init( &mesh->Indices[0], mesh->Indices.size() * sizeof( VERTEX_INDEX ), D3D11VertexBuffer::B_INDEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
+
+#if ENABLE_TESSELATION > 0
+            if ( !mesh->IndicesPNAEN.empty() ) {
+                Engine::GraphicsEngine->CreateVertexBuffer( &buffers.IndexBufferPNAEN );
+                buffers.IndexBufferPNAEN->Init( &mesh->IndicesPNAEN[0], mesh->IndicesPNAEN.size() * sizeof( VERTEX_INDEX ), D3D11VertexBuffer::B_INDEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
+            }
+#endif
+
+            job.Buffers.push_back( buffers );
+        }
+    }
+
+    std::list<std::vector<ExVertexStruct>*> vertexBuffers;
+    std::list<std::vector<VERTEX_INDEX>*> indexBuffers;
+    for ( WorldMeshSectionInfo* section : job.ResidentSections ) {
+        for ( auto const& it : section->WorldMeshes ) {
+            vertexBuffers.emplace_back( &it.second->Vertices );
+            indexBuffers.emplace_back( &it.second->Indices );
+        }
+    }
+
+    // Without any resident section there is nothing to draw from it
+    job.WrappedMesh = new MeshInfo;
+    if ( vertexBuffers.empty() )
+        return;
+
+    std::vector<ExVertexStruct> wrappedVertices;
+    std::vector<unsigned int> wrappedIndices;
+    WorldConverter::WrapVertexBuffers( vertexBuffers, indexBuffers, wrappedVertices, wrappedIndices, job.Offsets );
+
+    Engine::GraphicsEngine->CreateVertexBuffer( &job.WrappedMesh->MeshVertexBuffer );
+    Engine::GraphicsEngine->CreateVertexBuffer( &job.WrappedMesh->MeshIndexBuffer );
+    job.WrappedMesh->MeshVertexBuffer->Init( &wrappedVertices[0], wrappedVertices.size() * sizeof( ExVertexStruct ), D3D11VertexBuffer::B_VERTEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
+    job.WrappedMesh->MeshIndexBuffer->Init( &wrappedIndices[0], wrappedIndices.size() * sizeof( unsigned int ), D3D11VertexBuffer::B_INDEXBUFFER, D3D11VertexBuffer::U_IMMUTABLE );
+}
+
+/** Returns true if the world converter should leave the buffers of the sections to the streamer */
+bool WorldStreamer::IsEnabled() {
+    return Engine::GAPI->GetRendererState().RendererSettings.EnableWorldSectionStreaming;
+}
+
+/** Uploads and evicts sections around the camera. Called once per frame on the main thread. */
+void WorldStreamer::Update() {
+    if ( PendingUploadDone.valid() ) {
+        // Sections don't change while their buffers are created
+        if ( PendingUploadDone.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready ) {
+            UpdateRendererInfo();
+            return;
+        }
+
+        FinishUpload();
+    }
+
+    const GothicRendererSettings& settings = Engine::GAPI->GetRendererState().RendererSettings;
+    if ( Engine::GAPI->GetWorldSections().empty() || (!settings.EnableWorldSectionStreaming && AllSectionsResident) ) {
+        UpdateRendererInfo();
+        return;
+    }
+
+    // Without streaming, every section is in range. Sections that are drawn always need to be resident.
+    int uploadRadius = INT_MAX;
+    int evictRadius = INT_MAX;
+    if ( settings.EnableWorldSectionStreaming ) {
+        uploadRadius = std::max( settings.SectionStreamingRadius, settings.SectionDrawRadius );
+        evictRadius = uploadRadius + std::max( 0, settings.SectionStreamingHysteresis );
+    }
+
+    const INT2 camSection = WorldConverter::GetSectionOfPos( Engine::GAPI->GetCameraPosition() );
+
+    std::vector<WorldMeshSectionInfo*> sectionsToUpload;
+    unsigned int numEvicted = 0;
+    NumResidentSections = 0;
+    for ( auto& itx : Engine::GAPI->GetWorldSections() ) {
+        for ( auto& ity : itx.second ) {
+            WorldMeshSectionInfo& section = ity.second;
+            int distance = std::max( abs( itx.first - camSection.x ), abs( ity.first - camSection.y ) );
+
+            if ( section.StreamingState == WorldMeshSectionInfo::SS_RESIDENT ) {
+                if ( distance > evictRadius ) {
+                    EvictSection( section );
+                    numEvicted++;
+                } else {
+                    NumResidentSections++;
+                }
+            } else {
+                if ( distance <= uploadRadius ) {
+                    sectionsToUpload.push_back( &section );
+                } else {
+                    numEvicted++;
+                }
+            }
+        }
+    }
+
+    AllSectionsResident = !numEvicted && sectionsToUpload.empty();
+
+    if ( !sectionsToUpload.empty() || WrappedMeshOutdated ) {
+        StartUpload( sectionsToUpload );
+
+        // Don't show an empty world after loading or teleporting
+        if ( !NumResidentSections ) {
+            PendingUploadDone.wait();
+            FinishUpload();
+        }
+    }
+
+    UpdateRendererInfo();
+}
+
+/** Releases the video memory of the given section */
+void WorldStreamer::EvictSection( WorldMeshSectionInfo& section ) {
+    for ( auto const& it : section.WorldMeshes ) {
+        SAFE_DELETE( it.second->MeshVertexBuffer );
+        SAFE_DELETE( it.second->MeshIndexBuffer );
+#if ENABLE_TESSELATION > 0
+        SAFE_DELETE( it.second->MeshIndexBufferPNAEN );
+#endif
+    }
+
+    // Its geometry stays in the wrapped mesh until that is rebuilt, but it isn't drawn anymore
+    section.StreamingState = WorldMeshSectionInfo::SS_EVICTED;
+    WrappedMeshOutdated = true;
+    NumSectionsEvicted++;
+}
+
+/** Starts a job creating the buffers of the given sections and the wrapped mesh of all resident ones */
+void WorldStreamer::StartUpload( const std::vector<WorldMeshSectionInfo*>& sectionsToUpload ) {
+    PendingUpload = std::make_unique<UploadJob>();
+    UploadJob* job = PendingUpload.get();
+
+    for ( auto& itx : Engine::GAPI->GetWorldSections() ) {
+        for ( auto& ity : itx.second ) {
+            if ( ity.second.StreamingState == WorldMeshSectionInfo::SS_RESIDENT )
+                job->ResidentSections.push_back( &ity.second );
+        }
+    }
+
+    for ( WorldMeshSectionInfo* section : sectionsToUpload ) {
+        section->StreamingState = WorldMeshSectionInfo::SS_UPLOADING;
+        job->UploadedSections.push_back( section );
+        job->ResidentSections.push_back( section );
+    }
+
+    WrappedMeshOutdated = false;
+    PendingUploadDone = Engine::WorkerThreadPool->enqueue( [job]() {
+        CreateBuffers( *job );
+    } );
+}
+
+/** Hands the results of a finished job over to the sections */
+void WorldStreamer::FinishUpload() {
+    PendingUploadDone.get();
+    UploadJob& job = *PendingUpload;
+
+    for ( const UploadedMeshBuffers& buffers : job.Buffers ) {
+        // Tesselating a mesh creates its buffers on its own
+        delete buffers.Mesh->MeshVertexBuffer;
+        delete buffers.Mesh->MeshIndexBuffer;
+        buffers.Mesh->MeshVertexBuffer = buffers.VertexBuffer;
+        buffers.Mesh->MeshIndexBuffer = buffers.IndexBuffer;
+#if ENABLE_TESSELATION > 0
+        delete buffers.Mesh->MeshIndexBufferPNAEN;
+        buffers.Mesh->MeshIndexBufferPNAEN = buffers.IndexBufferPNAEN;
+#endif
+    }
+
+    // The offsets are in the order the meshes were wrapped
+    unsigned int i = 0;
+    for ( WorldMeshSectionInfo* section : job.ResidentSections ) {
+        section->NumIndices = 0;
+        for ( auto const& it : section->WorldMeshes ) {
+            it.second->BaseIndexLocation = job.Offsets[i++];
+            section->NumIndices += it.second->Indices.size();
+        }
+
+        if ( !section->WorldMeshes.empty() )
+            section->BaseIndexLocation = section->WorldMeshes.begin()->second->BaseIndexLocation;
+
+        section->StreamingState = WorldMeshSectionInfo::SS_RESIDENT;
+    }
+
+    NumResidentSections = job.ResidentSections.size();
+    NumSectionsUploaded += job.UploadedSections.size();
+    Engine::GAPI->SetWrappedWorldMesh( job.WrappedMesh );
+    PendingUpload.reset();
+}
+
+/** Waits for the upload in flight and drops its results. Must be called before the sections are deleted. */
+void WorldStreamer::OnWorldUnloaded() {
+    if ( PendingUploadDone.valid() ) {
+        PendingUploadDone.get();
+
+        for ( const UploadedMeshBuffers& buffers : PendingUpload->Buffers ) {
+            delete buffers.VertexBuffer;
+            delete buffers.IndexBuffer;
+#if ENABLE_TESSELATION > 0
+            delete buffers.IndexBufferPNAEN;
+#endif
+        }
+
+        delete PendingUpload->WrappedMesh;
+        PendingUpload.reset();
+    }
+
+    LogStatistics();
+
+    WrappedMeshOutdated = false;
+    AllSectionsResident = false;
+    NumResidentSections = 0;
+    NumSectionsUploaded = 0;
+    NumSectionsEvicted = 0;
+    PeakWorldUsage = 0;
+    PeakTotalUsage = 0;
+}
+
+/** Writes the peak video memory usage and the number of uploads since the world was loaded to the log */
+void WorldStreamer::LogStatistics() {
+    if ( !NumSectionsUploaded && !NumSectionsEvicted )
+        return;
+
+    LogInfoCh( LC_WORLD ) << "World streaming uploaded " << NumSectionsUploaded << " and evicted " << NumSectionsEvicted << " sections. Peak usage: "
+        << PeakWorldUsage / (1024 * 1024) << " MB world geometry, " << PeakTotalUsage / (1024 * 1024) << " MB in total";
+}
+
+/** Copies the statistics into the renderer info, for the frame stats */
+void WorldStreamer::UpdateRendererInfo() {
+    PeakWorldUsage = std::max( PeakWorldUsage, ResidencyManager::GetUsage( ResidencyManager::C_WORLD_GEOMETRY ) );
+    PeakTotalUsage = std::max( PeakTotalUsage, ResidencyManager::GetTotalUsage() );
+
+    GothicRendererInfo& info = Engine::GAPI->GetRendererState().RendererInfo;
+    info.WorldSectionsResident = static_cast<int>(NumResidentSections);
+    info.WorldSectionsUploaded = static_cast<int>(NumSectionsUploaded);
+    info.WorldSectionsEvicted = static_cast<int>(NumSectionsEvicted);
+    info.VideoMemoryWorldPeakMB = static_cast<int>(PeakWorldUsage / (1024 * 1024));
+    info.VideoMemoryTotalPeakMB = static_cast<int>(PeakTotalUsage / (1024 * 1024));
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "pch.h"
+
+struct WorldMeshSectionInfo;
+
+/** Keeps only the world sections around the camera in video memory. Sections further away keep their vertices and
+    indices on the CPU and are uploaded again by the worker threads once the camera comes closer. The wrapped world
+    mesh is rebuilt from the resident sections whenever they change. */
+class WorldStreamer {
+public:
+    /** Returns true if the world converter should leave the buffers of the sections to the streamer */
+    static bool IsEnabled();
+
+    /** Uploads and evicts sections around the camera. Called once per frame on the main thread. */
+    static void Update();
+
+    /** Waits for the upload in flight and drops its results. Must be called before the sections are deleted. */
+    static void OnWorldUnloaded();
+
+    /** Writes the peak video memory usage and the number of uploads since the world was loaded to the log */
+    static void LogStatistics();
+
+private:
+    /** Releases the video memory of the given section */
+    static void EvictSection( WorldMeshSectionInfo& section );
+
+    /** Starts a job creating the buffers of the given sections and the wrapped mesh of all resident ones */
+    static void StartUpload( const std::vector<WorldMeshSectionInfo*>& sectionsToUpload );
+
+    /** Hands the results of a finished job over to the sections */
+    static void FinishUpload();
+
+    /** Copies the statistics into the renderer info, for the frame stats */
+    static void UpdateRendererInfo();
+};
@@ -1,51 +1,143 @@
 #pragma once
 
-#include <chrono>
-#include <thread>
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <Windows.h>
+#include <intrin.h>
 
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+/** Frame pacing statistics over the last few seconds */
+struct FramePacingStats {
+	FramePacingStats() {
+		FrameTimeP50MS = 0;
+		FrameTimeP95MS = 0;
+		FrameTimeP99MS = 0;
+		JitterMS = 0;
+		PacingErrorMS = 0;
+		SpinPercent = 0;
+		SleepOvershootMS = 0;
+	}
+
+	float FrameTimeP50MS;
+	float FrameTimeP95MS;
+	float FrameTimeP99MS;
+
+	/** Average difference between two consecutive frame times */
+	float JitterMS;
+
+	/** Average distance between the end of the wait and the target on the timeline */
+	float PacingErrorMS;
+
+	/** Share of the frame time spent busy-waiting */
+	float SpinPercent;
+
+	/** Measured lateness of the sleep, which is covered by spinning */
+	float SleepOvershootMS;
+};
+
+/** Paces frames against an absolute timeline, so a late frame is made up by the next ones and the average rate
+	doesn't drift. Most of the wait sleeps on a high resolution waitable timer, only the calibrated overshoot of the
+	sleep plus a small margin is spun. */
 struct FpsLimiter {
 public:
 	FpsLimiter() {
-		m_frequency = 0;
-		m_counterStart = 0;
-		m_speedLimit = 0;
-		m_enabled = false;
 		m_fps = 0;
-		m_timeStart = 0;
+		m_enabled = false;
+		m_period = 0;
+		m_nextFrame = 0;
+		m_lastFrameEnd = 0;
+		m_overshootAvg = 0;
+		m_overshootDev = 0;
+		m_historyPos = 0;
+		m_historyCount = 0;
+		m_framesSinceStats = 0;
+		m_pacingErrorSum = 0;
+		m_spinSum = 0;
+		m_frameSum = 0;
+		m_pacedFrames = 0;
+
+		LARGE_INTEGER li;
+		QueryPerformanceFrequency(&li);
+		m_frequency = li.QuadPart;
+
+		// Only Windows 10 1803+ knows high resolution timers, the default one is bound to the timer period
+		m_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		m_highResolutionTimer = m_timer != nullptr;
+		if (!m_timer) {
+			m_timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+		}
+
+		// Start with a pessimistic guess, calibrated on the first waits
+		m_overshootAvg = m_highResolutionTimer ? 0.5 : 1.5;
+	}
+
+	~FpsLimiter() {
+		if (m_timer) {
+			CloseHandle(m_timer);
+		}
 	}
+
+	/** Starts pacing, if not already running */
 	void Start() {
-		m_timeStart = GetCounter();
-		m_enabled = true;
+		if (m_fps > 0) {
+			m_enabled = true;
+		}
 	}
+
+	/** Waits until the next frame is due on the timeline. Also records the frame time, even if not limiting. */
 	void Wait() {
-		using namespace std;
-		using namespace std::chrono;
+		__int64 spinTicks = 0;
+		__int64 now = GetCounter();
 
-		if (!m_enabled) {
-			return;
-		}
+		if (m_enabled) {
+			if (m_nextFrame == 0) {
+				m_nextFrame = now + m_period;
+			}
 
-		auto timeNow = GetCounter();
-		auto frameDuration = timeNow - m_timeStart;
-		if (frameDuration < m_speedLimit) {
-			auto waittime = m_speedLimit - frameDuration;
-			//if (true) {
-			if (waittime < 10) {
-				while (GetCounter() - timeNow < waittime) {}
+			if (now < m_nextFrame) {
+				// Sleep until shortly before the deadline
+				double sleepMS = TicksToMS(m_nextFrame - now) - GetSpinMarginMS();
+				if (sleepMS > 0.0 && m_timer) {
+					__int64 sleepStart = now;
+					LARGE_INTEGER dueTime;
+					dueTime.QuadPart = -static_cast<LONGLONG>(sleepMS * 10000.0); // Relative, in 100ns
+					if (SetWaitableTimer(m_timer, &dueTime, 0, nullptr, nullptr, FALSE)) {
+						WaitForSingleObject(m_timer, INFINITE);
+					}
+
+					now = GetCounter();
+					CalibrateOvershoot(TicksToMS(now - sleepStart) - sleepMS);
+				}
+
+				// Spin for the rest
+				__int64 spinStart = now;
+				while (now < m_nextFrame) {
+					_mm_pause();
+					now = GetCounter();
+				}
+				spinTicks = now - spinStart;
 			}
-			else {
-				std::this_thread::sleep_until(high_resolution_clock::now() + duration<int, milli>(((int)waittime / 10) * 10));
-				while (GetCounter() - timeNow < waittime) {}
+
+			m_pacingErrorSum += std::abs(TicksToMS(now - m_nextFrame));
+			m_pacedFrames++;
+
+			// Stay on the timeline, unless a hitch put us more than a frame behind
+			m_nextFrame += m_period;
+			if (m_nextFrame < now) {
+				m_nextFrame = now + m_period;
 			}
-			timeNow += waittime;
 		}
 
-		m_timeStart = timeNow;
+		RecordFrame(now, spinTicks);
 	}
 
 	void Reset() {
 		m_enabled = false;
+		m_nextFrame = 0;
 	}
 
 	int GetLimit() { return m_fps; }
@@ -54,34 +146,114 @@ public:
 		if (framerateLimit < MIN_FPS)
 			framerateLimit = MIN_FPS;
 
+		// Called every frame, only restart the timeline if the limit actually changed
+		if (static_cast<unsigned int>(framerateLimit) == m_fps)
+			return;
+
 		m_fps = framerateLimit;
-		m_enabled = framerateLimit > 0;
-		m_timeStart = 0;
-		if (m_enabled) {
-			m_speedLimit = 1000.0 / framerateLimit;
-			LARGE_INTEGER li;
+		m_period = m_frequency / framerateLimit;
+		m_nextFrame = 0;
+	}
 
-			QueryPerformanceFrequency(&li);
-			m_frequency = double(li.QuadPart) / 1000.0;
+	const FramePacingStats& GetStats() { return m_stats; }
 
-			QueryPerformanceCounter(&li);
-			m_counterStart = li.QuadPart;
+private:
+	static const int FRAME_HISTORY_SIZE = 256;
+	static const int FRAMES_PER_STATS_UPDATE = 60;
 
-			m_timeStart = GetCounter();
-		}
-	}
+	/** Spinning covers this much on top of the measured overshoot */
+	static constexpr double SPIN_SAFETY_MS = 0.5;
 
-private:
 	unsigned int m_fps;
 	bool m_enabled;
-	double m_speedLimit;
-	__int64 m_counterStart;
-	double m_timeStart;
-	double m_frequency;
+	bool m_highResolutionTimer;
+	HANDLE m_timer;
+	__int64 m_frequency;
+	__int64 m_period;
+	__int64 m_nextFrame;
+	__int64 m_lastFrameEnd;
+
+	double m_overshootAvg;
+	double m_overshootDev;
 
-	double GetCounter() {
+	std::array<float, FRAME_HISTORY_SIZE> m_frameTimes;
+	int m_historyPos;
+	int m_historyCount;
+	int m_framesSinceStats;
+	double m_pacingErrorSum;
+	double m_spinSum;
+	double m_frameSum;
+	int m_pacedFrames;
+	FramePacingStats m_stats;
+
+	__int64 GetCounter() {
 		LARGE_INTEGER li;
 		QueryPerformanceCounter(&li);
-		return double(li.QuadPart - m_counterStart) / m_frequency;
+		return li.QuadPart;
+	}
+
+	double TicksToMS(__int64 ticks) {
+		return static_cast<double>(ticks) * 1000.0 / static_cast<double>(m_frequency);
+	}
+
+	double GetSpinMarginMS() {
+		return m_overshootAvg + 2.0 * m_overshootDev + SPIN_SAFETY_MS;
+	}
+
+	/** Tracks how late the timer wakes us up, as moving average and deviation */
+	void CalibrateOvershoot(double overshootMS) {
+		const double alpha = 0.1;
+		overshootMS = std::max(overshootMS, 0.0);
+		m_overshootDev += alpha * (std::abs(overshootMS - m_overshootAvg) - m_overshootDev);
+		m_overshootAvg += alpha * (overshootMS - m_overshootAvg);
+	}
+
+	void RecordFrame(__int64 now, __int64 spinTicks) {
+		if (m_lastFrameEnd != 0) {
+			float frameMS = static_cast<float>(TicksToMS(now - m_lastFrameEnd));
+			m_frameTimes[m_historyPos] = frameMS;
+			m_historyPos = (m_historyPos + 1) % FRAME_HISTORY_SIZE;
+			m_historyCount = std::min(m_historyCount + 1, FRAME_HISTORY_SIZE);
+			m_spinSum += TicksToMS(spinTicks);
+			m_frameSum += frameMS;
+			m_framesSinceStats++;
+		}
+		m_lastFrameEnd = now;
+
+		if (m_framesSinceStats >= FRAMES_PER_STATS_UPDATE) {
+			UpdateStats();
+		}
+	}
+
+	void UpdateStats() {
+		// Oldest to newest, for the jitter
+		std::array<float, FRAME_HISTORY_SIZE> sorted;
+		int start = (m_historyPos - m_historyCount + FRAME_HISTORY_SIZE) % FRAME_HISTORY_SIZE;
+		double jitterSum = 0;
+		for (int i = 0; i < m_historyCount; i++) {
+			sorted[i] = m_frameTimes[(start + i) % FRAME_HISTORY_SIZE];
+			if (i > 0) {
+				jitterSum += std::abs(sorted[i] - sorted[i - 1]);
+			}
+		}
+		m_stats.JitterMS = m_historyCount > 1 ? static_cast<float>(jitterSum / (m_historyCount - 1)) : 0.0f;
+
+		std::sort(sorted.begin(), sorted.begin() + m_historyCount);
+		auto percentile = [&](float p) {
+			return sorted[std::min(m_historyCount - 1, static_cast<int>(p * m_historyCount))];
+		};
+		m_stats.FrameTimeP50MS = percentile(0.50f);
+		m_stats.FrameTimeP95MS = percentile(0.95f);
+		m_stats.FrameTimeP99MS = percentile(0.99f);
+
+		m_stats.SpinPercent = m_frameSum > 0 ? static_cast<float>(100.0 * m_spinSum / m_frameSum) : 0.0f;
+		m_stats.PacingErrorMS = m_pacedFrames > 0 ? static_cast<float>(m_pacingErrorSum / m_pacedFrames) : 0.0f;
+		m_stats.SleepOvershootMS = static_cast<float>(m_overshootAvg);
+
+		m_framesSinceStats = 0;
+		m_spinSum = 0;
+		m_frameSum = 0;
+		m_pacingErrorSum = 0;
+		m_pacedFrames = 0;
 	}
 };